@@ -0,0 +1,136 @@
+#ifndef BENCH_BST_BULKLOAD_HPP
+#define BENCH_BST_BULKLOAD_HPP
+
+#include "common_bst.hpp"
+
+/*
+ * Builds a tree from the (sorted) experiment nodes via build_from_sorted().
+ * Compare to the presorted insertion benchmarks (run_all_presorted) for
+ * the node-by-node baseline.
+ */
+struct BSTBulkLoadOptions : public DefaultBenchmarkOptions
+{
+	using MainRandomizer = DYN_GENERATOR;
+	constexpr static bool need_nodes = true;
+	using NodeRandomizer = DYN_GENERATOR;
+};
+
+/*
+ * Ygg's Red-Black Tree
+ */
+using BulkLoadYggRBBSTFixture =
+    BSTFixture<YggRBTreeInterface<BasicTreeOptions>, BulkLoadExperiment,
+               BSTBulkLoadOptions>;
+BENCHMARK_DEFINE_F(BulkLoadYggRBBSTFixture, BM_BST_BulkLoad)
+(benchmark::State & state)
+{
+	// The fixed nodes are not needed. Sorting the experiment nodes is only
+	// allowed as long as they are not in any tree.
+	this->t.clear();
+	std::sort(this->experiment_nodes.begin(), this->experiment_nodes.end());
+
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		this->t.build_from_sorted(this->experiment_nodes.begin(),
+		                          this->experiment_nodes.end());
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+
+		this->t.clear();
+	}
+
+	this->papi.report_and_reset(state);
+}
+REGISTER(BulkLoadYggRBBSTFixture, BM_BST_BulkLoad)
+
+/*
+ * Ygg's Weight-Balanced Tree
+ */
+using BulkLoadYggWBDefGDefDSPBSTFixture =
+    BSTFixture<YggWBTreeInterface<WBTSinglepassTreeOptions>, BulkLoadExperiment,
+               BSTBulkLoadOptions>;
+BENCHMARK_DEFINE_F(BulkLoadYggWBDefGDefDSPBSTFixture, BM_BST_BulkLoad)
+(benchmark::State & state)
+{
+	this->t.clear();
+	std::sort(this->experiment_nodes.begin(), this->experiment_nodes.end());
+
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		this->t.build_from_sorted(this->experiment_nodes.begin(),
+		                          this->experiment_nodes.end());
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+
+		this->t.clear();
+	}
+
+	this->papi.report_and_reset(state);
+}
+REGISTER(BulkLoadYggWBDefGDefDSPBSTFixture, BM_BST_BulkLoad)
+
+/*
+ * Ygg's Zip Tree, using randomness
+ */
+using BulkLoadYggZBSTFixture =
+    BSTFixture<YggZTreeInterface<ZRandomTreeOptions>, BulkLoadExperiment,
+               BSTBulkLoadOptions>;
+BENCHMARK_DEFINE_F(BulkLoadYggZBSTFixture, BM_BST_BulkLoad)
+(benchmark::State & state)
+{
+	this->t.clear();
+	std::sort(this->experiment_nodes.begin(), this->experiment_nodes.end());
+
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		this->t.build_from_sorted(this->experiment_nodes.begin(),
+		                          this->experiment_nodes.end());
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+
+		this->t.clear();
+	}
+
+	this->papi.report_and_reset(state);
+}
+REGISTER(BulkLoadYggZBSTFixture, BM_BST_BulkLoad)
+
+/*
+ * Ygg's Zip Tree, using hashing
+ */
+using BulkLoadYggZBSTFixtureHash =
+    BSTFixture<YggZTreeInterface<ZHashTreeOptions>, BulkLoadExperiment,
+               BSTBulkLoadOptions>;
+BENCHMARK_DEFINE_F(BulkLoadYggZBSTFixtureHash, BM_BST_BulkLoad)
+(benchmark::State & state)
+{
+	this->t.clear();
+	std::sort(this->experiment_nodes.begin(), this->experiment_nodes.end());
+
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		this->t.build_from_sorted(this->experiment_nodes.begin(),
+		                          this->experiment_nodes.end());
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+
+		this->t.clear();
+	}
+
+	this->papi.report_and_reset(state);
+}
+REGISTER(BulkLoadYggZBSTFixtureHash, BM_BST_BulkLoad)
+
+#ifndef NOMAIN
+#include "main.hpp"
+#endif
+
+#endif
@@ -464,6 +464,161 @@ BENCHMARK_DEFINE_F(MoveYggWB3G2DTPBSTFixture, BM_BST_Move)
 }
 REGISTER(MoveYggWB3G2DTPBSTFixture, BM_BST_Move)
 
+/*
+ * Ygg's Zip Tree, using randomness
+ */
+using MoveYggZBSTFixture =
+    BSTFixture<YggZTreeInterface<ZRandomTreeOptions>, MoveExperiment,
+               BSTMoveOptions>;
+BENCHMARK_DEFINE_F(MoveYggZBSTFixture, BM_BST_Move)
+(benchmark::State & state)
+{
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		for (size_t i = 0; i < this->experiment_node_pointers.size(); i++) {
+			auto * n = this->experiment_node_pointers[i];
+			auto new_val = this->experiment_values[i];
+
+			this->t.remove(*n);
+			NodeInterface::set_value(*n, new_val);
+			this->t.insert(*n);
+		}
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+
+		for (size_t i = 0; i < this->experiment_node_pointers.size(); i++) {
+			auto * n = this->experiment_node_pointers[i];
+			auto old_val = this->fixed_values[i];
+
+			this->t.remove(*n);
+			NodeInterface::set_value(*n, old_val);
+			this->t.insert(*n);
+		}
+	}
+
+	this->papi.report_and_reset(state);
+}
+REGISTER(MoveYggZBSTFixture, BM_BST_Move)
+
+/*
+ * Ygg's Red-Black Tree, moving via update_key(). Nodes that stay between
+ * their neighbors are not relinked, the others are re-inserted from their old
+ * position.
+ */
+using MoveUpdateKeyYggRBBSTFixture =
+    BSTFixture<YggRBTreeInterface<BasicTreeOptions>, MoveUpdateKeyExperiment,
+               BSTMoveOptions>;
+BENCHMARK_DEFINE_F(MoveUpdateKeyYggRBBSTFixture, BM_BST_Move)
+(benchmark::State & state)
+{
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		for (size_t i = 0; i < this->experiment_node_pointers.size(); i++) {
+			auto * n = this->experiment_node_pointers[i];
+			auto new_val = this->experiment_values[i];
+
+			this->t.update_key(*n, [new_val](auto & node) {
+				NodeInterface::set_value(node, new_val);
+			});
+		}
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+
+		for (size_t i = 0; i < this->experiment_node_pointers.size(); i++) {
+			auto * n = this->experiment_node_pointers[i];
+			auto old_val = this->fixed_values[i];
+
+			this->t.update_key(*n, [old_val](auto & node) {
+				NodeInterface::set_value(node, old_val);
+			});
+		}
+	}
+
+	this->papi.report_and_reset(state);
+}
+REGISTER(MoveUpdateKeyYggRBBSTFixture, BM_BST_Move)
+
+/*
+ * Ygg's Weight-Balanced Tree, default gamma, delta / single pass, moving via
+ * update_key()
+ */
+using MoveUpdateKeyYggWBDefGDefDSPBSTFixture =
+    BSTFixture<YggWBTreeInterface<WBTSinglepassTreeOptions>,
+               MoveUpdateKeyExperiment, BSTMoveOptions>;
+BENCHMARK_DEFINE_F(MoveUpdateKeyYggWBDefGDefDSPBSTFixture, BM_BST_Move)
+(benchmark::State & state)
+{
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		for (size_t i = 0; i < this->experiment_node_pointers.size(); i++) {
+			auto * n = this->experiment_node_pointers[i];
+			auto new_val = this->experiment_values[i];
+
+			this->t.update_key(*n, [new_val](auto & node) {
+				NodeInterface::set_value(node, new_val);
+			});
+		}
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+
+		for (size_t i = 0; i < this->experiment_node_pointers.size(); i++) {
+			auto * n = this->experiment_node_pointers[i];
+			auto old_val = this->fixed_values[i];
+
+			this->t.update_key(*n, [old_val](auto & node) {
+				NodeInterface::set_value(node, old_val);
+			});
+		}
+	}
+
+	this->papi.report_and_reset(state);
+}
+REGISTER(MoveUpdateKeyYggWBDefGDefDSPBSTFixture, BM_BST_Move)
+
+/*
+ * Ygg's Zip Tree, using randomness, moving via update_key()
+ */
+using MoveUpdateKeyYggZBSTFixture =
+    BSTFixture<YggZTreeInterface<ZRandomTreeOptions>, MoveUpdateKeyExperiment,
+               BSTMoveOptions>;
+BENCHMARK_DEFINE_F(MoveUpdateKeyYggZBSTFixture, BM_BST_Move)
+(benchmark::State & state)
+{
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		for (size_t i = 0; i < this->experiment_node_pointers.size(); i++) {
+			auto * n = this->experiment_node_pointers[i];
+			auto new_val = this->experiment_values[i];
+
+			this->t.update_key(*n, [new_val](auto & node) {
+				NodeInterface::set_value(node, new_val);
+			});
+		}
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+
+		for (size_t i = 0; i < this->experiment_node_pointers.size(); i++) {
+			auto * n = this->experiment_node_pointers[i];
+			auto old_val = this->fixed_values[i];
+
+			this->t.update_key(*n, [old_val](auto & node) {
+				NodeInterface::set_value(node, old_val);
+			});
+		}
+	}
+
+	this->papi.report_and_reset(state);
+}
+REGISTER(MoveUpdateKeyYggZBSTFixture, BM_BST_Move)
+
 #ifndef NOMAIN
 #include "main.hpp"
 #endif
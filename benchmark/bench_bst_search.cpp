@@ -9,6 +9,11 @@ struct BSTSearchOptions : public DefaultBenchmarkOptions
 	constexpr static bool need_values = true;
 	using ValueRandomizer = DYN_GENERATOR;
 	constexpr static bool values_from_fixed = true; // TODO take a percentage?
+
+#ifdef PRESORT
+	constexpr static bool values_presort = true;
+	constexpr static double values_presort_fraction = 0.5;
+#endif
 };
 
 // TODO search for values not in the tree?
@@ -342,6 +347,157 @@ BENCHMARK_DEFINE_F(SearchYggZBSTFixtureHash, BM_BST_Search)
 }
 REGISTER(SearchYggZBSTFixtureHash, BM_BST_Search)
 
+/*
+ * Ygg's Red-Black Tree, batched search
+ */
+using SearchBatchYggRBBSTFixture =
+    BSTFixture<YggRBTreeInterface<BasicTreeOptions>, SearchBatchExperiment,
+               BSTSearchOptions>;
+BENCHMARK_DEFINE_F(SearchBatchYggRBBSTFixture, BM_BST_Search)
+(benchmark::State & state)
+{
+	std::vector<decltype(this->t.end())> results(this->experiment_values.size());
+
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		this->t.find_batch(this->experiment_values.begin(),
+		                   this->experiment_values.end(), results.begin());
+		benchmark::DoNotOptimize(results.data());
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+	}
+	this->papi.report_and_reset(state);
+}
+REGISTER(SearchBatchYggRBBSTFixture, BM_BST_Search)
+
+/*
+ * Ygg's weight-balanced tree, default parameters, single-pass, batched search
+ */
+using SearchBatchYggWBDefSPBSTFixture =
+    BSTFixture<YggWBTreeInterface<WBTSinglepassTreeOptions>,
+               SearchBatchExperiment, BSTSearchOptions>;
+BENCHMARK_DEFINE_F(SearchBatchYggWBDefSPBSTFixture, BM_BST_Search)
+(benchmark::State & state)
+{
+	std::vector<decltype(this->t.end())> results(this->experiment_values.size());
+
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		this->t.find_batch(this->experiment_values.begin(),
+		                   this->experiment_values.end(), results.begin());
+		benchmark::DoNotOptimize(results.data());
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+	}
+	this->papi.report_and_reset(state);
+}
+REGISTER(SearchBatchYggWBDefSPBSTFixture, BM_BST_Search)
+
+/*
+ * Ygg's Zip Tree, using randomness, batched search
+ */
+using SearchBatchYggZBSTFixture =
+    BSTFixture<YggZTreeInterface<ZRandomTreeOptions>, SearchBatchExperiment,
+               BSTSearchOptions>;
+BENCHMARK_DEFINE_F(SearchBatchYggZBSTFixture, BM_BST_Search)
+(benchmark::State & state)
+{
+	std::vector<decltype(this->t.end())> results(this->experiment_values.size());
+
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		this->t.find_batch(this->experiment_values.begin(),
+		                   this->experiment_values.end(), results.begin());
+		benchmark::DoNotOptimize(results.data());
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+	}
+	this->papi.report_and_reset(state);
+}
+REGISTER(SearchBatchYggZBSTFixture, BM_BST_Search)
+
+/*
+ * Ygg's Red-Black Tree, hinted search. Every search starts at the result of the
+ * previous one, which pays off for the presorted values.
+ */
+using HintedSearchYggRBBSTFixture =
+    BSTFixture<YggRBTreeInterface<BasicTreeOptions>, HintedSearchExperiment,
+               BSTSearchOptions>;
+BENCHMARK_DEFINE_F(HintedSearchYggRBBSTFixture, BM_BST_Search)
+(benchmark::State & state)
+{
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		auto hint = this->t.end();
+		for (auto val : this->experiment_values) {
+			hint = this->t.lower_bound(val, hint);
+			benchmark::DoNotOptimize(hint);
+		}
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+	}
+	this->papi.report_and_reset(state);
+}
+REGISTER(HintedSearchYggRBBSTFixture, BM_BST_Search)
+
+/*
+ * Ygg's weight-balanced tree, default parameters, single-pass, hinted search
+ */
+using HintedSearchYggWBDefSPBSTFixture =
+    BSTFixture<YggWBTreeInterface<WBTSinglepassTreeOptions>,
+               HintedSearchExperiment, BSTSearchOptions>;
+BENCHMARK_DEFINE_F(HintedSearchYggWBDefSPBSTFixture, BM_BST_Search)
+(benchmark::State & state)
+{
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		auto hint = this->t.end();
+		for (auto val : this->experiment_values) {
+			hint = this->t.lower_bound(val, hint);
+			benchmark::DoNotOptimize(hint);
+		}
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+	}
+	this->papi.report_and_reset(state);
+}
+REGISTER(HintedSearchYggWBDefSPBSTFixture, BM_BST_Search)
+
+/*
+ * Ygg's Zip Tree, using randomness, hinted search
+ */
+using HintedSearchYggZBSTFixture =
+    BSTFixture<YggZTreeInterface<ZRandomTreeOptions>, HintedSearchExperiment,
+               BSTSearchOptions>;
+BENCHMARK_DEFINE_F(HintedSearchYggZBSTFixture, BM_BST_Search)
+(benchmark::State & state)
+{
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		auto hint = this->t.end();
+		for (auto val : this->experiment_values) {
+			hint = this->t.lower_bound(val, hint);
+			benchmark::DoNotOptimize(hint);
+		}
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+	}
+	this->papi.report_and_reset(state);
+}
+REGISTER(HintedSearchYggZBSTFixture, BM_BST_Search)
+
 /*
  * Boost::Intrusive::Set
  */
@@ -388,6 +544,44 @@ BENCHMARK_DEFINE_F(SearchStdSetBSTFixture, BM_BST_Search)
 }
 REGISTER(SearchStdSetBSTFixture, BM_BST_Search)
 
+/*
+ * Ygg's Red-Black Tree, searched via an Eytzinger-layout SearchSnapshot. The
+ * snapshot is built once, outside of the measurement.
+ */
+struct SnapshotValueGetter
+{
+	template <class Node>
+	static int
+	get_key(const Node & n)
+	{
+		return n.get_value();
+	}
+};
+
+using SnapshotSearchYggRBBSTFixture =
+    BSTFixture<YggRBTreeInterface<BasicTreeOptions>, SnapshotSearchExperiment,
+               BSTSearchOptions>;
+BENCHMARK_DEFINE_F(SnapshotSearchYggRBBSTFixture, BM_BST_Search)
+(benchmark::State & state)
+{
+	using Tree = typename YggRBTreeInterface<BasicTreeOptions>::Tree;
+	ygg::SearchSnapshot<Tree, SnapshotValueGetter> snapshot(this->t);
+
+	Clock c;
+	for (auto _ : state) {
+		c.start();
+		this->papi.start();
+		for (auto val : this->experiment_values) {
+			auto node = snapshot.find(val);
+			benchmark::DoNotOptimize(node);
+		}
+		this->papi.stop();
+		state.SetIterationTime(c.get());
+	}
+	this->papi.report_and_reset(state);
+}
+REGISTER(SnapshotSearchYggRBBSTFixture, BM_BST_Search)
+
 #ifndef NOMAIN
 #include "main.hpp"
 #endif
@@ -27,10 +27,22 @@ constexpr auto erase_experiment_c = BOOST_HANA_STRING("Erase");
 using EraseExperiment = decltype(erase_experiment_c);
 constexpr auto move_experiment_c = BOOST_HANA_STRING("Move");
 using MoveExperiment = decltype(move_experiment_c);
+constexpr auto move_update_key_experiment_c =
+    BOOST_HANA_STRING("MoveUpdateKey");
+using MoveUpdateKeyExperiment = decltype(move_update_key_experiment_c);
 constexpr auto insert_experiment_c = BOOST_HANA_STRING("Insert");
 using InsertExperiment = decltype(insert_experiment_c);
 constexpr auto search_experiment_c = BOOST_HANA_STRING("Search");
 using SearchExperiment = decltype(search_experiment_c);
+constexpr auto search_batch_experiment_c = BOOST_HANA_STRING("SearchBatch");
+using SearchBatchExperiment = decltype(search_batch_experiment_c);
+constexpr auto hinted_search_experiment_c = BOOST_HANA_STRING("HintedSearch");
+using HintedSearchExperiment = decltype(hinted_search_experiment_c);
+constexpr auto bulk_load_experiment_c = BOOST_HANA_STRING("BulkLoad");
+using BulkLoadExperiment = decltype(bulk_load_experiment_c);
+constexpr auto snapshot_search_experiment_c =
+    BOOST_HANA_STRING("SnapshotSearch");
+using SnapshotSearchExperiment = decltype(snapshot_search_experiment_c);
 
 std::vector<std::string> PAPI_MEASUREMENTS;
 bool PAPI_STATS_WRITTEN;
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <benchmark/benchmark.h>
 #include <boost/intrusive/set.hpp>
+#include <boost/iterator/indirect_iterator.hpp>
 #include <cstdlib>
 #include <draup.hpp>
 #include <functional>
@@ -87,11 +88,154 @@ struct UseSkewed
 	}
 };
 
-template <class T, class Compare = decltype(std::less<T>{})>
+/*
+ * Node storage
+ *
+ * By default, the fixtures keep their nodes in std::vectors, i.e., densely
+ * packed. Define SCATTER_NODES to allocate every node individually, with junk
+ * allocations in between (as they would be in a long-running program), or
+ * POOL_NODES to allocate them from a ygg::NodePool. The pool is backed by
+ * transparent huge pages, or by reserved huge pages if POOL_HUGETLB is
+ * defined.
+ */
+template <class Node>
+class ScatteredNodeAllocator {
+public:
+	template <class... Args>
+	Node *
+	create(Args &&... args)
+	{
+		// Replace random junk once we have enough of it, leaving holes behind
+		constexpr size_t max_junk = size_t{1} << 20;
+		if (this->junk.size() < max_junk) {
+			this->junk.emplace_back(new char[this->rng() % 512 + 1]);
+		} else {
+			this->junk[this->rng() % max_junk].reset(
+			    new char[this->rng() % 512 + 1]);
+		}
+
+		return new Node(std::forward<Args>(args)...);
+	}
+
+	void
+	destroy(Node * node)
+	{
+		delete node;
+	}
+
+private:
+	std::vector<std::unique_ptr<char[]>> junk;
+	std::mt19937 rng{42};
+};
+
+template <class Node>
+class PooledNodeAllocator {
+public:
+	template <class... Args>
+	Node *
+	create(Args &&... args)
+	{
+		return this->pool.create(std::forward<Args>(args)...);
+	}
+
+	void
+	destroy(Node * node)
+	{
+		this->pool.destroy(node);
+	}
+
+private:
+#ifdef POOL_HUGETLB
+	ygg::NodePool<Node> pool{ygg::NodePoolBacking::HUGETLB};
+#else
+	ygg::NodePool<Node> pool{ygg::NodePoolBacking::TRANSPARENT_HUGE_PAGES};
+#endif
+};
+
+/*
+ * Provides the parts of the std::vector interface that the fixtures use, but
+ * obtains every node from an Allocator.
+ */
+template <class Node, class Allocator>
+class IndirectNodeStorage {
+public:
+	using value_type = Node;
+	using iterator =
+	    boost::indirect_iterator<typename std::vector<Node *>::iterator>;
+
+	IndirectNodeStorage() = default;
+	IndirectNodeStorage(const IndirectNodeStorage &) = delete;
+	~IndirectNodeStorage() { this->clear(); }
+
+	template <class N>
+	void
+	push_back(N && node)
+	{
+		this->nodes.push_back(this->allocator.create(std::forward<N>(node)));
+	}
+
+	void
+	clear()
+	{
+		for (Node * n : this->nodes) {
+			this->allocator.destroy(n);
+		}
+		this->nodes.clear();
+	}
+
+	size_t
+	size() const noexcept
+	{
+		return this->nodes.size();
+	}
+
+	Node &
+	operator[](size_t i)
+	{
+		return *this->nodes[i];
+	}
+
+	Node * const *
+	data() const noexcept
+	{
+		return this->nodes.data();
+	}
+
+	iterator
+	begin()
+	{
+		return iterator(this->nodes.begin());
+	}
+
+	iterator
+	end()
+	{
+		return iterator(this->nodes.end());
+	}
+
+private:
+	std::vector<Node *> nodes;
+	Allocator allocator;
+};
+
+#if defined(SCATTER_NODES)
+template <class Node>
+using NodeStorage = IndirectNodeStorage<Node, ScatteredNodeAllocator<Node>>;
+#elif defined(POOL_NODES)
+template <class Node>
+using NodeStorage = IndirectNodeStorage<Node, PooledNodeAllocator<Node>>;
+#else
+template <class Node>
+using NodeStorage = std::vector<Node>;
+#endif
+
+template <class Container,
+          class Compare = std::less<typename Container::value_type>>
 void
-presort(std::vector<T> & v, size_t shuffle_count, size_t seed,
-        Compare cmp = std::less<T>{})
+presort(Container & v, size_t shuffle_count, size_t seed,
+        Compare cmp = Compare{})
 {
+	using T = typename Container::value_type;
 	std::mt19937 rng(seed);
 
 	std::sort(v.begin(), v.end(), cmp);
@@ -342,7 +486,7 @@ public:
 			if constexpr (Options::values_presort) {
 				size_t presort_count = static_cast<size_t>(std::floor(
 				    this->experiment_values.size() * Options::values_presort_fraction));
-				presort(this->fixed_values, presort_count, this->rng());
+				presort(this->experiment_values, presort_count, this->rng());
 			}
 		}
 	}
@@ -355,9 +499,9 @@ public:
 	}
 
 	std::vector<int> fixed_values;
-	std::vector<typename Interface::Node> fixed_nodes;
+	NodeStorage<typename Interface::Node> fixed_nodes;
 
-	std::vector<typename Interface::Node> experiment_nodes;
+	NodeStorage<typename Interface::Node> experiment_nodes;
 	std::vector<int> experiment_values;
 	std::vector<typename Interface::Node *> experiment_node_pointers;
 
@@ -668,7 +812,10 @@ public:
 	set_value(int new_value)
 	{
 		this->value = new_value;
-		this->update_rank();
+		// Random ranks do not depend on the value
+		if constexpr (MyTreeOptions::ztree_use_hash) {
+			this->update_rank();
+		}
 	}
 
 	int
@@ -735,6 +882,12 @@ public:
 		return n.get_value();
 	}
 
+	static void
+	set_value(Node & n, int val)
+	{
+		n.set_value(val);
+	}
+
 	static Node
 	create_node(int val)
 	{
@@ -129,6 +129,11 @@ using RandomRankTreeOptions =
                      ygg::TreeFlags::ZTREE_RANK_HASH_UNIVERSALIZE_MODUL<
                          std::numeric_limits<size_t>::max()>>;
 
+using ZipZipRankTreeOptions =
+    ygg::TreeOptions<ygg::TreeFlags::MULTIPLE,
+                     ygg::TreeFlags::ZTREE_RANK_TYPE<uint32_t>,
+                     ygg::TreeFlags::ZTREE_ZIPZIP_RANKS>;
+
 /* WBTree Options */
 using WBTTwopassTreeOptions = ygg::TreeOptions<ygg::TreeFlags::MULTIPLE>;
 using WBTSinglepassTreeOptions =
@@ -214,6 +219,12 @@ public:
 	size_t val;
 };
 
+class ZipZipTreeNode
+    : public ygg::ZTreeNodeBase<ZipZipTreeNode, ZipZipRankTreeOptions> {
+public:
+	size_t val;
+};
+
 bool
 operator<(const ZTreeNode & lhs, const ZTreeNode & rhs)
 {
@@ -226,6 +237,12 @@ operator<(const RandZTreeNode & lhs, const RandZTreeNode & rhs)
 	return lhs.val < rhs.val;
 }
 
+bool
+operator<(const ZipZipTreeNode & lhs, const ZipZipTreeNode & rhs)
+{
+	return lhs.val < rhs.val;
+}
+
 template <class T>
 struct type_container
 {
@@ -253,6 +270,11 @@ using RandZTree =
     ygg::ZTree<RandZTreeNode, ygg::ZTreeDefaultNodeTraits<RandZTreeNode>,
                RandomRankTreeOptions>;
 
+/* ZipZipTree */
+using ZipZipTree =
+    ygg::ZTree<ZipZipTreeNode, ygg::ZTreeDefaultNodeTraits<ZipZipTreeNode>,
+               ZipZipRankTreeOptions>;
+
 auto
 all_types()
 {
@@ -281,7 +303,12 @@ all_types()
 	    std::make_tuple(
 	        std::string("WBTree[SP|SuperBal]"),
 	        type_container<WBTree<WBTSinglepassSuperBalTreeOptions>>{},
-	        type_container<WBTreeNode<WBTSinglepassSuperBalTreeOptions>>{})
+	        type_container<WBTreeNode<WBTSinglepassSuperBalTreeOptions>>{}),
+	    std::make_tuple(std::string("ZTree[Rand]"), type_container<RandZTree>{},
+	                    type_container<RandZTreeNode>{}),
+	    std::make_tuple(std::string("ZTree[ZipZip]"),
+	                    type_container<ZipZipTree>{},
+	                    type_container<ZipZipTreeNode>{})
 
 	);
 }
@@ -0,0 +1,98 @@
+#include "../src/ygg.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/*
+ * Searches in a Red-Black Tree whose nodes are scattered across the heap (as
+ * they would be after a long series of allocations and deallocations), before
+ * and after the tree has been moved into van Emde Boas order via relayout().
+ */
+
+using RelayoutOptions = ygg::TreeOptions<ygg::TreeFlags::MULTIPLE>;
+
+class RelayoutNode : public ygg::RBTreeNodeBase<RelayoutNode, RelayoutOptions> {
+public:
+	int value;
+	// Pad the node to a full cache line
+	char payload[32];
+
+	RelayoutNode() : value(0) {}
+
+	bool
+	operator<(const RelayoutNode & rhs) const
+	{
+		return this->value < rhs.value;
+	}
+};
+
+bool
+operator<(const RelayoutNode & lhs, int rhs)
+{
+	return lhs.value < rhs;
+}
+bool
+operator<(int lhs, const RelayoutNode & rhs)
+{
+	return lhs < rhs.value;
+}
+
+using RelayoutTree =
+    ygg::RBTree<RelayoutNode, ygg::RBDefaultNodeTraits, RelayoutOptions>;
+
+template <bool relayout>
+static void
+BM_RBTree_Search(benchmark::State & state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::mt19937 rng(42);
+
+	// Allocate the nodes in a random order, with junk allocations in between
+	std::vector<std::unique_ptr<RelayoutNode>> nodes;
+	std::vector<std::unique_ptr<char[]>> junk;
+	for (size_t i = 0; i < count; ++i) {
+		nodes.emplace_back(new RelayoutNode());
+		junk.emplace_back(new char[rng() % 512 + 1]);
+	}
+	std::vector<int> values(count);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(), rng);
+
+	RelayoutTree t;
+	for (size_t i = 0; i < count; ++i) {
+		nodes[i]->value = values[i];
+		t.insert(*nodes[i]);
+	}
+
+	std::vector<RelayoutNode> arena;
+	if constexpr (relayout) {
+		arena.resize(count);
+		t.relayout(arena.data(), [](RelayoutNode &, RelayoutNode &) {});
+	}
+
+	std::vector<int> queries(1 << 16);
+	std::uniform_int_distribution<int> query_distr(0, static_cast<int>(count) -
+	                                                      1);
+	for (auto & q : queries) {
+		q = query_distr(rng);
+	}
+
+	for (auto _ : state) {
+		for (int q : queries) {
+			benchmark::DoNotOptimize(t.find(q));
+		}
+	}
+
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+	                        static_cast<int64_t>(queries.size()));
+}
+
+BENCHMARK_TEMPLATE(BM_RBTree_Search, false)->Range(1 << 12, 1 << 22);
+BENCHMARK_TEMPLATE(BM_RBTree_Search, true)->Range(1 << 12, 1 << 22);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,202 @@
+#include "../src/ygg.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+/*
+ * Multi-threaded mixed workload on one shared tree: Every thread searches for
+ * random keys and, after every FIND_PER_UPDATE searches, inserts or removes one
+ * of its own nodes. The tree is either a ShardedTree or a single RBTree guarded
+ * by a std::mutex. Compare the total throughput of both variants as the thread
+ * count increases.
+ */
+
+constexpr int KEY_SPACE = 1 << 20;
+constexpr size_t PREFILL = 1 << 16;
+constexpr size_t SHARDS = 32;
+constexpr size_t FIND_PER_UPDATE = 8;
+constexpr size_t PRIVATE_NODES = 1 << 10;
+
+using Options = ygg::TreeOptions<ygg::TreeFlags::MULTIPLE>;
+
+class Node : public ygg::RBTreeNodeBase<Node, Options> {
+public:
+	int key;
+
+	Node() : key(0) {}
+	explicit Node(int key_in) : key(key_in) {}
+};
+
+bool
+operator<(const Node & lhs, const Node & rhs)
+{
+	return lhs.key < rhs.key;
+}
+bool
+operator<(const Node & lhs, int rhs)
+{
+	return lhs.key < rhs;
+}
+bool
+operator<(int lhs, const Node & rhs)
+{
+	return lhs < rhs.key;
+}
+
+class KeyGetter {
+public:
+	static int
+	get_key(const Node & n)
+	{
+		return n.key;
+	}
+};
+
+using Tree = ygg::RBTree<Node, ygg::RBDefaultNodeTraits, Options>;
+
+class ShardedSet {
+public:
+	ShardedSet() : sharded(make_boundaries()) {}
+
+	void
+	insert(Node & n)
+	{
+		this->sharded.insert(n);
+	}
+	void
+	remove(Node & n)
+	{
+		this->sharded.remove(n);
+	}
+	bool
+	contains(int key)
+	{
+		return this->sharded.find(key) != nullptr;
+	}
+
+private:
+	ygg::ShardedTree<Tree, KeyGetter> sharded;
+
+	static std::vector<int>
+	make_boundaries()
+	{
+		std::vector<int> boundaries;
+		for (size_t i = 1; i < SHARDS; ++i) {
+			boundaries.push_back(static_cast<int>(i * (KEY_SPACE / SHARDS)));
+		}
+		return boundaries;
+	}
+};
+
+class MutexSet {
+public:
+	void
+	insert(Node & n)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->tree.insert(n);
+	}
+	void
+	remove(Node & n)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->tree.remove(n);
+	}
+	bool
+	contains(int key)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return this->tree.find(key) != this->tree.end();
+	}
+
+private:
+	Tree tree;
+	std::mutex mutex;
+};
+
+// Shared by all threads and all runs. The prefilled nodes are never removed.
+template <class Set>
+Set &
+get_fixture()
+{
+	static std::vector<Node> prefill_nodes;
+	static Set * set = []() {
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<int> key_dist(0, KEY_SPACE - 1);
+		prefill_nodes.reserve(PREFILL);
+		Set * s = new Set();
+		for (size_t i = 0; i < PREFILL; ++i) {
+			prefill_nodes.emplace_back(key_dist(rng));
+			s->insert(prefill_nodes.back());
+		}
+		return s;
+	}();
+	return *set;
+}
+
+template <class Set>
+static void
+BM_Parallel_Mixed(benchmark::State & state)
+{
+	Set & set = get_fixture<Set>();
+
+	std::mt19937 rng(static_cast<unsigned>(state.thread_index()));
+	std::uniform_int_distribution<int> key_dist(0, KEY_SPACE - 1);
+	std::vector<Node> own_nodes;
+	own_nodes.reserve(PRIVATE_NODES);
+	for (size_t i = 0; i < PRIVATE_NODES; ++i) {
+		own_nodes.emplace_back(key_dist(rng));
+	}
+	std::vector<int> queries(PRIVATE_NODES * FIND_PER_UPDATE);
+	for (auto & q : queries) {
+		q = key_dist(rng);
+	}
+
+	size_t query_index = 0;
+	size_t update_index = 0;
+	size_t inserted = 0;
+	for (auto _ : state) {
+		for (size_t i = 0; i < FIND_PER_UPDATE; ++i) {
+			benchmark::DoNotOptimize(set.contains(queries[query_index]));
+			query_index = (query_index + 1) % queries.size();
+		}
+
+		// Insert all own nodes, then remove them again
+		if (inserted < PRIVATE_NODES) {
+			set.insert(own_nodes[update_index]);
+			++inserted;
+		} else {
+			set.remove(own_nodes[update_index]);
+			if (update_index + 1 == PRIVATE_NODES) {
+				inserted = 0;
+			}
+		}
+		update_index = (update_index + 1) % PRIVATE_NODES;
+	}
+
+	// The next run must find the set as it was prefilled
+	if (inserted < PRIVATE_NODES) {
+		for (size_t i = 0; i < inserted; ++i) {
+			set.remove(own_nodes[i]);
+		}
+	} else {
+		for (size_t i = update_index; i < PRIVATE_NODES; ++i) {
+			set.remove(own_nodes[i]);
+		}
+	}
+
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+	                        static_cast<int64_t>(FIND_PER_UPDATE + 1));
+}
+
+BENCHMARK_TEMPLATE(BM_Parallel_Mixed, MutexSet)
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Parallel_Mixed, ShardedSet)
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,90 @@
+#include "../src/ygg.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/*
+ * Multi-threaded Zip Tree insertion. Every thread owns a separate tree and
+ * separate nodes, so the threads share no data. Nodes are re-randomized right
+ * before being inserted, as one would do when reusing nodes. With std::rand()
+ * ranks, the threads contend on the C library's generator state. Compare the
+ * per-thread throughput of both variants as the thread count increases.
+ */
+
+using ZRandRankOptions =
+    ygg::TreeOptions<ygg::TreeFlags::MULTIPLE,
+                     ygg::TreeFlags::ZTREE_RANK_TYPE<std::uint8_t>>;
+using ZFastRankOptions =
+    ygg::TreeOptions<ygg::TreeFlags::MULTIPLE,
+                     ygg::TreeFlags::ZTREE_RANK_TYPE<std::uint8_t>,
+                     ygg::TreeFlags::ZTREE_FAST_RANDOM_RANKS>;
+
+template <class MyTreeOptions>
+class ParallelZipNode
+    : public ygg::ZTreeNodeBase<ParallelZipNode<MyTreeOptions>, MyTreeOptions> {
+public:
+	int value;
+
+	ParallelZipNode() : value(0) {}
+
+	void
+	rerandomize()
+	{
+		this->update_rank();
+	}
+
+	bool
+	operator<(const ParallelZipNode<MyTreeOptions> & rhs) const
+	{
+		return this->value < rhs.value;
+	}
+};
+
+template <class MyTreeOptions>
+static void
+BM_ZTree_ParallelInsertion(benchmark::State & state)
+{
+	using Node = ParallelZipNode<MyTreeOptions>;
+	using Tree =
+	    ygg::ZTree<Node, ygg::ZTreeDefaultNodeTraits<Node>, MyTreeOptions>;
+
+	const size_t count = static_cast<size_t>(state.range(0));
+	std::vector<Node> nodes(count);
+	std::vector<int> values(count);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(),
+	             std::mt19937(static_cast<unsigned>(state.thread_index())));
+	for (size_t i = 0; i < count; ++i) {
+		nodes[i].value = values[i];
+	}
+
+	Tree t;
+	for (auto _ : state) {
+		for (auto & n : nodes) {
+			n.rerandomize();
+			t.insert(n);
+		}
+
+		state.PauseTiming();
+		t.clear();
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+	                        static_cast<int64_t>(count));
+}
+
+BENCHMARK_TEMPLATE(BM_ZTree_ParallelInsertion, ZRandRankOptions)
+    ->Arg(1 << 14)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ZTree_ParallelInsertion, ZFastRankOptions)
+    ->Arg(1 << 14)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,281 @@
+#ifndef YGG_AUGMENTATION_CPP
+#define YGG_AUGMENTATION_CPP
+
+#include "augmentation.hpp"
+
+namespace ygg {
+
+template <class Monoid, class Tag>
+const typename Monoid::value_type &
+AugmentedNodeBase<Monoid, Tag>::get_aggregate() const noexcept
+{
+	return this->_aug_aggregate;
+}
+
+namespace augmentation_internal {
+
+template <class Node, class NB, class Monoid, class Tag>
+typename Monoid::value_type
+AugmentationOps<Node, NB, Monoid, Tag>::aggregate_of(const Node * node)
+{
+	if (node == nullptr) {
+		return Monoid::identity();
+	}
+	return node->ANB::_aug_aggregate;
+}
+
+template <class Node, class NB, class Monoid, class Tag>
+void
+AugmentationOps<Node, NB, Monoid, Tag>::recompute(Node & node,
+                                                  const Node * excluded)
+{
+	const Node * left = node.NB::get_left();
+	const Node * right = node.NB::get_right();
+	if (left == excluded) {
+		left = nullptr;
+	}
+	if (right == excluded) {
+		right = nullptr;
+	}
+
+	node.ANB::_aug_aggregate = Monoid::combine(
+	    Monoid::combine(aggregate_of(left), Monoid::get_value(node)),
+	    aggregate_of(right));
+}
+
+template <class Node, class NB, class Monoid, class Tag>
+void
+AugmentationOps<Node, NB, Monoid, Tag>::recompute_to_root(Node * node,
+                                                          const Node * excluded)
+{
+	while (node != nullptr) {
+		recompute(*node, excluded);
+		node = node->NB::get_parent();
+	}
+}
+
+template <class Monoid, class Tag, class BaseTraits>
+template <class Node, class Tree>
+void
+BSTAugmentedNodeTraits<Monoid, Tag, BaseTraits>::leaf_inserted(Node & node,
+                                                               Tree & t)
+{
+	BaseTraits::leaf_inserted(node, t);
+	Ops<Node, Tree>::recompute_to_root(&node);
+}
+
+template <class Monoid, class Tag, class BaseTraits>
+template <class Node, class Tree>
+void
+BSTAugmentedNodeTraits<Monoid, Tag, BaseTraits>::rotated_left(Node & node,
+                                                              Tree & t)
+{
+	BaseTraits::rotated_left(node, t);
+
+	// <node> is the old parent. The set of nodes below the new parent did not
+	// change, so the ancestors are still correct.
+	using NB = typename Tree::NB;
+	Ops<Node, Tree>::recompute(node);
+	Ops<Node, Tree>::recompute(*node.NB::get_parent());
+}
+
+template <class Monoid, class Tag, class BaseTraits>
+template <class Node, class Tree>
+void
+BSTAugmentedNodeTraits<Monoid, Tag, BaseTraits>::rotated_right(Node & node,
+                                                               Tree & t)
+{
+	BaseTraits::rotated_right(node, t);
+
+	using NB = typename Tree::NB;
+	Ops<Node, Tree>::recompute(node);
+	Ops<Node, Tree>::recompute(*node.NB::get_parent());
+}
+
+template <class Monoid, class Tag, class BaseTraits>
+template <class Node, class Tree>
+void
+BSTAugmentedNodeTraits<Monoid, Tag, BaseTraits>::deleted_below(Node & node,
+                                                               Tree & t)
+{
+	BaseTraits::deleted_below(node, t);
+	Ops<Node, Tree>::recompute_to_root(&node);
+}
+
+template <class Monoid, class Tag, class BaseTraits>
+template <class Node, class Tree>
+void
+BSTAugmentedNodeTraits<Monoid, Tag, BaseTraits>::swapped(
+    Node & old_ancestor, Node & old_descendant, Tree & t)
+{
+	BaseTraits::swapped(old_ancestor, old_descendant, t);
+
+	// <old_ancestor> is now the lower one of both nodes, so walking up from it
+	// passes <old_descendant> if they were related.
+	Ops<Node, Tree>::recompute_to_root(&old_ancestor);
+	Ops<Node, Tree>::recompute_to_root(&old_descendant);
+}
+
+template <class Monoid, class Tag, class BaseTraits>
+template <class Node, class Tree>
+void
+BSTAugmentedNodeTraits<Monoid, Tag, BaseTraits>::children_changed(Node & node,
+                                                                  Tree & t)
+{
+	BaseTraits::children_changed(node, t);
+
+	// Nodes are visited bottom-up, no need to propagate upwards.
+	Ops<Node, Tree>::recompute(node);
+}
+
+} // namespace augmentation_internal
+
+template <class Node, class Options, class Monoid, class Tag,
+          class BaseTraits>
+void
+ZAugmentedNodeTraits<Node, Options, Monoid, Tag,
+                     BaseTraits>::delete_without_zipping(Node * to_be_deleted)
+{
+	BaseTraits::delete_without_zipping(to_be_deleted);
+
+	// This is called before the node is unlinked.
+	Ops::recompute_to_root(
+	    to_be_deleted->ZTreeNodeBase<Node, Options, Tag>::get_parent(),
+	    to_be_deleted);
+}
+
+template <class Node, class Options, class Monoid, class Tag,
+          class BaseTraits>
+void
+ZAugmentedNodeTraits<Node, Options, Monoid, Tag, BaseTraits>::zipping_done(
+    Node * head, Node * tail)
+{
+	BaseTraits::zipping_done(head, tail);
+
+	// All nodes with changed children are on the path from <tail> upwards
+	Ops::recompute_to_root(tail);
+}
+
+template <class Node, class Options, class Monoid, class Tag,
+          class BaseTraits>
+void
+ZAugmentedNodeTraits<Node, Options, Monoid, Tag, BaseTraits>::unzip_done(
+    Node * unzip_root, Node * left_spine_end, Node * right_spine_end)
+{
+	BaseTraits::unzip_done(unzip_root, left_spine_end, right_spine_end);
+
+	using NB = ZTreeNodeBase<Node, Options, Tag>;
+	// Fix both spines bottom-up, then everything above the inserted node
+	for (Node * cur = left_spine_end; cur != unzip_root;
+	     cur = cur->NB::get_parent()) {
+		Ops::recompute(*cur);
+	}
+	for (Node * cur = right_spine_end; cur != unzip_root;
+	     cur = cur->NB::get_parent()) {
+		Ops::recompute(*cur);
+	}
+	Ops::recompute_to_root(unzip_root);
+}
+
+template <class Node, class Options, class Monoid, class Tag,
+          class BaseTraits>
+void
+ZAugmentedNodeTraits<Node, Options, Monoid, Tag,
+                     BaseTraits>::inserted_without_unzipping(Node * node)
+{
+	BaseTraits::inserted_without_unzipping(node);
+	Ops::recompute_to_root(node);
+}
+
+template <class Node, class Options, class Monoid, class Tag,
+          class BaseTraits>
+void
+ZAugmentedNodeTraits<Node, Options, Monoid, Tag, BaseTraits>::children_changed(
+    Node * node)
+{
+	BaseTraits::children_changed(node);
+
+	// Nodes are visited bottom-up, no need to propagate upwards.
+	Ops::recompute(*node);
+}
+
+template <class Tree, class Monoid, class Tag>
+Aggregator<Tree, Monoid, Tag>::Aggregator(Tree & tree_in) noexcept
+    : tree(tree_in)
+{}
+
+template <class Tree, class Monoid, class Tag>
+template <class Comparable1, class Comparable2>
+typename Monoid::value_type
+Aggregator<Tree, Monoid, Tag>::aggregate(const Comparable1 & lo,
+                                         const Comparable2 & hi) const
+{
+	// Find the topmost node in [lo, hi). All other nodes in the range are
+	// below it.
+	Node * fork = this->tree.get_root();
+	while (fork != nullptr) {
+		if (this->cmp(*fork, lo)) {
+			fork = fork->NB::get_right();
+		} else if (!this->cmp(*fork, hi)) {
+			fork = fork->NB::get_left();
+		} else {
+			break;
+		}
+	}
+
+	if (fork == nullptr) {
+		return Monoid::identity();
+	}
+
+	// In the left subtree, collect every node not less than lo together with
+	// its right subtree.
+	value_type left_acc = Monoid::identity();
+	Node * cur = fork->NB::get_left();
+	while (cur != nullptr) {
+		if (!this->cmp(*cur, lo)) {
+			left_acc = Monoid::combine(
+			    Monoid::combine(Monoid::get_value(*cur),
+			                    Ops::aggregate_of(cur->NB::get_right())),
+			    left_acc);
+			cur = cur->NB::get_left();
+		} else {
+			cur = cur->NB::get_right();
+		}
+	}
+
+	// In the right subtree, collect every node less than hi together with its
+	// left subtree.
+	value_type right_acc = Monoid::identity();
+	cur = fork->NB::get_right();
+	while (cur != nullptr) {
+		if (this->cmp(*cur, hi)) {
+			right_acc = Monoid::combine(
+			    right_acc, Monoid::combine(Ops::aggregate_of(cur->NB::get_left()),
+			                               Monoid::get_value(*cur)));
+			cur = cur->NB::get_right();
+		} else {
+			cur = cur->NB::get_left();
+		}
+	}
+
+	return Monoid::combine(Monoid::combine(left_acc, Monoid::get_value(*fork)),
+	                       right_acc);
+}
+
+template <class Tree, class Monoid, class Tag>
+typename Monoid::value_type
+Aggregator<Tree, Monoid, Tag>::total() const
+{
+	return Ops::aggregate_of(this->tree.get_root());
+}
+
+template <class Tree, class Monoid, class Tag>
+void
+Aggregator<Tree, Monoid, Tag>::refresh(Node & node)
+{
+	Ops::recompute_to_root(&node);
+}
+
+} // namespace ygg
+
+#endif // YGG_AUGMENTATION_CPP
@@ -0,0 +1,240 @@
+#ifndef YGG_AUGMENTATION_HPP
+#define YGG_AUGMENTATION_HPP
+
+#include "rbtree.hpp"
+#include "util.hpp"
+#include "wbtree.hpp"
+#include "ziptree.hpp"
+
+#include <type_traits>
+
+namespace ygg {
+
+/**
+ * @brief Base class for nodes that carry an aggregate of their subtree
+ *
+ * Derive your node class from this class (in addition to the node base of
+ * your tree) to have the tree maintain, at every node, the aggregate of all
+ * values in the subtree below (and including) that node. The aggregate is
+ * defined by a monoid, i.e., a class that must provide:
+ *
+ * - a type value_type,
+ * - a static method value_type identity() returning the neutral element,
+ * - a static method value_type combine(const value_type & lhs, const
+ * value_type & rhs) that is associative, and
+ * - a static template method value_type get_value(const Node &) that
+ * extracts the value of a single node.
+ *
+ * combine() need not be commutative: Aggregates are always combined in
+ * ascending order of the nodes.
+ *
+ * The aggregates are maintained by the tree if you use RBAugmentedNodeTraits,
+ * WBAugmentedNodeTraits or ZAugmentedNodeTraits as node traits. Use an
+ * Aggregator to query them.
+ *
+ * @tparam Monoid The monoid defining the aggregate, see above
+ * @tparam Tag    The tag of the tree the aggregate belongs to. Only needed if
+ * the same node is in multiple augmented trees.
+ */
+template <class Monoid, class Tag = int>
+class AugmentedNodeBase {
+public:
+	/// @cond INTERNAL
+	typename Monoid::value_type _aug_aggregate;
+	/// @endcond
+
+	/**
+	 * @brief Returns the aggregate of the subtree rooted at this node
+	 *
+	 * @return The aggregate of the subtree rooted at this node
+	 */
+	const typename Monoid::value_type & get_aggregate() const noexcept;
+};
+
+/// @cond INTERNAL
+namespace augmentation_internal {
+
+template <class Node, class NB, class Monoid, class Tag>
+class AugmentationOps {
+public:
+	using ANB = AugmentedNodeBase<Monoid, Tag>;
+	using value_type = typename Monoid::value_type;
+
+	static value_type aggregate_of(const Node * node);
+
+	// <excluded> is treated as if it had already been removed from the tree
+	static void recompute(Node & node, const Node * excluded = nullptr);
+	static void recompute_to_root(Node * node,
+	                              const Node * excluded = nullptr);
+};
+
+template <class Monoid, class Tag, class BaseTraits>
+class BSTAugmentedNodeTraits : public BaseTraits {
+public:
+	template <class Node, class Tree>
+	using Ops =
+	    AugmentationOps<Node, typename Tree::NB, Monoid, Tag>;
+
+	template <class Node, class Tree>
+	static void leaf_inserted(Node & node, Tree & t);
+	template <class Node, class Tree>
+	static void rotated_left(Node & node, Tree & t);
+	template <class Node, class Tree>
+	static void rotated_right(Node & node, Tree & t);
+	template <class Node, class Tree>
+	static void deleted_below(Node & node, Tree & t);
+	template <class Node, class Tree>
+	static void swapped(Node & old_ancestor, Node & old_descendant, Tree & t);
+	template <class Node, class Tree>
+	static void children_changed(Node & node, Tree & t);
+};
+
+} // namespace augmentation_internal
+/// @endcond
+
+/**
+ * @brief Node traits that maintain the aggregates of an RBTree
+ *
+ * Use these as NodeTraits of your RBTree to maintain the aggregates of an
+ * AugmentedNodeBase. If you need callbacks of your own, pass your node traits
+ * as BaseTraits. They will be called before the aggregates are updated.
+ *
+ * @tparam Monoid     The monoid defining the aggregate, see AugmentedNodeBase
+ * @tparam Tag        The tag of the AugmentedNodeBase
+ * @tparam BaseTraits Node traits whose callbacks should be called, too
+ */
+template <class Monoid, class Tag = int,
+          class BaseTraits = RBDefaultNodeTraits>
+using RBAugmentedNodeTraits =
+    augmentation_internal::BSTAugmentedNodeTraits<Monoid, Tag, BaseTraits>;
+
+/**
+ * @brief Node traits that maintain the aggregates of a WBTree
+ *
+ * Use these as NodeTraits of your WBTree to maintain the aggregates of an
+ * AugmentedNodeBase. If you need callbacks of your own, pass your node traits
+ * as BaseTraits. They will be called before the aggregates are updated.
+ *
+ * @tparam Monoid     The monoid defining the aggregate, see AugmentedNodeBase
+ * @tparam Tag        The tag of the AugmentedNodeBase
+ * @tparam BaseTraits Node traits whose callbacks should be called, too
+ */
+template <class Monoid, class Tag = int,
+          class BaseTraits = WBDefaultNodeTraits>
+using WBAugmentedNodeTraits =
+    augmentation_internal::BSTAugmentedNodeTraits<Monoid, Tag, BaseTraits>;
+
+/**
+ * @brief Node traits that maintain the aggregates of a ZTree
+ *
+ * Use these as NodeTraits of your ZTree to maintain the aggregates of an
+ * AugmentedNodeBase. If you need callbacks of your own, pass your node traits
+ * as BaseTraits. They will be called before the aggregates are updated.
+ *
+ * @warning The aggregates are updated by walking up from the modified nodes,
+ * thus the ZTree must not have the NO_PARENT_POINTERS option set.
+ *
+ * @tparam Node       The node class of your ZTree
+ * @tparam Options    The options of your ZTree
+ * @tparam Monoid     The monoid defining the aggregate, see AugmentedNodeBase
+ * @tparam Tag        The tag of the AugmentedNodeBase. Must be the tag of the
+ * ZTree, too.
+ * @tparam BaseTraits Node traits whose callbacks should be called, too
+ */
+template <class Node, class Options, class Monoid, class Tag = int,
+          class BaseTraits = ZTreeDefaultNodeTraits<Node>>
+class ZAugmentedNodeTraits : public BaseTraits {
+public:
+	static_assert(!Options::no_parent_pointers,
+	              "Augmented ZTrees need parent pointers.");
+
+	/// @cond INTERNAL
+	using Ops = augmentation_internal::AugmentationOps<
+	    Node, ZTreeNodeBase<Node, Options, Tag>, Monoid, Tag>;
+
+	void delete_without_zipping(Node * to_be_deleted);
+	void zipping_done(Node * head, Node * tail);
+	void unzip_done(Node * unzip_root, Node * left_spine_end,
+	                Node * right_spine_end);
+	void inserted_without_unzipping(Node * node);
+	void children_changed(Node * node);
+	/// @endcond
+};
+
+/**
+ * @brief Queries the aggregates maintained in an augmented tree
+ *
+ * An Aggregator answers queries for the aggregate of all nodes in a range of
+ * keys in O(log n), using the aggregates that the tree maintains at its
+ * nodes. The tree must use RBAugmentedNodeTraits, WBAugmentedNodeTraits or
+ * ZAugmentedNodeTraits with the same Monoid and Tag.
+ *
+ * The aggregator does not store any data except for a reference to the tree,
+ * so it can be created and thrown away at will.
+ *
+ * @tparam Tree   The type of the augmented tree
+ * @tparam Monoid The monoid defining the aggregate, see AugmentedNodeBase
+ * @tparam Tag    The tag of the AugmentedNodeBase
+ */
+template <class Tree, class Monoid, class Tag = int>
+class Aggregator {
+public:
+	/// @cond INTERNAL
+	using Node = typename Tree::NodeT;
+	using NB = typename Tree::NB;
+	using Ops = augmentation_internal::AugmentationOps<Node, NB, Monoid, Tag>;
+	/// @endcond
+	using value_type = typename Monoid::value_type;
+
+	/**
+	 * @brief Create an aggregator for a tree
+	 *
+	 * @param tree The augmented tree to query
+	 */
+	explicit Aggregator(Tree & tree) noexcept;
+
+	/**
+	 * @brief Returns the aggregate of all nodes in [lo, hi)
+	 *
+	 * Combines the values of all nodes that are not less than lo and less than
+	 * hi, in ascending order. Returns Monoid::identity() if there are no such
+	 * nodes. This runs in O(log n).
+	 *
+	 * @param lo The lower bound of the range (inclusive)
+	 * @param hi The upper bound of the range (exclusive)
+	 * @return The aggregate of all nodes in the range
+	 */
+	template <class Comparable1, class Comparable2>
+	value_type aggregate(const Comparable1 & lo, const Comparable2 & hi) const;
+
+	/**
+	 * @brief Returns the aggregate of all nodes in the tree
+	 *
+	 * This runs in O(1).
+	 *
+	 * @return The aggregate of all nodes in the tree
+	 */
+	value_type total() const;
+
+	/**
+	 * @brief Update the aggregates after the value of a node has changed
+	 *
+	 * The tree can not notice if you change the value of a node that is in
+	 * the tree (this includes keys changed via update_key() if the node stays
+	 * in place). Call this afterwards to fix the aggregates of the node and
+	 * all of its ancestors. This runs in O(log n).
+	 *
+	 * @param node The node whose value has changed
+	 */
+	void refresh(Node & node);
+
+private:
+	Tree & tree;
+	typename Tree::CompareT cmp;
+};
+
+} // namespace ygg
+
+#include "augmentation.cpp"
+
+#endif // YGG_AUGMENTATION_HPP
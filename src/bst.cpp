@@ -29,6 +29,153 @@ DefaultParentContainer<Node>::set_parent(Node * parent) noexcept
 	this->_bst_parent = parent;
 }
 
+template <class Node, class Options>
+std::uint32_t
+RelativeLink<Node, Options>::to_index(Node * node) noexcept
+{
+	if (node == nullptr) {
+		return null_index;
+	}
+	std::ptrdiff_t index = node - static_cast<Node *>(Pool::get_base());
+	// The largest index is reserved for nullptr
+	assert((index >= 0) && (static_cast<std::uint64_t>(index) < null_index));
+	return static_cast<std::uint32_t>(index);
+}
+
+template <class Node, class Options>
+Node *
+RelativeLink<Node, Options>::from_index(std::uint32_t index_in) noexcept
+{
+	if (index_in == null_index) {
+		return nullptr;
+	}
+	return static_cast<Node *>(Pool::get_base()) + index_in;
+}
+
+template <class Node, class Options>
+RelativeLink<Node, Options>::RelativeLink(Node * node) noexcept
+    : index(to_index(node))
+{}
+
+template <class Node, class Options>
+RelativeLink<Node, Options> &
+RelativeLink<Node, Options>::operator=(Node * node) noexcept
+{
+	this->index = to_index(node);
+	return *this;
+}
+
+template <class Node, class Options>
+RelativeLink<Node, Options>::operator Node *() const noexcept
+{
+	return from_index(this->index);
+}
+
+template <class Node, class Options>
+Node *
+RelativeLink<Node, Options>::operator->() const noexcept
+{
+	return from_index(this->index);
+}
+
+template <class Node, class Options>
+Node &
+RelativeLink<Node, Options>::operator*() const noexcept
+{
+	return *from_index(this->index);
+}
+
+template <class Node, class Options>
+Node *
+RelativeParentContainer<Node, Options>::get_parent() const noexcept
+{
+	return this->_bst_parent;
+}
+
+template <class Node, class Options>
+void
+RelativeParentContainer<Node, Options>::set_parent(Node * parent) noexcept
+{
+	this->_bst_parent = parent;
+}
+
+template <class Node>
+void
+NoParentContainer<Node>::set_parent(Node * parent) noexcept
+{
+	(void)parent;
+}
+
+template <class Node, class Options>
+Node *
+ThreadContainer<Node, Options>::get_prev() const noexcept
+{
+	return this->_bst_prev;
+}
+
+template <class Node, class Options>
+Node *
+ThreadContainer<Node, Options>::get_next() const noexcept
+{
+	return this->_bst_next;
+}
+
+template <class Node, class Options>
+void
+ThreadContainer<Node, Options>::set_prev(Node * prev) noexcept
+{
+	this->_bst_prev = prev;
+}
+
+template <class Node, class Options>
+void
+ThreadContainer<Node, Options>::set_next(Node * next) noexcept
+{
+	this->_bst_next = next;
+}
+
+template <class Node, class Options>
+Node *
+DuplicateContainer<Node, Options>::get_prev() const noexcept
+{
+	return this->_bst_dup_prev;
+}
+
+template <class Node, class Options>
+Node *
+DuplicateContainer<Node, Options>::get_next() const noexcept
+{
+	return this->_bst_dup_next;
+}
+
+template <class Node, class Options>
+size_t
+DuplicateContainer<Node, Options>::get_count() const noexcept
+{
+	return this->_bst_dup_count;
+}
+
+template <class Node, class Options>
+void
+DuplicateContainer<Node, Options>::set_prev(Node * prev) noexcept
+{
+	this->_bst_dup_prev = prev;
+}
+
+template <class Node, class Options>
+void
+DuplicateContainer<Node, Options>::set_next(Node * next) noexcept
+{
+	this->_bst_dup_next = next;
+}
+
+template <class Node, class Options>
+void
+DuplicateContainer<Node, Options>::set_count(size_t count) noexcept
+{
+	this->_bst_dup_count = count;
+}
+
 template <class Node, class Options, class Tag, class ParentContainer>
 size_t
 BSTNodeBase<Node, Options, Tag, ParentContainer>::get_depth() const noexcept
@@ -66,7 +213,7 @@ BSTNodeBase<Node, Options, Tag, ParentContainer>::get_parent() const noexcept
 }
 
 template <class Node, class Options, class Tag, class ParentContainer>
-Node *&
+typename BSTNodeBase<Node, Options, Tag, ParentContainer>::Link &
 BSTNodeBase<Node, Options, Tag, ParentContainer>::get_left() noexcept
 {
 	if constexpr (Options::has_pointer_get_callback) {
@@ -76,7 +223,7 @@ BSTNodeBase<Node, Options, Tag, ParentContainer>::get_left() noexcept
 }
 
 template <class Node, class Options, class Tag, class ParentContainer>
-Node *&
+typename BSTNodeBase<Node, Options, Tag, ParentContainer>::Link &
 BSTNodeBase<Node, Options, Tag, ParentContainer>::get_right() noexcept
 {
 	if constexpr (Options::has_pointer_get_callback) {
@@ -86,7 +233,7 @@ BSTNodeBase<Node, Options, Tag, ParentContainer>::get_right() noexcept
 }
 
 template <class Node, class Options, class Tag, class ParentContainer>
-Node * const &
+const typename BSTNodeBase<Node, Options, Tag, ParentContainer>::Link &
 BSTNodeBase<Node, Options, Tag, ParentContainer>::get_left() const noexcept
 {
 	if constexpr (Options::has_pointer_get_callback) {
@@ -96,7 +243,7 @@ BSTNodeBase<Node, Options, Tag, ParentContainer>::get_left() const noexcept
 }
 
 template <class Node, class Options, class Tag, class ParentContainer>
-Node * const &
+const typename BSTNodeBase<Node, Options, Tag, ParentContainer>::Link &
 BSTNodeBase<Node, Options, Tag, ParentContainer>::get_right() const noexcept
 {
 	if constexpr (Options::has_pointer_get_callback) {
@@ -138,6 +285,81 @@ BSTNodeBase<Node, Options, Tag, ParentContainer>::set_right(
 	this->_bst_children[1] = new_right;
 }
 
+template <class Node, class Options, class Tag, class ParentContainer>
+Node *
+BSTNodeBase<Node, Options, Tag, ParentContainer>::get_prev() const noexcept
+{
+	return this->_bst_threads.get_prev();
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+Node *
+BSTNodeBase<Node, Options, Tag, ParentContainer>::get_next() const noexcept
+{
+	return this->_bst_threads.get_next();
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+void
+BSTNodeBase<Node, Options, Tag, ParentContainer>::set_prev(
+    Node * new_prev) noexcept
+{
+	this->_bst_threads.set_prev(new_prev);
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+void
+BSTNodeBase<Node, Options, Tag, ParentContainer>::set_next(
+    Node * new_next) noexcept
+{
+	this->_bst_threads.set_next(new_next);
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+Node *
+BSTNodeBase<Node, Options, Tag, ParentContainer>::get_dup_prev() const noexcept
+{
+	return this->_bst_dups.get_prev();
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+Node *
+BSTNodeBase<Node, Options, Tag, ParentContainer>::get_dup_next() const noexcept
+{
+	return this->_bst_dups.get_next();
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+size_t
+BSTNodeBase<Node, Options, Tag, ParentContainer>::get_dup_count() const noexcept
+{
+	return this->_bst_dups.get_count();
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+void
+BSTNodeBase<Node, Options, Tag, ParentContainer>::set_dup_prev(
+    Node * new_prev) noexcept
+{
+	this->_bst_dups.set_prev(new_prev);
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+void
+BSTNodeBase<Node, Options, Tag, ParentContainer>::set_dup_next(
+    Node * new_next) noexcept
+{
+	this->_bst_dups.set_next(new_next);
+}
+
+template <class Node, class Options, class Tag, class ParentContainer>
+void
+BSTNodeBase<Node, Options, Tag, ParentContainer>::set_dup_count(
+    size_t count) noexcept
+{
+	this->_bst_dups.set_count(count);
+}
+
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
 BinarySearchTree<Node, Options, Tag, Compare,
@@ -153,6 +375,7 @@ BinarySearchTree<Node, Options, Tag, Compare,
 	this->root = other.root;
 	other.root = nullptr;
 	this->s = other.s;
+	this->extremes = other.extremes;
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -164,6 +387,7 @@ BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::operator=(
 	this->root = other.root;
 	other.root = nullptr;
 	this->s = other.s;
+	this->extremes = other.extremes;
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -173,142 +397,1144 @@ BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::clear() noexcept
 {
 	this->root = nullptr;
 	this->s.set(0);
+	this->refresh_extremes();
 }
 
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
-Node *
-BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::get_uncle(
-    Node * node) const noexcept
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::take_size_from(
+    MyClass & other, size_t additional) noexcept
 {
-	Node * parent = node->NB::get_parent();
-	Node * grandparent = parent->NB::get_parent();
-
-	if (grandparent->NB::get_left() == parent) {
-		return grandparent->NB::get_right();
+	if constexpr (Options::constant_time_size) {
+		this->s.add(other.s.get() + additional);
 	} else {
-		return grandparent->NB::get_left();
+		(void)additional;
+		this->s.touch();
 	}
+	other.s.set(0);
 }
 
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
 void
-BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::verify_order()
-    const
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::distribute_size(
+    MyClass & other, size_t total) noexcept
 {
-	for (const Node & n : *this) {
-		if (n.NB::get_left() != nullptr) {
-			// left may not be larger
-			debug::yggassert(!(this->cmp(n, *(n.NB::get_left()))));
+	// Count the nodes of both trees in lockstep until the smaller one is
+	// exhausted. This takes O(min(n1, n2) + log n) time.
+	if constexpr (Options::constant_time_size) {
+		auto this_it = this->cbegin();
+		auto other_it = other.cbegin();
+		size_t count = 0;
+		while ((this_it != this->cend()) && (other_it != other.cend())) {
+			++this_it;
+			++other_it;
+			++count;
 		}
 
-		if (n.NB::get_right() != nullptr) {
-			// right may not be smaller
-			debug::yggassert(!(this->cmp(*(n.NB::get_right()), n)));
+		if (this_it == this->cend()) {
+			this->s.set(count);
+			other.s.set(total - count);
+		} else {
+			this->s.set(total - count);
+			other.s.set(count);
 		}
+	} else {
+		(void)total;
+		this->s.touch();
+		other.s.touch();
 	}
 }
 
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
-void
-BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::verify_tree()
-    const
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::leftmost_in(
+    Node * sub_root) noexcept
 {
-	if (this->root == nullptr) {
-		return;
+	if (sub_root == nullptr) {
+		return nullptr;
 	}
 
-	Node * cur = this->root;
-	while (cur->NB::get_left() != nullptr) {
-		debug::yggassert(cur->NB::get_left() != cur->NB::get_right());
-		cur = cur->NB::get_left();
-		debug::yggassert(cur->NB::get_left() != cur);
-		debug::yggassert(cur->NB::get_right() != cur);
+	while (sub_root->NB::get_left() != nullptr) {
+		sub_root = sub_root->NB::get_left();
 	}
 
-	std::set<Node *> seen;
-
-	while (cur != nullptr) {
-		debug::yggassert(cur->NB::get_left() != cur);
-		debug::yggassert(cur->NB::get_right() != cur);
-		if (cur->NB::get_left() != nullptr) {
-			debug::yggassert(cur->NB::get_left() != cur->NB::get_right());
-		}
+	return sub_root;
+}
 
-		debug::yggassert(seen.find(cur) == seen.end());
-		seen.insert(cur);
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::rightmost_in(
+    Node * sub_root) noexcept
+{
+	if (sub_root == nullptr) {
+		return nullptr;
+	}
 
-		if (cur->NB::get_left() != nullptr) {
-			debug::yggassert(cur->NB::get_left()->NB::get_parent() == cur);
-			debug::yggassert(cur->NB::get_left()->NB::get_left() != cur);
-			debug::yggassert(cur->NB::get_left()->NB::get_right() != cur);
-			debug::yggassert(cur->NB::get_left() != cur);
-		}
+	while (sub_root->NB::get_right() != nullptr) {
+		sub_root = sub_root->NB::get_right();
+	}
 
-		if (cur->NB::get_right() != nullptr) {
-			debug::yggassert(cur->NB::get_right()->NB::get_parent() == cur);
-			debug::yggassert(cur->NB::get_right()->NB::get_left() != cur);
-			debug::yggassert(cur->NB::get_right()->NB::get_right() != cur);
-			debug::yggassert(cur->NB::get_right() != cur);
-		}
+	return sub_root;
+}
 
-		/*
-		 * Begin: find the next-largest vertex
-		 */
-		if (cur->NB::get_right() != nullptr) {
-			// go to smallest larger-or-equal child
-			cur = cur->NB::get_right();
-			while (cur->NB::get_left() != nullptr) {
-				cur = cur->NB::get_left();
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::leaf_attached(
+    Node & node, Node * parent) noexcept
+{
+	thread_leaf(node, parent);
+
+	if constexpr (Options::cached_extremes) {
+		if (parent == nullptr) {
+			this->extremes.smallest = &node;
+			this->extremes.largest = &node;
+		} else if (parent->NB::get_left() == &node) {
+			// The only leaf position directly before the smallest node is its
+			// left child
+			if (parent == this->extremes.smallest) {
+				this->extremes.smallest = &node;
 			}
-		} else {
-			// go up
+		} else if (parent == this->extremes.largest) {
+			this->extremes.largest = &node;
+		}
+	}
+}
 
-			// skip over the nodes already visited
-			// TODO have a 'parents_left_child_is' / 'parents_right_child_is'
-			// function?
-			while ((cur->NB::get_parent() != nullptr) &&
-			       (cur->NB::get_parent()->NB::get_right() ==
-			        cur)) { // these are the nodes which are smaller and were already
-				              // visited
-				cur = cur->NB::get_parent();
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::node_detaching(
+    Node & node, Node * parent) noexcept
+{
+	if constexpr (Options::cached_extremes) {
+		// The smallest node has no left child, thus its successor is either the
+		// smallest node of its right subtree or its parent. Vice versa for the
+		// largest node. The subtrees in question are small in balanced trees.
+		if (&node == this->extremes.smallest) {
+			if (node.NB::get_right() != nullptr) {
+				this->extremes.smallest = leftmost_in(node.NB::get_right());
+			} else {
+				this->extremes.smallest = parent;
 			}
-
-			// go one further up
-			if (cur->NB::get_parent() == nullptr) {
-				// done
-				cur = nullptr;
+		}
+		if (&node == this->extremes.largest) {
+			if (node.NB::get_left() != nullptr) {
+				this->extremes.largest = rightmost_in(node.NB::get_left());
 			} else {
-				// go up
-				cur = cur->NB::get_parent();
+				this->extremes.largest = parent;
 			}
 		}
-		/*
-		 * End: find the next-largest vertex
-		 */
+	} else {
+		(void)parent;
 	}
+
+	thread_unlink(node);
 }
 
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
 void
-BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::dbg_verify()
-    const
+BinarySearchTree<Node, Options, Tag, Compare,
+                 ParentContainer>::refresh_extremes() noexcept
 {
-	this->verify_tree();
-	this->verify_order();
-	this->verify_size();
+	if constexpr (Options::cached_extremes) {
+		this->extremes.smallest = leftmost_in(this->root);
+		this->extremes.largest = rightmost_in(this->root);
+	}
 }
 
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
-bool
-BinarySearchTree<Node, Options, Tag, Compare,
-                 ParentContainer>::verify_integrity() const
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::thread_leaf(
+    Node & node, Node * parent) noexcept
 {
-	try {
+	if constexpr (Options::threaded) {
+		if (parent == nullptr) {
+			thread_between(nullptr, node, nullptr);
+		} else if (parent->NB::get_left() == &node) {
+			thread_between(parent->NB::get_prev(), node, parent);
+		} else {
+			thread_between(parent, node, parent->NB::get_next());
+		}
+	} else {
+		(void)node;
+		(void)parent;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::thread_between(
+    Node * prev, Node & node, Node * next) noexcept
+{
+	if constexpr (Options::threaded) {
+		node.NB::set_prev(prev);
+		node.NB::set_next(next);
+		if (prev != nullptr) {
+			prev->NB::set_next(&node);
+		}
+		if (next != nullptr) {
+			next->NB::set_prev(&node);
+		}
+	} else {
+		(void)prev;
+		(void)node;
+		(void)next;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::thread_unlink(
+    Node & node) noexcept
+{
+	if constexpr (Options::threaded) {
+		Node * prev = node.NB::get_prev();
+		Node * next = node.NB::get_next();
+		if (prev != nullptr) {
+			prev->NB::set_next(next);
+		}
+		if (next != nullptr) {
+			next->NB::set_prev(prev);
+		}
+	} else {
+		(void)node;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::thread_join(
+    Node * left_root, Node * pivot, Node * right_root) noexcept
+{
+	if constexpr (Options::threaded) {
+		Node * left_last = rightmost_in(left_root);
+		Node * right_first = leftmost_in(right_root);
+
+		if (pivot != nullptr) {
+			thread_between(left_last, *pivot, right_first);
+		} else {
+			if (left_last != nullptr) {
+				left_last->NB::set_next(right_first);
+			}
+			if (right_first != nullptr) {
+				right_first->NB::set_prev(left_last);
+			}
+		}
+	} else {
+		(void)left_root;
+		(void)pivot;
+		(void)right_root;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::thread_split(
+    Node * left_root, Node * right_root) noexcept
+{
+	if constexpr (Options::threaded) {
+		if (left_root != nullptr) {
+			rightmost_in(left_root)->NB::set_next(nullptr);
+		}
+		if (right_root != nullptr) {
+			leftmost_in(right_root)->NB::set_prev(nullptr);
+		}
+	} else {
+		(void)left_root;
+		(void)right_root;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::thread_cut_out(
+    Node * sub_root) noexcept
+{
+	if constexpr (Options::threaded) {
+		if (sub_root == nullptr) {
+			return;
+		}
+
+		Node * first = leftmost_in(sub_root);
+		Node * last = rightmost_in(sub_root);
+
+		// The threads at the ends of the subtree still lead to its former
+		// neighbors
+		Node * before = first->NB::get_prev();
+		Node * after = last->NB::get_next();
+		if (before != nullptr) {
+			before->NB::set_next(after);
+		}
+		if (after != nullptr) {
+			after->NB::set_prev(before);
+		}
+		first->NB::set_prev(nullptr);
+		last->NB::set_next(nullptr);
+	} else {
+		(void)sub_root;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::rethread() noexcept
+{
+	if constexpr (Options::threaded) {
+		// Walk the tree in order via the child and parent links
+		Node * prev = nullptr;
+		Node * cur = leftmost_in(this->root);
+		while (cur != nullptr) {
+			cur->NB::set_prev(prev);
+			if (prev != nullptr) {
+				prev->NB::set_next(cur);
+			}
+			prev = cur;
+
+			if (cur->NB::get_right() != nullptr) {
+				cur = cur->NB::get_right();
+				while (cur->NB::get_left() != nullptr) {
+					cur = cur->NB::get_left();
+				}
+			} else {
+				while ((cur->NB::get_parent() != nullptr) &&
+				       (cur->NB::get_parent()->NB::get_right() == cur)) {
+					cur = cur->NB::get_parent();
+				}
+				cur = cur->NB::get_parent();
+			}
+		}
+		if (prev != nullptr) {
+			prev->NB::set_next(nullptr);
+		}
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+bool
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::is_duplicate(
+    const Node & node) noexcept
+{
+	if constexpr (Options::compress_duplicates) {
+		return node.NB::get_dup_count() == 0;
+	} else {
+		(void)node;
+		return false;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+size_t
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::group_size(
+    const Node & node) noexcept
+{
+	if constexpr (Options::compress_duplicates) {
+		return node.NB::get_dup_count();
+	} else {
+		(void)node;
+		return 1;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::last_in_group(
+    Node & rep) noexcept
+{
+	return NodeInterface::get_last_dup(&rep);
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::init_group(
+    Node & node) noexcept
+{
+	node.NB::set_dup_count(1);
+	node.NB::set_dup_prev(nullptr);
+	node.NB::set_dup_next(nullptr);
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare,
+                 ParentContainer>::append_duplicate(Node & rep,
+                                                    Node & node) noexcept
+{
+	node.NB::set_parent(&rep);
+	node.NB::set_left(nullptr);
+	node.NB::set_right(nullptr);
+	node.NB::set_dup_count(0);
+	node.NB::set_dup_next(nullptr);
+
+	Node * tail = rep.NB::get_dup_prev();
+	node.NB::set_dup_prev(tail);
+	if (tail != nullptr) {
+		tail->NB::set_dup_next(&node);
+	} else {
+		rep.NB::set_dup_next(&node);
+	}
+	rep.NB::set_dup_prev(&node);
+	rep.NB::set_dup_count(rep.NB::get_dup_count() + 1);
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::merge_groups(
+    Node & rep, Node & other_rep) noexcept
+{
+	Node * other_head = other_rep.NB::get_dup_next();
+	Node * other_tail = other_rep.NB::get_dup_prev();
+	size_t other_count = other_rep.NB::get_dup_count();
+
+	append_duplicate(rep, other_rep);
+	if (other_head == nullptr) {
+		return;
+	}
+
+	// Splice the rest of the other group in after its representative
+	other_rep.NB::set_dup_next(other_head);
+	other_head->NB::set_dup_prev(&other_rep);
+	rep.NB::set_dup_prev(other_tail);
+	rep.NB::set_dup_count(rep.NB::get_dup_count() + other_count - 1);
+	for (Node * dup = other_head; dup != nullptr; dup = dup->NB::get_dup_next()) {
+		dup->NB::set_parent(&rep);
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+bool
+BinarySearchTree<Node, Options, Tag, Compare,
+                 ParentContainer>::remove_duplicate(Node & node) noexcept
+{
+	if (node.NB::get_dup_count() != 0) {
+		return false;
+	}
+
+	Node * rep = node.NB::get_parent();
+	Node * prev = node.NB::get_dup_prev();
+	Node * next = node.NB::get_dup_next();
+	if (prev != nullptr) {
+		prev->NB::set_dup_next(next);
+	} else {
+		rep->NB::set_dup_next(next);
+	}
+	if (next != nullptr) {
+		next->NB::set_dup_prev(prev);
+	} else {
+		rep->NB::set_dup_prev(prev);
+	}
+	rep->NB::set_dup_count(rep->NB::get_dup_count() - 1);
+
+	return true;
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare,
+                 ParentContainer>::promote_duplicate(Node & rep) noexcept
+{
+	Node * head = rep.NB::get_dup_next();
+	if (head == nullptr) {
+		return nullptr;
+	}
+
+	// The rest of the group now hangs off <head>
+	Node * rest = head->NB::get_dup_next();
+	head->NB::set_dup_count(rep.NB::get_dup_count() - 1);
+	head->NB::set_dup_next(rest);
+	if (rest != nullptr) {
+		head->NB::set_dup_prev(rep.NB::get_dup_prev());
+		rest->NB::set_dup_prev(nullptr);
+	} else {
+		head->NB::set_dup_prev(nullptr);
+	}
+	for (Node * dup = rest; dup != nullptr; dup = dup->NB::get_dup_next()) {
+		dup->NB::set_parent(head);
+	}
+
+	// Put <head> into the place of <rep> in the tree
+	Node * parent = rep.NB::get_parent();
+	head->NB::set_parent(parent);
+	if (parent == nullptr) {
+		this->root = head;
+	} else if (parent->NB::get_left() == &rep) {
+		parent->NB::set_left(head);
+	} else {
+		parent->NB::set_right(head);
+	}
+
+	head->NB::set_left(rep.NB::get_left());
+	if (head->NB::get_left() != nullptr) {
+		head->NB::get_left()->NB::set_parent(head);
+	}
+	head->NB::set_right(rep.NB::get_right());
+	if (head->NB::get_right() != nullptr) {
+		head->NB::get_right()->NB::set_parent(head);
+	}
+
+	if constexpr (Options::cached_extremes) {
+		if (this->extremes.smallest == &rep) {
+			this->extremes.smallest = head;
+		}
+		if (this->extremes.largest == &rep) {
+			this->extremes.largest = head;
+		}
+	}
+
+	return head;
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Consumer>
+size_t
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::consume_subtree(
+    Node * sub_root, Consumer && consume)
+{
+	// Visit the nodes in order, flattening the subtree by right rotations on the
+	// way. The links of a node are not read anymore once it has been passed to
+	// <consume>, so it may e.g. destroy the node or insert it into a tree.
+	size_t count = 0;
+	Node * cur = sub_root;
+	while (cur != nullptr) {
+		Node * left_child = cur->NB::get_left();
+		if (left_child != nullptr) {
+			cur->NB::set_left(left_child->NB::get_right());
+			left_child->NB::set_right(cur);
+			cur = left_child;
+		} else {
+			Node * next = cur->NB::get_right();
+			if constexpr (Options::compress_duplicates) {
+				// The group of a representative follows it
+				Node * dup = cur->NB::get_dup_next();
+				consume(*cur);
+				count++;
+				while (dup != nullptr) {
+					Node * next_dup = dup->NB::get_dup_next();
+					consume(*dup);
+					count++;
+					dup = next_dup;
+				}
+			} else {
+				consume(*cur);
+				count++;
+			}
+			cur = next;
+		}
+	}
+
+	return count;
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+size_t
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::subtree_height(
+    const Node * sub_root) noexcept
+{
+	if (sub_root == nullptr) {
+		return 0;
+	}
+
+	return 1 + std::max(subtree_height(sub_root->NB::get_left()),
+	                    subtree_height(sub_root->NB::get_right()));
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::
+    collect_at_depth(Node * sub_root, size_t depth, std::vector<Node *> & out)
+{
+	if (sub_root == nullptr) {
+		return;
+	}
+
+	if (depth == 0) {
+		out.push_back(sub_root);
+	} else {
+		collect_at_depth(sub_root->NB::get_left(), depth - 1, out);
+		collect_at_depth(sub_root->NB::get_right(), depth - 1, out);
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::veb_order(
+    Node * sub_root, size_t height, std::vector<Node *> & order,
+    std::vector<Node *> & scratch)
+{
+	if (sub_root == nullptr) {
+		return;
+	}
+
+	if (height == 1) {
+		order.push_back(sub_root);
+		return;
+	}
+
+	// Lay out the top half of the levels, then every subtree hanging off it
+	// from left to right.
+	size_t top_height = height / 2;
+	veb_order(sub_root, top_height, order, scratch);
+
+	size_t first = scratch.size();
+	collect_at_depth(sub_root, top_height, scratch);
+	size_t last = scratch.size();
+	// Recursive calls push to (and pop from) scratch beyond <last>, so we must
+	// not hold references into it.
+	for (size_t i = first; i < last; ++i) {
+		veb_order(scratch[i], height - top_height, order, scratch);
+	}
+	scratch.resize(first);
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class TreeNodeBase, class Relocate>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::relayout_base(
+    Node * arena, Relocate && relocate)
+{
+	std::vector<Node *> order;
+	{
+		std::vector<Node *> scratch;
+		veb_order(this->root, subtree_height(this->root), order, scratch);
+	}
+	if constexpr (Options::compress_duplicates) {
+		// Duplicates are never visited by a search, they go behind the tree.
+		size_t tree_nodes = order.size();
+		for (size_t i = 0; i < tree_nodes; ++i) {
+			for (Node * dup = order[i]->NB::get_dup_next(); dup != nullptr;
+			     dup = dup->NB::get_dup_next()) {
+				order.push_back(dup);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < order.size(); ++i) {
+		arena[i] = std::move(*order[i]);
+		static_cast<TreeNodeBase &>(arena[i]) =
+		    static_cast<const TreeNodeBase &>(*order[i]);
+	}
+
+	// From now on, the left link of every old node points to its copy. All
+	// links of the copies still point to old nodes and are translated.
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i]->NB::set_left(&arena[i]);
+	}
+	auto moved = [](Node * old) -> Node * {
+		return (old != nullptr) ? static_cast<Node *>(old->NB::get_left())
+		                        : nullptr;
+	};
+	for (size_t i = 0; i < order.size(); ++i) {
+		Node & n = arena[i];
+		n.NB::set_left(moved(n.NB::get_left()));
+		n.NB::set_right(moved(n.NB::get_right()));
+		if constexpr (!Options::no_parent_pointers) {
+			n.NB::set_parent(moved(n.NB::get_parent()));
+		}
+		if constexpr (Options::threaded) {
+			n.NB::set_prev(moved(n.NB::get_prev()));
+			n.NB::set_next(moved(n.NB::get_next()));
+		}
+		if constexpr (Options::compress_duplicates) {
+			n.NB::set_dup_prev(moved(n.NB::get_dup_prev()));
+			n.NB::set_dup_next(moved(n.NB::get_dup_next()));
+		}
+	}
+
+	this->root = moved(this->root);
+	if constexpr (Options::cached_extremes) {
+		this->extremes.smallest = moved(this->extremes.smallest);
+		this->extremes.largest = moved(this->extremes.largest);
+	}
+	// Node addresses have changed, which e.g. invalidates snapshots.
+	this->s.touch();
+
+	for (size_t i = 0; i < order.size(); ++i) {
+		relocate(*order[i], arena[i]);
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <size_t meta_bytes, class WriteMeta>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::
+    write_structure_base(StructureHeader::Kind kind, const Node * nodes,
+                         std::ostream & out, WriteMeta && write_meta) const
+{
+	// Without parent pointers, a stack is needed to walk the tree. <visit> is
+	// called for every node (including duplicates) in pre-order.
+	auto preorder = [&](auto && visit) {
+		std::vector<const Node *> stack;
+		if (this->root != nullptr) {
+			stack.push_back(this->root);
+		}
+		while (!stack.empty()) {
+			const Node * n = stack.back();
+			stack.pop_back();
+
+			visit(*n, false);
+			if constexpr (Options::compress_duplicates) {
+				for (const Node * dup = n->NB::get_dup_next(); dup != nullptr;
+				     dup = dup->NB::get_dup_next()) {
+					visit(*dup, true);
+				}
+			}
+
+			if (n->NB::get_right() != nullptr) {
+				stack.push_back(n->NB::get_right());
+			}
+			if (n->NB::get_left() != nullptr) {
+				stack.push_back(n->NB::get_left());
+			}
+		}
+	};
+
+	// The first pass determines how wide indices must be.
+	std::uint64_t record_count = 0;
+	size_t max_index = 0;
+	preorder([&](const Node & n, bool is_dup) {
+		(void)is_dup;
+		assert(&n >= nodes);
+		max_index = std::max(max_index, static_cast<size_t>(&n - nodes));
+		record_count++;
+	});
+
+	StructureHeader header;
+	std::memcpy(header.magic, StructureHeader::MAGIC, sizeof(header.magic));
+	header.version = StructureHeader::VERSION;
+	header.kind = kind;
+	header.index_bytes = (max_index <= UINT32_MAX) ? 4 : 8;
+	header.meta_bytes = static_cast<std::uint8_t>(meta_bytes);
+	header.record_count = record_count;
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	const size_t record_bytes = header.index_bytes + 1 + meta_bytes;
+	std::vector<unsigned char> buffer;
+	buffer.reserve(record_bytes * 4096);
+
+	preorder([&](const Node & n, bool is_dup) {
+		size_t pos = buffer.size();
+		buffer.resize(pos + record_bytes);
+		unsigned char * record = buffer.data() + pos;
+
+		size_t index = static_cast<size_t>(&n - nodes);
+		if (header.index_bytes == 4) {
+			auto narrow = static_cast<std::uint32_t>(index);
+			std::memcpy(record, &narrow, 4);
+		} else {
+			std::uint64_t wide = index;
+			std::memcpy(record, &wide, 8);
+		}
+
+		std::uint8_t flags = 0;
+		if (is_dup) {
+			flags |= StructureHeader::DUPLICATE;
+		} else {
+			if (n.NB::get_left() != nullptr) {
+				flags |= StructureHeader::HAS_LEFT;
+			}
+			if (n.NB::get_right() != nullptr) {
+				flags |= StructureHeader::HAS_RIGHT;
+			}
+		}
+		if (write_meta(n, record + header.index_bytes + 1)) {
+			flags |= StructureHeader::TREE_FLAG;
+		}
+		record[header.index_bytes] = flags;
+
+		if (buffer.size() + record_bytes > buffer.capacity()) {
+			out.write(reinterpret_cast<const char *>(buffer.data()),
+			          static_cast<std::streamsize>(buffer.size()));
+			buffer.clear();
+		}
+	});
+
+	out.write(reinterpret_cast<const char *>(buffer.data()),
+	          static_cast<std::streamsize>(buffer.size()));
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <size_t meta_bytes, class ReadMeta, class FixNode>
+bool
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::
+    restore_structure_base(StructureHeader::Kind kind, Node * nodes,
+                           size_t node_count, const void * data, size_t bytes,
+                           ReadMeta && read_meta, FixNode && fix_node)
+{
+	auto fail = [&]() {
+		this->root = nullptr;
+		this->s.set(0);
+		this->refresh_extremes();
+		return false;
+	};
+
+	StructureHeader header;
+	if (bytes < sizeof(header)) {
+		return fail();
+	}
+	std::memcpy(&header, data, sizeof(header));
+	if ((std::memcmp(header.magic, StructureHeader::MAGIC,
+	                 sizeof(header.magic)) != 0) ||
+	    (header.version != StructureHeader::VERSION) || (header.kind != kind) ||
+	    ((header.index_bytes != 4) && (header.index_bytes != 8)) ||
+	    (header.meta_bytes != meta_bytes)) {
+		return fail();
+	}
+
+	const size_t record_bytes = header.index_bytes + 1 + meta_bytes;
+	if ((header.record_count > (bytes - sizeof(header)) / record_bytes) ||
+	    (header.record_count * record_bytes != bytes - sizeof(header))) {
+		return fail();
+	}
+	const size_t count = header.record_count;
+	const unsigned char * records =
+	    static_cast<const unsigned char *>(data) + sizeof(header);
+
+	auto index_of = [&](const unsigned char * record) -> size_t {
+		if (header.index_bytes == 4) {
+			std::uint32_t narrow;
+			std::memcpy(&narrow, record, 4);
+			return narrow;
+		} else {
+			std::uint64_t wide;
+			std::memcpy(&wide, record, 8);
+			return wide;
+		}
+	};
+
+	/* In pre-order, a node is the left child of its predecessor if that has a
+	 * left child. Otherwise, it is the right child of the latest node whose
+	 * right child is still missing. */
+	this->root = nullptr;
+	Node * left_parent = nullptr;
+	std::vector<Node *> right_parents;
+	Node * rep = nullptr;
+	// Linking a node twice would create a cycle
+	std::vector<bool> seen(node_count, false);
+	for (size_t i = 0; i < count; ++i) {
+		const unsigned char * record = records + i * record_bytes;
+		size_t index = index_of(record);
+		std::uint8_t flags = record[header.index_bytes];
+		if ((index >= node_count) || seen[index]) {
+			return fail();
+		}
+		seen[index] = true;
+		Node & node = nodes[index];
+
+		if ((flags & StructureHeader::DUPLICATE) != 0) {
+			if constexpr (Options::compress_duplicates) {
+				if (rep == nullptr) {
+					return fail();
+				}
+				this->append_duplicate(*rep, node);
+			} else {
+				return fail();
+			}
+		} else {
+			Node * parent;
+			if (left_parent != nullptr) {
+				parent = left_parent;
+				parent->NB::set_left(&node);
+			} else if (!right_parents.empty()) {
+				parent = right_parents.back();
+				right_parents.pop_back();
+				parent->NB::set_right(&node);
+			} else if (i == 0) {
+				parent = nullptr;
+				this->root = &node;
+			} else {
+				return fail();
+			}
+
+			node.NB::set_left(nullptr);
+			node.NB::set_right(nullptr);
+			if constexpr (!Options::no_parent_pointers) {
+				node.NB::set_parent(parent);
+			}
+			if constexpr (Options::compress_duplicates) {
+				this->init_group(node);
+				rep = &node;
+			}
+
+			if ((flags & StructureHeader::HAS_RIGHT) != 0) {
+				right_parents.push_back(&node);
+			}
+			left_parent =
+			    ((flags & StructureHeader::HAS_LEFT) != 0) ? &node : nullptr;
+		}
+
+		read_meta(node, (flags & StructureHeader::TREE_FLAG) != 0,
+		          record + header.index_bytes + 1);
+	}
+	if ((left_parent != nullptr) || !right_parents.empty()) {
+		return fail();
+	}
+
+	// Reverse pre-order visits all children before their parents.
+	for (size_t i = count; i-- > 0;) {
+		const unsigned char * record = records + i * record_bytes;
+		if ((record[header.index_bytes] & StructureHeader::DUPLICATE) == 0) {
+			fix_node(nodes[index_of(record)]);
+		}
+	}
+
+	this->s.set(count);
+	this->refresh_extremes();
+	this->rethread();
+
+	return true;
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::get_uncle(
+    Node * node) const noexcept
+{
+	Node * parent = node->NB::get_parent();
+	Node * grandparent = parent->NB::get_parent();
+
+	if (grandparent->NB::get_left() == parent) {
+		return grandparent->NB::get_right();
+	} else {
+		return grandparent->NB::get_left();
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::verify_order()
+    const
+{
+	for (const Node & n : *this) {
+		if (n.NB::get_left() != nullptr) {
+			// left may not be larger
+			debug::yggassert(!(this->cmp(n, *(n.NB::get_left()))));
+		}
+
+		if (n.NB::get_right() != nullptr) {
+			// right may not be smaller
+			debug::yggassert(!(this->cmp(*(n.NB::get_right()), n)));
+		}
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::verify_tree()
+    const
+{
+	if (this->root == nullptr) {
+		return;
+	}
+
+	Node * cur = this->root;
+	while (cur->NB::get_left() != nullptr) {
+		debug::yggassert(cur->NB::get_left() != cur->NB::get_right());
+		cur = cur->NB::get_left();
+		debug::yggassert(cur->NB::get_left() != cur);
+		debug::yggassert(cur->NB::get_right() != cur);
+	}
+
+	std::set<Node *> seen;
+
+	while (cur != nullptr) {
+		debug::yggassert(cur->NB::get_left() != cur);
+		debug::yggassert(cur->NB::get_right() != cur);
+		if (cur->NB::get_left() != nullptr) {
+			debug::yggassert(cur->NB::get_left() != cur->NB::get_right());
+		}
+
+		debug::yggassert(seen.find(cur) == seen.end());
+		seen.insert(cur);
+
+		if (cur->NB::get_left() != nullptr) {
+			debug::yggassert(cur->NB::get_left()->NB::get_parent() == cur);
+			debug::yggassert(cur->NB::get_left()->NB::get_left() != cur);
+			debug::yggassert(cur->NB::get_left()->NB::get_right() != cur);
+			debug::yggassert(cur->NB::get_left() != cur);
+		}
+
+		if (cur->NB::get_right() != nullptr) {
+			debug::yggassert(cur->NB::get_right()->NB::get_parent() == cur);
+			debug::yggassert(cur->NB::get_right()->NB::get_left() != cur);
+			debug::yggassert(cur->NB::get_right()->NB::get_right() != cur);
+			debug::yggassert(cur->NB::get_right() != cur);
+		}
+
+		/*
+		 * Begin: find the next-largest vertex
+		 */
+		if (cur->NB::get_right() != nullptr) {
+			// go to smallest larger-or-equal child
+			cur = cur->NB::get_right();
+			while (cur->NB::get_left() != nullptr) {
+				cur = cur->NB::get_left();
+			}
+		} else {
+			// go up
+
+			// skip over the nodes already visited
+			// TODO have a 'parents_left_child_is' / 'parents_right_child_is'
+			// function?
+			while ((cur->NB::get_parent() != nullptr) &&
+			       (cur->NB::get_parent()->NB::get_right() ==
+			        cur)) { // these are the nodes which are smaller and were already
+				              // visited
+				cur = cur->NB::get_parent();
+			}
+
+			// go one further up
+			if (cur->NB::get_parent() == nullptr) {
+				// done
+				cur = nullptr;
+			} else {
+				// go up
+				cur = cur->NB::get_parent();
+			}
+		}
+		/*
+		 * End: find the next-largest vertex
+		 */
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::verify_threads()
+    const
+{
+	if constexpr (Options::threaded) {
+		// The threads must visit the same nodes as a structural in-order walk
+		const Node * prev = nullptr;
+		const Node * cur = leftmost_in(this->root);
+		while (cur != nullptr) {
+			debug::yggassert(cur->NB::get_prev() == prev);
+			if (prev != nullptr) {
+				debug::yggassert(prev->NB::get_next() == cur);
+			}
+			prev = cur;
+
+			if (cur->NB::get_right() != nullptr) {
+				cur = cur->NB::get_right();
+				while (cur->NB::get_left() != nullptr) {
+					cur = cur->NB::get_left();
+				}
+			} else {
+				while ((cur->NB::get_parent() != nullptr) &&
+				       (cur->NB::get_parent()->NB::get_right() == cur)) {
+					cur = cur->NB::get_parent();
+				}
+				cur = cur->NB::get_parent();
+			}
+		}
+		if (prev != nullptr) {
+			debug::yggassert(prev->NB::get_next() == nullptr);
+		}
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::verify_extremes()
+    const
+{
+	if constexpr (Options::cached_extremes) {
+		debug::yggassert(this->extremes.smallest == leftmost_in(this->root));
+		debug::yggassert(this->extremes.largest == rightmost_in(this->root));
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare,
+                 ParentContainer>::verify_duplicates() const
+{
+	if constexpr (Options::compress_duplicates) {
+		// The representatives must be strictly ordered, and every group must
+		// consist of equal nodes
+		const Node * prev_rep = nullptr;
+		for (const Node & n : *this) {
+			if (is_duplicate(n)) {
+				continue;
+			}
+
+			if (prev_rep != nullptr) {
+				debug::yggassert(this->cmp(*prev_rep, n));
+			}
+			prev_rep = &n;
+
+			size_t count = 1;
+			const Node * prev = nullptr;
+			for (const Node * dup = n.NB::get_dup_next(); dup != nullptr;
+			     dup = dup->NB::get_dup_next()) {
+				debug::yggassert(is_duplicate(*dup));
+				debug::yggassert(dup->NB::get_parent() == &n);
+				debug::yggassert(dup->NB::get_left() == nullptr);
+				debug::yggassert(dup->NB::get_right() == nullptr);
+				debug::yggassert(dup->NB::get_dup_prev() == prev);
+				debug::yggassert(!this->cmp(n, *dup) && !this->cmp(*dup, n));
+				prev = dup;
+				count++;
+			}
+			debug::yggassert(n.NB::get_dup_prev() == prev);
+			debug::yggassert(n.NB::get_dup_count() == count);
+		}
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::dbg_verify()
+    const
+{
+	this->verify_tree();
+	this->verify_threads();
+	this->verify_extremes();
+	this->verify_duplicates();
+	this->verify_order();
+	this->verify_size();
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+bool
+BinarySearchTree<Node, Options, Tag, Compare,
+                 ParentContainer>::verify_integrity() const
+{
+	try {
 		this->dbg_verify();
 	} catch (debug::VerifyException & e) {
 		return false;
@@ -403,6 +1629,15 @@ BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::size()
 	return this->s.get();
 }
 
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+size_t
+BinarySearchTree<Node, Options, Tag, Compare,
+                 ParentContainer>::get_modification_count() const noexcept
+{
+	return this->s.get_modifications();
+}
+
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
 bool
@@ -418,16 +1653,11 @@ Node *
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::get_smallest()
     const noexcept
 {
-	Node * smallest = this->root;
-	if (smallest == nullptr) {
-		return nullptr;
-	}
-
-	while (smallest->NB::get_left() != nullptr) {
-		smallest = smallest->NB::get_left();
+	if constexpr (Options::cached_extremes) {
+		return this->extremes.smallest;
+	} else {
+		return leftmost_in(this->root);
 	}
-
-	return smallest;
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -447,16 +1677,11 @@ Node *
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::get_largest()
     const noexcept
 {
-	Node * largest = this->root;
-	if (largest == nullptr) {
-		return nullptr;
-	}
-
-	while (largest->NB::get_right() != nullptr) {
-		largest = largest->NB::get_right();
+	if constexpr (Options::cached_extremes) {
+		return this->extremes.largest;
+	} else {
+		return rightmost_in(this->root);
 	}
-
-	return largest;
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -466,7 +1691,12 @@ typename BinarySearchTree<Node, Options, Tag, Compare,
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::iterator_to(
     const Node & node) const noexcept
 {
-	return const_iterator<false>(&node);
+	if constexpr (Options::no_parent_pointers) {
+		return const_iterator<false>(
+		    const_cast<MyClass *>(this)->iterator_to(const_cast<Node &>(node)));
+	} else {
+		return const_iterator<false>(&node);
+	}
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -476,7 +1706,75 @@ typename BinarySearchTree<Node, Options, Tag, Compare,
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::iterator_to(
     Node & node) noexcept
 {
-	return iterator<false>(&node);
+	if constexpr (Options::no_parent_pointers) {
+		iterator<false> it;
+		this->build_path_to(this->root, &node, it);
+		return it;
+	} else {
+		return iterator<false>(&node);
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class PathIterator>
+bool
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::build_path_to(
+    Node * sub_root, const Node * target, PathIterator & it) noexcept
+{
+	Node * cur = sub_root;
+	while (cur != nullptr) {
+		it.push(cur);
+		if (cur == target) {
+			return true;
+		}
+
+		if (this->cmp(*target, *cur)) {
+			cur = cur->NB::get_left();
+		} else if (this->cmp(*cur, *target)) {
+			cur = cur->NB::get_right();
+		} else {
+			// Equal keys: The target may be on either side.
+			size_t depth = it.get_depth();
+			if (this->build_path_to(cur->NB::get_left(), target, it)) {
+				return true;
+			}
+			it.truncate(depth);
+			cur = cur->NB::get_right();
+		}
+	}
+
+	return false;
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::find_parent(
+    Node & node) noexcept
+{
+	if constexpr (Options::no_parent_pointers) {
+		return parent_of(this->iterator_to(node));
+	} else {
+		return node.NB::get_parent();
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Iterator>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::parent_of(
+    const Iterator & it) noexcept
+{
+	if constexpr (Options::no_parent_pointers) {
+		if (it.get_depth() < 2) {
+			return nullptr;
+		}
+		return it.get_node_at(it.get_depth() - 2);
+	} else {
+		return it->NB::get_parent();
+	}
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -486,12 +1784,16 @@ typename BinarySearchTree<Node, Options, Tag, Compare,
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::cbegin()
     const noexcept
 {
-	Node * smallest = this->get_smallest();
-	if (smallest == nullptr) { // TODO what the hell?
-		return const_iterator<false>(nullptr);
-	}
+	if constexpr (Options::no_parent_pointers) {
+		return const_iterator<false>(const_cast<MyClass *>(this)->begin());
+	} else {
+		Node * smallest = this->get_smallest();
+		if (smallest == nullptr) { // TODO what the hell?
+			return const_iterator<false>(nullptr);
+		}
 
-	return const_iterator<false>(smallest);
+		return const_iterator<false>(smallest);
+	}
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -520,12 +1822,20 @@ typename BinarySearchTree<Node, Options, Tag, Compare,
                           ParentContainer>::template iterator<false>
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::begin() noexcept
 {
-	Node * smallest = this->get_smallest();
-	if (smallest == nullptr) {
-		return iterator<false>(nullptr);
-	}
+	if constexpr (Options::no_parent_pointers) {
+		iterator<false> it;
+		for (Node * cur = this->root; cur != nullptr; cur = cur->NB::get_left()) {
+			it.push(cur);
+		}
+		return it;
+	} else {
+		Node * smallest = this->get_smallest();
+		if (smallest == nullptr) {
+			return iterator<false>(nullptr);
+		}
 
-	return iterator<false>(smallest);
+		return iterator<false>(smallest);
+	}
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -554,12 +1864,19 @@ typename BinarySearchTree<Node, Options, Tag, Compare,
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::crbegin()
     const noexcept
 {
-	Node * largest = this->get_largest();
-	if (largest == nullptr) {
-		return const_iterator<true>(nullptr);
-	}
+	if constexpr (Options::no_parent_pointers) {
+		return const_iterator<true>(const_cast<MyClass *>(this)->rbegin());
+	} else {
+		Node * largest = this->get_largest();
+		if (largest == nullptr) {
+			return const_iterator<true>(nullptr);
+		}
+		if constexpr (Options::compress_duplicates) {
+			largest = NodeInterface::get_last_dup(largest);
+		}
 
-	return const_iterator<true>(largest);
+		return const_iterator<true>(largest);
+	}
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -599,57 +1916,251 @@ typename BinarySearchTree<Node, Options, Tag, Compare,
 BinarySearchTree<Node, Options, Tag, Compare,
                  ParentContainer>::rbegin() noexcept
 {
-	Node * largest = this->get_largest();
-	if (largest == nullptr) {
-		return iterator<true>(nullptr);
+	if constexpr (Options::no_parent_pointers) {
+		iterator<true> it;
+		for (Node * cur = this->root; cur != nullptr; cur = cur->NB::get_right()) {
+			it.push(cur);
+		}
+		return it;
+	} else {
+		Node * largest = this->get_largest();
+		if (largest == nullptr) {
+			return iterator<true>(nullptr);
+		}
+		if constexpr (Options::compress_duplicates) {
+			largest = NodeInterface::get_last_dup(largest);
+		}
+
+		return iterator<true>(largest);
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+typename BinarySearchTree<Node, Options, Tag, Compare,
+                          ParentContainer>::template iterator<true>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::rend() noexcept
+{
+	return iterator<true>(nullptr);
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Comparable, class Callbacks>
+typename BinarySearchTree<Node, Options, Tag, Compare,
+                          ParentContainer>::template iterator<false>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::find(
+    const Comparable & query, Callbacks * cbs)
+{
+#ifdef YGG_STORE_SEQUENCE
+	this->bss.register_search(reinterpret_cast<const void *>(&query),
+	                          Options::SequenceInterface::get_key(query));
+#endif
+
+	Node * cur = this->root;
+	cbs->init_root(cur);
+
+	/* We do a 3-way comparison here even though it is less efficient,
+	 * to ensure the callbacks are called in the right way. */
+
+	// Only used without parent pointers
+	iterator<false> path;
+
+	while (cur != nullptr) {
+		if constexpr (Options::no_parent_pointers) {
+			path.push(cur);
+		}
+
+		if (this->cmp(*cur, query)) {
+			cur = cur->NB::get_right();
+			cbs->descend_right(cur);
+		} else if (this->cmp(query, *cur)) {
+			cur = cur->NB::get_left();
+			cbs->descend_left(cur);
+		} else {
+			cbs->found(cur);
+			if constexpr (Options::no_parent_pointers) {
+				return path;
+			} else {
+				return iterator<false>(cur);
+			}
+		}
+	}
+
+	cbs->not_found();
+	return this->end();
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <size_t group_size, class InputIt, class OutputIt>
+void
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::find_batch(
+    InputIt keys_begin, InputIt keys_end, OutputIt out)
+    CMP_NOEXCEPT(*keys_begin)
+{
+	static_assert(group_size > 0, "find_batch needs at least one slot");
+
+	if constexpr (Options::no_parent_pointers) {
+		// Interleaving would mean keeping group_size paths around.
+		std::ptrdiff_t index = 0;
+		for (; keys_begin != keys_end; ++keys_begin) {
+			out[index++] = this->find(*keys_begin);
+		}
+	} else {
+		struct Descent
+		{
+			Node * cur;
+			Node * last_left;
+			InputIt query;
+			size_t index;
+		};
+
+		Descent slots[group_size];
+		size_t active = 0;
+		size_t next_index = 0;
+
+		// Initially fill all slots
+		while ((active < group_size) && (keys_begin != keys_end)) {
+#ifdef YGG_STORE_SEQUENCE
+			this->bss.register_search(
+			    reinterpret_cast<const void *>(&(*keys_begin)),
+			    Options::SequenceInterface::get_key(*keys_begin));
+#endif
+			slots[active++] = Descent{this->root, nullptr, keys_begin, next_index++};
+			++keys_begin;
+		}
+
+		/* The same search as in find(), but we take only one step per descent
+		 * before switching to the next one. The prefetch issued for a descent has
+		 * (group_size - 1) steps of other descents to complete. */
+		while (active > 0) {
+			size_t i = 0;
+			while (i < active) {
+				Descent & d = slots[i];
+
+				if (d.cur != nullptr) {
+					if (this->cmp(*d.cur, *d.query)) {
+						d.cur = d.cur->NB::get_right();
+					} else {
+						d.last_left = d.cur;
+						d.cur = d.cur->NB::get_left();
+					}
+					__builtin_prefetch(d.cur);
+					++i;
+					continue;
+				}
+
+				// This descent is done.
+				if ((d.last_left != nullptr) && (!this->cmp(*d.query, *d.last_left))) {
+					out[static_cast<std::ptrdiff_t>(d.index)] =
+					    iterator<false>(d.last_left);
+				} else {
+					out[static_cast<std::ptrdiff_t>(d.index)] = this->end();
+				}
+
+				if (keys_begin != keys_end) {
+#ifdef YGG_STORE_SEQUENCE
+					this->bss.register_search(
+					    reinterpret_cast<const void *>(&(*keys_begin)),
+					    Options::SequenceInterface::get_key(*keys_begin));
+#endif
+					d = Descent{this->root, nullptr, keys_begin, next_index++};
+					++keys_begin;
+					++i;
+				} else {
+					// Nothing left to refill with - move the last active descent here.
+					d = slots[--active];
+				}
+			}
+		}
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::InsertHandle::InsertHandle() noexcept
+    : node(nullptr), exists(false), as_left_child(false)
+{}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::InsertHandle::InsertHandle(
+    Node * node_in, bool exists_in, bool as_left_child_in) noexcept
+    : node(node_in), exists(exists_in), as_left_child(as_left_child_in)
+{}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+bool
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::InsertHandle::found() const noexcept
+{
+	return this->exists;
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::InsertHandle::get_node() const noexcept
+{
+	if (this->exists) {
+		return this->node;
 	}
+	return nullptr;
+}
 
-	return iterator<true>(largest);
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::InsertHandle::get_parent() const noexcept
+{
+	return this->node;
 }
 
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
-typename BinarySearchTree<Node, Options, Tag, Compare,
-                          ParentContainer>::template iterator<true>
-BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::rend() noexcept
+bool
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::InsertHandle::is_left_child() const noexcept
 {
-	return iterator<true>(nullptr);
+	return this->as_left_child;
 }
 
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
-template <class Comparable, class Callbacks>
+template <class Comparable>
 typename BinarySearchTree<Node, Options, Tag, Compare,
-                          ParentContainer>::template iterator<false>
-BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::find(
-    const Comparable & query, Callbacks * cbs)
+                          ParentContainer>::InsertHandle
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::
+    find_or_prepare_insert(const Comparable & query) CMP_NOEXCEPT(query)
 {
 #ifdef YGG_STORE_SEQUENCE
 	this->bss.register_search(reinterpret_cast<const void *>(&query),
 	                          Options::SequenceInterface::get_key(query));
 #endif
 
+	Node * parent = nullptr;
 	Node * cur = this->root;
-	cbs->init_root(cur);
-
-	/* We do a 3-way comparison here even though it is less efficient,
-	 * to ensure the callbacks are called in the right way. */
+	bool as_left_child = false;
 
 	while (cur != nullptr) {
-		if (this->cmp(*cur, query)) {
-			cur = cur->NB::get_right();
-			cbs->descend_right(cur);
-		} else if (this->cmp(query, *cur)) {
+		if constexpr (Options::micro_prefetch) {
+			__builtin_prefetch(cur->NB::get_left());
+			__builtin_prefetch(cur->NB::get_right());
+		}
+
+		parent = cur;
+		if (this->cmp(query, *cur)) {
+			as_left_child = true;
 			cur = cur->NB::get_left();
-			cbs->descend_left(cur);
+		} else if (this->cmp(*cur, query)) {
+			as_left_child = false;
+			cur = cur->NB::get_right();
 		} else {
-			cbs->found(cur);
-			return iterator<false>(cur);
+			return InsertHandle(cur, true, false);
 		}
 	}
 
-	cbs->not_found();
-	return this->end();
+	return InsertHandle(parent, false, as_left_child);
 }
 
 template <class Node, class Options, class Tag, class Compare,
@@ -658,6 +2169,11 @@ Node *
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::get_first_equal(
     Node * n) noexcept
 {
+	if constexpr (Options::compress_duplicates) {
+		// Only the first node of every group is in the tree
+		return NodeInterface::get_representative(n);
+	}
+
 	auto it = this->iterator_to(*n);
 	if (it == this->begin()) {
 		return n;
@@ -682,53 +2198,63 @@ typename BinarySearchTree<Node, Options, Tag, Compare,
 BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::find(
     const Comparable & query) CMP_NOEXCEPT(query)
 {
+	if constexpr (Options::no_parent_pointers) {
+		// The lower bound is always the first equal element.
+		auto it = this->lower_bound(query);
+		if ((it != this->end()) && !this->cmp(query, *it)) {
+			return it;
+		}
+		return this->end();
+	} else {
 #ifdef YGG_STORE_SEQUENCE
-	this->bss.register_search(reinterpret_cast<const void *>(&query),
-	                          Options::SequenceInterface::get_key(query));
+		this->bss.register_search(reinterpret_cast<const void *>(&query),
+		                          Options::SequenceInterface::get_key(query));
 #endif
 
-	Node * cur = this->root;
-	Node * last_left = nullptr;
+		Node * cur = this->root;
+		Node * last_left = nullptr;
 
-	while (cur != nullptr) {
+		while (cur != nullptr) {
 
-		if constexpr (Options::micro_prefetch) {
-			__builtin_prefetch(cur->NB::get_left());
-			__builtin_prefetch(cur->NB::get_right());
-		}
+			if constexpr (Options::micro_prefetch) {
+				__builtin_prefetch(cur->NB::get_left());
+				__builtin_prefetch(cur->NB::get_right());
+			}
 
-		if constexpr (Options::micro_avoid_conditionals) {
-			(void)last_left;
+			if constexpr (Options::micro_avoid_conditionals) {
+				(void)last_left;
 
-			if (__builtin_expect(
-			        (!this->cmp(*cur, query)) && (!this->cmp(query, *cur)), false)) {
-				if constexpr (ensure_first) {
-					cur = this->get_first_equal(cur);
+				if (__builtin_expect((!this->cmp(*cur, query)) &&
+				                         (!this->cmp(query, *cur)),
+				                     false)) {
+					if constexpr (ensure_first) {
+						cur = this->get_first_equal(cur);
+					}
+					return iterator<false>(cur);
 				}
-				return iterator<false>(cur);
-			}
-			cur = utilities::go_right_if(this->cmp(*cur, query), cur);
-		} else {
-			if (this->cmp(*cur, query)) {
-				cur = cur->NB::get_right();
+				cur = utilities::go_right_if(this->cmp(*cur, query), cur);
 			} else {
-				last_left = cur;
-				cur = cur->NB::get_left();
+				if (this->cmp(*cur, query)) {
+					cur = cur->NB::get_right();
+				} else {
+					last_left = cur;
+					cur = cur->NB::get_left();
+				}
 			}
 		}
-	}
 
-	if constexpr (!Options::micro_avoid_conditionals) {
-		if ((last_left != nullptr) && (!this->cmp(query, *last_left))) {
-			if constexpr (ensure_first) {
-				last_left = this->get_first_equal(last_left);
+		if constexpr (!Options::micro_avoid_conditionals) {
+			if ((last_left != nullptr) && (!this->cmp(query, *last_left))) {
+				if constexpr (ensure_first) {
+					last_left = this->get_first_equal(last_left);
+				}
+				return iterator<false>(last_left);
+			} else {
+				return this->end();
 			}
-			return iterator<false>(last_left);
 		} else {
 			return this->end();
 		}
-	} else {
-		return this->end();
 	}
 }
 
@@ -760,23 +2286,40 @@ BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::lower_bound(
 	                          Options::SequenceInterface::get_key(query));
 #endif
 
-	// TODO avoid conditionals!
-	Node * cur = this->root;
-	Node * last_left = nullptr;
+	if constexpr (Options::no_parent_pointers) {
+		// Record the descent, then cut it back to where we last went left.
+		iterator<false> it;
+		size_t last_left_depth = 0;
+		for (Node * cur = this->root; cur != nullptr;) {
+			it.push(cur);
+			if (this->cmp(*cur, query)) {
+				cur = cur->NB::get_right();
+			} else {
+				last_left_depth = it.get_depth();
+				cur = cur->NB::get_left();
+			}
+		}
+		it.truncate(last_left_depth);
+		return it;
+	} else {
+		// TODO avoid conditionals!
+		Node * cur = this->root;
+		Node * last_left = nullptr;
 
-	while (cur != nullptr) {
-		if (this->cmp(*cur, query)) {
-			cur = cur->NB::get_right();
-		} else {
-			last_left = cur;
-			cur = cur->NB::get_left();
+		while (cur != nullptr) {
+			if (this->cmp(*cur, query)) {
+				cur = cur->NB::get_right();
+			} else {
+				last_left = cur;
+				cur = cur->NB::get_left();
+			}
 		}
-	}
 
-	if (last_left != nullptr) {
-		return iterator<false>(last_left);
-	} else {
-		return this->end();
+		if (last_left != nullptr) {
+			return iterator<false>(last_left);
+		} else {
+			return this->end();
+		}
 	}
 }
 
@@ -793,23 +2336,39 @@ BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::upper_bound(
 	                          Options::SequenceInterface::get_key(query));
 #endif
 
-	// TODO avoid conditionals!
-	Node * cur = this->root;
-	Node * last_left = nullptr;
+	if constexpr (Options::no_parent_pointers) {
+		iterator<false> it;
+		size_t last_left_depth = 0;
+		for (Node * cur = this->root; cur != nullptr;) {
+			it.push(cur);
+			if (this->cmp(query, *cur)) {
+				last_left_depth = it.get_depth();
+				cur = cur->NB::get_left();
+			} else {
+				cur = cur->NB::get_right();
+			}
+		}
+		it.truncate(last_left_depth);
+		return it;
+	} else {
+		// TODO avoid conditionals!
+		Node * cur = this->root;
+		Node * last_left = nullptr;
 
-	while (cur != nullptr) {
-		if (this->cmp(query, *cur)) {
-			last_left = cur;
-			cur = cur->get_left();
-		} else {
-			cur = cur->get_right();
+		while (cur != nullptr) {
+			if (this->cmp(query, *cur)) {
+				last_left = cur;
+				cur = cur->get_left();
+			} else {
+				cur = cur->get_right();
+			}
 		}
-	}
 
-	if (last_left != nullptr) {
-		return iterator<false>(last_left);
-	} else {
-		return this->end();
+		if (last_left != nullptr) {
+			return iterator<false>(last_left);
+		} else {
+			return this->end();
+		}
 	}
 }
 
@@ -835,6 +2394,314 @@ BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::lower_bound(
 	return const_iterator<false>(const_cast<MyClass *>(this)->lower_bound(query));
 }
 
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Comparable>
+std::pair<typename BinarySearchTree<Node, Options, Tag, Compare,
+                                    ParentContainer>::template iterator<false>,
+          typename BinarySearchTree<Node, Options, Tag, Compare,
+                                    ParentContainer>::template iterator<false>>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::equal_range(
+    const Comparable & query) CMP_NOEXCEPT(query)
+{
+	if constexpr (Options::compress_duplicates) {
+		auto lower = this->lower_bound(query);
+		if ((lower == this->end()) || this->cmp(query, *lower)) {
+			return {lower, lower};
+		}
+
+		// The range ends after the last node of the group
+		iterator<false> upper(NodeInterface::get_last_dup(&(*lower)));
+		++upper;
+		return {lower, upper};
+	} else {
+		return {this->lower_bound(query), this->upper_bound(query)};
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Comparable>
+std::pair<typename BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::
+              template const_iterator<false>,
+          typename BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::
+              template const_iterator<false>>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::equal_range(
+    const Comparable & query) const CMP_NOEXCEPT(query)
+{
+	auto range = const_cast<MyClass *>(this)->equal_range(query);
+	return {const_iterator<false>(range.first),
+	        const_iterator<false>(range.second)};
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Comparable>
+size_t
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::count(
+    const Comparable & query) const CMP_NOEXCEPT(query)
+{
+	auto it = this->lower_bound(query);
+	if constexpr (Options::compress_duplicates) {
+		if ((it == this->end()) || this->cmp(query, *it)) {
+			return 0;
+		}
+		return group_size(*it);
+	} else {
+		size_t count = 0;
+		while ((it != this->end()) && !this->cmp(query, *it)) {
+			++it;
+			++count;
+		}
+		return count;
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+typename BinarySearchTree<Node, Options, Tag, Compare,
+                          ParentContainer>::InsertHandle
+BinarySearchTree<Node, Options, Tag, Compare,
+                 ParentContainer>::prepare_insert_near(const Node & node,
+                                                       Node & hint)
+    CMP_NOEXCEPT(node)
+{
+	// insert() sends equal nodes to the left, i.e., it searches the lower bound
+	Node * last_left;
+	Node * cur = this->template climb_from_hint<false>(node, &hint, last_left);
+
+	Node * parent = nullptr;
+	bool as_left_child = false;
+	while (cur != nullptr) {
+		parent = cur;
+		as_left_child = !this->cmp(*cur, node);
+		if (as_left_child) {
+			cur = cur->NB::get_left();
+		} else {
+			cur = cur->NB::get_right();
+		}
+	}
+
+	return InsertHandle(parent, false, as_left_child);
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <bool strict, class Comparable>
+Node *
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::climb_from_hint(
+    const Comparable & query, Node * hint, Node *& last_left)
+    CMP_NOEXCEPT(query)
+{
+	// Whether the search for <query> descends into the left subtree of n
+	auto goes_left = [&](const Node & n) {
+		if constexpr (strict) {
+			return this->cmp(query, n);
+		} else {
+			return !this->cmp(n, query);
+		}
+	};
+
+	/* The search for <query> from the root passes through a node if all
+	 * ancestors of the node send it the way towards the node. It suffices to
+	 * check this up to the first ancestor that we ascended to from the left and
+	 * the first that we ascended to from the right: Their keys enclose all keys
+	 * in the subtree, and all ancestors further up lie on the same side of
+	 * these two as the subtree. If an ancestor sends the search the other way,
+	 * the search must start at that ancestor instead.
+	 *
+	 * The last node at which the search went left before reaching the start of
+	 * the descent is the first ancestor that we ascended to from the left.
+	 */
+	bool left_seen = false;
+	bool right_seen = false;
+	last_left = nullptr;
+
+	if constexpr (Options::compress_duplicates) {
+		// Duplicates are not in the tree, climb from their representative
+		hint = NodeInterface::get_representative(hint);
+	}
+
+	Node * sub = hint;
+	Node * cur = sub;
+	while ((cur != nullptr) && !(left_seen && right_seen)) {
+		Node * parent = cur->NB::get_parent();
+		if (parent == nullptr) {
+			break;
+		}
+		const bool ascended_left = (parent->NB::get_left() == cur);
+
+		if (ascended_left != goes_left(*parent)) {
+			// Wrong turn, start at the parent
+			sub = parent;
+			left_seen = false;
+			right_seen = false;
+			last_left = nullptr;
+		} else if (ascended_left) {
+			if (!left_seen) {
+				last_left = parent;
+			}
+			left_seen = true;
+		} else {
+			right_seen = true;
+		}
+
+		cur = parent;
+	}
+
+	return sub;
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <bool strict, class Comparable>
+typename BinarySearchTree<Node, Options, Tag, Compare,
+                          ParentContainer>::template iterator<false>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::bound_from_hint(
+    const Comparable & query, iterator<false> hint) CMP_NOEXCEPT(query)
+{
+	// Whether the search for <query> descends into the left subtree of n
+	auto goes_left = [&](const Node & n) {
+		if constexpr (strict) {
+			return this->cmp(query, n);
+		} else {
+			return !this->cmp(n, query);
+		}
+	};
+
+	if constexpr (Options::no_parent_pointers) {
+		// The iterator knows the path from the root, we climb up along it. See
+		// climb_from_hint() for why this works.
+		bool left_seen = false;
+		bool right_seen = false;
+
+		if (hint.get_depth() == 0) {
+			// end() as hint: start at the root
+			if (this->root == nullptr) {
+				return hint;
+			}
+			hint.push(this->root);
+		}
+
+		size_t sub_depth = hint.get_depth();
+		size_t last_left_depth = 0;
+		for (size_t depth = sub_depth - 1;
+		     (depth > 0) && !(left_seen && right_seen); --depth) {
+			const Node * parent = hint.get_node_at(depth - 1);
+			const bool ascended_left =
+			    (parent->NB::get_left() == hint.get_node_at(depth));
+
+			if (ascended_left != goes_left(*parent)) {
+				// Wrong turn, start at the parent
+				sub_depth = depth;
+				left_seen = false;
+				right_seen = false;
+				last_left_depth = 0;
+			} else if (ascended_left) {
+				if (!left_seen) {
+					last_left_depth = depth;
+				}
+				left_seen = true;
+			} else {
+				right_seen = true;
+			}
+		}
+
+		hint.truncate(sub_depth);
+		for (Node * cur = hint.get_node_at(sub_depth - 1); cur != nullptr;) {
+			if (goes_left(*cur)) {
+				last_left_depth = hint.get_depth();
+				cur = cur->NB::get_left();
+			} else {
+				cur = cur->NB::get_right();
+			}
+			if (cur != nullptr) {
+				hint.push(cur);
+			}
+		}
+
+		hint.truncate(last_left_depth);
+		return hint;
+	} else {
+		// With end() as hint, start at the root
+		Node * last_left = nullptr;
+		Node * cur = this->template climb_from_hint<strict>(
+		    query, (hint == this->end()) ? this->root : &(*hint), last_left);
+
+		while (cur != nullptr) {
+			if constexpr (Options::micro_prefetch) {
+				__builtin_prefetch(cur->NB::get_left());
+				__builtin_prefetch(cur->NB::get_right());
+			}
+
+			if (goes_left(*cur)) {
+				last_left = cur;
+				cur = cur->NB::get_left();
+			} else {
+				cur = cur->NB::get_right();
+			}
+		}
+
+		if (last_left != nullptr) {
+			return iterator<false>(last_left);
+		} else {
+			return this->end();
+		}
+	}
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Comparable>
+typename BinarySearchTree<Node, Options, Tag, Compare,
+                          ParentContainer>::template iterator<false>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::lower_bound(
+    const Comparable & query, iterator<false> hint) CMP_NOEXCEPT(query)
+{
+#ifdef YGG_STORE_SEQUENCE
+	this->bss.register_lbound(reinterpret_cast<const void *>(&query),
+	                          Options::SequenceInterface::get_key(query));
+#endif
+
+	return this->template bound_from_hint<false>(query, hint);
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Comparable>
+typename BinarySearchTree<Node, Options, Tag, Compare,
+                          ParentContainer>::template iterator<false>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::upper_bound(
+    const Comparable & query, iterator<false> hint) CMP_NOEXCEPT(query)
+{
+#ifdef YGG_STORE_SEQUENCE
+	this->bss.register_ubound(reinterpret_cast<const void *>(&query),
+	                          Options::SequenceInterface::get_key(query));
+#endif
+
+	return this->template bound_from_hint<true>(query, hint);
+}
+
+template <class Node, class Options, class Tag, class Compare,
+          class ParentContainer>
+template <class Comparable>
+typename BinarySearchTree<Node, Options, Tag, Compare,
+                          ParentContainer>::template iterator<false>
+BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>::find(
+    const Comparable & query, iterator<false> hint) CMP_NOEXCEPT(query)
+{
+#ifdef YGG_STORE_SEQUENCE
+	this->bss.register_search(reinterpret_cast<const void *>(&query),
+	                          Options::SequenceInterface::get_key(query));
+#endif
+
+	auto it = this->template bound_from_hint<false>(query, hint);
+	if ((it != this->end()) && !this->cmp(query, *it)) {
+		return it;
+	}
+	return this->end();
+}
+
 template <class Node, class Options, class Tag, class Compare,
           class ParentContainer>
 Node *
@@ -6,10 +6,15 @@
 #include "tree_iterator.hpp"
 #include "util.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
 #include <set>
 #include <type_traits>
+#include <utility>
 
 #ifdef YGG_STORE_SEQUENCE
 #include "benchmark_sequence.hpp"
@@ -44,6 +49,190 @@ private:
 	Node * _bst_parent;
 };
 
+/**
+ * @brief A link to a node, stored as 32-bit index into the node pool
+ *
+ * This is used instead of a Node * if the POOL_RELATIVE_LINKS option is set.
+ * It behaves like a pointer: It converts implicitly to Node * and can be
+ * assigned from a Node *.
+ */
+template <class Node, class Options>
+class RelativeLink {
+public:
+	using Pool = typename Options::LinkPool;
+	static constexpr std::uint32_t null_index = ~std::uint32_t{0};
+
+	RelativeLink() noexcept = default;
+	explicit RelativeLink(Node * node) noexcept;
+	RelativeLink & operator=(Node * node) noexcept;
+
+	operator Node *() const noexcept;
+	Node * operator->() const noexcept;
+	Node & operator*() const noexcept;
+
+	[[gnu::always_inline]] static inline std::uint32_t
+	to_index(Node * node) noexcept;
+	[[gnu::always_inline]] static inline Node *
+	from_index(std::uint32_t index) noexcept;
+
+private:
+	std::uint32_t index;
+};
+
+template <class Node, class Options>
+class RelativeParentContainer {
+public:
+	Node * get_parent() const noexcept;
+	void set_parent(Node * parent) noexcept;
+	static constexpr bool parent_reference = false;
+
+private:
+	RelativeLink<Node, Options> _bst_parent;
+};
+
+/**
+ * @brief A parent container that does not store anything
+ *
+ * This is used if the NO_PARENT_POINTERS option is set. Setting the parent is
+ * a no-op, and there is no way of retrieving the parent of a node.
+ */
+template <class Node>
+class NoParentContainer {
+public:
+	void set_parent(Node * parent) noexcept;
+	static constexpr bool parent_reference = false;
+};
+
+/* The type in which links to nodes are stored, depending on whether
+ * POOL_RELATIVE_LINKS is set. */
+template <class Node, class Options>
+using NodeLink = std::conditional_t<Options::pool_relative_links,
+                                    RelativeLink<Node, Options>, Node *>;
+
+template <class Node, class Options>
+using DefaultParentContainerFor = std::conditional_t<
+    Options::no_parent_pointers, NoParentContainer<Node>,
+    std::conditional_t<Options::pool_relative_links,
+                       RelativeParentContainer<Node, Options>,
+                       DefaultParentContainer<Node>>>;
+
+/**
+ * @brief Stores the in-order predecessor and successor of a node
+ *
+ * This is used if the THREADED option is set.
+ */
+template <class Node, class Options>
+class ThreadContainer {
+public:
+	Node * get_prev() const noexcept;
+	Node * get_next() const noexcept;
+	void set_prev(Node * prev) noexcept;
+	void set_next(Node * next) noexcept;
+
+private:
+	NodeLink<Node, Options> _bst_prev;
+	NodeLink<Node, Options> _bst_next;
+};
+
+/**
+ * @brief A thread container that does not store anything
+ *
+ * This is used if the THREADED option is not set.
+ */
+class NoThreadContainer {
+};
+
+template <class Node, class Options>
+using ThreadContainerFor =
+    std::conditional_t<Options::threaded, ThreadContainer<Node, Options>,
+                       NoThreadContainer>;
+
+/**
+ * @brief Stores the list of nodes equal to a node
+ *
+ * This is used if the COMPRESS_DUPLICATES option is set. For a node in the
+ * tree (a representative), <prev> and <next> are the last and first node of
+ * the list hanging off it, and <count> is the size of the group including the
+ * representative. For a node in the list, <prev> and <next> are its neighbors
+ * in the list and <count> is zero.
+ */
+template <class Node, class Options>
+class DuplicateContainer {
+public:
+	Node * get_prev() const noexcept;
+	Node * get_next() const noexcept;
+	size_t get_count() const noexcept;
+	void set_prev(Node * prev) noexcept;
+	void set_next(Node * next) noexcept;
+	void set_count(size_t count) noexcept;
+
+private:
+	NodeLink<Node, Options> _bst_dup_prev;
+	NodeLink<Node, Options> _bst_dup_next;
+	size_t _bst_dup_count;
+};
+
+/**
+ * @brief A duplicate container that does not store anything
+ *
+ * This is used if the COMPRESS_DUPLICATES option is not set.
+ */
+class NoDuplicateContainer {
+};
+
+template <class Node, class Options>
+using DuplicateContainerFor =
+    std::conditional_t<Options::compress_duplicates,
+                       DuplicateContainer<Node, Options>, NoDuplicateContainer>;
+
+/**
+ * @brief Stores the smallest and largest node of a tree
+ *
+ * This is used if the CACHED_EXTREMES option is set. Otherwise, it does not
+ * store anything.
+ */
+template <class Node, bool enable>
+class ExtremesHolder {
+public:
+	Node * smallest = nullptr;
+	Node * largest = nullptr;
+};
+
+template <class Node>
+class ExtremesHolder<Node, false> {
+};
+
+/**
+ * @brief The header of a tree structure, see RBTree::write_structure()
+ *
+ * A written structure consists of this header, followed by one fixed-size
+ * record per node in pre-order. Duplicates (see TreeFlags::COMPRESS_DUPLICATES)
+ * directly follow their representative. A record holds the node's index (in
+ * <index_bytes> bytes), a flags byte and <meta_bytes> bytes of data specific to
+ * the kind of tree. All numbers are stored in native byte order.
+ */
+class StructureHeader {
+public:
+	static constexpr char MAGIC[4] = {'Y', 'G', 'G', 'S'};
+	static constexpr std::uint8_t VERSION = 1;
+
+	enum class Kind : std::uint8_t { RBTREE = 1, WBTREE = 2, ZTREE = 3 };
+
+	// Flags of a record
+	static constexpr std::uint8_t HAS_LEFT = 1;
+	static constexpr std::uint8_t HAS_RIGHT = 2;
+	static constexpr std::uint8_t DUPLICATE = 4;
+	// Free for the concrete tree to use
+	static constexpr std::uint8_t TREE_FLAG = 8;
+
+	char magic[4];
+	std::uint8_t version;
+	Kind kind;
+	std::uint8_t index_bytes;
+	std::uint8_t meta_bytes;
+	std::uint64_t record_count;
+};
+
 // TODO document
 template <class Node>
 class DefaultFindCallbacks {
@@ -74,7 +263,7 @@ public:
 };
 
 template <class Node, class Options, class Tag = int,
-          class ParentContainer = DefaultParentContainer<Node>>
+          class ParentContainer = DefaultParentContainerFor<Node, Options>>
 class BSTNodeBase {
 
 private:
@@ -91,7 +280,12 @@ private:
 	}
 
 protected:
-	ParentContainer _bst_parent;
+	// Takes no space if the container is empty, see NoParentContainer
+	[[no_unique_address]] ParentContainer _bst_parent;
+	// Takes no space if the THREADED option is not set
+	[[no_unique_address]] ThreadContainerFor<Node, Options> _bst_threads;
+	// Takes no space if the COMPRESS_DUPLICATES option is not set
+	[[no_unique_address]] DuplicateContainerFor<Node, Options> _bst_dups;
 
 	template <class InnerNode>
 	friend InnerNode * utilities::go_right_if(bool cond, InnerNode * parent);
@@ -99,7 +293,9 @@ protected:
 	friend InnerNode * utilities::go_left_if(bool cond, InnerNode * parent);
 
 public:
-	Node * _bst_children[2];
+	using Link = NodeLink<Node, Options>;
+
+	Link _bst_children[2];
 	[[gnu::always_inline]] inline void set_parent(Node * new_parent) noexcept;
 	[[gnu::always_inline, gnu::pure]] inline Node * get_parent() const noexcept;
 	template <class InnerPC = ParentContainer>
@@ -110,28 +306,57 @@ public:
 
 	[[gnu::always_inline]] inline void set_left(Node * new_left) noexcept;
 	[[gnu::always_inline]] inline void set_right(Node * new_right) noexcept;
-	[[gnu::always_inline, gnu::pure]] inline Node *& get_left() noexcept;
-	[[gnu::always_inline, gnu::pure]] inline Node *& get_right() noexcept;
-	[[gnu::always_inline, gnu::pure]] inline Node * const &
+	[[gnu::always_inline, gnu::pure]] inline Link & get_left() noexcept;
+	[[gnu::always_inline, gnu::pure]] inline Link & get_right() noexcept;
+	[[gnu::always_inline, gnu::pure]] inline const Link &
 	get_left() const noexcept;
-	[[gnu::always_inline, gnu::pure]] inline Node * const &
+	[[gnu::always_inline, gnu::pure]] inline const Link &
 	get_right() const noexcept;
 
+	// In-order neighbors, only available if the THREADED option is set
+	[[gnu::always_inline, gnu::pure]] inline Node * get_prev() const noexcept;
+	[[gnu::always_inline, gnu::pure]] inline Node * get_next() const noexcept;
+	[[gnu::always_inline]] inline void set_prev(Node * new_prev) noexcept;
+	[[gnu::always_inline]] inline void set_next(Node * new_next) noexcept;
+
+	// Group of equal nodes, only available if the COMPRESS_DUPLICATES option is
+	// set. See DuplicateContainer.
+	[[gnu::always_inline, gnu::pure]] inline Node *
+	get_dup_prev() const noexcept;
+	[[gnu::always_inline, gnu::pure]] inline Node *
+	get_dup_next() const noexcept;
+	[[gnu::always_inline, gnu::pure]] inline size_t
+	get_dup_count() const noexcept;
+	[[gnu::always_inline]] inline void set_dup_prev(Node * new_prev) noexcept;
+	[[gnu::always_inline]] inline void set_dup_next(Node * new_next) noexcept;
+	[[gnu::always_inline]] inline void set_dup_count(size_t count) noexcept;
+
 	// Debugging methods TODO remove this
 	size_t get_depth() const noexcept;
 };
 
 template <class Node, class Options, class Tag = int,
           class Compare = ygg::utilities::flexible_less,
-          class ParentContainer = DefaultParentContainer<Node>>
+          class ParentContainer = DefaultParentContainerFor<Node, Options>>
 class BinarySearchTree {
 public:
 	using MyClass =
 	    BinarySearchTree<Node, Options, Tag, Compare, ParentContainer>;
+	using NodeT = Node;
+	using OptionsT = Options;
+	using CompareT = Compare;
 	// Node Base
 	using NB = BSTNodeBase<Node, Options, Tag, ParentContainer>;
 	static_assert(std::is_base_of<NB, Node>::value,
 	              "Node class not properly derived from BSTNodeBase");
+	static_assert(!(Options::threaded && Options::no_parent_pointers),
+	              "THREADED can not be combined with NO_PARENT_POINTERS.");
+	static_assert(!Options::compress_duplicates || Options::multiple,
+	              "COMPRESS_DUPLICATES requires MULTIPLE.");
+	static_assert(!(Options::compress_duplicates &&
+	                (Options::threaded || Options::no_parent_pointers)),
+	              "COMPRESS_DUPLICATES can not be combined with THREADED or "
+	              "NO_PARENT_POINTERS.");
 
 	/**
 	 * @brief Create a new empty red-black tree.
@@ -202,25 +427,105 @@ private:
 		{
 			return n->NB::get_right();
 		}
+
+		// If set, iterators step along the in-order threads
+		static constexpr bool threaded = Options::threaded;
+
+		[[gnu::always_inline, gnu::const]] static inline Node *
+		get_next(Node * n) noexcept
+		{
+			return n->NB::get_next();
+		}
+
+		[[gnu::always_inline, gnu::const]] static inline Node *
+		get_prev(Node * n) noexcept
+		{
+			return n->NB::get_prev();
+		}
+
+		[[gnu::always_inline, gnu::const]] static inline const Node *
+		get_next(const Node * n) noexcept
+		{
+			return n->NB::get_next();
+		}
+
+		[[gnu::always_inline, gnu::const]] static inline const Node *
+		get_prev(const Node * n) noexcept
+		{
+			return n->NB::get_prev();
+		}
+
+		// If set, iterators visit the group of equal nodes hanging off every
+		// node in the tree, see TreeFlags::COMPRESS_DUPLICATES
+		static constexpr bool compressed = Options::compress_duplicates;
+
+		// The node after <n> in its group, or nullptr if <n> is the last one
+		template <class N>
+		[[gnu::always_inline]] static inline N *
+		get_dup_successor(N * n) noexcept
+		{
+			return n->NB::get_dup_next();
+		}
+
+		// The node before <n> in its group, or nullptr if <n> is in the tree
+		template <class N>
+		[[gnu::always_inline]] static inline N *
+		get_dup_predecessor(N * n) noexcept
+		{
+			if (n->NB::get_dup_count() != 0) {
+				return nullptr;
+			}
+			if (n->NB::get_dup_prev() != nullptr) {
+				return n->NB::get_dup_prev();
+			}
+			return n->NB::get_parent();
+		}
+
+		// The node in the tree that represents the group of <n>
+		template <class N>
+		[[gnu::always_inline]] static inline N *
+		get_representative(N * n) noexcept
+		{
+			if (n->NB::get_dup_count() == 0) {
+				return n->NB::get_parent();
+			}
+			return n;
+		}
+
+		// The last node of the group represented by <n>
+		template <class N>
+		[[gnu::always_inline]] static inline N *
+		get_last_dup(N * n) noexcept
+		{
+			if (n->NB::get_dup_prev() != nullptr) {
+				return n->NB::get_dup_prev();
+			}
+			return n;
+		}
 	};
 
+	/* Without parent pointers, iterators must store the path from the root to
+	 * the node they point to. */
+	template <class ConcreteIterator, class ItNode, bool reverse>
+	using IteratorBaseFor = std::conditional_t<
+	    Options::no_parent_pointers,
+	    internal::PathIteratorBase<ConcreteIterator, ItNode, NodeInterface,
+	                               reverse, Options::max_tree_depth>,
+	    internal::IteratorBase<ConcreteIterator, ItNode, NodeInterface,
+	                           reverse>>;
+
 public:
 	// forward, for friendship
 	template <bool reverse>
 	class const_iterator;
 
 	template <bool reverse>
-	class iterator : public internal::IteratorBase<iterator<reverse>, Node,
-	                                               NodeInterface, reverse> {
+	class iterator : public IteratorBaseFor<iterator<reverse>, Node, reverse> {
 	public:
-		using internal::IteratorBase<iterator<reverse>, Node, NodeInterface,
-		                             reverse>::IteratorBase;
-		iterator(const iterator<reverse> & orig) noexcept
-		    : internal::IteratorBase<iterator<reverse>, Node, NodeInterface,
-		                             reverse>(orig.n){};
-		iterator() noexcept
-		    : internal::IteratorBase<iterator<reverse>, Node, NodeInterface,
-		                             reverse>(){};
+		using Base = IteratorBaseFor<iterator<reverse>, Node, reverse>;
+		using Base::Base;
+		iterator(const iterator<reverse> & orig) noexcept : Base(orig){};
+		iterator() noexcept : Base(){};
 
 		iterator<reverse> &
 		operator=(const iterator<reverse> & orig) noexcept = default;
@@ -231,20 +536,14 @@ public:
 
 	template <bool reverse>
 	class const_iterator
-	    : public internal::IteratorBase<const_iterator<reverse>, const Node,
-	                                    NodeInterface, reverse> {
+	    : public IteratorBaseFor<const_iterator<reverse>, const Node, reverse> {
 	public:
-		using internal::IteratorBase<const_iterator<reverse>, const Node,
-		                             NodeInterface, reverse>::IteratorBase;
+		using Base = IteratorBaseFor<const_iterator<reverse>, const Node, reverse>;
+		using Base::Base;
 		const_iterator(const const_iterator<reverse> & orig) noexcept
-		    : internal::IteratorBase<const_iterator<reverse>, const Node,
-		                             NodeInterface, reverse>(orig.n){};
-		const_iterator(const iterator<reverse> & orig) noexcept
-		    : internal::IteratorBase<const_iterator<reverse>, const Node,
-		                             NodeInterface, reverse>(orig.n){};
-		const_iterator() noexcept
-		    : internal::IteratorBase<const_iterator<reverse>, const Node,
-		                             NodeInterface, reverse>(){};
+		    : Base(orig){};
+		const_iterator(const iterator<reverse> & orig) noexcept : Base(orig){};
+		const_iterator() noexcept : Base(){};
 
 		const_iterator<reverse> &
 		operator=(const const_iterator<reverse> & orig) noexcept = default;
@@ -260,6 +559,19 @@ protected:
 	// TODO document
 	inline Node * get_first_equal(Node * n) noexcept;
 
+	// Climbs from <hint> to the node at which the search for <query> may start,
+	// see bound_from_hint(). <last_left> is set to the last node above it at
+	// which the search goes left. Requires parent pointers.
+	template <bool strict, class Comparable>
+	Node * climb_from_hint(const Comparable & query, Node * hint,
+	                       Node *& last_left) CMP_NOEXCEPT(query);
+
+	// Shared implementation of the hinted lower_bound() (strict == false) and
+	// upper_bound() (strict == true)
+	template <bool strict, class Comparable>
+	iterator<false> bound_from_hint(const Comparable & query,
+	                                iterator<false> hint) CMP_NOEXCEPT(query);
+
 public:
 	// TODO document ensure_firstx
 	/**
@@ -294,6 +606,99 @@ public:
 	template <class Comparable, class Callbacks = DefaultFindCallbacks<Node>>
 	iterator<false> find(const Comparable & query, Callbacks * cbs);
 
+	/**
+	 * @brief Finds many elements in the tree at once
+	 *
+	 * Performs one find() for every element in [<keys_begin>, <keys_end>) and
+	 * writes the resulting iterators to <out>, i.e., the result for the i-th
+	 * query is written to out[i]. The result for each query is the same as
+	 * what find() would have returned for that query.
+	 *
+	 * Instead of descending the tree for one query after the other, up to
+	 * <group_size> descents are advanced in a round-robin fashion. Every step
+	 * prefetches the next node of the respective descent, such that the cache
+	 * misses of independent queries overlap. As soon as one descent finishes,
+	 * its slot is refilled with the next query.
+	 *
+	 * @warning Not available for explicitly ordered trees
+	 *
+	 * @tparam group_size The number of descents that are in flight at the same
+	 * time.
+	 * @param keys_begin  Forward iterator to the first query. Queries must be
+	 * comparable to Node, see find().
+	 * @param keys_end    Forward iterator past the last query
+	 * @param out         Random-access iterator to the first result. There must
+	 * be room for as many results as there are queries.
+	 */
+	template <size_t group_size = 8, class InputIt, class OutputIt>
+	void find_batch(InputIt keys_begin, InputIt keys_end, OutputIt out)
+	    CMP_NOEXCEPT(*keys_begin);
+
+	/**
+	 * @brief The result of find_or_prepare_insert()
+	 *
+	 * Either refers to an existing node that compared equally to the query, or
+	 * describes the position at which a node comparing equally to the query can
+	 * be inserted. In the latter case, pass it to the tree's insert_at().
+	 *
+	 * The handle becomes invalid as soon as the tree is modified.
+	 */
+	class InsertHandle {
+	public:
+		InsertHandle() noexcept;
+
+		/**
+		 * @brief Returns whether an element comparing equally to the query exists
+		 *
+		 * @return true if get_node() returns the existing element
+		 */
+		bool found() const noexcept;
+
+		/**
+		 * @brief Returns the existing element
+		 *
+		 * @return The element comparing equally to the query, or nullptr if
+		 * there is no such element
+		 */
+		Node * get_node() const noexcept;
+
+		/// @cond INTERNAL
+		InsertHandle(Node * node, bool exists, bool as_left_child) noexcept;
+
+		// The node that must become the parent of the inserted node. May be
+		// nullptr if the tree is empty.
+		Node * get_parent() const noexcept;
+		bool is_left_child() const noexcept;
+		/// @endcond
+
+	private:
+		// The existing node if exists is true, otherwise the parent
+		Node * node;
+		bool exists;
+		bool as_left_child;
+	};
+
+	/**
+	 * @brief Finds an element or the position at which it should be inserted
+	 *
+	 * For the common "insert if not present" pattern, calling find() and then
+	 * insert() descends the tree twice. This method descends only once. If an
+	 * element comparing equally to <query> exists, the returned handle's
+	 * get_node() returns it. Otherwise, the handle can be passed to the tree's
+	 * insert_at() together with a node that compares equally to <query>, which
+	 * inserts the node without searching again.
+	 *
+	 * See find() for the requirements on <query>.
+	 *
+	 * @warning Not available for explicitly ordered trees
+	 *
+	 * @param query An object comparable to Node
+	 * @return A handle to the existing element or to the insertion position
+	 */
+	template <class Comparable>
+	InsertHandle find_or_prepare_insert(const Comparable & query)
+	    CMP_NOEXCEPT(query);
+
 	/**
 	 * @brief Upper-bounds an element
 	 *
@@ -349,6 +754,109 @@ public:
 	template <class Comparable>
 	iterator<false> lower_bound(const Comparable & query) CMP_NOEXCEPT(query);
 
+	/**
+	 * @brief Returns the range of elements comparing equally to <query>
+	 *
+	 * Returns the pair (lower_bound(query), upper_bound(query)). If the
+	 * COMPRESS_DUPLICATES option is set, this needs only a single descent, since
+	 * the end of the range is the successor of the last duplicate of the first
+	 * element.
+	 *
+	 * See lower_bound(query) for the requirements on <query>.
+	 *
+	 * @warning Not available for explicitly ordered trees
+	 *
+	 * @param query An object comparable to Node
+	 * @returns A pair of iterators delimiting the range of elements comparing
+	 * equally to <query>
+	 */
+	template <class Comparable>
+	std::pair<const_iterator<false>, const_iterator<false>>
+	equal_range(const Comparable & query) const CMP_NOEXCEPT(query);
+	template <class Comparable>
+	std::pair<iterator<false>, iterator<false>>
+	equal_range(const Comparable & query) CMP_NOEXCEPT(query);
+
+	/**
+	 * @brief Counts the elements comparing equally to <query>
+	 *
+	 * This runs in O(log n + k) for k equal elements. If the
+	 * COMPRESS_DUPLICATES option is set, the size of the group is stored in the
+	 * tree, and this runs in O(log n).
+	 *
+	 * See lower_bound(query) for the requirements on <query>.
+	 *
+	 * @warning Not available for explicitly ordered trees
+	 *
+	 * @param query An object comparable to Node
+	 * @returns The number of elements comparing equally to <query>
+	 */
+	template <class Comparable>
+	size_t count(const Comparable & query) const CMP_NOEXCEPT(query);
+
+	/**
+	 * @brief Lower-bounds an element, starting the search at a hint
+	 *
+	 * Returns the same as lower_bound(query), but instead of descending from
+	 * the root, the search climbs up from <hint> until the position of <query>
+	 * is bracketed by the nodes on the way, and then descends from there. If
+	 * the result is d elements away from <hint>, this only visits O(log d)
+	 * nodes on balanced trees. This pays off if consecutive queries are close
+	 * to each other, e.g., if they are (nearly) sorted and the result of the
+	 * previous query is passed as hint.
+	 *
+	 * See lower_bound(query) for the requirements on <query>.
+	 *
+	 * @warning Not available for explicitly ordered trees
+	 *
+	 * @param query An object comparable to Node that should be lower-bounded
+	 * @param hint  An iterator into this tree at which the search starts. If
+	 * this is end(), the search starts at the root.
+	 * @returns An iterator to the first element comparing greater-or-equally to
+	 * <query>, or end() if no such element exists
+	 */
+	template <class Comparable>
+	iterator<false> lower_bound(const Comparable & query, iterator<false> hint)
+	    CMP_NOEXCEPT(query);
+
+	/**
+	 * @brief Upper-bounds an element, starting the search at a hint
+	 *
+	 * Returns the same as upper_bound(query). See lower_bound(query, hint) for
+	 * how <hint> is used.
+	 *
+	 * @warning Not available for explicitly ordered trees
+	 *
+	 * @param query An object comparable to Node that should be upper-bounded
+	 * @param hint  An iterator into this tree at which the search starts. If
+	 * this is end(), the search starts at the root.
+	 * @returns An iterator to the first element comparing "greater" to <query>,
+	 * or end() if no such element exists
+	 */
+	template <class Comparable>
+	iterator<false> upper_bound(const Comparable & query, iterator<false> hint)
+	    CMP_NOEXCEPT(query);
+
+	/**
+	 * @brief Finds an element, starting the search at a hint
+	 *
+	 * Returns an iterator to the first element that compares equally to
+	 * <query>. See lower_bound(query, hint) for how <hint> is used, and
+	 * find(query) for the requirements on <query>.
+	 *
+	 * @warning Not available for explicitly ordered trees
+	 *
+	 * @param query An object comparing equally to the element that should be
+	 * found.
+	 * @param hint  An iterator into this tree at which the search starts. If
+	 * this is end(), the search starts at the root.
+	 * @returns An iterator to the first element comparing equally to <query>, or
+	 * end() if no such element exists
+	 */
+	template <class Comparable>
+	iterator<false> find(const Comparable & query, iterator<false> hint)
+	    CMP_NOEXCEPT(query);
+
 	/**
 	 * @brief Debugging Method: Draw the Tree as a .dot file
 	 *
@@ -406,6 +914,9 @@ public:
 	/**
 	 * Returns an iterator pointing to the entry held in node.
 	 *
+	 * This runs in O(1), except if NO_PARENT_POINTERS is set. Then, the node
+	 * must be searched from the root, which takes O(log n).
+	 *
 	 * @param node  The node the iterator should point to.
 	 */
 	const_iterator<false> iterator_to(const Node & node) const noexcept;
@@ -439,6 +950,20 @@ public:
 	 */
 	bool empty() const noexcept;
 
+	/**
+	 * @brief Returns the number of modifications made to this tree
+	 *
+	 * Every operation that changes the set of nodes in the tree (insertion,
+	 * removal, split, join, clearing, …) increases this count. Use it to
+	 * detect whether a tree has changed since some earlier point in time.
+	 *
+	 * @warning This method is only available if MODIFICATION_COUNTER is set as
+	 * option!
+	 *
+	 * @return The number of modifications made to this tree
+	 */
+	size_t get_modification_count() const noexcept;
+
 	// TODO document
 	// TODO do we need them anymore?
 	Node * get_root() const noexcept;
@@ -460,9 +985,122 @@ protected:
 	Node * get_largest() const noexcept;
 	Node * get_uncle(Node * node) const noexcept;
 
+	/* Parent lookup that also works without parent pointers. Without parent
+	 * pointers, find_parent() runs in O(log n) and parent_of() reads the
+	 * parent from the path stored in the iterator. */
+	Node * find_parent(Node & node) noexcept;
+	template <class Iterator>
+	static Node * parent_of(const Iterator & it) noexcept;
+	template <class PathIterator>
+	bool build_path_to(Node * sub_root, const Node * target,
+	                   PathIterator & it) noexcept;
+
+	// Finds the leaf position at which insert() would place <node>, searching
+	// from <hint> instead of the root. Requires parent pointers.
+	InsertHandle prepare_insert_near(const Node & node, Node & hint)
+	    CMP_NOEXCEPT(node);
+
+	// The smallest / largest node in the subtree below <sub_root>
+	static Node * leftmost_in(Node * sub_root) noexcept;
+	static Node * rightmost_in(Node * sub_root) noexcept;
+
+	/* Bookkeeping for the THREADED and CACHED_EXTREMES options. Call
+	 * leaf_attached() after <node> has been attached as leaf below <parent>
+	 * (which is null for a new root), and node_detaching() before <node> is
+	 * removed from below <parent>. Call refresh_extremes() after a bulk
+	 * operation has changed the tree. */
+	void leaf_attached(Node & node, Node * parent) noexcept;
+	void node_detaching(Node & node, Node * parent) noexcept;
+	void refresh_extremes() noexcept;
+
+	/* Maintenance of the in-order threads, see TreeFlags::THREADED. All of
+	 * these are no-ops if the THREADED option is not set. */
+	// Links <node>, which has just been attached as a leaf below <parent>, to
+	// its neighbors.
+	static void thread_leaf(Node & node, Node * parent) noexcept;
+	// Links <node> between <prev> and <next>, either of which may be null
+	static void thread_between(Node * prev, Node & node, Node * next) noexcept;
+	// Links the neighbors of <node> to each other. Call this before removing
+	// <node> from the tree.
+	static void thread_unlink(Node & node) noexcept;
+	// Links the largest node below <left_root>, <pivot> (if not null) and the
+	// smallest node below <right_root>. Call this before joining the subtrees.
+	static void thread_join(Node * left_root, Node * pivot,
+	                        Node * right_root) noexcept;
+	// Cuts the threads between two trees that have just been split
+	static void thread_split(Node * left_root, Node * right_root) noexcept;
+	// Links the neighbors of a subtree to each other and terminates the threads
+	// of the subtree. Call this after the subtree has been cut out.
+	static void thread_cut_out(Node * sub_root) noexcept;
+	// Relinks all threads of the tree in O(n)
+	void rethread() noexcept;
+
+	/* Maintenance of the groups of equal nodes, see
+	 * TreeFlags::COMPRESS_DUPLICATES. Except for is_duplicate(), these must only
+	 * be called if the COMPRESS_DUPLICATES option is set. */
+	// Whether <node> hangs off a representative instead of being in the tree
+	static bool is_duplicate(const Node & node) noexcept;
+	// The number of nodes in the group of the representative <node>. This is 1
+	// if the COMPRESS_DUPLICATES option is not set.
+	static size_t group_size(const Node & node) noexcept;
+	// The last node of the group represented by <rep>
+	static Node * last_in_group(Node & rep) noexcept;
+	// Makes <node> the representative of an otherwise empty group
+	static void init_group(Node & node) noexcept;
+	// Appends <node> to the group of <rep>
+	static void append_duplicate(Node & rep, Node & node) noexcept;
+	// Appends <other_rep> and its whole group to the group of <rep> in O(k),
+	// where k is the size of the appended group. <other_rep> must not be in a
+	// tree anymore.
+	static void merge_groups(Node & rep, Node & other_rep) noexcept;
+	// Removes <node> from its group if it is not in the tree. Returns whether
+	// it was removed.
+	bool remove_duplicate(Node & node) noexcept;
+	// If <rep> has duplicates, moves its first duplicate to its position in the
+	// tree and returns it. Otherwise, returns nullptr.
+	Node * promote_duplicate(Node & rep) noexcept;
+
+	// Size bookkeeping for splitting and joining trees
+	void take_size_from(MyClass & other, size_t additional) noexcept;
+	void distribute_size(MyClass & other, size_t total) noexcept;
+	template <class Consumer>
+	static size_t consume_subtree(Node * sub_root, Consumer && consume);
+
+	/* Relayout into van Emde Boas order, see RBTree::relayout(). <TreeNodeBase>
+	 * is the node base class of the concrete tree. It is copied explicitly,
+	 * since the node's own assignment operator may not copy it. */
+	template <class TreeNodeBase, class Relocate>
+	void relayout_base(Node * arena, Relocate && relocate);
+	static size_t subtree_height(const Node * sub_root) noexcept;
+	// Appends the topmost <height> levels below <sub_root> to <order> in van
+	// Emde Boas order. <scratch> is used as a stack of bottom subtree roots.
+	static void veb_order(Node * sub_root, size_t height,
+	                      std::vector<Node *> & order,
+	                      std::vector<Node *> & scratch);
+	static void collect_at_depth(Node * sub_root, size_t depth,
+	                             std::vector<Node *> & out);
+
+	/* Writing and restoring the structure, see RBTree::write_structure(). The
+	 * concrete tree stores <meta_bytes> bytes plus one flag bit
+	 * (StructureHeader::TREE_FLAG) per node: write_meta(const Node &,
+	 * unsigned char * meta) returns whether the flag is set, and
+	 * read_meta(Node &, bool flag, const unsigned char * meta) reads it back.
+	 * After all nodes have been linked, restore_structure_base() calls
+	 * fix_node(Node &) on every node in the tree, children before parents. */
+	template <size_t meta_bytes, class WriteMeta>
+	void write_structure_base(StructureHeader::Kind kind, const Node * nodes,
+	                          std::ostream & out, WriteMeta && write_meta) const;
+	template <size_t meta_bytes, class ReadMeta, class FixNode>
+	bool restore_structure_base(StructureHeader::Kind kind, Node * nodes,
+	                            size_t node_count, const void * data,
+	                            size_t bytes, ReadMeta && read_meta,
+	                            FixNode && fix_node);
+
 	Compare cmp;
 
-	SizeHolder<Options::constant_time_size> s;
+	SizeHolder<Options::constant_time_size, Options::modification_counter> s;
+	[[no_unique_address]] ExtremesHolder<Node, Options::cached_extremes>
+	    extremes;
 
 	/* What follows are debugging tools */
 	template <class NodeNameGetter>
@@ -475,6 +1113,9 @@ protected:
 
 	// @cond INTERNAL
 	void verify_tree() const;
+	void verify_threads() const;
+	void verify_extremes() const;
+	void verify_duplicates() const;
 	void verify_order() const;
 	void verify_size() const;
 	// @endcond
@@ -503,6 +503,22 @@ InnerZNodeTraits<InnerTree, InnerNode, AggValueT>::unzip_done(
 	InnerTree::rebuild_combiners_recursively(unzip_root);
 }
 
+template <class InnerTree, class InnerNode, class AggValueT>
+void
+InnerZNodeTraits<InnerTree, InnerNode, AggValueT>::inserted_without_unzipping(
+    InnerNode * n) const noexcept
+{
+	(void)n;
+}
+
+template <class InnerTree, class InnerNode, class AggValueT>
+void
+InnerZNodeTraits<InnerTree, InnerNode, AggValueT>::children_changed(
+    InnerNode * n) const noexcept
+{
+	(void)n;
+}
+
 /***************************************************
  * End of node traits
  ***************************************************/
@@ -779,6 +795,19 @@ DynamicSegmentTree<Node, NodeTraits, Combiners, Options, TreeSelector,
 	    Options::SequenceInterface::get_value(n));
 #endif
 
+	this->prepare_inner_nodes(n);
+	this->t.insert(n.NB::start);
+	this->t.insert(n.NB::end);
+
+	this->apply_interval(n);
+}
+
+template <class Node, class NodeTraits, class Combiners, class Options,
+          class TreeSelector, class Tag>
+void
+DynamicSegmentTree<Node, NodeTraits, Combiners, Options, TreeSelector,
+                   Tag>::prepare_inner_nodes(Node & n) noexcept(noexcept_ops)
+{
 	// TODO why are we doing this every time? Should be done once in the
 	// constructor!
 	n.NB::start.point = NodeTraits::get_lower(n);
@@ -789,6 +818,14 @@ DynamicSegmentTree<Node, NodeTraits, Combiners, Options, TreeSelector,
 	n.NB::start.start = true;
 	n.NB::start.container = static_cast<NB *>(&n);
 
+	n.NB::end.point = NodeTraits::get_upper(n);
+	n.NB::end.closed = NodeTraits::is_upper_closed(n);
+	n.NB::end.agg_left = AggValueT();
+	n.NB::end.agg_right = AggValueT();
+
+	n.NB::end.start = false;
+	n.NB::end.container = static_cast<NB *>(&n);
+
 	if constexpr (utilities::is_specialization<TreeSelector, UseZipTree>{} &&
 	              InnerOptions::ztree_use_hash &&
 	              InnerOptions::ztree_store_rank) {
@@ -796,19 +833,72 @@ DynamicSegmentTree<Node, NodeTraits, Combiners, Options, TreeSelector,
 		n.NB::start.update_rank();
 		n.NB::end.update_rank();
 	}
+}
 
-	this->t.insert(n.NB::start);
-	n.NB::end.point = NodeTraits::get_upper(n);
-	n.NB::end.closed = NodeTraits::is_upper_closed(n);
-	n.NB::end.agg_left = AggValueT();
-	n.NB::end.agg_right = AggValueT();
+template <class Node, class NodeTraits, class Combiners, class Options,
+          class TreeSelector, class Tag>
+template <class InputIt>
+void
+DynamicSegmentTree<Node, NodeTraits, Combiners, Options, TreeSelector,
+                   Tag>::build(InputIt first, InputIt last)
+{
+	std::vector<InnerNode *> events;
+	for (; first != last; ++first) {
+		Node & n = *first;
+		this->prepare_inner_nodes(n);
+		events.push_back(&n.NB::start);
+		events.push_back(&n.NB::end);
+	}
 
-	n.NB::end.start = false;
-	n.NB::end.container = static_cast<NB *>(&n);
+	dyn_segtree_internal::Compare<InnerNode> cmp;
+	std::sort(events.begin(), events.end(),
+	          [&](const InnerNode * lhs, const InnerNode * rhs) {
+		          return cmp(*lhs, *rhs);
+	          });
 
-	this->t.insert(n.NB::end);
+	using EventIterator = dyn_segtree_internal::DereferencingIterator<InnerNode>;
+	this->t.build_from_sorted(EventIterator(events.data()),
+	                          EventIterator(events.data() + events.size()));
+
+	// The value of every gap between two events is the sum of the values of all
+	// intervals started before it minus those ended before it. Queries add up
+	// the aggregates along their search path, thus it is sufficient to store the
+	// gaps' values at the edges to the (empty) leaves. The underlying tree may
+	// have reordered equal events, so this must follow the tree's order.
+	AggValueT running = AggValueT();
+	for (InnerNode & e : this->t) {
+		e.agg_left = (e.get_left() == nullptr) ? running : AggValueT();
+		if (e.is_start()) {
+			running += NodeTraits::get_value(*static_cast<Node *>(e.container));
+		} else {
+			running +=
+			    -1 * NodeTraits::get_value(*static_cast<Node *>(e.container));
+		}
+		e.agg_right = (e.get_right() == nullptr) ? running : AggValueT();
+	}
 
-	this->apply_interval(n);
+	// Combiners must be rebuilt bottom-up, i.e., in post-order
+	InnerNode * cur = this->t.get_root();
+	auto descend = [](InnerNode * n) {
+		while ((n->get_left() != nullptr) || (n->get_right() != nullptr)) {
+			n = (n->get_left() != nullptr) ? n->get_left() : n->get_right();
+		}
+		return n;
+	};
+	if (cur != nullptr) {
+		cur = descend(cur);
+	}
+	while (cur != nullptr) {
+		InnerTree::rebuild_combiners_at(cur);
+
+		InnerNode * parent = cur->get_parent();
+		if ((parent != nullptr) && (parent->get_left() == cur) &&
+		    (parent->get_right() != nullptr)) {
+			cur = descend(parent->get_right());
+		} else {
+			cur = parent;
+		}
+	}
 }
 
 template <class Node, class NodeTraits, class Combiners, class Options,
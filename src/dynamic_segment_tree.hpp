@@ -15,7 +15,10 @@
 #include "ziptree.hpp"
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <type_traits>
+#include <vector>
 
 namespace ygg {
 
@@ -427,6 +430,13 @@ public:
 	void unzip_to_right(InnerNode * n) noexcept;
 	void unzip_done(InnerNode * unzip_root, InnerNode * left_spine_end,
 	                InnerNode * right_spine_end) noexcept;
+
+	/*
+	 * The segment tree updates the aggregates of new leaves itself and does
+	 * not use any of the bulk operations.
+	 */
+	void inserted_without_unzipping(InnerNode * n) const noexcept;
+	void children_changed(InnerNode * n) const noexcept;
 };
 
 template <class InnerTree, class InnerNode, class Node, class NodeTraits>
@@ -484,6 +494,60 @@ public:
 	                const PointDescription & rhs) const noexcept;
 };
 
+/*
+ * Iterates over a range of InnerNode pointers, yielding InnerNode &. This is
+ * used to hand the sorted events to build_from_sorted() of the underlying tree.
+ */
+template <class InnerNode>
+class DereferencingIterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = InnerNode;
+	using difference_type = std::ptrdiff_t;
+	using pointer = InnerNode *;
+	using reference = InnerNode &;
+
+	explicit DereferencingIterator(InnerNode * const * pos_in) noexcept
+	    : pos(pos_in)
+	{}
+
+	reference
+	operator*() const noexcept
+	{
+		return **this->pos;
+	}
+
+	DereferencingIterator &
+	operator++() noexcept
+	{
+		++this->pos;
+		return *this;
+	}
+
+	DereferencingIterator
+	operator++(int) noexcept
+	{
+		DereferencingIterator ret = *this;
+		++this->pos;
+		return ret;
+	}
+
+	bool
+	operator==(const DereferencingIterator & other) const noexcept
+	{
+		return this->pos == other.pos;
+	}
+
+	bool
+	operator!=(const DereferencingIterator & other) const noexcept
+	{
+		return this->pos != other.pos;
+	}
+
+private:
+	InnerNode * const * pos;
+};
+
 /*
  * Debugging helpers
  */
@@ -1325,6 +1389,26 @@ public:
 	 */
 	void remove(Node & n) noexcept(noexcept_ops);
 
+	/**
+	 * @brief Builds the dynamic segment tree from a range of intervals
+	 *
+	 * Replaces the contents of the dynamic segment tree with the intervals in
+	 * [first, last). The intervals do not need to be sorted. All their start and
+	 * end events are sorted and linked up via build_from_sorted() of the
+	 * underlying tree, after which the aggregates and combiners are computed in
+	 * two linear passes over the tree. Apart from sorting the events, this runs
+	 * in O(n), while inserting the intervals one by one costs O(log n) per
+	 * event for unzipping or rebalancing plus the contour updates. Any
+	 * intervals previously contained in the dynamic segment tree are discarded
+	 * (as if clear() had been called).
+	 *
+	 * @param first   Iterator to the first node. Dereferencing it must yield a
+	 * Node &.
+	 * @param last    Iterator past the last node.
+	 */
+	template <class InputIt>
+	void build(InputIt first, InputIt last);
+
 	/**
 	 * @brief Returns whether the dynamic segment tree is empty
 	 *
@@ -1498,6 +1582,7 @@ public:
 	std::stringstream & dbg_get_dot() const;
 
 private:
+	void prepare_inner_nodes(Node & n) noexcept(noexcept_ops);
 	void apply_interval(Node & n) noexcept(noexcept_ops);
 	void unapply_interval(Node & n) noexcept(noexcept_ops);
 
@@ -128,6 +128,26 @@ ExtendedNodeTraits<Node, INB, NodeTraits>::swapped(Node & n1, Node & n2,
 	}
 }
 
+template <class Node, class INB, class NodeTraits>
+template <class BaseTree>
+void
+ExtendedNodeTraits<Node, INB, NodeTraits>::children_changed(Node & node,
+                                                            BaseTree & t)
+{
+	(void)t;
+
+	// Nodes are visited bottom-up, thus there is no need to propagate upwards.
+	node.INB::_it_max_upper = NodeTraits::get_upper(node);
+	if (node.get_left() != nullptr) {
+		node.INB::_it_max_upper =
+		    std::max(node.INB::_it_max_upper, node.get_left()->INB::_it_max_upper);
+	}
+	if (node.get_right() != nullptr) {
+		node.INB::_it_max_upper =
+		    std::max(node.INB::_it_max_upper, node.get_right()->INB::_it_max_upper);
+	}
+}
+
 template <class Node, class INB, class NodeTraits>
 typename NodeTraits::key_type
 ExtendedNodeTraits<Node, INB, NodeTraits>::get_lower(
@@ -50,6 +50,8 @@ public:
 	}
 	template <class BaseTree>
 	static void swapped(Node & n1, Node & n2, BaseTree & t);
+	template <class BaseTree>
+	static void children_changed(Node & node, BaseTree & t);
 
 	// Make our DummyRange comparable
 	static typename NodeTraits::key_type get_lower(
@@ -156,9 +158,12 @@ public:
 	void dump_to_dot(const std::string & filename) const;
 
 	/* Import some of RBTree's methods into the public namespace */
+	using BaseTree::build_from_sorted;
 	using BaseTree::empty;
 	using BaseTree::insert;
 	using BaseTree::remove;
+	using BaseTree::restore_structure;
+	using BaseTree::write_structure;
 
 	// Iteration of sets of intervals
 	template <class Comparable>
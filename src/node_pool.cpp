@@ -0,0 +1,261 @@
+#ifndef YGG_NODE_POOL_CPP
+#define YGG_NODE_POOL_CPP
+
+#include "node_pool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace ygg {
+
+namespace node_pool_internal {
+/// @cond INTERNAL
+constexpr size_t HUGE_PAGE_BYTES = size_t{2} * 1024 * 1024;
+constexpr size_t CACHE_LINE_BYTES = 64;
+/// @endcond
+} // namespace node_pool_internal
+
+template <class Node>
+NodePool<Node>::NodePool(NodePoolBacking backing_in, size_t chunk_bytes_in)
+    : backing(backing_in), chunk_bytes(std::max(chunk_bytes_in, sizeof(Slot))),
+      live(0)
+{
+#if !defined(__linux__)
+	this->backing = NodePoolBacking::HEAP;
+#endif
+
+	if (this->backing != NodePoolBacking::HEAP) {
+		constexpr size_t huge = node_pool_internal::HUGE_PAGE_BYTES;
+		this->chunk_bytes = (this->chunk_bytes + huge - 1) / huge * huge;
+	}
+	this->per_chunk = this->chunk_bytes / sizeof(Slot);
+}
+
+template <class Node>
+NodePool<Node>::~NodePool()
+{
+	for (Chunk & c : this->chunks) {
+		this->unmap_chunk(c.slots, c.bytes);
+	}
+}
+
+template <class Node>
+void *
+NodePool<Node>::map_chunk(size_t bytes)
+{
+#if defined(__linux__)
+	if (this->backing == NodePoolBacking::HUGETLB) {
+		void * mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+		                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (mem != MAP_FAILED) {
+			return mem;
+		}
+		// No huge pages reserved - this will not change while we are running.
+		this->backing = NodePoolBacking::TRANSPARENT_HUGE_PAGES;
+	}
+
+	if (this->backing == NodePoolBacking::TRANSPARENT_HUGE_PAGES) {
+		// Transparent huge pages are only used for aligned memory. We map an
+		// additional huge page and cut off what lies outside the aligned part.
+		constexpr size_t huge = node_pool_internal::HUGE_PAGE_BYTES;
+		void * mem = mmap(nullptr, bytes + huge, PROT_READ | PROT_WRITE,
+		                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+
+		auto start = reinterpret_cast<std::uintptr_t>(mem);
+		auto aligned = (start + huge - 1) / huge * huge;
+		size_t front = aligned - start;
+		if (front > 0) {
+			munmap(mem, front);
+		}
+		munmap(reinterpret_cast<void *>(aligned + bytes), huge - front);
+
+		mem = reinterpret_cast<void *>(aligned);
+		madvise(mem, bytes, MADV_HUGEPAGE);
+		return mem;
+	}
+#endif
+
+	return ::operator new(bytes,
+	                      std::align_val_t{std::max(
+	                          alignof(Slot), node_pool_internal::CACHE_LINE_BYTES)});
+}
+
+template <class Node>
+void
+NodePool<Node>::unmap_chunk(void * ptr, size_t bytes) noexcept
+{
+#if defined(__linux__)
+	if (this->backing != NodePoolBacking::HEAP) {
+		munmap(ptr, bytes);
+		return;
+	}
+#endif
+
+	::operator delete(ptr, std::align_val_t{std::max(
+	                           alignof(Slot), node_pool_internal::CACHE_LINE_BYTES)});
+}
+
+template <class Node>
+void
+NodePool<Node>::add_chunk()
+{
+	void * mem = this->map_chunk(this->chunk_bytes);
+
+	size_t index = this->chunks.size();
+	this->chunks.push_back(
+	    Chunk{static_cast<Slot *>(mem), this->chunk_bytes, 0, nullptr, true});
+
+	auto pos = std::lower_bound(
+	    this->by_address.begin(), this->by_address.end(), mem,
+	    [&](size_t lhs, const void * rhs) {
+		    return reinterpret_cast<std::uintptr_t>(this->chunks[lhs].slots) <
+		           reinterpret_cast<std::uintptr_t>(rhs);
+	    });
+	this->by_address.insert(pos, index);
+	this->with_room.push_back(index);
+}
+
+template <class Node>
+bool
+NodePool<Node>::has_room(const Chunk & c) const noexcept
+{
+	return (c.free_list != nullptr) || (c.used < this->per_chunk);
+}
+
+template <class Node>
+typename NodePool<Node>::Slot *
+NodePool<Node>::take_from(Chunk & c) noexcept
+{
+	if (c.free_list != nullptr) {
+		Slot * slot = c.free_list;
+		c.free_list = slot->next_free;
+		return slot;
+	}
+
+	return &c.slots[c.used++];
+}
+
+template <class Node>
+size_t
+NodePool<Node>::chunk_of(const void * ptr) const noexcept
+{
+	// The last chunk starting at or before <ptr>
+	auto pos = std::upper_bound(
+	    this->by_address.begin(), this->by_address.end(),
+	    reinterpret_cast<std::uintptr_t>(ptr),
+	    [&](std::uintptr_t lhs, size_t rhs) {
+		    return lhs < reinterpret_cast<std::uintptr_t>(this->chunks[rhs].slots);
+	    });
+	return *(pos - 1);
+}
+
+template <class Node>
+typename NodePool<Node>::Slot *
+NodePool<Node>::allocate_slot()
+{
+	while (!this->with_room.empty() &&
+	       !this->has_room(this->chunks[this->with_room.back()])) {
+		this->chunks[this->with_room.back()].listed = false;
+		this->with_room.pop_back();
+	}
+
+	if (this->with_room.empty()) {
+		this->add_chunk();
+	}
+
+	return this->take_from(this->chunks[this->with_room.back()]);
+}
+
+template <class Node>
+void
+NodePool<Node>::release(Slot * slot) noexcept
+{
+	size_t index = this->chunk_of(slot);
+	Chunk & c = this->chunks[index];
+
+	slot->next_free = c.free_list;
+	c.free_list = slot;
+
+	if (!c.listed) {
+		c.listed = true;
+		this->with_room.push_back(index);
+	}
+}
+
+template <class Node>
+template <class... Args>
+Node *
+NodePool<Node>::construct(Slot * slot, Args &&... args)
+{
+	try {
+		Node * node = new (slot->storage) Node(std::forward<Args>(args)...);
+		this->live++;
+		return node;
+	} catch (...) {
+		this->release(slot);
+		throw;
+	}
+}
+
+template <class Node>
+template <class... Args>
+Node *
+NodePool<Node>::create(Args &&... args)
+{
+	return this->construct(this->allocate_slot(), std::forward<Args>(args)...);
+}
+
+template <class Node>
+template <class... Args>
+Node *
+NodePool<Node>::create_near(const Node & hint, Args &&... args)
+{
+	Chunk & c = this->chunks[this->chunk_of(&hint)];
+	if (this->has_room(c)) {
+		return this->construct(this->take_from(c), std::forward<Args>(args)...);
+	}
+
+	return this->create(std::forward<Args>(args)...);
+}
+
+template <class Node>
+void
+NodePool<Node>::destroy(Node * node) noexcept
+{
+	node->~Node();
+	this->live--;
+	this->release(reinterpret_cast<Slot *>(node));
+}
+
+template <class Node>
+size_t
+NodePool<Node>::size() const noexcept
+{
+	return this->live;
+}
+
+template <class Node>
+size_t
+NodePool<Node>::capacity() const noexcept
+{
+	return this->chunks.size() * this->per_chunk;
+}
+
+template <class Node>
+NodePoolBacking
+NodePool<Node>::get_backing() const noexcept
+{
+	return this->backing;
+}
+
+} // namespace ygg
+
+#endif // YGG_NODE_POOL_CPP
@@ -0,0 +1,197 @@
+#ifndef YGG_NODE_POOL_HPP
+#define YGG_NODE_POOL_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ygg {
+
+/**
+ * @brief The kind of memory a NodePool obtains its chunks from
+ */
+enum class NodePoolBacking
+{
+	/**
+	 * Chunks are allocated via operator new.
+	 */
+	HEAP,
+	/**
+	 * Chunks are mapped anonymously, aligned to the huge page size and marked
+	 * for transparent huge pages via madvise(MADV_HUGEPAGE). Whether the kernel
+	 * actually backs them with huge pages depends on its configuration.
+	 */
+	TRANSPARENT_HUGE_PAGES,
+	/**
+	 * Chunks are mapped with MAP_HUGETLB, i.e., from the reserved huge pages.
+	 * If no huge pages are available, the pool falls back to
+	 * TRANSPARENT_HUGE_PAGES.
+	 */
+	HUGETLB
+};
+
+/**
+ * @brief A pool to allocate nodes from
+ *
+ * Since all trees in Ygg are intrusive, you need to store your nodes somewhere,
+ * and they must not move in memory as long as they are part of a tree. A
+ * NodePool provides that: It allocates memory in chunks of (by default) two
+ * megabytes, constructs nodes in them and never moves a node. Destroyed nodes
+ * are put on a free list, and their memory is reused by later allocations.
+ *
+ * Since nodes are densely packed into large chunks, a tree whose nodes come
+ * from a NodePool touches far fewer pages than one whose nodes are allocated
+ * individually. The chunks can be backed by huge pages (see NodePoolBacking),
+ * which further reduces TLB misses. Additionally, create_near() places a new
+ * node in the chunk of an existing node (e.g., its future neighbor in the
+ * tree), if there is room.
+ *
+ * The pool is not thread-safe.
+ *
+ * @tparam Node The node class to allocate
+ */
+template <class Node>
+class NodePool {
+public:
+	/**
+	 * @brief Create a new, empty pool
+	 *
+	 * No memory is allocated before the first node is created.
+	 *
+	 * @param backing       The kind of memory the chunks are obtained from. On
+	 * systems other than Linux, this is ignored and chunks are allocated from
+	 * the heap.
+	 * @param chunk_bytes   The size of every chunk in bytes. It is enlarged to
+	 * hold at least one node and, with huge page backings, rounded up to a
+	 * multiple of the huge page size.
+	 */
+	explicit NodePool(NodePoolBacking backing = NodePoolBacking::HEAP,
+	                  size_t chunk_bytes = size_t{2} * 1024 * 1024);
+
+	/**
+	 * @brief Destroys the pool, releasing all its memory
+	 *
+	 * Note that this does *not* call the destructors of nodes that have not
+	 * been destroyed via destroy(). None of the nodes may be part of a tree
+	 * anymore.
+	 */
+	~NodePool();
+
+	NodePool(const NodePool &) = delete;
+	NodePool & operator=(const NodePool &) = delete;
+
+	/**
+	 * @brief Creates a new node
+	 *
+	 * Allocates memory for a node and constructs the node from <args>. This
+	 * runs in amortized O(1) time. Throws std::bad_alloc if no memory can be
+	 * obtained.
+	 *
+	 * @param args  The arguments passed to Node's constructor
+	 * @return A pointer to the new node
+	 */
+	template <class... Args>
+	Node * create(Args &&... args);
+
+	/**
+	 * @brief Creates a new node close to an existing node
+	 *
+	 * Works like create(), but tries to place the new node in the same chunk as
+	 * <hint>. If that chunk is full, the node is placed as create() would place
+	 * it. Finding the chunk of <hint> takes O(log c) time for c chunks.
+	 *
+	 * @param hint  A node that was created from this pool and not destroyed yet
+	 * @param args  The arguments passed to Node's constructor
+	 * @return A pointer to the new node
+	 */
+	template <class... Args>
+	Node * create_near(const Node & hint, Args &&... args);
+
+	/**
+	 * @brief Destroys a node
+	 *
+	 * Calls the destructor of <node> and makes its memory available to later
+	 * allocations. Finding the chunk of <node> takes O(log c) time for c
+	 * chunks. The node must have been created from this pool and must not be
+	 * part of any tree anymore.
+	 *
+	 * @param node  The node to destroy
+	 */
+	void destroy(Node * node) noexcept;
+
+	/**
+	 * @brief Returns the number of nodes that have been created and not been
+	 * destroyed yet
+	 *
+	 * @return The number of live nodes
+	 */
+	size_t size() const noexcept;
+
+	/**
+	 * @brief Returns the number of nodes that fit into the currently allocated
+	 * chunks
+	 *
+	 * @return The number of nodes that can be live without allocating a new
+	 * chunk
+	 */
+	size_t capacity() const noexcept;
+
+	/**
+	 * @brief Returns the kind of memory the chunks are obtained from
+	 *
+	 * This may differ from the backing requested in the constructor if the
+	 * requested backing is not available.
+	 *
+	 * @return The kind of memory the chunks are obtained from
+	 */
+	NodePoolBacking get_backing() const noexcept;
+
+private:
+	// Free slots hold the pointer to the next free slot of the same chunk
+	union Slot {
+		Slot * next_free;
+		alignas(Node) unsigned char storage[sizeof(Node)];
+	};
+
+	class Chunk {
+	public:
+		Slot * slots;
+		size_t bytes;
+		// Slots [used, per_chunk) have never been handed out
+		size_t used;
+		Slot * free_list;
+		// Whether the chunk is in with_room
+		bool listed;
+	};
+
+	NodePoolBacking backing;
+	size_t chunk_bytes;
+	size_t per_chunk;
+	size_t live;
+
+	std::vector<Chunk> chunks;
+	// Indices of the chunks, sorted by their address
+	std::vector<size_t> by_address;
+	/* Indices of chunks that may have room. A chunk is pushed when a node in it
+	 * is destroyed (unless it is listed already), and popped once found to be
+	 * full. The topmost chunk is the one allocated from. */
+	std::vector<size_t> with_room;
+
+	bool has_room(const Chunk & c) const noexcept;
+	Slot * take_from(Chunk & c) noexcept;
+	size_t chunk_of(const void * ptr) const noexcept;
+	Slot * allocate_slot();
+	void release(Slot * slot) noexcept;
+	template <class... Args>
+	Node * construct(Slot * slot, Args &&... args);
+	void add_chunk();
+
+	void * map_chunk(size_t bytes);
+	void unmap_chunk(void * ptr, size_t bytes) noexcept;
+};
+
+} // namespace ygg
+
+#include "node_pool.cpp"
+
+#endif // YGG_NODE_POOL_HPP
@@ -47,13 +47,12 @@ public:
 	/**
 	 * @brief RBTree option: Support order queries
 	 *
-	 * If this flag is set, the RBTree efficiently supports order queries, i.e.,
-	 * queries of the form "is a before b in the tree". Please note that this only
-	 * makes sense if MULTIPLE is also set --- otherwise, Compare(a,b) answers
-	 * that question for every pair (a,b). For elements that compare equally (i.e.
-	 * Compare(a,b) == Compare(b,a) == false), the hinted version of
-	 * RBTree::insert allows you to enforce a certain order on equal elements.
-	 * TODO link to method
+	 * If this flag is set, every node of the RBTree additionally stores the size
+	 * of the subtree below it. This allows the tree to answer order queries in
+	 * O(log n), i.e., to compute the rank of a node (RBTree::rank()), to find
+	 * the k-th node (RBTree::select()) and to count the nodes in a range of keys
+	 * (RBTree::count_range()). This requires an additional size_t per node and
+	 * slows down insert and remove operations slightly.
 	 */
 	class ORDER_QUERIES {
 	};
@@ -68,6 +67,34 @@ public:
 	class CONSTANT_TIME_SIZE {
 	};
 
+	/**
+	 * @brief BST option: count modifications of the tree
+	 *
+	 * If this flag is set, the tree counts every operation that changes its set
+	 * of nodes, i.e., insertions, removals, splits, joins etc. The count can be
+	 * queried via get_modification_count(). This is e.g. used by SearchSnapshot
+	 * to detect that it has become stale. This requires a size_t per tree.
+	 */
+	class MODIFICATION_COUNTER {
+	};
+
+	/**
+	 * @brief BST option: cache the smallest and largest node of the tree
+	 *
+	 * If this flag is set, the tree keeps pointers to its smallest and its
+	 * largest node. Thus, begin(), rbegin() and the like run in O(1) instead of
+	 * descending the whole height of the tree, and pop_front() / pop_back()
+	 * remove the smallest / largest node without any search, which makes the
+	 * tree usable as a double-ended priority queue. This requires two pointers
+	 * per tree.
+	 *
+	 * The cache is updated in O(1) amortized time by insertions and removals.
+	 * Splitting, joining, the set operations and erase_range() recompute it in
+	 * O(log n).
+	 */
+	class CACHED_EXTREMES {
+	};
+
 	/**
 	 * @brief Make the erase() method adhere to STL conventions
 	 *
@@ -90,6 +117,114 @@ public:
 	class COMPRESS_COLOR {
 	};
 
+	/**
+	 * @brief BST option: Store links between nodes as 32-bit indices into a node
+	 * pool
+	 *
+	 * If this flag is set, the parent and child links of RBTree, WBTree and
+	 * ZTree nodes are not stored as pointers, but as 32-bit indices relative to
+	 * the beginning of a node pool that you supply. This halves the space needed
+	 * for the links on 64-bit systems. For the RBTree, the color is packed into
+	 * the parent index.
+	 *
+	 * All nodes of the tree must be elements of a single array of nodes which
+	 * starts at the pool's base. The pool is a class that must provide a static
+	 * method
+	 *
+	 *   static void * get_base() noexcept
+	 *
+	 * returning the address of the first node of that array. The base must not
+	 * change while any node is in a tree. The largest index is reserved for
+	 * nullptr, thus only nodes at indices 0 to 2^32 - 2 can be linked. For the
+	 * RBTree, the color takes one bit, which limits the indices to 0 to
+	 * 2^31 - 2. Debug builds assert that linked nodes lie within this range.
+	 *
+	 * @tparam Pool The node pool class, see above
+	 */
+	template <class Pool>
+	class POOL_RELATIVE_LINKS {
+	public:
+		using type = Pool;
+	};
+
+	/**
+	 * @brief ZTree option: Do not store parent pointers in the nodes
+	 *
+	 * If this flag is set, nodes do not store a pointer to their parent. This
+	 * saves a pointer per node and a write per changed link. Instead, iterators
+	 * carry the path from the root to the node they point to, which allows to
+	 * step through the tree without parent pointers. The price is that
+	 * iterator_to() and remove() must search the node from the root, i.e., run
+	 * in O(log n) (plus the number of nodes comparing equally to the node)
+	 * instead of O(1). Prefer the erase() methods, which can use the path of an
+	 * iterator.
+	 *
+	 * The iterators store paths of up to max_depth nodes inline. Deeper paths
+	 * are moved to the heap, which makes such iterators more expensive to
+	 * create and copy. For zip trees with random ranks, the height is about
+	 * 1.5 log(n) with high probability. The default of 48 keeps iterators
+	 * small and covers that height for up to about 2^32 nodes. Raise it if
+	 * iterators into higher trees are created often. Note that nodes with equal
+	 * ranks form chains: Many equal keys with hash-derived ranks, or explicit
+	 * ranks that are often equal, can make the tree much higher.
+	 *
+	 * This is only supported by the ZTree. The rebalancing of the RBTree and
+	 * WBTree walks up the tree from the changed node, which would need the
+	 * path to be recorded during insertion and removal.
+	 *
+	 * @tparam max_depth The number of nodes an iterator stores inline
+	 */
+	template <size_t max_depth = 48>
+	class NO_PARENT_POINTERS {
+	public:
+		constexpr static size_t value = max_depth;
+	};
+
+	/**
+	 * @brief BST option: Link every node to its in-order neighbors
+	 *
+	 * If this flag is set, every node stores pointers to its predecessor and
+	 * successor in the tree. These are maintained during insertion and removal
+	 * in O(1) and let iterators step through the tree by following a single
+	 * pointer, instead of walking up and down the tree. Thus, incrementing or
+	 * decrementing an iterator takes O(1) worst-case time and full scans do not
+	 * jump around in the tree. This costs two pointers per node.
+	 *
+	 * Splitting, joining and removing ranges adjust the threads in O(log n).
+	 * The set operations (union_with(), intersect_with(), difference_with())
+	 * and build_from_sorted() relink all threads in O(n).
+	 *
+	 * This can not be combined with NO_PARENT_POINTERS.
+	 */
+	class THREADED {
+	};
+
+	/**
+	 * @brief RBTree option: Keep only one tree node per distinct key
+	 *
+	 * Requires MULTIPLE. If this flag is set, only the first node of every
+	 * group of equal nodes (its representative) is linked into the tree. All
+	 * further nodes of the group hang off the representative in a doubly linked
+	 * list. Thus, the height of the tree only depends on the number of distinct
+	 * keys, and count() and equal_range() do not need to walk over the group.
+	 * Inserting into or removing from an existing group takes O(log n) for the
+	 * search and O(1) for the list, except for removing the representative
+	 * itself, which takes O(k) for a group of k nodes. This costs two pointers
+	 * and a counter per node.
+	 *
+	 * The node traits only see the representatives, i.e., no callbacks are
+	 * called for nodes joining or leaving an existing group. If a
+	 * representative is removed, the next node of its group takes its place in
+	 * the tree, and children_changed() is called for that node and all its
+	 * ancestors.
+	 *
+	 * This is only supported by the RBTree. It can not be combined with
+	 * THREADED, NO_PARENT_POINTERS or ORDER_QUERIES, since the threads, paths
+	 * and subtree sizes would have to count the nodes of every group.
+	 */
+	class COMPRESS_DUPLICATES {
+	};
+
 	/**
 	 * @brief Zip Tree Option: Indicates that nodes' ranks should be derived from
 	 * a std::hash hash of the node.
@@ -117,6 +252,70 @@ public:
 		using type = T;
 	};
 
+	/**
+	 * @brief Zip Tree Option: Draw random ranks from a fast thread-local
+	 * generator instead of std::rand().
+	 *
+	 * By default, random ranks are drawn via std::rand(), which is slow and,
+	 * depending on the C library, serializes all threads on a global lock. With
+	 * this option, ranks are drawn from a small per-thread generator (see
+	 * ZTreeFastRandom), and the geometrically distributed rank is derived from
+	 * the trailing zeroes of a single 64-bit draw.
+	 *
+	 * This only has an effect on randomly generated ranks, i.e., it requires
+	 * ZTREE_RANK_TYPE and must not be combined with ZTREE_USE_HASH.
+	 */
+	class ZTREE_FAST_RANDOM_RANKS {
+	};
+
+	/**
+	 * @brief Zip Tree Option: Turns the Zip Tree into a Zip-Zip Tree, which uses
+	 * two-part ranks.
+	 *
+	 * In a plain Zip Tree, rank ties between nodes are frequent. They are broken
+	 * by insertion order (the later node ends up above), so if nodes are
+	 * inserted in (roughly) sorted order, the expected depth of a node is about
+	 * 1.5 log n. With this option, every node additionally draws a uniformly
+	 * distributed secondary rank, which breaks most of these ties randomly. This
+	 * lowers the expected depth to about 1.39 log n, the same as for a treap,
+	 * regardless of the insertion order (see Gila, Goodrich and Tarjan: "Zip-Zip
+	 * Trees: Making Zip Trees More Balanced, Biased, Compact, or Persistent").
+	 * Insertion and deletion are unchanged.
+	 *
+	 * Both parts are packed into the rank type set via ZTREE_RANK_TYPE: the
+	 * geometric rank is stored in the upper bits, the secondary rank in the
+	 * lower ones. Thus, the rank type must have at least 16 bits. Every bit above
+	 * that widens the range of the secondary ranks. dbg_get_rank() returns the
+	 * packed rank.
+	 *
+	 * This only has an effect on randomly generated ranks, i.e., it must not be
+	 * combined with ZTREE_USE_HASH. It can be combined with
+	 * ZTREE_FAST_RANDOM_RANKS.
+	 */
+	class ZTREE_ZIPZIP_RANKS {
+	};
+
+	/**
+	 * @brief Zip Tree Option: Store the nodes' ranks in the parent pointers
+	 *
+	 * On 64-bit systems, user-space pointers do not use their eight most
+	 * significant bits (neither with four- nor with five-level paging). If this
+	 * flag is set, the rank of every node is stored in these bits of its parent
+	 * pointer instead of in a separate field, which shrinks the node base to
+	 * three pointers. Like COMPRESS_COLOR for the RBTree, this uses pointer magic
+	 * which is technically not standard compliant.
+	 *
+	 * This requires ZTREE_RANK_TYPE to be set to std::uint8_t, which can hold
+	 * any geometric rank. It can not be combined with ZTREE_ZIPZIP_RANKS (which
+	 * needs wider ranks), NO_PARENT_POINTERS or POOL_RELATIVE_LINKS.
+	 *
+	 * @warning This conflicts with anything else that uses the upper bits of
+	 * pointers, e.g., hardware pointer tagging (ARM's top byte ignore and memory
+	 * tagging, as used by HWASan) or Intel's linear address masking.
+	 */
+	class ZTREE_COMPRESS_RANK {
+	};
+
 	/**
 	 * @brief Zip Tree Option: Supply your own hasher class to be used with
 	 * hash-based ranks.
@@ -282,6 +481,21 @@ public:
 	class WBT_SINGLE_PASS {
 	};
 
+	/**
+	 * @brief Weight Balanced Tree Option: Store subtree sizes as 32-bit
+	 * integers
+	 *
+	 * By default, every node of a weight balanced tree stores the size of its
+	 * subtree as size_t. With this option, a 32-bit integer is used instead,
+	 * which saves four bytes per node on 64-bit systems. Note that the saved
+	 * bytes are tail padding, which is only put to use if the first member of
+	 * your node class (or the next base class) is at most four bytes large.
+	 *
+	 * @warning With this option, a tree must contain less than 2^32 - 1 nodes.
+	 */
+	class WBT_32BIT_SIZES {
+	};
+
 	/**
 	 * @brief Causes the IntervalTrees's find() queries to run in O(log n)
 	 *
@@ -405,6 +619,19 @@ private:
 		}
 	}
 
+	constexpr static auto
+	compute_link_pool_type()
+	{
+		using T = typename utilities::get_type_if_present<
+		    TreeFlags::POOL_RELATIVE_LINKS, void, Opts...>::type;
+
+		if constexpr (!std::is_same_v<T, void>) {
+			return utilities::TypeHolder<typename T::type>{};
+		} else {
+			return utilities::TypeHolder<void>{};
+		}
+	}
+
 	constexpr static auto
 	compute_sequence_interface_type()
 	{
@@ -505,8 +732,25 @@ public:
 	    OptPack::template has<TreeFlags::ORDER_QUERIES>();
 	static constexpr bool constant_time_size =
 	    OptPack::template has<TreeFlags::CONSTANT_TIME_SIZE>();
+	static constexpr bool modification_counter =
+	    OptPack::template has<TreeFlags::MODIFICATION_COUNTER>();
+	static constexpr bool cached_extremes =
+	    OptPack::template has<TreeFlags::CACHED_EXTREMES>();
 	static constexpr bool compress_color =
 	    OptPack::template has<TreeFlags::COMPRESS_COLOR>();
+	using LinkPool = typename decltype(compute_link_pool_type())::type;
+	static constexpr bool pool_relative_links =
+	    !std::is_same_v<LinkPool, void>;
+	static constexpr bool no_parent_pointers =
+	    utilities::get_value_if_present<TreeFlags::NO_PARENT_POINTERS,
+	                                    Opts...>::found;
+	static constexpr bool threaded =
+	    OptPack::template has<TreeFlags::THREADED>();
+	static constexpr bool compress_duplicates =
+	    OptPack::template has<TreeFlags::COMPRESS_DUPLICATES>();
+	static constexpr size_t max_tree_depth =
+	    utilities::get_value_if_present_else_default<
+	        TreeFlags::NO_PARENT_POINTERS, 48, Opts...>::value;
 	static constexpr bool ztree_use_hash =
 	    OptPack::template has<TreeFlags::ZTREE_USE_HASH>();
 	static constexpr bool stl_erase =
@@ -535,6 +779,14 @@ public:
 
 	static constexpr bool ztree_store_rank =
 	    !std::is_same<ztree_rank_type, void>::value;
+	static constexpr bool ztree_fast_random_ranks =
+	    OptPack::template has<TreeFlags::ZTREE_FAST_RANDOM_RANKS>();
+	static constexpr bool ztree_zipzip_ranks =
+	    OptPack::template has<TreeFlags::ZTREE_ZIPZIP_RANKS>();
+	static constexpr bool ztree_compress_rank =
+	    OptPack::template has<TreeFlags::ZTREE_COMPRESS_RANK>();
+	static constexpr bool wbt_32bit_sizes =
+	    OptPack::template has<TreeFlags::WBT_32BIT_SIZES>();
 
 	static constexpr size_t ztree_universalize_modul =
 	    utilities::get_value_if_present_else_default<
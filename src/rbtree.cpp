@@ -161,6 +161,90 @@ ColorParentStorage<Node, false>::swap_parent_with(
 {
 	std::swap(this->parent, other.parent);
 }
+
+template <class Node, bool compress_color, class Options>
+void
+ColorParentStorage<Node, compress_color,
+                   bst::RelativeLink<Node, Options>>::set_color(Color new_color) noexcept
+{
+	this->parent_and_color = (this->parent_and_color & ~std::uint32_t{1}) |
+	                         static_cast<std::uint32_t>(new_color);
+}
+
+template <class Node, bool compress_color, class Options>
+void
+ColorParentStorage<Node, compress_color,
+                   bst::RelativeLink<Node, Options>>::make_black() noexcept
+{
+	this->parent_and_color &= ~std::uint32_t{1};
+}
+
+template <class Node, bool compress_color, class Options>
+void
+ColorParentStorage<Node, compress_color,
+                   bst::RelativeLink<Node, Options>>::make_red() noexcept
+{
+	this->parent_and_color |= std::uint32_t{1};
+}
+
+template <class Node, bool compress_color, class Options>
+Color
+ColorParentStorage<Node, compress_color,
+                   bst::RelativeLink<Node, Options>>::get_color() const noexcept
+{
+	return static_cast<Color>(this->parent_and_color & std::uint32_t{1});
+}
+
+template <class Node, bool compress_color, class Options>
+void
+ColorParentStorage<Node, compress_color, bst::RelativeLink<Node, Options>>::
+    set_parent(Node * new_parent) noexcept
+{
+	std::uint32_t index = null_parent;
+	if (new_parent != nullptr) {
+		index = Link::to_index(new_parent);
+		// One bit is taken by the color, and the largest remaining index is
+		// reserved for nullptr.
+		assert(index < null_parent);
+	}
+	this->parent_and_color =
+	    (index << 1) | (this->parent_and_color & std::uint32_t{1});
+}
+
+template <class Node, bool compress_color, class Options>
+Node *
+ColorParentStorage<Node, compress_color,
+                   bst::RelativeLink<Node, Options>>::get_parent() const noexcept
+{
+	std::uint32_t index = this->parent_and_color >> 1;
+	if (index == null_parent) {
+		return nullptr;
+	}
+	return Link::from_index(index);
+}
+
+template <class Node, bool compress_color, class Options>
+void
+ColorParentStorage<Node, compress_color, bst::RelativeLink<Node, Options>>::
+    swap_parent_with(ColorParentStorage & other) noexcept
+{
+	std::uint32_t mask = ~std::uint32_t{1};
+	std::uint32_t diff = (this->parent_and_color ^ other.parent_and_color) & mask;
+	this->parent_and_color ^= diff;
+	other.parent_and_color ^= diff;
+}
+
+template <class Node, bool compress_color, class Options>
+void
+ColorParentStorage<Node, compress_color, bst::RelativeLink<Node, Options>>::
+    swap_color_with(ColorParentStorage & other) noexcept
+{
+	std::uint32_t diff =
+	    (this->parent_and_color ^ other.parent_and_color) & std::uint32_t{1};
+	this->parent_and_color ^= diff;
+	other.parent_and_color ^= diff;
+}
+
 } // namespace rbtree_internal
 
 template <class Node, class Tag, class Options>
@@ -217,6 +301,7 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::RBTree(
 	this->root = other.root;
 	other.root = nullptr;
 	this->s = other.s;
+	this->extremes = other.extremes;
 }
 
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
@@ -227,6 +312,9 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base(Node & node,
 {
 	node.NB::set_right(nullptr);
 	node.NB::set_left(nullptr);
+	if constexpr (Options::compress_duplicates) {
+		this->init_group(node);
+	}
 
 	Node * parent = start;
 	Node * cur = start;
@@ -239,7 +327,7 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base(Node & node,
 			__builtin_prefetch(cur->NB::get_right());
 		}
 
-		if constexpr (Options::multiple) {
+		if constexpr (Options::multiple && !Options::compress_duplicates) {
 			if constexpr (Options::micro_avoid_conditionals) {
 				cur = utilities::go_right_if(this->cmp(*cur, node), cur);
 			} else {
@@ -250,12 +338,17 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base(Node & node,
 				}
 			}
 		} else {
-			// Multiple are not allowed - we need three-way comparisons!
+			// Multiple are not allowed or are kept out of the tree - we need
+			// three-way comparisons!
 			// on_equality_prefer_left has no effect here
 
 			if constexpr (Options::micro_avoid_conditionals) {
 				if (__builtin_expect(
 				        (!this->cmp(*cur, node)) && (!this->cmp(node, *cur)), false)) {
+					if constexpr (Options::compress_duplicates) {
+						this->append_duplicate(*cur, node);
+						return;
+					}
 					// Same as existing. Reduce size (because we increased it earlier)
 					// and exit.
 					this->s.reduce(1);
@@ -269,6 +362,10 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base(Node & node,
 				} else if (this->cmp(node, *cur)) {
 					cur = cur->NB::get_left();
 				} else {
+					if constexpr (Options::compress_duplicates) {
+						this->append_duplicate(*cur, node);
+						return;
+					}
 					// Same as existing. Reduce size (because we increased it earlier)
 					// and exit.
 					this->s.reduce(1);
@@ -283,6 +380,10 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base(Node & node,
 		node.NB::set_parent(nullptr);
 		node.NB::make_black();
 		this->root = &node;
+		if constexpr (Options::order_queries) {
+			node.NB::_rbt_size = 1;
+		}
+		this->leaf_attached(node, nullptr);
 		NodeTraits::leaf_inserted(node, *this);
 	} else {
 		node.NB::set_parent(parent);
@@ -306,6 +407,12 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base(Node & node,
 			}
 		}
 
+		if constexpr (Options::order_queries) {
+			node.NB::_rbt_size = 1;
+			this->adjust_sizes_to_root(parent, true);
+		}
+
+		this->leaf_attached(node, parent);
 		NodeTraits::leaf_inserted(node, *this);
 		this->fixup_after_insert(&node);
 	}
@@ -313,6 +420,16 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base(Node & node,
 	return;
 }
 
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::children_changed_upwards(
+    Node * node) noexcept
+{
+	for (Node * n = node; n != nullptr; n = n->NB::get_parent()) {
+		NodeTraits::children_changed(*n, *this);
+	}
+}
+
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
 void
 RBTree<Node, NodeTraits, Options, Tag, Compare>::rotate_left(
@@ -341,6 +458,11 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::rotate_left(
 
 	parent->NB::set_parent(right_child);
 
+	if constexpr (Options::order_queries) {
+		right_child->NB::_rbt_size = parent->NB::_rbt_size;
+		this->fix_subtree_size(parent);
+	}
+
 	NodeTraits::rotated_left(*parent, *this);
 }
 
@@ -373,11 +495,16 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::rotate_right(
 
 	parent->NB::set_parent(left_child);
 
+	if constexpr (Options::order_queries) {
+		left_child->NB::_rbt_size = parent->NB::_rbt_size;
+		this->fix_subtree_size(parent);
+	}
+
 	NodeTraits::rotated_right(*parent, *this);
 }
 
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
-void
+bool
 RBTree<Node, NodeTraits, Options, Tag, Compare>::fixup_after_insert(
     Node * node) noexcept
 {
@@ -405,14 +532,14 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::fixup_after_insert(
 			node = grandparent;
 		} else {
 			// Don't recurse into the root; don't color it red. We could immediately
-			// re-color it black.
-			return;
+			// re-color it black. This increases the black height of the tree.
+			return true;
 		}
 	}
 
 	if (node->NB::get_parent()->NB::get_color() ==
 	    rbtree_internal::Color::BLACK) {
-		return;
+		return false;
 	}
 
 	Node * parent = node->NB::get_parent();
@@ -442,6 +569,8 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::fixup_after_insert(
 	}
 
 	grandparent->NB::make_red();
+
+	return false;
 }
 
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
@@ -477,6 +606,14 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert(Node & node,
 	//(void)hint;
 	// this->insert(node);
 
+	if constexpr (Options::compress_duplicates) {
+		// The group of <node> may be anywhere above the hint, the climb below
+		// does not notice it.
+		(void)hint;
+		this->insert_leaf_base(node, this->root);
+		return;
+	}
+
 	// find parent
 	Node * parent = &hint;
 	Node * cur = parent;
@@ -563,25 +700,80 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::insert(
 	this->bss.register_insert(reinterpret_cast<const void *>(&node),
 	                          Options::SequenceInterface::get_key(node));
 #endif
-	this->s.add(1);
 
 	if (hint == this->end()) {
 		// special case: insert at the end
+		this->s.add(1);
 		Node * parent = this->root;
 
 		if (parent == nullptr) {
-			this->insert_leaf_base<false>(node, parent);
+			this->insert_leaf_base(node, parent);
 		} else {
 			while (parent->NB::get_right() != nullptr) {
 				parent = parent->NB::get_right();
 			}
-			this->insert_leaf_base<false>(node, parent);
+			this->insert_leaf_base(node, parent);
 		}
 	} else {
 		this->insert(node, *hint);
 	}
 }
 
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::insert_at(
+    const typename TB::InsertHandle & handle, Node & node) noexcept
+{
+#ifdef YGG_STORE_SEQUENCE
+	this->bss.register_insert(reinterpret_cast<const void *>(&node),
+	                          Options::SequenceInterface::get_key(node));
+#endif
+	assert(!handle.found() || Options::compress_duplicates);
+	this->s.add(1);
+
+	if constexpr (Options::compress_duplicates) {
+		if (handle.found()) {
+			this->append_duplicate(*handle.get_node(), node);
+			return;
+		}
+		this->init_group(node);
+	}
+
+	node.NB::set_right(nullptr);
+	node.NB::set_left(nullptr);
+
+	Node * parent = handle.get_parent();
+	if (parent == nullptr) {
+		// new root!
+		node.NB::set_parent(nullptr);
+		node.NB::make_black();
+		this->root = &node;
+		if constexpr (Options::order_queries) {
+			node.NB::_rbt_size = 1;
+		}
+		this->leaf_attached(node, nullptr);
+		NodeTraits::leaf_inserted(node, *this);
+		return;
+	}
+
+	node.NB::set_parent(parent);
+	node.NB::make_red();
+	if (handle.is_left_child()) {
+		parent->NB::set_left(&node);
+	} else {
+		parent->NB::set_right(&node);
+	}
+
+	if constexpr (Options::order_queries) {
+		node.NB::_rbt_size = 1;
+		this->adjust_sizes_to_root(parent, true);
+	}
+
+	this->leaf_attached(node, parent);
+	NodeTraits::leaf_inserted(node, *this);
+	this->fixup_after_insert(&node);
+}
+
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
 void
 RBTree<Node, NodeTraits, Options, Tag, Compare>::verify_black_root() const
@@ -667,6 +859,26 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::dbg_verify() const
 		this->verify_red_black(this->root);
 	}
 	this->verify_black_root();
+
+	if constexpr (Options::order_queries) {
+		this->verify_subtree_sizes(this->root);
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+size_t
+RBTree<Node, NodeTraits, Options, Tag, Compare>::verify_subtree_sizes(
+    const Node * node) const
+{
+	if (node == nullptr) {
+		return 0;
+	}
+
+	size_t size = this->verify_subtree_sizes(node->NB::get_left()) +
+	              this->verify_subtree_sizes(node->NB::get_right()) + 1;
+	debug::yggassert(node->NB::_rbt_size == size);
+
+	return size;
 }
 
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
@@ -687,6 +899,10 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::swap_nodes(
 		n1->swap_color_with(n2);
 	}
 
+	if constexpr (Options::order_queries) {
+		std::swap(n1->NB::_rbt_size, n2->NB::_rbt_size);
+	}
+
 	NodeTraits::swapped(*n1, *n2, *this);
 }
 
@@ -806,6 +1022,8 @@ void
 RBTree<Node, NodeTraits, Options, Tag, Compare>::remove_to_leaf(Node & node)
     CMP_NOEXCEPT(node)
 {
+	this->node_detaching(node, node.NB::get_parent());
+
 	Node * cur = &node;
 	Node * child = &node;
 
@@ -859,6 +1077,10 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::remove_to_leaf(Node & node)
 		                                     // TODO null the pointers in node?
 		                                     //}
 
+		if constexpr (Options::order_queries) {
+			this->adjust_sizes_to_root(right_child, false);
+		}
+
 		NodeTraits::deleted_below(*right_child, *this);
 
 		return; // no fixup necessary
@@ -877,6 +1099,10 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::remove_to_leaf(Node & node)
 			node.NB::get_parent()->NB::set_right(nullptr);
 		}
 
+		if constexpr (Options::order_queries) {
+			this->adjust_sizes_to_root(node.NB::get_parent(), false);
+		}
+
 		NodeTraits::deleted_below(*node.NB::get_parent(), *this);
 	} else {
 		this->root = nullptr; // Tree is now empty!
@@ -905,7 +1131,19 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::erase(const Comparable & c)
 	                              (Options::stl_erase && Options::multiple)>(c);
 
 	if (el != this->end()) {
-		if constexpr (Options::stl_erase) {
+		if constexpr (Options::compress_duplicates) {
+			if constexpr (Options::stl_erase) {
+				// The whole group leaves together with its representative
+				size_t count = this->group_size(*el);
+				this->remove_to_leaf(*el);
+				this->s.reduce(count);
+				return count;
+			} else {
+				Node * n = &(*el);
+				this->remove(*n);
+				return n;
+			}
+		} else if constexpr (Options::stl_erase) {
 			size_t count = 1;
 
 			auto next = el + 1;
@@ -1082,6 +1320,928 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::fixup_after_delete(
 	}
 }
 
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+size_t
+RBTree<Node, NodeTraits, Options, Tag, Compare>::get_subtree_size(
+    const Node * n) noexcept
+{
+	if (n == nullptr) {
+		return 0;
+	}
+	return n->NB::_rbt_size;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::fix_subtree_size(
+    Node * n) noexcept
+{
+	n->NB::_rbt_size = get_subtree_size(n->NB::get_left()) +
+	                   get_subtree_size(n->NB::get_right()) + 1;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::adjust_sizes_to_root(
+    Node * start, bool increase) noexcept
+{
+	// Adding the all-ones value decrements modulo 2^n, thus the loop needs
+	// no branch.
+	const size_t delta = increase ? size_t{1} : ~size_t{0};
+	while (start != nullptr) {
+		start->NB::_rbt_size += delta;
+		start = start->NB::get_parent();
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+size_t
+RBTree<Node, NodeTraits, Options, Tag, Compare>::rank(
+    const Node & node) const noexcept
+{
+	static_assert(Options::order_queries,
+	              "rank() is only available with ORDER_QUERIES set.");
+
+	const Node * cur = &node;
+	size_t r = get_subtree_size(cur->NB::get_left());
+
+	while (cur->NB::get_parent() != nullptr) {
+		const Node * parent = cur->NB::get_parent();
+		if (parent->NB::get_right() == cur) {
+			r += get_subtree_size(parent->NB::get_left()) + 1;
+		}
+		cur = parent;
+	}
+
+	return r;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+typename RBTree<Node, NodeTraits, Options, Tag, Compare>::template iterator<
+    false>
+RBTree<Node, NodeTraits, Options, Tag, Compare>::select(size_t k) noexcept
+{
+	static_assert(Options::order_queries,
+	              "select() is only available with ORDER_QUERIES set.");
+
+	Node * cur = this->root;
+
+	while (cur != nullptr) {
+		size_t left_size = get_subtree_size(cur->NB::get_left());
+		if (k < left_size) {
+			cur = cur->NB::get_left();
+		} else if (k == left_size) {
+			return iterator<false>(cur);
+		} else {
+			k -= left_size + 1;
+			cur = cur->NB::get_right();
+		}
+	}
+
+	return this->end();
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+typename RBTree<Node, NodeTraits, Options, Tag,
+                Compare>::template const_iterator<false>
+RBTree<Node, NodeTraits, Options, Tag, Compare>::select(size_t k) const noexcept
+{
+	return const_iterator<false>(const_cast<MyClass *>(this)->select(k));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable, bool count_equal>
+size_t
+RBTree<Node, NodeTraits, Options, Tag, Compare>::count_before(
+    const Comparable & query) const CMP_NOEXCEPT(query)
+{
+	size_t count = 0;
+	const Node * cur = this->root;
+
+	while (cur != nullptr) {
+		bool before;
+		if constexpr (count_equal) {
+			before = !this->cmp(query, *cur);
+		} else {
+			before = this->cmp(*cur, query);
+		}
+
+		if (before) {
+			count += get_subtree_size(cur->NB::get_left()) + 1;
+			cur = cur->NB::get_right();
+		} else {
+			cur = cur->NB::get_left();
+		}
+	}
+
+	return count;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class ComparableLo, class ComparableHi>
+size_t
+RBTree<Node, NodeTraits, Options, Tag, Compare>::count_range(
+    const ComparableLo & lo, const ComparableHi & hi) const CMP_NOEXCEPT(lo)
+{
+	static_assert(Options::order_queries,
+	              "count_range() is only available with ORDER_QUERIES set.");
+
+	size_t up_to_hi = this->template count_before<ComparableHi, true>(hi);
+	size_t before_lo = this->template count_before<ComparableLo, false>(lo);
+
+	if (up_to_hi <= before_lo) {
+		return 0;
+	}
+	return up_to_hi - before_lo;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class ForwardIt>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::build_from_sorted(
+    ForwardIt first, ForwardIt last) noexcept
+{
+	using Category = typename std::iterator_traits<ForwardIt>::iterator_category;
+	static_assert(std::is_base_of_v<std::forward_iterator_tag, Category>,
+	              "build_from_sorted() traverses the range more than once and "
+	              "thus needs a forward iterator.");
+	size_t count = static_cast<size_t>(std::distance(first, last));
+
+	this->root = nullptr;
+	this->s.set(count);
+	if (count == 0) {
+		this->refresh_extremes();
+		return;
+	}
+
+	if constexpr (Options::compress_duplicates) {
+		// Attach every run of equal nodes to its first node. Only those go into
+		// the tree, build_subtree() skips the others.
+		count = 0;
+		Node * rep = nullptr;
+		for (ForwardIt it = first; it != last; ++it) {
+			Node & node = *it;
+			if ((rep != nullptr) && !this->cmp(*rep, node)) {
+				this->append_duplicate(*rep, node);
+			} else {
+				this->init_group(node);
+				rep = &node;
+				count++;
+			}
+		}
+	}
+
+	// The perfectly balanced tree has its deepest nodes on level
+	// floor(log2(count)). Coloring exactly those red (unless they are the root)
+	// gives the same number of black nodes on every path.
+	size_t red_depth = 0;
+	while ((size_t{2} << red_depth) <= count) {
+		red_depth++;
+	}
+
+	this->root = this->build_subtree(first, count, 0, red_depth);
+	this->root->NB::set_parent(nullptr);
+	this->refresh_extremes();
+	this->rethread();
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class ForwardIt>
+Node *
+RBTree<Node, NodeTraits, Options, Tag, Compare>::build_subtree(
+    ForwardIt & it, size_t count, size_t depth, size_t red_depth) noexcept
+{
+	if (count == 0) {
+		return nullptr;
+	}
+
+	size_t left_count = (count - 1) / 2;
+	Node * left = this->build_subtree(it, left_count, depth + 1, red_depth);
+	while (this->is_duplicate(*it)) {
+		++it;
+	}
+	Node & node = *it;
+	++it;
+	Node * right =
+	    this->build_subtree(it, count - left_count - 1, depth + 1, red_depth);
+
+	node.NB::set_left(left);
+	node.NB::set_right(right);
+	node.NB::set_parent(nullptr);
+	if (left != nullptr) {
+		left->NB::set_parent(&node);
+	}
+	if (right != nullptr) {
+		right->NB::set_parent(&node);
+	}
+
+	if ((depth == red_depth) && (depth > 0)) {
+		node.NB::make_red();
+	} else {
+		node.NB::make_black();
+	}
+
+	if constexpr (Options::order_queries) {
+		node.NB::_rbt_size = count;
+	}
+
+	NodeTraits::children_changed(node, *this);
+
+	return &node;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+size_t
+RBTree<Node, NodeTraits, Options, Tag, Compare>::black_height(
+    const Node * sub_root) noexcept
+{
+	size_t bh = 0;
+	while (sub_root != nullptr) {
+		if (sub_root->NB::get_color() == rbtree_internal::Color::BLACK) {
+			bh++;
+		}
+		sub_root = sub_root->NB::get_left();
+	}
+	return bh;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+RBTree<Node, NodeTraits, Options, Tag, Compare>::join_subtrees(
+    Node * left, size_t left_bh, Node & pivot, Node * right, size_t right_bh,
+    size_t & joined_bh) noexcept
+{
+	// Both <left> and <right> must have black roots without parents. We descend
+	// along the inner spine of the higher tree until we find a black node of the
+	// same black height as the lower tree, which is then replaced by <pivot>.
+	bool descend_left = left_bh < right_bh;
+	Node * lower = descend_left ? left : right;
+	size_t lower_bh = descend_left ? left_bh : right_bh;
+	Node * cur = descend_left ? right : left;
+	size_t cur_bh = descend_left ? right_bh : left_bh;
+	joined_bh = cur_bh;
+	this->root = cur;
+
+	Node * parent = nullptr;
+	while ((cur_bh > lower_bh) ||
+	       ((cur != nullptr) &&
+	        (cur->NB::get_color() == rbtree_internal::Color::RED))) {
+		if (cur->NB::get_color() == rbtree_internal::Color::BLACK) {
+			cur_bh--;
+		}
+		parent = cur;
+		if (descend_left) {
+			cur = cur->NB::get_left();
+		} else {
+			cur = cur->NB::get_right();
+		}
+	}
+
+	if (descend_left) {
+		pivot.NB::set_left(lower);
+		pivot.NB::set_right(cur);
+	} else {
+		pivot.NB::set_left(cur);
+		pivot.NB::set_right(lower);
+	}
+	if (cur != nullptr) {
+		cur->NB::set_parent(&pivot);
+	}
+	if (lower != nullptr) {
+		lower->NB::set_parent(&pivot);
+	}
+	pivot.NB::set_parent(parent);
+
+	if constexpr (Options::order_queries) {
+		this->fix_subtree_size(&pivot);
+		size_t added = get_subtree_size(lower) + 1;
+		for (Node * n = parent; n != nullptr; n = n->NB::get_parent()) {
+			n->NB::_rbt_size += added;
+		}
+	}
+
+	NodeTraits::children_changed(pivot, *this);
+
+	if (parent == nullptr) {
+		pivot.NB::make_black();
+		this->root = &pivot;
+		joined_bh = cur_bh + 1;
+		return this->root;
+	}
+
+	if (descend_left) {
+		parent->NB::set_left(&pivot);
+	} else {
+		parent->NB::set_right(&pivot);
+	}
+	this->children_changed_upwards(parent);
+
+	pivot.NB::make_red();
+	if (parent->NB::get_color() == rbtree_internal::Color::RED) {
+		if (this->fixup_after_insert(&pivot)) {
+			joined_bh++;
+		}
+	}
+
+	return this->root;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+size_t
+RBTree<Node, NodeTraits, Options, Tag, Compare>::detach_subtree(
+    Node * sub_root, size_t sub_bh) noexcept
+{
+	// The subtree becomes a tree of its own, which needs a black root.
+	if (sub_root == nullptr) {
+		return sub_bh;
+	}
+
+	sub_root->NB::set_parent(nullptr);
+	if (sub_root->NB::get_color() == rbtree_internal::Color::RED) {
+		sub_root->NB::make_black();
+		return sub_bh + 1;
+	}
+	return sub_bh;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+RBTree<Node, NodeTraits, Options, Tag, Compare>::join_subtrees(
+    Node * left, size_t left_bh, Node * right, size_t right_bh,
+    size_t & joined_bh) noexcept
+{
+	if (left == nullptr) {
+		joined_bh = right_bh;
+		return right;
+	}
+	if (right == nullptr) {
+		joined_bh = left_bh;
+		return left;
+	}
+
+	// Use the largest node of <left> as pivot
+	Node * rest;
+	size_t rest_bh;
+	Node * pivot = this->split_last(left, left_bh, rest, rest_bh);
+	return this->join_subtrees(rest, rest_bh, *pivot, right, right_bh,
+	                           joined_bh);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+RBTree<Node, NodeTraits, Options, Tag, Compare>::split_last(
+    Node * sub_root, size_t sub_bh, Node *& rest, size_t & rest_bh) noexcept
+{
+	size_t child_bh = sub_bh;
+	if (sub_root->NB::get_color() == rbtree_internal::Color::BLACK) {
+		child_bh--;
+	}
+
+	Node * left_child = sub_root->NB::get_left();
+	Node * right_child = sub_root->NB::get_right();
+	size_t left_bh = detach_subtree(left_child, child_bh);
+
+	if (right_child == nullptr) {
+		rest = left_child;
+		rest_bh = left_bh;
+		return sub_root;
+	}
+
+	right_child->NB::set_parent(nullptr);
+	Node * inner;
+	size_t inner_bh;
+	Node * last = this->split_last(right_child, child_bh, inner, inner_bh);
+	rest = this->join_subtrees(left_child, left_bh, *sub_root, inner, inner_bh,
+	                           rest_bh);
+	return last;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <bool on_equality_prefer_left, class Comparable>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::split_subtree(
+    Node * sub_root, size_t sub_bh, const Comparable & key, Node *& left,
+    size_t & left_bh, Node *& right, size_t & right_bh) CMP_NOEXCEPT(key)
+{
+	if (sub_root == nullptr) {
+		left = nullptr;
+		left_bh = 0;
+		right = nullptr;
+		right_bh = 0;
+		return;
+	}
+
+	size_t child_bh = sub_bh;
+	if (sub_root->NB::get_color() == rbtree_internal::Color::BLACK) {
+		child_bh--;
+	}
+
+	bool goes_right;
+	if constexpr (on_equality_prefer_left) {
+		goes_right = this->cmp(key, *sub_root);
+	} else {
+		goes_right = !this->cmp(*sub_root, key);
+	}
+	Node * split_child;
+	Node * kept_child;
+	if (goes_right) {
+		split_child = sub_root->NB::get_left();
+		kept_child = sub_root->NB::get_right();
+	} else {
+		split_child = sub_root->NB::get_right();
+		kept_child = sub_root->NB::get_left();
+	}
+
+	// The subtree that is not split becomes a tree of its own
+	size_t kept_bh = detach_subtree(kept_child, child_bh);
+	if (split_child != nullptr) {
+		split_child->NB::set_parent(nullptr);
+	}
+
+	if (goes_right) {
+		Node * inner;
+		size_t inner_bh;
+		this->template split_subtree<on_equality_prefer_left>(
+		    split_child, child_bh, key, left, left_bh, inner, inner_bh);
+		right = this->join_subtrees(inner, inner_bh, *sub_root, kept_child,
+		                            kept_bh, right_bh);
+	} else {
+		Node * inner;
+		size_t inner_bh;
+		this->template split_subtree<on_equality_prefer_left>(
+		    split_child, child_bh, key, inner, inner_bh, right, right_bh);
+		left = this->join_subtrees(kept_child, kept_bh, *sub_root, inner,
+		                           inner_bh, left_bh);
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::split(const Comparable & key,
+                                                       MyClass & right)
+    CMP_NOEXCEPT(key)
+{
+	// Nodes in <right> would be lost
+	assert(right.empty());
+
+	size_t total = 0;
+	if constexpr (Options::constant_time_size) {
+		total = this->size();
+	}
+
+	Node * left_root;
+	size_t left_bh;
+	Node * right_root;
+	size_t right_bh;
+	this->template split_subtree<false>(this->root, black_height(this->root),
+	                                    key, left_root, left_bh, right_root,
+	                                    right_bh);
+	this->thread_split(left_root, right_root);
+
+	this->root = left_root;
+	right.root = right_root;
+	this->refresh_extremes();
+	right.refresh_extremes();
+
+	if constexpr (Options::order_queries && Options::constant_time_size) {
+		this->s.set(get_subtree_size(left_root));
+		right.s.set(get_subtree_size(right_root));
+	} else {
+		this->distribute_size(right, total);
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::join(Node & pivot,
+                                                      MyClass & right) noexcept
+{
+	if constexpr (Options::compress_duplicates) {
+		// <pivot> may belong to a group at either side
+		this->join(right);
+		this->insert(pivot);
+	} else {
+		this->join_at(pivot, right, 1);
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::join_at(
+    Node & pivot, MyClass & right, size_t pivot_count) noexcept
+{
+	this->thread_join(this->root, &pivot, right.root);
+	size_t joined_bh;
+	this->join_subtrees(this->root, black_height(this->root), pivot, right.root,
+	                    black_height(right.root), joined_bh);
+	right.root = nullptr;
+	this->refresh_extremes();
+	right.refresh_extremes();
+	this->take_size_from(right, pivot_count);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::join(MyClass & right) noexcept
+{
+	if (right.empty()) {
+		return;
+	}
+
+	// Use the smallest node of <right> as pivot
+	Node * pivot = right.get_smallest();
+	if constexpr (Options::compress_duplicates) {
+		// The pivot takes its group along
+		size_t pivot_count = this->group_size(*pivot);
+		right.remove_to_leaf(*pivot);
+		right.s.reduce(pivot_count);
+
+		Node * largest = this->get_largest();
+		if ((largest != nullptr) && !this->cmp(*largest, *pivot)) {
+			// Both trees contain the same key
+			this->merge_groups(*largest, *pivot);
+			this->s.add(pivot_count);
+			this->join(right);
+		} else {
+			this->join_at(*pivot, right, pivot_count);
+		}
+	} else {
+		right.remove(*pivot);
+		this->join(*pivot, right);
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::union_subtrees(
+    Node * a, size_t a_bh, Node * b, size_t b_bh, Node *& result,
+    size_t & result_bh, Node *& dups, size_t & dups_bh, size_t & dup_count,
+    unsigned int parallel_depth) CMP_NOEXCEPT(*b)
+{
+	dups = nullptr;
+	dups_bh = 0;
+	dup_count = 0;
+
+	if (b == nullptr) {
+		result = a;
+		result_bh = a_bh;
+		return;
+	}
+	if (a == nullptr) {
+		result = b;
+		result_bh = b_bh;
+		return;
+	}
+
+	// Take <b> apart and split <a> at <b>
+	size_t child_bh = b_bh;
+	if (b->NB::get_color() == rbtree_internal::Color::BLACK) {
+		child_bh--;
+	}
+	Node * b_left = b->NB::get_left();
+	Node * b_right = b->NB::get_right();
+	size_t b_left_bh = detach_subtree(b_left, child_bh);
+	size_t b_right_bh = detach_subtree(b_right, child_bh);
+
+	Node * a_left;
+	size_t a_left_bh;
+	Node * a_right;
+	size_t a_right_bh;
+	this->template split_subtree<false>(a, a_bh, *b, a_left, a_left_bh, a_right,
+	                                    a_right_bh);
+
+	Node * equal = nullptr;
+	if constexpr (!Options::multiple || Options::compress_duplicates) {
+		// There is at most one node equal to <b>
+		size_t equal_bh;
+		Node * upper;
+		size_t upper_bh;
+		this->template split_subtree<true>(a_right, a_right_bh, *b, equal,
+		                                   equal_bh, upper, upper_bh);
+		a_right = upper;
+		a_right_bh = upper_bh;
+	}
+
+	Node * result_left;
+	size_t result_left_bh;
+	Node * dups_left;
+	size_t dups_left_bh;
+	size_t dup_count_left;
+	Node * result_right;
+	size_t result_right_bh;
+	Node * dups_right;
+	size_t dups_right_bh;
+	size_t dup_count_right;
+
+	unsigned int next_depth = (parallel_depth > 0) ? parallel_depth - 1 : 0;
+	utilities::run_maybe_parallel(
+	    parallel_depth > 0,
+	    [&]() {
+		    // Joining uses the tree's root as scratch space, so every thread
+		    // needs its own tree.
+		    MyClass scratch;
+		    scratch.union_subtrees(a_left, a_left_bh, b_left, b_left_bh,
+		                           result_left, result_left_bh, dups_left,
+		                           dups_left_bh, dup_count_left, next_depth);
+	    },
+	    [&]() {
+		    this->union_subtrees(a_right, a_right_bh, b_right, b_right_bh,
+		                         result_right, result_right_bh, dups_right,
+		                         dups_right_bh, dup_count_right, next_depth);
+	    });
+
+	if (equal == nullptr) {
+		result = this->join_subtrees(result_left, result_left_bh, *b, result_right,
+		                             result_right_bh, result_bh);
+		dups = this->join_subtrees(dups_left, dups_left_bh, dups_right,
+		                           dups_right_bh, dups_bh);
+	} else if constexpr (Options::compress_duplicates) {
+		// <b> and its group join the group of our node
+		this->merge_groups(*equal, *b);
+		result = this->join_subtrees(result_left, result_left_bh, *equal,
+		                             result_right, result_right_bh, result_bh);
+		dups = this->join_subtrees(dups_left, dups_left_bh, dups_right,
+		                           dups_right_bh, dups_bh);
+	} else {
+		// Keep our node, <b> becomes a duplicate
+		result = this->join_subtrees(result_left, result_left_bh, *equal,
+		                             result_right, result_right_bh, result_bh);
+		dups = this->join_subtrees(dups_left, dups_left_bh, *b, dups_right,
+		                           dups_right_bh, dups_bh);
+		dup_count = 1;
+	}
+	dup_count += dup_count_left + dup_count_right;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <bool keep_equal>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::filter_subtree(
+    Node * a, size_t a_bh, const Node * b, Node *& kept, size_t & kept_bh,
+    Node *& removed, size_t & removed_bh, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*b)
+{
+	if ((a == nullptr) || ((b == nullptr) && keep_equal)) {
+		kept = nullptr;
+		kept_bh = 0;
+		removed = a;
+		removed_bh = a_bh;
+		return;
+	}
+	if (b == nullptr) {
+		kept = a;
+		kept_bh = a_bh;
+		removed = nullptr;
+		removed_bh = 0;
+		return;
+	}
+
+	// Split <a> into the nodes less than, equal to and greater than <b>
+	Node * a_left;
+	size_t a_left_bh;
+	Node * upper;
+	size_t upper_bh;
+	Node * equal;
+	size_t equal_bh;
+	Node * a_right;
+	size_t a_right_bh;
+	this->template split_subtree<false>(a, a_bh, *b, a_left, a_left_bh, upper,
+	                                    upper_bh);
+	this->template split_subtree<true>(upper, upper_bh, *b, equal, equal_bh,
+	                                   a_right, a_right_bh);
+
+	Node * kept_left;
+	size_t kept_left_bh;
+	Node * removed_left;
+	size_t removed_left_bh;
+	Node * kept_right;
+	size_t kept_right_bh;
+	Node * removed_right;
+	size_t removed_right_bh;
+
+	unsigned int next_depth = (parallel_depth > 0) ? parallel_depth - 1 : 0;
+	utilities::run_maybe_parallel(
+	    parallel_depth > 0,
+	    [&]() {
+		    MyClass scratch;
+		    scratch.template filter_subtree<keep_equal>(
+		        a_left, a_left_bh, b->NB::get_left(), kept_left, kept_left_bh,
+		        removed_left, removed_left_bh, next_depth);
+	    },
+	    [&]() {
+		    this->template filter_subtree<keep_equal>(
+		        a_right, a_right_bh, b->NB::get_right(), kept_right, kept_right_bh,
+		        removed_right, removed_right_bh, next_depth);
+	    });
+
+	if constexpr (keep_equal) {
+		kept_right = this->join_subtrees(equal, equal_bh, kept_right,
+		                                 kept_right_bh, kept_right_bh);
+	} else {
+		removed_right = this->join_subtrees(equal, equal_bh, removed_right,
+		                                    removed_right_bh, removed_right_bh);
+	}
+	kept = this->join_subtrees(kept_left, kept_left_bh, kept_right,
+	                           kept_right_bh, kept_bh);
+	removed = this->join_subtrees(removed_left, removed_left_bh, removed_right,
+	                              removed_right_bh, removed_bh);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <bool keep_equal>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::filter(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	size_t total = 0;
+	if constexpr (Options::constant_time_size) {
+		total = this->size();
+	}
+
+	Node * kept_root;
+	size_t kept_bh;
+	Node * removed_root;
+	size_t removed_bh;
+	this->template filter_subtree<keep_equal>(
+	    this->root, black_height(this->root), other.root, kept_root, kept_bh,
+	    removed_root, removed_bh, parallel_depth);
+
+	this->root = kept_root;
+	removed.root = removed_root;
+	this->refresh_extremes();
+	removed.refresh_extremes();
+	this->rethread();
+	removed.rethread();
+
+	if constexpr (Options::order_queries && Options::constant_time_size) {
+		this->s.set(get_subtree_size(kept_root));
+		removed.s.set(get_subtree_size(removed_root));
+	} else {
+		this->distribute_size(removed, total);
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::union_with(
+    MyClass & other, unsigned int parallel_depth) CMP_NOEXCEPT(*other.root)
+{
+	size_t total = 0;
+	if constexpr (Options::constant_time_size) {
+		total = this->size() + other.size();
+	}
+
+	Node * result;
+	size_t result_bh;
+	Node * dups;
+	size_t dups_bh;
+	size_t dup_count;
+	this->union_subtrees(this->root, black_height(this->root), other.root,
+	                     black_height(other.root), result, result_bh, dups,
+	                     dups_bh, dup_count, parallel_depth);
+
+	this->root = result;
+	other.root = dups;
+	this->refresh_extremes();
+	other.refresh_extremes();
+	this->rethread();
+	other.rethread();
+
+	if constexpr (Options::constant_time_size) {
+		this->s.set(total - dup_count);
+		other.s.set(dup_count);
+	} else {
+		this->s.touch();
+		other.s.touch();
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::intersect_with(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	this->template filter<true>(other, removed, parallel_depth);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::difference_with(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	this->template filter<false>(other, removed, parallel_depth);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable1, class Comparable2>
+Node *
+RBTree<Node, NodeTraits, Options, Tag, Compare>::cut_range(
+    const Comparable1 & lo, const Comparable2 & hi)
+{
+	Node * left;
+	size_t left_bh;
+	Node * upper;
+	size_t upper_bh;
+	Node * middle;
+	size_t middle_bh;
+	Node * right;
+	size_t right_bh;
+	this->template split_subtree<false>(this->root, black_height(this->root), lo,
+	                                    left, left_bh, upper, upper_bh);
+	this->template split_subtree<false>(upper, upper_bh, hi, middle, middle_bh,
+	                                    right, right_bh);
+
+	size_t joined_bh;
+	this->root =
+	    this->join_subtrees(left, left_bh, right, right_bh, joined_bh);
+	this->refresh_extremes();
+	this->thread_cut_out(middle);
+	return middle;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable1, class Comparable2>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::erase_range(
+    const Comparable1 & lo, const Comparable2 & hi, MyClass & removed)
+{
+	size_t total = 0;
+	if constexpr (Options::constant_time_size) {
+		total = this->size();
+	}
+
+	removed.root = this->cut_range(lo, hi);
+	removed.refresh_extremes();
+
+	if constexpr (Options::order_queries && Options::constant_time_size) {
+		this->s.set(get_subtree_size(this->root));
+		removed.s.set(get_subtree_size(removed.root));
+	} else {
+		// The removed tree is counted first, so this takes O(k).
+		removed.distribute_size(*this, total);
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable1, class Comparable2, class Disposer>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::erase_range(
+    const Comparable1 & lo, const Comparable2 & hi, Disposer && disposer)
+{
+	Node * middle = this->cut_range(lo, hi);
+	this->s.reduce(this->consume_subtree(middle, disposer));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Relocate>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::relayout(Node * arena,
+                                                          Relocate && relocate)
+{
+	this->template relayout_base<NB>(arena, relocate);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::write_structure(
+    const Node * nodes, std::ostream & out) const
+{
+	// The color goes into the tree flag, there is no further data.
+	this->template write_structure_base<0>(
+	    bst::StructureHeader::Kind::RBTREE, nodes, out,
+	    [](const Node & n, unsigned char * meta) {
+		    (void)meta;
+		    return n.NB::get_color() == rbtree_internal::Color::RED;
+	    });
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+bool
+RBTree<Node, NodeTraits, Options, Tag, Compare>::restore_structure(
+    Node * nodes, size_t node_count, const void * data, size_t bytes)
+{
+	return this->template restore_structure_base<0>(
+	    bst::StructureHeader::Kind::RBTREE, nodes, node_count, data, bytes,
+	    [](Node & n, bool red, const unsigned char * meta) {
+		    (void)meta;
+		    if (red) {
+			    n.NB::make_red();
+		    } else {
+			    n.NB::make_black();
+		    }
+	    },
+	    [this](Node & n) {
+		    if constexpr (Options::order_queries) {
+			    this->fix_subtree_size(&n);
+		    }
+		    NodeTraits::children_changed(n, *this);
+	    });
+}
+
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
 void
 RBTree<Node, NodeTraits, Options, Tag, Compare>::remove(Node & node)
@@ -1092,8 +2252,114 @@ RBTree<Node, NodeTraits, Options, Tag, Compare>::remove(Node & node)
 	                          Options::SequenceInterface::get_key(node));
 #endif
 
-	this->remove_to_leaf(node);
 	this->s.reduce(1);
+	if constexpr (Options::compress_duplicates) {
+		if (this->remove_duplicate(node)) {
+			return;
+		}
+		Node * promoted = this->promote_duplicate(node);
+		if (promoted != nullptr) {
+			promoted->NB::set_color(node.NB::get_color());
+			// <promoted> has taken over the children of <node>, but any
+			// augmented data must be recomputed for it and its ancestors.
+			this->children_changed_upwards(promoted);
+			return;
+		}
+	}
+
+	this->remove_to_leaf(node);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+RBTree<Node, NodeTraits, Options, Tag, Compare>::pop_front()
+{
+	Node * smallest = this->get_smallest();
+	if (smallest != nullptr) {
+		this->remove(*smallest);
+	}
+	return smallest;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+RBTree<Node, NodeTraits, Options, Tag, Compare>::pop_back()
+{
+	Node * largest = this->get_largest();
+	if (largest != nullptr) {
+		if constexpr (Options::compress_duplicates) {
+			// Iterating backwards visits the end of the group first
+			largest = this->last_in_group(*largest);
+		}
+		this->remove(*largest);
+	}
+	return largest;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Mutator>
+void
+RBTree<Node, NodeTraits, Options, Tag, Compare>::update_key(Node & node,
+                                                            Mutator && mutator)
+{
+	if constexpr (Options::compress_duplicates) {
+		if (this->is_duplicate(node) || (this->group_size(node) > 1)) {
+			// The node stays in its group if it still equals the other members.
+			// Duplicates store their representative as parent.
+			Node * peer = this->is_duplicate(node) ? node.NB::get_parent()
+			                                       : node.NB::get_dup_next();
+			mutator(node);
+			if (!this->cmp(node, *peer) && !this->cmp(*peer, node)) {
+				if (!this->is_duplicate(node)) {
+					this->children_changed_upwards(&node);
+				}
+				this->s.touch();
+				return;
+			}
+			this->remove(node);
+			this->insert(node);
+			return;
+		}
+	}
+
+	auto it = this->iterator_to(node);
+	auto prev_it = it;
+	--prev_it;
+	auto next_it = it;
+	++next_it;
+	Node * prev = (prev_it != this->end()) ? &(*prev_it) : nullptr;
+	Node * next = (next_it != this->end()) ? &(*next_it) : nullptr;
+
+	mutator(node);
+
+	const bool before_prev = (prev != nullptr) && this->cmp(node, *prev);
+	const bool after_next = (next != nullptr) && this->cmp(*next, node);
+	if constexpr (Options::compress_duplicates) {
+		// A node alone in its group stays in place only if it does not equal a
+		// neighbor. Otherwise, it joins the neighbor's group, which the search
+		// from the root finds.
+		const bool joins_prev = (prev != nullptr) && !this->cmp(*prev, node);
+		const bool joins_next = (next != nullptr) && !this->cmp(node, *next);
+		if (!joins_prev && !joins_next) {
+			this->children_changed_upwards(&node);
+			this->s.touch();
+			return;
+		}
+		this->remove(node);
+		this->insert(node);
+		return;
+	}
+	if (!before_prev && !after_next) {
+		this->children_changed_upwards(&node);
+		this->s.touch();
+		return;
+	}
+
+	// The node moved past one of its neighbors. That neighbor is close to the
+	// new position.
+	this->remove(node);
+	this->insert_at(this->prepare_insert_near(node, before_prev ? *prev : *next),
+	                node);
 }
 
 } // namespace ygg
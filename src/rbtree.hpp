@@ -8,6 +8,7 @@
 
 #include <cassert>
 #include <cstddef>
+#include <iterator>
 #include <set>
 #include <type_traits>
 
@@ -25,7 +26,7 @@ enum class Color : unsigned char
 	RED = 1
 };
 
-template <class Node, bool compress_color>
+template <class Node, bool compress_color, class Link = Node *>
 class ColorParentStorage;
 
 template <class Node>
@@ -70,6 +71,49 @@ private:
 	Color color;
 };
 
+/* With POOL_RELATIVE_LINKS, the color is always packed into the lowest bit of
+ * the 32-bit parent index, regardless of COMPRESS_COLOR. */
+template <class Node, bool compress_color, class Options>
+class ColorParentStorage<Node, compress_color,
+                         bst::RelativeLink<Node, Options>> {
+public:
+	void set_color(Color new_color) noexcept;
+	void make_black() noexcept;
+	void make_red() noexcept;
+
+	Color get_color() const noexcept;
+	void set_parent(Node * new_parent) noexcept;
+	Node * get_parent() const noexcept;
+
+	void swap_parent_with(ColorParentStorage & other) noexcept;
+	void swap_color_with(ColorParentStorage & other) noexcept;
+
+	static constexpr bool parent_reference = false;
+
+private:
+	using Link = bst::RelativeLink<Node, Options>;
+	static constexpr std::uint32_t null_parent = Link::null_index >> 1;
+
+	std::uint32_t parent_and_color;
+};
+
+template <class Node, class Options>
+using ColorParentStorageFor =
+    ColorParentStorage<Node, Options::compress_color,
+                       bst::NodeLink<Node, Options>>;
+
+/* Stores the size of the subtree below a node if ORDER_QUERIES is set, and
+ * nothing otherwise. */
+template <bool enable>
+class SubtreeSizeStorage {
+};
+
+template <>
+class SubtreeSizeStorage<true> {
+public:
+	size_t _rbt_size;
+};
+
 /// @endcond
 } // namespace rbtree_internal
 
@@ -92,7 +136,8 @@ template <class Node, class Options = DefaultOptions, class Tag = int>
 class RBTreeNodeBase
     : public bst::BSTNodeBase<
           Node, Options, Tag,
-          rbtree_internal::ColorParentStorage<Node, Options::compress_color>> {
+          rbtree_internal::ColorParentStorageFor<Node, Options>>,
+      public rbtree_internal::SubtreeSizeStorage<Options::order_queries> {
 public:
 	// TODO namespacing!
 
@@ -106,8 +151,7 @@ public:
 
 private:
 	using ActiveOptions = Options;
-	friend class rbtree_internal::ColorParentStorage<Node,
-	                                                 Options::compress_color>;
+	friend rbtree_internal::ColorParentStorageFor<Node, Options>;
 };
 
 /**
@@ -168,6 +212,23 @@ public:
 		(void)old_descendant;
 		(void)t;
 	}
+
+	/**
+	 * @brief Called when a node's children have been set wholesale
+	 *
+	 * This is called during bulk construction (see
+	 * RBTree::build_from_sorted()) as well as while splitting and joining trees,
+	 * whenever the subtrees below <node> have been exchanged. Nodes are visited
+	 * bottom-up, thus it suffices to recompute any information of <node> from
+	 * its children.
+	 */
+	template <class Node, class Tree>
+	static void
+	children_changed(Node & node, Tree & t) noexcept
+	{
+		(void)node;
+		(void)t;
+	}
 };
 
 /**
@@ -194,18 +255,22 @@ template <class Node, class NodeTraits, class Options = DefaultOptions,
 class RBTree
     : public bst::BinarySearchTree<
           Node, Options, Tag, Compare,
-          rbtree_internal::ColorParentStorage<Node, Options::compress_color>>
+          rbtree_internal::ColorParentStorageFor<Node, Options>>
 
 {
 public:
 	using MyClass = RBTree<Node, NodeTraits, Options, Tag, Compare>;
 	// Node Base
 	using NB = RBTreeNodeBase<Node, Options, Tag>;
-	using TB = bst::BinarySearchTree<
-	    Node, Options, Tag, Compare,
-	    rbtree_internal::ColorParentStorage<Node, Options::compress_color>>;
+	using TB =
+	    bst::BinarySearchTree<Node, Options, Tag, Compare,
+	                          rbtree_internal::ColorParentStorageFor<Node, Options>>;
 	static_assert(std::is_base_of<NB, Node>::value,
 	              "Node class not properly derived from RBTreeNodeBase");
+	static_assert(!Options::no_parent_pointers,
+	              "NO_PARENT_POINTERS is currently only supported by the ZTree");
+	static_assert(!(Options::compress_duplicates && Options::order_queries),
+	              "COMPRESS_DUPLICATES can not be combined with ORDER_QUERIES.");
 
 	/**
 	 * @brief Create a new empty red-black tree.
@@ -248,6 +313,21 @@ public:
 	void insert(Node & node, Node & hint) CMP_NOEXCEPT(node);
 	void insert(Node & node, iterator<false> hint) CMP_NOEXCEPT(node);
 
+	/**
+	 * @brief Inserts <node> at a position found by find_or_prepare_insert()
+	 *
+	 * Inserts <node> without searching for its position again. <node> must
+	 * compare equally to the query that was passed to find_or_prepare_insert(),
+	 * the handle must not refer to an existing node (i.e., handle.found() must
+	 * be false) and the tree must not have been modified since the handle was
+	 * created.
+	 *
+	 * @param handle  The insertion position returned by find_or_prepare_insert()
+	 * @param node    The node to be inserted
+	 */
+	void insert_at(const typename TB::InsertHandle & handle, Node & node)
+	    noexcept;
+
 	// TODO document hinted inserts
 	// TODO should order be preserved on hints?
 
@@ -260,6 +340,59 @@ public:
 	 */
 	void remove(Node & node) CMP_NOEXCEPT(node);
 
+	/**
+	 * @brief Removes the smallest node from the tree
+	 *
+	 * Removes the smallest node from the tree and returns it. If the
+	 * CACHED_EXTREMES option is set, the node is not searched and this runs in
+	 * O(1) amortized time. Otherwise, this takes O(log n).
+	 *
+	 * @return The removed node, or nullptr if the tree was empty
+	 */
+	Node * pop_front();
+
+	/**
+	 * @brief Removes the largest node from the tree
+	 *
+	 * Removes the largest node from the tree and returns it. If the
+	 * CACHED_EXTREMES option is set, the node is not searched and this runs in
+	 * O(1) amortized time. Otherwise, this takes O(log n).
+	 *
+	 * @return The removed node, or nullptr if the tree was empty
+	 */
+	Node * pop_back();
+
+	/**
+	 * @brief Changes the key of <node>, which is in the tree
+	 *
+	 * Calls <mutator> with <node> as only argument. <mutator> may change the
+	 * key of the node. If the node still lies between its in-order predecessor
+	 * and successor afterwards, the tree is left as it is. Otherwise, the node
+	 * is removed and re-inserted, searching for the new position starting from
+	 * the old one (see lower_bound(query, hint)). If keys only change by a few
+	 * positions, this is much cheaper than calling remove() and insert().
+	 *
+	 * If the COMPRESS_DUPLICATES option is set, a node that shares its group
+	 * with other nodes is left as it is if it still equals them. A node that
+	 * is alone in its group is left as it is if it lies strictly between its
+	 * predecessor and successor. In all other cases, the node is removed and
+	 * re-inserted, searching from the root.
+	 *
+	 * If the node stays in place, NodeTraits::children_changed() is called for
+	 * it and all its ancestors, so that data derived from the keys (e.g., in
+	 * an augmented tree) is recomputed. This takes O(log n). Nodes that hang
+	 * off a representative (see COMPRESS_DUPLICATES) are not seen by the
+	 * NodeTraits, thus nothing is recomputed for them.
+	 *
+	 * @warning If the tree does not allow multiple equal keys, the new key must
+	 * not be present in the tree.
+	 *
+	 * @param node     The node whose key should be changed
+	 * @param mutator  A callable that is passed <node> and changes its key
+	 */
+	template <class Mutator>
+	void update_key(Node & node, Mutator && mutator);
+
 	/**
 	 * @brief Deletes a node that compares equally to <c> from the tree
 	 *
@@ -304,6 +437,273 @@ public:
 	utilities::select_type_t<const iterator<reverse>, Node *, Options::stl_erase>
 	erase(const iterator<reverse> & it) CMP_NOEXCEPT(*it);
 
+	/**
+	 * @brief Computes the rank of a node
+	 *
+	 * Returns the number of nodes that come before <node> in the tree, i.e.,
+	 * the position of <node> in an in-order traversal of the tree, starting at
+	 * zero. This method runs in O(log n).
+	 *
+	 * @warning This method is only available if ORDER_QUERIES is set as option!
+	 *
+	 * @param node  The node whose rank should be computed. Must be in the tree.
+	 * @return The number of nodes before <node>
+	 */
+	size_t rank(const Node & node) const noexcept;
+
+	/**
+	 * @brief Finds the k-th node
+	 *
+	 * Returns an iterator to the node that has rank <k>, i.e., that has exactly
+	 * <k> nodes before it in the tree. This method runs in O(log n).
+	 *
+	 * @warning This method is only available if ORDER_QUERIES is set as option!
+	 *
+	 * @param k   The rank of the node to be found, starting at zero.
+	 * @return An iterator to the node with rank <k>, or end() if the tree holds
+	 * no more than <k> nodes.
+	 */
+	const_iterator<false> select(size_t k) const noexcept;
+	iterator<false> select(size_t k) noexcept;
+
+	/**
+	 * @brief Counts the nodes in a range of keys
+	 *
+	 * Returns the number of nodes that are neither less than <lo> nor greater
+	 * than <hi>, i.e., the number of nodes between lower_bound(lo) and
+	 * upper_bound(hi). This method runs in O(log n).
+	 *
+	 * Note that <lo> and <hi> do not have to be Nodes, but can be anything
+	 * that can be compared to a Node. See BinarySearchTree::find() for
+	 * details.
+	 *
+	 * @warning This method is only available if ORDER_QUERIES is set as option!
+	 *
+	 * @param lo  The lower end of the range (inclusive)
+	 * @param hi  The upper end of the range (inclusive)
+	 * @return The number of nodes in [lo, hi]
+	 */
+	template <class ComparableLo, class ComparableHi>
+	size_t count_range(const ComparableLo & lo, const ComparableHi & hi) const
+	    CMP_NOEXCEPT(lo);
+
+	/**
+	 * @brief Builds the tree from a sorted range of nodes
+	 *
+	 * Replaces the contents of the tree with the nodes in [first, last). The
+	 * nodes must already be sorted with respect to the tree's Compare. The tree
+	 * is built in O(n) as a perfectly balanced tree, in which only the deepest
+	 * level is colored red. Any nodes previously contained in the tree are
+	 * discarded (as if clear() had been called).
+	 *
+	 * The children_changed() callback of the NodeTraits is called for every
+	 * node in a bottom-up fashion, so that augmented trees can compute their
+	 * additional information.
+	 *
+	 * @param first   Forward iterator to the first node. Dereferencing it must
+	 * yield a Node &. The range is traversed more than once.
+	 * @param last    Iterator past the last node.
+	 */
+	template <class ForwardIt>
+	void build_from_sorted(ForwardIt first, ForwardIt last) noexcept;
+
+	/**
+	 * @brief Splits the tree at <key>
+	 *
+	 * All nodes that are less than <key> remain in this tree, all other nodes
+	 * are moved into <right>, which must be empty.
+	 *
+	 * If CONSTANT_TIME_SIZE is set but ORDER_QUERIES is not, this runs in
+	 * O(log n + m), where m is the size of the smaller resulting tree, since
+	 * the sizes of the resulting trees must be counted. Otherwise, it runs in
+	 * O(log n).
+	 *
+	 * @param key     Anything comparable to a Node. See BinarySearchTree::find()
+	 * for details.
+	 * @param right   An empty tree that receives all nodes not less than
+	 * <key>.
+	 */
+	template <class Comparable>
+	void split(const Comparable & key, MyClass & right) CMP_NOEXCEPT(key);
+
+	/**
+	 * @brief Appends a tree to this tree
+	 *
+	 * Moves all nodes of <right> into this tree. No node in <right> may be less
+	 * than any node in this tree. Afterwards, <right> is empty. This runs in
+	 * O(log n).
+	 *
+	 * The variant taking a <pivot> additionally inserts <pivot>, which must not
+	 * be contained in any tree and must fit between the nodes of this tree and
+	 * the nodes of <right>.
+	 *
+	 * @param right   The tree whose nodes should be appended.
+	 */
+	void join(MyClass & right) noexcept;
+	void join(Node & pivot, MyClass & right) noexcept;
+
+	/**
+	 * @brief Moves all nodes of <other> into this tree
+	 *
+	 * Computes the union of this tree and <other> using the join-based
+	 * divide-and-conquer algorithm, which takes O(m log(n/m + 1)) time for trees
+	 * of sizes m <= n. If MULTIPLE is not set, nodes of <other> for which an
+	 * equal node exists in this tree are not moved, but remain in <other>.
+	 * Otherwise, <other> is empty afterwards.
+	 *
+	 * On the topmost <parallel_depth> levels of the recursion, the two halves are
+	 * processed in parallel, using up to 2^<parallel_depth> threads. Comparisons
+	 * must not throw in that case.
+	 *
+	 * @param other           The tree whose nodes should be moved into this tree.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void union_with(MyClass & other, unsigned int parallel_depth = 0)
+	    CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes that have no equal node in <other>
+	 *
+	 * Afterwards, this tree contains exactly the nodes for which an equal node
+	 * exists in <other>. All other nodes are moved into <removed>. Any nodes
+	 * previously contained in <removed> are discarded. <other> is not modified.
+	 * This takes O(m log(n/m + 1)) time for trees of sizes m <= n, see
+	 * union_with() for the meaning of <parallel_depth>.
+	 *
+	 * Note that if CONSTANT_TIME_SIZE is set but ORDER_QUERIES is not, the
+	 * sizes of the resulting trees must be counted, which takes time linear in
+	 * the size of the smaller of the two.
+	 *
+	 * @param other           The tree to intersect this tree with.
+	 * @param removed         The tree that receives all removed nodes.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void intersect_with(const MyClass & other, MyClass & removed,
+	                    unsigned int parallel_depth = 0) CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes that have an equal node in <other>
+	 *
+	 * The removed nodes are moved into <removed>, any nodes previously contained
+	 * in <removed> are discarded. <other> is not modified. See intersect_with()
+	 * for details.
+	 *
+	 * @param other           The tree whose nodes should be subtracted.
+	 * @param removed         The tree that receives all removed nodes.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void difference_with(const MyClass & other, MyClass & removed,
+	                     unsigned int parallel_depth = 0)
+	    CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes in the range [<lo>, <hi>)
+	 *
+	 * All nodes that are not less than <lo> but less than <hi> are moved into
+	 * <removed>. Any nodes previously contained in <removed> are discarded.
+	 * This takes O(log n + k) time for k removed nodes.
+	 *
+	 * The range is split out of the tree and the remainder is joined again in
+	 * O(log n). The O(k) term is for updating the sizes: If CONSTANT_TIME_SIZE
+	 * is set but ORDER_QUERIES is not, the removed nodes must be counted. If
+	 * ORDER_QUERIES is set, the sizes are taken from the subtree sizes, and if
+	 * CONSTANT_TIME_SIZE is not set, there are no sizes to update. In both
+	 * cases, this takes O(log n) time, independent of k.
+	 *
+	 * The variant taking a <disposer> instead calls it for every removed node (as
+	 * Node &) in order, taking O(log n + k) time. The links of a node are not
+	 * accessed anymore once the disposer has been called on it, so the disposer
+	 * may e.g. destroy the node.
+	 *
+	 * @param lo        Anything comparable to a Node. The inclusive lower bound
+	 * of the range.
+	 * @param hi        Anything comparable to a Node. The exclusive upper bound
+	 * of the range.
+	 * @param removed   The tree that receives all removed nodes.
+	 */
+	template <class Comparable1, class Comparable2>
+	void erase_range(const Comparable1 & lo, const Comparable2 & hi,
+	                 MyClass & removed);
+	template <class Comparable1, class Comparable2, class Disposer>
+	void erase_range(const Comparable1 & lo, const Comparable2 & hi,
+	                 Disposer && disposer);
+
+	/**
+	 * @brief Moves all nodes into <arena>, in van Emde Boas order
+	 *
+	 * Copies the nodes of the tree into the contiguous buffer <arena> and makes
+	 * the copies the nodes of the tree. The nodes are placed in van Emde Boas
+	 * order: the upper half of the levels of the tree is laid out recursively,
+	 * followed by every subtree hanging off it, from left to right. Thus, any
+	 * search touches only O(log_B n) cache lines or pages, whatever their size B.
+	 * This takes O(n log log n) time and O(n) additional space and is meant to
+	 * be run in quiet periods, e.g. after the tree has been built.
+	 *
+	 * Every node is moved into the arena via its move assignment operator. The
+	 * tree's own node base (i.e., its color and subtree size) is copied separately.
+	 * Afterwards, <relocate> is called as relocate(Node & old_node, Node &
+	 * new_node) for every node, so that external references can be updated.
+	 * The old nodes are not part of the tree anymore at that point, and are not
+	 * accessed after <relocate> has been called on them, so it may e.g. destroy
+	 * them.
+	 *
+	 * The nodes must not be part of any other tree. If
+	 * POOL_RELATIVE_LINKS is set, the arena must be part of the pool.
+	 *
+	 * @param arena     Pointer to an array of at least size() nodes that are
+	 * not part of any tree. It must not overlap with the tree's nodes.
+	 * @param relocate  Called for every node after it has been moved.
+	 */
+	template <class Relocate>
+	void relayout(Node * arena, Relocate && relocate);
+
+	/**
+	 * @brief Writes the structure of the tree to <out>
+	 *
+	 * Writes a compact binary description of the tree's shape to <out>: For
+	 * every node in pre-order, its index relative to <nodes>, which of its
+	 * children exist and its color. The nodes themselves are not written, you
+	 * must persist them yourself, e.g. as an array. This takes O(n) time.
+	 *
+	 * Together with the nodes, the structure allows restore_structure() to
+	 * rebuild the tree in O(n) time, without comparing any nodes. For n nodes
+	 * spread over less than 2^32 array slots, 16 + 5n bytes are written. See
+	 * bst::StructureHeader for the format.
+	 *
+	 * @param nodes   The start of the array that all nodes of the tree are in
+	 * @param out     The stream to write the structure to
+	 */
+	void write_structure(const Node * nodes, std::ostream & out) const;
+
+	/**
+	 * @brief Restores a tree from its structure written by write_structure()
+	 *
+	 * Makes this tree the tree that write_structure() described, with its nodes
+	 * taken from the array <nodes> at the written indices. Nodes that were in
+	 * this tree before are not part of it anymore (and not touched). The
+	 * structure is read strictly sequentially, so it can e.g. be mapped from a
+	 * file via mmap(). This takes O(n) time and O(log n) additional space, and
+	 * does not compare any nodes. NodeTraits::children_changed() is called on
+	 * every node, children before parents, so that augmented data (e.g., in
+	 * IntervalTree) is rebuilt.
+	 *
+	 * The nodes must be equal to the ones the structure was written from, in
+	 * the same order. Only the format of <data> and the indices are checked,
+	 * not whether the tree is a valid tree. If the check fails, the tree is
+	 * empty afterwards.
+	 *
+	 * @param nodes       The start of the array the tree's nodes are taken from
+	 * @param node_count  The number of nodes in the array
+	 * @param data        The structure written by write_structure()
+	 * @param bytes       The size of <data> in bytes
+	 * @return Whether <data> was a valid structure
+	 */
+	bool restore_structure(Node * nodes, size_t node_count, const void * data,
+	                       size_t bytes);
+
 	// Mainly debugging methods
 	/// @cond INTERNAL
 	void dbg_verify() const;
@@ -318,10 +718,54 @@ protected:
 
 	void insert_leaf_base(Node & node, Node * start) CMP_NOEXCEPT(node);
 
-	void fixup_after_insert(Node * node) noexcept;
+	bool fixup_after_insert(Node * node) noexcept;
+	// Calls NodeTraits::children_changed() for <node> and all its ancestors
+	void children_changed_upwards(Node * node) noexcept;
 	void rotate_left(Node * parent) noexcept;
 	void rotate_right(Node * parent) noexcept;
 
+	// Order queries
+	static size_t get_subtree_size(const Node * n) noexcept;
+	void fix_subtree_size(Node * n) noexcept;
+	void adjust_sizes_to_root(Node * start, bool increase) noexcept;
+	template <class Comparable, bool count_equal>
+	size_t count_before(const Comparable & query) const CMP_NOEXCEPT(query);
+
+	template <class ForwardIt>
+	Node * build_subtree(ForwardIt & it, size_t count, size_t depth,
+	                     size_t red_depth) noexcept;
+
+	// Splitting and joining
+	static size_t black_height(const Node * sub_root) noexcept;
+	static size_t detach_subtree(Node * sub_root, size_t sub_bh) noexcept;
+	Node * join_subtrees(Node * left, size_t left_bh, Node & pivot, Node * right,
+	                     size_t right_bh, size_t & joined_bh) noexcept;
+	Node * join_subtrees(Node * left, size_t left_bh, Node * right,
+	                     size_t right_bh, size_t & joined_bh) noexcept;
+	template <bool on_equality_prefer_left, class Comparable>
+	void split_subtree(Node * sub_root, size_t sub_bh, const Comparable & key,
+	                   Node *& left, size_t & left_bh, Node *& right,
+	                   size_t & right_bh) CMP_NOEXCEPT(key);
+	Node * split_last(Node * sub_root, size_t sub_bh, Node *& rest,
+	                  size_t & rest_bh) noexcept;
+	// Joins with <right> at <pivot>, which carries <pivot_count> nodes
+	void join_at(Node & pivot, MyClass & right, size_t pivot_count) noexcept;
+
+	// Set operations
+	void union_subtrees(Node * a, size_t a_bh, Node * b, size_t b_bh,
+	                    Node *& result, size_t & result_bh, Node *& dups,
+	                    size_t & dups_bh, size_t & dup_count,
+	                    unsigned int parallel_depth) CMP_NOEXCEPT(*b);
+	template <bool keep_equal>
+	void filter_subtree(Node * a, size_t a_bh, const Node * b, Node *& kept,
+	                    size_t & kept_bh, Node *& removed, size_t & removed_bh,
+	                    unsigned int parallel_depth) CMP_NOEXCEPT(*b);
+	template <bool keep_equal>
+	void filter(const MyClass & other, MyClass & removed,
+	            unsigned int parallel_depth) CMP_NOEXCEPT(*other.root);
+	template <class Comparable1, class Comparable2>
+	Node * cut_range(const Comparable1 & lo, const Comparable2 & hi);
+
 	void swap_nodes(Node * n1, Node * n2, bool swap_colors = true) noexcept;
 	void replace_node(Node * to_be_replaced, Node * replace_with) noexcept;
 	void swap_unrelated_nodes(Node * n1, Node * n2) noexcept;
@@ -330,6 +774,7 @@ protected:
 	void verify_black_root() const;
 	void verify_black_paths(const Node * node, unsigned int * path_length) const;
 	void verify_red_black(const Node * node) const;
+	size_t verify_subtree_sizes(const Node * node) const;
 };
 
 } // namespace ygg
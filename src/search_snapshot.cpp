@@ -0,0 +1,189 @@
+#ifndef YGG_SEARCH_SNAPSHOT_CPP
+#define YGG_SEARCH_SNAPSHOT_CPP
+
+#include "search_snapshot.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace ygg {
+
+template <class Tree, class KeyGetter, class Compare>
+SearchSnapshot<Tree, KeyGetter, Compare>::SearchSnapshot() noexcept
+    : tree(nullptr), modifications_at_build(0)
+{}
+
+template <class Tree, class KeyGetter, class Compare>
+SearchSnapshot<Tree, KeyGetter, Compare>::SearchSnapshot(Tree & tree_in)
+    : tree(nullptr), modifications_at_build(0)
+{
+	this->rebuild(tree_in);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+void
+SearchSnapshot<Tree, KeyGetter, Compare>::rebuild(Tree & tree_in)
+{
+	this->tree = &tree_in;
+
+	size_t n;
+	if constexpr (Options::constant_time_size) {
+		n = tree_in.size();
+	} else {
+		n = static_cast<size_t>(std::distance(tree_in.begin(), tree_in.end()));
+	}
+
+	this->keys.clear();
+	this->nodes.clear();
+	this->keys.resize(n + 1);
+	this->nodes.resize(n + 1, nullptr);
+
+	this->fill(tree_in.begin(), 1);
+
+	if constexpr (Options::modification_counter) {
+		this->modifications_at_build = tree_in.get_modification_count();
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+void
+SearchSnapshot<Tree, KeyGetter, Compare>::rebuild()
+{
+	this->rebuild(*this->tree);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class InputIt>
+InputIt
+SearchSnapshot<Tree, KeyGetter, Compare>::fill(InputIt it, size_t k)
+{
+	// In-order traversal of the implicit tree, assigning the tree's nodes in
+	// ascending order.
+	if (k > this->size()) {
+		return it;
+	}
+
+	it = this->fill(it, 2 * k);
+	this->keys[k] = KeyGetter::get_key(*it);
+	this->nodes[k] = &(*it);
+	++it;
+	return this->fill(it, 2 * k + 1);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+bool
+SearchSnapshot<Tree, KeyGetter, Compare>::is_stale() const noexcept
+{
+	// A default-constructed snapshot belongs to no tree and can not be used
+	if (this->tree == nullptr) {
+		return true;
+	}
+	return this->tree->get_modification_count() != this->modifications_at_build;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+size_t
+SearchSnapshot<Tree, KeyGetter, Compare>::size() const noexcept
+{
+	if (this->keys.empty()) {
+		return 0;
+	}
+	return this->keys.size() - 1;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+bool
+SearchSnapshot<Tree, KeyGetter, Compare>::empty() const noexcept
+{
+	return this->size() == 0;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <bool strict, class Comparable>
+size_t
+SearchSnapshot<Tree, KeyGetter, Compare>::search(
+    const Comparable & query) const
+{
+	const size_t n = this->size();
+	const Key * key_array = this->keys.data();
+
+	size_t k = 1;
+	while (k <= n) {
+		// The 16 descendants four levels below are stored contiguously. Fetching
+		// them now hides the latency of the cache misses of the lower levels.
+		// Only the part of the block that lies within the array is fetched. The
+		// block need not start at a cache line boundary, thus its last byte may
+		// lie in a line that the loop does not reach.
+		const size_t block = k << PREFETCH_LEVELS;
+		if (block <= n) {
+			const size_t block_size =
+			    std::min(size_t(1) << PREFETCH_LEVELS, n + 1 - block);
+			const char * first = reinterpret_cast<const char *>(key_array + block);
+			const char * last =
+			    reinterpret_cast<const char *>(key_array + block + block_size) - 1;
+			for (const char * line = first; line < last; line += CACHE_LINE_BYTES) {
+				__builtin_prefetch(line);
+			}
+			__builtin_prefetch(last);
+		}
+
+		// Go right if the key at k is before the result. No branching on the
+		// comparison result here, it is unpredictable.
+		bool go_right;
+		if constexpr (strict) {
+			go_right = !this->cmp(query, key_array[k]);
+		} else {
+			go_right = this->cmp(key_array[k], query);
+		}
+		k = 2 * k + static_cast<size_t>(go_right);
+	}
+
+	// We went right since the last time we went left, i.e., we must strip the
+	// trailing ones plus the last left turn. If we only went right, this
+	// results in 0.
+	return k >> __builtin_ffsl(static_cast<long int>(~k));
+}
+
+template <class Tree, class KeyGetter, class Compare>
+typename SearchSnapshot<Tree, KeyGetter, Compare>::iterator
+SearchSnapshot<Tree, KeyGetter, Compare>::iterator_at(size_t k) const
+{
+	if (k == 0) {
+		return this->tree->end();
+	}
+	return this->tree->iterator_to(*this->nodes[k]);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class Comparable>
+typename SearchSnapshot<Tree, KeyGetter, Compare>::iterator
+SearchSnapshot<Tree, KeyGetter, Compare>::upper_bound(
+    const Comparable & query) const
+{
+	return this->iterator_at(this->template search<true>(query));
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class Comparable>
+typename SearchSnapshot<Tree, KeyGetter, Compare>::iterator
+SearchSnapshot<Tree, KeyGetter, Compare>::lower_bound(
+    const Comparable & query) const
+{
+	return this->iterator_at(this->template search<false>(query));
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class Comparable>
+typename SearchSnapshot<Tree, KeyGetter, Compare>::iterator
+SearchSnapshot<Tree, KeyGetter, Compare>::find(const Comparable & query) const
+{
+	size_t k = this->template search<false>(query);
+	if ((k != 0) && !this->cmp(query, this->keys[k])) {
+		return this->iterator_at(k);
+	}
+	return this->tree->end();
+}
+
+} // namespace ygg
+
+#endif // YGG_SEARCH_SNAPSHOT_CPP
@@ -0,0 +1,178 @@
+#ifndef YGG_SEARCH_SNAPSHOT_HPP
+#define YGG_SEARCH_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "util.hpp"
+
+namespace ygg {
+
+/**
+ * @brief A read-only search structure built from a snapshot of a tree
+ *
+ * A SearchSnapshot copies the keys of all nodes of a tree (plus pointers to
+ * the nodes) into an array in Eytzinger layout, i.e., the layout of an
+ * implicit binary heap. Searching this array touches the same cache lines for
+ * the top levels of every search, prefetches all keys four levels further
+ * down (every cache line they span, so this also works for large keys) and
+ * does not branch on the comparison results. For trees that go through long
+ * phases in which they are only searched, this is considerably faster than
+ * following the tree's pointers.
+ *
+ * All searches return iterators into the original tree. The snapshot does
+ * not follow modifications of the tree. If the tree is modified, the
+ * snapshot must be rebuilt via rebuild(). If the tree has the
+ * MODIFICATION_COUNTER option set, is_stale() can be used to detect this.
+ *
+ * Any tree derived from bst::BinarySearchTree (RBTree, WBTree, ZTree, …) can
+ * be used.
+ *
+ * @tparam Tree       The type of tree to build the snapshot from
+ * @tparam KeyGetter  A class that must provide a static method get_key(const
+ * Node &) that returns the key of a node. The returned keys are copied into
+ * the snapshot. Keys must be sorted in the same way as the nodes in the tree
+ * and must be default-constructible.
+ * @tparam Compare    A compare class for the keys. Defaults to std::less-like
+ * comparison of keys and query values.
+ */
+template <class Tree, class KeyGetter,
+          class Compare = ygg::utilities::flexible_less>
+class SearchSnapshot {
+public:
+	/// @cond INTERNAL
+	using Node = typename Tree::NodeT;
+	using Options = typename Tree::OptionsT;
+	using Key = std::decay_t<decltype(
+	    KeyGetter::get_key(std::declval<const Node &>()))>;
+	/// @endcond
+	using iterator = decltype(std::declval<Tree &>().begin());
+
+	/**
+	 * @brief Create an empty snapshot that is not associated with any tree
+	 */
+	SearchSnapshot() noexcept;
+
+	/**
+	 * @brief Create a snapshot of a tree
+	 *
+	 * This runs in O(n).
+	 *
+	 * @param tree  The tree to create the snapshot of
+	 */
+	explicit SearchSnapshot(Tree & tree);
+
+	/**
+	 * @brief Rebuild the snapshot from a (possibly different) tree
+	 *
+	 * This runs in O(n).
+	 *
+	 * @param tree  The tree to create the snapshot of
+	 */
+	void rebuild(Tree & tree);
+
+	/**
+	 * @brief Rebuild the snapshot from the tree it was last built from
+	 *
+	 * This runs in O(n).
+	 */
+	void rebuild();
+
+	/**
+	 * @brief Returns whether the tree was modified since the snapshot was built
+	 *
+	 * @warning This method is only available if the tree has the
+	 * MODIFICATION_COUNTER option set!
+	 *
+	 * @return true if the snapshot must be rebuilt before it can be used again.
+	 * This is always true for a default-constructed snapshot.
+	 */
+	bool is_stale() const noexcept;
+
+	/**
+	 * @brief Returns the number of nodes in the snapshot
+	 *
+	 * @return The number of nodes in the snapshot
+	 */
+	size_t size() const noexcept;
+
+	/**
+	 * @brief Returns whether the snapshot is empty
+	 *
+	 * @return true if the snapshot contains no nodes
+	 */
+	bool empty() const noexcept;
+
+	/**
+	 * @brief Upper-bounds an element
+	 *
+	 * Returns an iterator into the tree pointing to the first element that is
+	 * greater than query, or the tree's end() if there is no such element.
+	 * This runs in O(log n).
+	 *
+	 * @param query An object comparable to the keys in the snapshot
+	 * @return An iterator to the first element greater than query
+	 */
+	template <class Comparable>
+	iterator upper_bound(const Comparable & query) const;
+
+	/**
+	 * @brief Lower-bounds an element
+	 *
+	 * Returns an iterator into the tree pointing to the first element that is
+	 * not less than query, or the tree's end() if there is no such element.
+	 * This runs in O(log n).
+	 *
+	 * @param query An object comparable to the keys in the snapshot
+	 * @return An iterator to the first element not less than query
+	 */
+	template <class Comparable>
+	iterator lower_bound(const Comparable & query) const;
+
+	/**
+	 * @brief Finds an element
+	 *
+	 * Returns an iterator into the tree pointing to the first element whose key
+	 * compares equally to query, or the tree's end() if there is no such
+	 * element. This runs in O(log n).
+	 *
+	 * @param query An object comparable to the keys in the snapshot
+	 * @return An iterator to the first element equal to query
+	 */
+	template <class Comparable>
+	iterator find(const Comparable & query) const;
+
+private:
+	Tree * tree;
+	size_t modifications_at_build;
+
+	// Both arrays are in Eytzinger layout and 1-based, i.e., the children of
+	// index k are at 2k and 2k+1. Index 0 is unused.
+	std::vector<Key> keys;
+	std::vector<Node *> nodes;
+
+	Compare cmp;
+
+	// search() prefetches the 16 descendants four levels down, which are
+	// contiguous in the key array. For large keys, they span several cache
+	// lines, each of which must be prefetched.
+	static constexpr size_t PREFETCH_LEVELS = 4;
+	static constexpr size_t CACHE_LINE_BYTES = 64;
+
+	template <class InputIt>
+	InputIt fill(InputIt it, size_t k);
+
+	// Returns the Eytzinger index of the result, or 0 if there is none
+	template <bool strict, class Comparable>
+	size_t search(const Comparable & query) const;
+
+	iterator iterator_at(size_t k) const;
+};
+
+} // namespace ygg
+
+#include "search_snapshot.cpp"
+
+#endif // YGG_SEARCH_SNAPSHOT_HPP
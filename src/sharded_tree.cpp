@@ -0,0 +1,542 @@
+#ifndef YGG_SHARDED_TREE_CPP
+#define YGG_SHARDED_TREE_CPP
+
+#include "sharded_tree.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+namespace ygg {
+
+namespace sharded_tree_internal {
+/// @cond INTERNAL
+
+inline DistributedSharedMutex::DistributedSharedMutex()
+    : slot_count(std::max(size_t{1},
+                          static_cast<size_t>(std::thread::hardware_concurrency()))),
+      slots(new Slot[slot_count])
+{}
+
+inline size_t
+DistributedSharedMutex::thread_index() noexcept
+{
+	// Threads are numbered in the order in which they first take a lock. The
+	// atomic is only touched once per thread.
+	static std::atomic<size_t> thread_counter{0};
+	thread_local size_t index =
+	    thread_counter.fetch_add(1, std::memory_order_relaxed);
+	return index;
+}
+
+inline size_t
+DistributedSharedMutex::lock_shared()
+{
+	size_t slot = thread_index() % this->slot_count;
+	this->slots[slot].mutex.lock_shared();
+	return slot;
+}
+
+inline void
+DistributedSharedMutex::unlock_shared(size_t slot) noexcept
+{
+	this->slots[slot].mutex.unlock_shared();
+}
+
+inline void
+DistributedSharedMutex::lock()
+{
+	// Always locking in the same order rules out deadlocks between writers
+	for (size_t i = 0; i < this->slot_count; ++i) {
+		this->slots[i].mutex.lock();
+	}
+}
+
+inline void
+DistributedSharedMutex::unlock() noexcept
+{
+	for (size_t i = 0; i < this->slot_count; ++i) {
+		this->slots[i].mutex.unlock();
+	}
+}
+
+inline SharedLockGuard::SharedLockGuard(DistributedSharedMutex & mutex_in)
+    : mutex(mutex_in), slot(mutex_in.lock_shared())
+{}
+
+inline SharedLockGuard::~SharedLockGuard()
+{
+	this->mutex.unlock_shared(this->slot);
+}
+
+/// @endcond
+} // namespace sharded_tree_internal
+
+template <class Tree, class KeyGetter, class Compare>
+ShardedTree<Tree, KeyGetter, Compare>::ShardedTree(
+    std::vector<Key> boundaries_in)
+    : boundaries(std::move(boundaries_in)), shards(this->boundaries.size() + 1)
+{
+	// shard_of() binary searches the boundaries
+	assert(std::is_sorted(this->boundaries.begin(), this->boundaries.end(),
+	                      [this](const Key & lhs, const Key & rhs) {
+		                      return this->cmp(lhs, rhs);
+	                      }));
+}
+
+template <class Tree, class KeyGetter, class Compare>
+size_t
+ShardedTree<Tree, KeyGetter, Compare>::shard_count() const noexcept
+{
+	return this->shards.size();
+}
+
+template <class Tree, class KeyGetter, class Compare>
+std::vector<typename ShardedTree<Tree, KeyGetter, Compare>::Key>
+ShardedTree<Tree, KeyGetter, Compare>::get_boundaries() const
+{
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	return this->boundaries;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class Comparable>
+size_t
+ShardedTree<Tree, KeyGetter, Compare>::shard_of(const Comparable & query) const
+{
+	// The first shard whose upper boundary is greater than <query>
+	auto it = std::upper_bound(
+	    this->boundaries.begin(), this->boundaries.end(), query,
+	    [this](const Comparable & lhs, const Key & rhs) {
+		    return this->cmp(lhs, rhs);
+	    });
+	return static_cast<size_t>(it - this->boundaries.begin());
+}
+
+template <class Tree, class KeyGetter, class Compare>
+size_t
+ShardedTree<Tree, KeyGetter, Compare>::count(const Tree & tree)
+{
+	if constexpr (Options::constant_time_size) {
+		return tree.size();
+	} else {
+		return static_cast<size_t>(std::distance(tree.begin(), tree.end()));
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+void
+ShardedTree<Tree, KeyGetter, Compare>::insert(Node & node)
+{
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	Shard & shard = this->shards[this->shard_of(node)];
+	std::unique_lock<std::shared_mutex> lock(shard.mutex);
+	shard.tree.insert(node);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+void
+ShardedTree<Tree, KeyGetter, Compare>::remove(Node & node)
+{
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	Shard & shard = this->shards[this->shard_of(node)];
+	std::unique_lock<std::shared_mutex> lock(shard.mutex);
+	shard.tree.remove(node);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class Comparable>
+typename ShardedTree<Tree, KeyGetter, Compare>::Node *
+ShardedTree<Tree, KeyGetter, Compare>::find(const Comparable & query)
+{
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	Shard & shard = this->shards[this->shard_of(query)];
+	std::shared_lock<std::shared_mutex> lock(shard.mutex);
+	auto it = shard.tree.find(query);
+	if (it == shard.tree.end()) {
+		return nullptr;
+	}
+	return &(*it);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class ComparableLo, class ComparableHi, class Callback>
+void
+ShardedTree<Tree, KeyGetter, Compare>::for_each_in_range(
+    const ComparableLo & lo, const ComparableHi & hi, Callback && callback) const
+{
+	if (this->cmp(hi, lo)) {
+		return;
+	}
+
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	const size_t first = this->shard_of(lo);
+	const size_t last = this->shard_of(hi);
+
+	// Locking in ascending order rules out deadlocks with other range queries
+	std::vector<std::shared_lock<std::shared_mutex>> locks;
+	locks.reserve(last - first + 1);
+	for (size_t i = first; i <= last; ++i) {
+		locks.emplace_back(this->shards[i].mutex);
+	}
+
+	for (size_t i = first; i <= last; ++i) {
+		const Tree & tree = this->shards[i].tree;
+		for (auto it = tree.lower_bound(lo);
+		     it != tree.end() && !this->cmp(hi, *it); ++it) {
+			callback(*it);
+		}
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class Callback>
+void
+ShardedTree<Tree, KeyGetter, Compare>::for_each(Callback && callback) const
+{
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	for (const Shard & shard : this->shards) {
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		for (const Node & n : shard.tree) {
+			callback(n);
+		}
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+ShardedTree<Tree, KeyGetter, Compare>::View::View(const ShardedTree & sharded_in)
+    : sharded(sharded_in), layout(sharded_in.layout_mutex)
+{
+	// Locking in ascending order rules out deadlocks with range queries
+	this->locks.reserve(this->sharded.shards.size());
+	for (const Shard & shard : this->sharded.shards) {
+		this->locks.emplace_back(shard.mutex);
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+typename ShardedTree<Tree, KeyGetter, Compare>::View
+ShardedTree<Tree, KeyGetter, Compare>::view() const
+{
+	return View(*this);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+typename ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator
+ShardedTree<Tree, KeyGetter, Compare>::View::begin() const noexcept
+{
+	const_iterator it(&this->sharded, 0, this->sharded.shards[0].tree.begin());
+	it.skip_exhausted();
+	return it;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+typename ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator
+ShardedTree<Tree, KeyGetter, Compare>::View::end() const noexcept
+{
+	return const_iterator(&this->sharded, this->sharded.shards.size(),
+	                      typename const_iterator::TreeIterator());
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class Comparable>
+typename ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator
+ShardedTree<Tree, KeyGetter, Compare>::View::lower_bound(
+    const Comparable & query) const
+{
+	// All nodes of later shards are greater than <query>
+	const size_t shard = this->sharded.shard_of(query);
+	const_iterator it(&this->sharded, shard,
+	                  this->sharded.shards[shard].tree.lower_bound(query));
+	it.skip_exhausted();
+	return it;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+template <class Comparable>
+typename ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator
+ShardedTree<Tree, KeyGetter, Compare>::View::upper_bound(
+    const Comparable & query) const
+{
+	const size_t shard = this->sharded.shard_of(query);
+	const_iterator it(&this->sharded, shard,
+	                  this->sharded.shards[shard].tree.upper_bound(query));
+	it.skip_exhausted();
+	return it;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::
+    const_iterator() noexcept
+    : sharded(nullptr), shard(0), it()
+{}
+
+template <class Tree, class KeyGetter, class Compare>
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::const_iterator(
+    const ShardedTree * sharded_in, size_t shard_in, TreeIterator it_in) noexcept
+    : sharded(sharded_in), shard(shard_in), it(it_in)
+{}
+
+template <class Tree, class KeyGetter, class Compare>
+void
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::
+    skip_exhausted() noexcept
+{
+	const auto & shards = this->sharded->shards;
+	while ((this->shard < shards.size()) &&
+	       (this->it == shards[this->shard].tree.end())) {
+		++this->shard;
+		if (this->shard < shards.size()) {
+			this->it = shards[this->shard].tree.begin();
+		}
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+bool
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::operator==(
+    const const_iterator & other) const noexcept
+{
+	// All iterators at the end compare equal, regardless of the tree iterator
+	if (this->shard != other.shard) {
+		return false;
+	}
+	return (this->sharded == nullptr) ||
+	       (this->shard == this->sharded->shards.size()) ||
+	       (this->it == other.it);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+bool
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::operator!=(
+    const const_iterator & other) const noexcept
+{
+	return !(*this == other);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+typename ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator &
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::
+operator++() noexcept
+{
+	++this->it;
+	this->skip_exhausted();
+	return *this;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+typename ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::operator++(
+    int) noexcept
+{
+	const_iterator cpy(*this);
+	this->operator++();
+	return cpy;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+const typename ShardedTree<Tree, KeyGetter, Compare>::Node &
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::operator*()
+    const noexcept
+{
+	return *this->it;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+const typename ShardedTree<Tree, KeyGetter, Compare>::Node *
+ShardedTree<Tree, KeyGetter, Compare>::View::const_iterator::operator->()
+    const noexcept
+{
+	return &(*this->it);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+size_t
+ShardedTree<Tree, KeyGetter, Compare>::shard_size(size_t shard) const
+{
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	std::shared_lock<std::shared_mutex> lock(this->shards[shard].mutex);
+	return count(this->shards[shard].tree);
+}
+
+template <class Tree, class KeyGetter, class Compare>
+size_t
+ShardedTree<Tree, KeyGetter, Compare>::size() const
+{
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	size_t result = 0;
+	for (const Shard & shard : this->shards) {
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		result += count(shard.tree);
+	}
+	return result;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+bool
+ShardedTree<Tree, KeyGetter, Compare>::empty() const
+{
+	sharded_tree_internal::SharedLockGuard layout(this->layout_mutex);
+	for (const Shard & shard : this->shards) {
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		if (!shard.tree.empty()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <class Tree, class KeyGetter, class Compare>
+const typename ShardedTree<Tree, KeyGetter, Compare>::Node &
+ShardedTree<Tree, KeyGetter, Compare>::nth_node(const Tree & tree, size_t k,
+                                                size_t size)
+{
+	if constexpr (sharded_tree_internal::SupportsSelect<Tree>::value) {
+		(void)size;
+		auto it = tree.select(k);
+		if (it == tree.end()) {
+			return *tree.rbegin();
+		}
+		return *it;
+	} else {
+		// Walk from the closer end. If <size> is an estimate, the walk stops
+		// at the ends of the tree.
+		if (k < size / 2) {
+			auto it = tree.begin();
+			for (size_t walked = 0; walked < k; ++walked) {
+				auto next = std::next(it);
+				if (next == tree.end()) {
+					break;
+				}
+				it = next;
+			}
+			return *it;
+		}
+
+		auto it = tree.rbegin();
+		const size_t from_back = (k < size) ? size - 1 - k : 0;
+		for (size_t walked = 0; walked < from_back; ++walked) {
+			auto next = std::next(it);
+			if (next == tree.rend()) {
+				break;
+			}
+			it = next;
+		}
+		return *it;
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+void
+ShardedTree<Tree, KeyGetter, Compare>::move_right(size_t i, size_t n,
+                                                  std::vector<size_t> & sizes)
+{
+	Tree & left = this->shards[i].tree;
+	Tree & right = this->shards[i + 1].tree;
+	if (left.empty()) {
+		return;
+	}
+
+	// The n-th largest node of the left shard becomes the smallest node of the
+	// right shard
+	const size_t k = (n < sizes[i]) ? sizes[i] - n : 0;
+	Key key = KeyGetter::get_key(nth_node(left, k, sizes[i]));
+
+	Tree moving;
+	left.split(key, moving);
+	moving.join(right);
+	right.join(moving);
+	this->boundaries[i] = std::move(key);
+
+	if constexpr (Options::constant_time_size) {
+		sizes[i] = left.size();
+		sizes[i + 1] = right.size();
+	} else {
+		// Exact unless nodes with equal keys moved along
+		const size_t moved = std::min(n, sizes[i]);
+		sizes[i] -= moved;
+		sizes[i + 1] += moved;
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+void
+ShardedTree<Tree, KeyGetter, Compare>::move_left(size_t i, size_t n,
+                                                 std::vector<size_t> & sizes)
+{
+	Tree & left = this->shards[i].tree;
+	Tree & right = this->shards[i + 1].tree;
+	if (right.empty()) {
+		return;
+	}
+
+	// The node of the right shard that has <n> nodes before it stays in the
+	// right shard and becomes its smallest node. At least one node stays,
+	// since it provides the new boundary.
+	Key key = KeyGetter::get_key(nth_node(right, n, sizes[i + 1]));
+
+	Tree staying;
+	right.split(key, staying);
+	left.join(right);
+	right.join(staying);
+	this->boundaries[i] = std::move(key);
+
+	if constexpr (Options::constant_time_size) {
+		sizes[i] = left.size();
+		sizes[i + 1] = right.size();
+	} else {
+		const size_t moved =
+		    std::min(n, (sizes[i + 1] > 0) ? sizes[i + 1] - 1 : 0);
+		sizes[i] += moved;
+		sizes[i + 1] -= moved;
+	}
+}
+
+template <class Tree, class KeyGetter, class Compare>
+void
+ShardedTree<Tree, KeyGetter, Compare>::rebalance()
+{
+	std::lock_guard<sharded_tree_internal::DistributedSharedMutex> layout(
+	    this->layout_mutex);
+	// No other operation is running now, the shards need not be locked.
+
+	const size_t count_shards = this->shards.size();
+	std::vector<size_t> sizes;
+	size_t total = 0;
+	for (const Shard & shard : this->shards) {
+		sizes.push_back(count(shard.tree));
+		total += sizes.back();
+	}
+
+	/* The number of nodes that must cross boundary i, positive if they move
+	 * to the right. Moving to the right from left to right first, and then to
+	 * the left from right to left, every shard has received all its incoming
+	 * nodes before it must hand nodes on. */
+	std::vector<std::ptrdiff_t> flow(count_shards - 1);
+	size_t prefix = 0;
+	size_t target_prefix = 0;
+	for (size_t i = 0; i + 1 < count_shards; ++i) {
+		prefix += sizes[i];
+		target_prefix += total / count_shards + ((i < total % count_shards) ? 1 : 0);
+		flow[i] = static_cast<std::ptrdiff_t>(prefix) -
+		          static_cast<std::ptrdiff_t>(target_prefix);
+	}
+
+	for (size_t i = 0; i + 1 < count_shards; ++i) {
+		if (flow[i] > 0) {
+			this->move_right(i, static_cast<size_t>(flow[i]), sizes);
+		}
+	}
+	for (size_t i = count_shards - 1; i > 0; --i) {
+		if (flow[i - 1] < 0) {
+			this->move_left(i - 1, static_cast<size_t>(-flow[i - 1]), sizes);
+		}
+	}
+}
+
+} // namespace ygg
+
+#endif // YGG_SHARDED_TREE_CPP
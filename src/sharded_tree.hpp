@@ -0,0 +1,401 @@
+#ifndef YGG_SHARDED_TREE_HPP
+#define YGG_SHARDED_TREE_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "util.hpp"
+
+namespace ygg {
+
+// forward, see rbtree.hpp and wbtree.hpp
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+class RBTree;
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+class WBTree;
+
+namespace sharded_tree_internal {
+/// @cond INTERNAL
+
+constexpr size_t CACHE_LINE_BYTES = 64;
+
+/* Whether Tree::select() finds the k-th node in O(log n). The WBTree always
+ * stores the sizes of its subtrees, the RBTree only if ORDER_QUERIES is set. */
+template <class Tree>
+class SupportsSelect : public std::false_type {
+};
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+class SupportsSelect<RBTree<Node, NodeTraits, Options, Tag, Compare>>
+    : public std::bool_constant<Options::order_queries> {
+};
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+class SupportsSelect<WBTree<Node, NodeTraits, Options, Tag, Compare>>
+    : public std::true_type {
+};
+
+/* A reader-writer lock that spreads its readers over several cache lines.
+ * Every thread locks one of the slots for reading, thus readers on different
+ * slots do not contend. A writer must lock all slots. */
+class DistributedSharedMutex {
+public:
+	DistributedSharedMutex();
+
+	// Returns the slot that must be passed to unlock_shared()
+	size_t lock_shared();
+	void unlock_shared(size_t slot) noexcept;
+	void lock();
+	void unlock() noexcept;
+
+private:
+	class alignas(CACHE_LINE_BYTES) Slot {
+	public:
+		std::shared_mutex mutex;
+	};
+
+	size_t slot_count;
+	std::unique_ptr<Slot[]> slots;
+
+	static size_t thread_index() noexcept;
+};
+
+// Holds a DistributedSharedMutex for reading as long as it exists
+class SharedLockGuard {
+public:
+	explicit SharedLockGuard(DistributedSharedMutex & mutex);
+	~SharedLockGuard();
+
+	SharedLockGuard(const SharedLockGuard &) = delete;
+	SharedLockGuard & operator=(const SharedLockGuard &) = delete;
+
+private:
+	DistributedSharedMutex & mutex;
+	size_t slot;
+};
+
+/// @endcond
+} // namespace sharded_tree_internal
+
+/**
+ * @brief A tree that is split into several independently locked trees
+ *
+ * None of the trees in Ygg are thread-safe. Guarding a single tree with a
+ * mutex serializes all threads accessing it. A ShardedTree instead partitions
+ * the key space into consecutive ranges (the shards), each of which is backed
+ * by its own tree and its own reader-writer lock. Operations on different
+ * shards run in parallel, and operations that only read a shard (find(), the
+ * range queries) run in parallel with each other.
+ *
+ * The shards are separated by boundary keys: Shard i holds all nodes that are
+ * not less than boundary i-1 and less than boundary i. Initially, the
+ * boundaries are supplied by you. If the distribution of keys changes,
+ * rebalance() moves the boundaries such that all shards hold about the same
+ * number of nodes, using the trees' split() and join() methods.
+ *
+ * Like the trees themselves, a ShardedTree is intrusive: It does not own the
+ * nodes. Pointers returned by find() stay valid until the node is removed. It
+ * is your responsibility to not destroy a node that another thread might still
+ * be working with.
+ *
+ * There is no iterator that is valid on its own: Moving from one shard to the
+ * next needs the next shard to be locked, and a node that an iterator points
+ * to may be removed by another thread at any time. Iterators are therefore
+ * only available through a View, which holds all shards locked for reading.
+ *
+ * Any tree that supports split() and join() (RBTree, WBTree, ZTree) can be
+ * used.
+ *
+ * @tparam Tree       The type of the trees backing the shards
+ * @tparam KeyGetter  A class that must provide a static method get_key(const
+ * Node &) that returns the key of a node. It is used to derive new boundaries
+ * from nodes during rebalance(). Keys must be sorted in the same way as the
+ * nodes in the tree, and nodes must be comparable to keys (and vice versa)
+ * via Compare.
+ * @tparam Compare    A compare class. Defaults to
+ * ygg::utilities::flexible_less.
+ */
+template <class Tree, class KeyGetter,
+          class Compare = ygg::utilities::flexible_less>
+class ShardedTree {
+public:
+	/// @cond INTERNAL
+	using Node = typename Tree::NodeT;
+	using Options = typename Tree::OptionsT;
+	using Key = std::decay_t<decltype(
+	    KeyGetter::get_key(std::declval<const Node &>()))>;
+	/// @endcond
+
+	/**
+	 * @brief Create a new, empty sharded tree
+	 *
+	 * Creates one shard more than there are boundaries.
+	 *
+	 * @param boundaries  The keys separating the shards. They must be sorted
+	 * in ascending order with respect to Compare, which debug builds assert.
+	 * Unsorted boundaries make all operations misplace nodes.
+	 */
+	explicit ShardedTree(std::vector<Key> boundaries);
+
+	ShardedTree(const ShardedTree &) = delete;
+	ShardedTree & operator=(const ShardedTree &) = delete;
+
+	/**
+	 * @brief Returns the number of shards
+	 *
+	 * @return The number of shards
+	 */
+	size_t shard_count() const noexcept;
+
+	/**
+	 * @brief Returns the current boundaries between the shards
+	 *
+	 * @return A copy of the boundaries, sorted in ascending order
+	 */
+	std::vector<Key> get_boundaries() const;
+
+	/**
+	 * @brief Inserts a node
+	 *
+	 * Locks the shard that <node> belongs to for writing and inserts <node>
+	 * into its tree.
+	 *
+	 * @param node  The node to be inserted
+	 */
+	void insert(Node & node);
+
+	/**
+	 * @brief Removes a node
+	 *
+	 * Locks the shard that <node> belongs to for writing and removes <node>
+	 * from its tree. The node must be contained in the sharded tree.
+	 *
+	 * @param node  The node to be removed
+	 */
+	void remove(Node & node);
+
+	/**
+	 * @brief Finds a node
+	 *
+	 * Locks the shard that <query> belongs to for reading and searches it.
+	 *
+	 * @param query An object comparable to the nodes and the keys
+	 * @return A pointer to a node that compares equally to <query>, or nullptr
+	 * if there is no such node
+	 */
+	template <class Comparable>
+	Node * find(const Comparable & query);
+
+	/**
+	 * @brief Calls <callback> for every node in a range of keys
+	 *
+	 * Visits the nodes that are neither less than <lo> nor greater than <hi>
+	 * in ascending order. All shards that overlap the range are locked for
+	 * reading at the same time, thus the visited nodes form a consistent view,
+	 * even if the range spans several shards.
+	 *
+	 * @param lo        The lower end of the range (inclusive)
+	 * @param hi        The upper end of the range (inclusive)
+	 * @param callback  Called with a const Node & for every node in the range.
+	 * It must not modify the sharded tree.
+	 */
+	template <class ComparableLo, class ComparableHi, class Callback>
+	void for_each_in_range(const ComparableLo & lo, const ComparableHi & hi,
+	                       Callback && callback) const;
+
+	/**
+	 * @brief Calls <callback> for every node
+	 *
+	 * Visits all nodes in ascending order. Shards are locked for reading one
+	 * after the other, thus nodes that are inserted into or removed from a
+	 * shard that has already been (or not yet been) visited might be missed
+	 * (or seen).
+	 *
+	 * @param callback  Called with a const Node & for every node. It must not
+	 * modify the sharded tree.
+	 */
+	template <class Callback>
+	void for_each(Callback && callback) const;
+
+	/**
+	 * @brief A read-only view of all nodes, which can be iterated
+	 *
+	 * A View holds all shards locked for reading as long as it exists. Its
+	 * iterators visit the nodes of all shards in ascending order, stepping from
+	 * the end of one shard's tree to the beginning of the next non-empty one.
+	 * All of them stay valid as long as the View exists.
+	 *
+	 * Since no node can be inserted or removed while a View exists, the
+	 * thread holding it must not modify the sharded tree, which would
+	 * deadlock. Other writers wait until the View is destroyed, thus keep
+	 * Views short-lived. for_each() and for_each_in_range() hold fewer locks.
+	 */
+	class View {
+	public:
+		class const_iterator {
+		public:
+			typedef ptrdiff_t difference_type;
+			typedef Node value_type;
+			typedef const Node & reference;
+			typedef const Node * pointer;
+			typedef std::forward_iterator_tag iterator_category;
+
+			const_iterator() noexcept;
+
+			bool operator==(const const_iterator & other) const noexcept;
+			bool operator!=(const const_iterator & other) const noexcept;
+
+			const_iterator & operator++() noexcept;
+			const_iterator operator++(int) noexcept;
+
+			reference operator*() const noexcept;
+			pointer operator->() const noexcept;
+
+		private:
+			friend class View;
+			using TreeIterator = typename Tree::template const_iterator<false>;
+
+			const_iterator(const ShardedTree * sharded, size_t shard,
+			               TreeIterator it) noexcept;
+			// Moves on to the next non-empty shard while at the end of a shard
+			void skip_exhausted() noexcept;
+
+			const ShardedTree * sharded;
+			// The index of the shard, or the number of shards for end()
+			size_t shard;
+			TreeIterator it;
+		};
+
+		View(const View &) = delete;
+		View & operator=(const View &) = delete;
+
+		const_iterator begin() const noexcept;
+		const_iterator end() const noexcept;
+
+		/**
+		 * @brief Returns an iterator to the first node not less than <query>
+		 *
+		 * Searches only the shard that <query> belongs to, i.e., runs in
+		 * O(log n) for a shard of n nodes, plus the number of empty shards
+		 * that follow.
+		 *
+		 * @param query An object comparable to the nodes and the keys
+		 * @return An iterator to the first node not less than <query>, or end()
+		 */
+		template <class Comparable>
+		const_iterator lower_bound(const Comparable & query) const;
+
+		/**
+		 * @brief Returns an iterator to the first node greater than <query>
+		 *
+		 * See lower_bound() for the running time.
+		 *
+		 * @param query An object comparable to the nodes and the keys
+		 * @return An iterator to the first node greater than <query>, or end()
+		 */
+		template <class Comparable>
+		const_iterator upper_bound(const Comparable & query) const;
+
+	private:
+		friend class ShardedTree;
+		explicit View(const ShardedTree & sharded);
+
+		const ShardedTree & sharded;
+		sharded_tree_internal::SharedLockGuard layout;
+		std::vector<std::shared_lock<std::shared_mutex>> locks;
+	};
+
+	/**
+	 * @brief Locks all shards for reading and returns a View of them
+	 *
+	 * See View for what may be done while the View exists.
+	 *
+	 * @return A View of all nodes
+	 */
+	View view() const;
+
+	/**
+	 * @brief Returns the number of nodes in a shard
+	 *
+	 * This runs in O(1) if the tree has the CONSTANT_TIME_SIZE option set, and
+	 * in time linear in the size of the shard otherwise.
+	 *
+	 * @param shard  The index of the shard
+	 * @return The number of nodes in the shard
+	 */
+	size_t shard_size(size_t shard) const;
+
+	/**
+	 * @brief Returns the number of nodes in all shards
+	 *
+	 * See shard_size() for the running time. Shards are counted one after the
+	 * other, thus the result is exact only if the sharded tree is not modified
+	 * concurrently.
+	 *
+	 * @return The number of nodes
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief Returns whether the sharded tree is empty
+	 *
+	 * @return true if no shard contains any nodes
+	 */
+	bool empty() const;
+
+	/**
+	 * @brief Moves the shard boundaries such that all shards hold about the
+	 * same number of nodes
+	 *
+	 * Nodes only ever move between neighboring shards, using one split() and
+	 * two join()s per moved boundary. The sizes of the shards are counted once
+	 * and then carried along as boundaries move. Finding a new boundary takes
+	 * O(log n) if the trees support select() (WBTree, or RBTree with
+	 * ORDER_QUERIES). Otherwise, it walks from the closer end of the shard, and
+	 * thus takes time linear in the smaller of the number of nodes moved and
+	 * the number of nodes that stay. See split() for the cost of moving the
+	 * nodes, which may be linear as well. If the tree contains several
+	 * nodes with equal keys, these always stay in one shard, thus the shards'
+	 * sizes can differ by more than one.
+	 *
+	 * This locks the whole sharded tree for writing, i.e., no other operation
+	 * can run in parallel.
+	 */
+	void rebalance();
+
+private:
+	class alignas(sharded_tree_internal::CACHE_LINE_BYTES) Shard {
+	public:
+		Tree tree;
+		mutable std::shared_mutex mutex;
+	};
+
+	// Taken for reading by all operations, and for writing by rebalance()
+	mutable sharded_tree_internal::DistributedSharedMutex layout_mutex;
+	std::vector<Key> boundaries;
+	std::vector<Shard> shards;
+	Compare cmp;
+
+	template <class Comparable>
+	size_t shard_of(const Comparable & query) const;
+
+	static size_t count(const Tree & tree);
+	// The node of the non-empty <tree> that has <k> nodes before it, or its
+	// largest node if <tree> holds no more than <k> nodes. <size> is the
+	// (possibly estimated) size of <tree>.
+	static const Node & nth_node(const Tree & tree, size_t k, size_t size);
+	// Move the <n> largest nodes of shard <i> into shard i+1, or the <n>
+	// smallest nodes of shard i+1 into shard i. Both update <sizes>, which
+	// hold the sizes of the shards.
+	void move_right(size_t i, size_t n, std::vector<size_t> & sizes);
+	void move_left(size_t i, size_t n, std::vector<size_t> & sizes);
+};
+
+} // namespace ygg
+
+#include "sharded_tree.cpp"
+
+#endif // YGG_SHARDED_TREE_HPP
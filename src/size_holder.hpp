@@ -5,12 +5,12 @@
 #ifndef YGG_SIZE_HOLDER_HPP
 #define YGG_SIZE_HOLDER_HPP
 
-template <bool enable>
+template <bool enable, bool count_modifications = false>
 class SizeHolder {
 };
 
 template <>
-class SizeHolder<true> {
+class SizeHolder<true, false> {
 public:
   SizeHolder() : n(0){};
 
@@ -38,12 +38,16 @@ public:
     this->n = i;
   }
 
+  void
+  touch()
+  {}
+
 private:
   size_t n;
 };
 
 template <>
-class SizeHolder<false> {
+class SizeHolder<false, false> {
 public:
   void
   add(size_t i)
@@ -63,7 +67,58 @@ public:
     (void)i;
   }
 
+  void
+  touch()
+  {}
+
+private:
+};
+
+/*
+ * Every change to the size is also counted as a modification. Operations
+ * that restructure the tree without knowing the resulting size must call
+ * touch() instead.
+ */
+template <bool enable>
+class SizeHolder<enable, true> : public SizeHolder<enable, false> {
+public:
+  SizeHolder() : modifications(0){};
+
+  void
+  add(size_t i)
+  {
+    SizeHolder<enable, false>::add(i);
+    this->modifications++;
+  }
+
+  void
+  reduce(size_t i)
+  {
+    SizeHolder<enable, false>::reduce(i);
+    this->modifications++;
+  }
+
+  void
+  set(size_t i)
+  {
+    SizeHolder<enable, false>::set(i);
+    this->modifications++;
+  }
+
+  void
+  touch()
+  {
+    this->modifications++;
+  }
+
+  size_t
+  get_modifications() const
+  {
+    return this->modifications;
+  }
+
 private:
+  size_t modifications;
 };
 
 #endif // YGG_SIZE_HOLDER_HPP
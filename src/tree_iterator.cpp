@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
 
 #include "tree_iterator.hpp"
@@ -9,6 +11,21 @@ template <class ConcreteIterator, class Node, class NodeInterface, bool reverse>
 void
 IteratorBase<ConcreteIterator, Node, NodeInterface, reverse>::step_forward()
 {
+  if constexpr (is_threaded<NodeInterface>::value) {
+    this->n = NodeInterface::get_next(this->n);
+    return;
+  }
+
+  if constexpr (is_compressed<NodeInterface>::value) {
+    // Visit the rest of the group first, then continue in the tree
+    Node * dup = NodeInterface::get_dup_successor(this->n);
+    if (dup != nullptr) {
+      this->n = dup;
+      return;
+    }
+    this->n = NodeInterface::get_representative(this->n);
+  }
+
   // No more equal elements
   if (NodeInterface::get_right(this->n) != nullptr) {
     // go to smallest larger-or-equal child
@@ -42,6 +59,19 @@ template <class ConcreteIterator, class Node, class NodeInterface, bool reverse>
 void
 IteratorBase<ConcreteIterator, Node, NodeInterface, reverse>::step_back()
 {
+  if constexpr (is_threaded<NodeInterface>::value) {
+    this->n = NodeInterface::get_prev(this->n);
+    return;
+  }
+
+  if constexpr (is_compressed<NodeInterface>::value) {
+    Node * dup = NodeInterface::get_dup_predecessor(this->n);
+    if (dup != nullptr) {
+      this->n = dup;
+      return;
+    }
+  }
+
   if (NodeInterface::get_left(this->n) != nullptr) {
     // go to largest smaller child
     this->n = NodeInterface::get_left(this->n);
@@ -68,6 +98,13 @@ IteratorBase<ConcreteIterator, Node, NodeInterface, reverse>::step_back()
       this->n = NodeInterface::get_parent(this->n);
     }
   }
+
+  if constexpr (is_compressed<NodeInterface>::value) {
+    // The previous group is entered at its end
+    if (this->n != nullptr) {
+      this->n = NodeInterface::get_last_dup(this->n);
+    }
+  }
 }
 
 template <class ConcreteIterator, class Node, class NodeInterface, bool reverse>
@@ -87,6 +124,14 @@ IteratorBase<ConcreteIterator, Node, NodeInterface, reverse>::IteratorBase(
     : n(other.n)
 {}
 
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse>
+template <class OtherConcrete, class OtherNode>
+IteratorBase<ConcreteIterator, Node, NodeInterface, reverse>::IteratorBase(
+    const IteratorBase<OtherConcrete, OtherNode, NodeInterface, reverse> &
+        other)
+    : n(other.n)
+{}
+
 template <class ConcreteIterator, class Node, class NodeInterface, bool reverse>
 ConcreteIterator &
 IteratorBase<ConcreteIterator, Node, NodeInterface, reverse>::
@@ -219,5 +264,311 @@ typename IteratorBase<ConcreteIterator, Node, NodeInterface, reverse>::pointer
   return this->n;
 }
 
+/*
+ * Path-based iterator
+ */
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+void
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::step_forward()
+{
+  Node * n = this->get_node_at(this->depth - 1);
+  if (NodeInterface::get_right(n) != nullptr) {
+    // go to smallest larger-or-equal child
+    n = NodeInterface::get_right(n);
+    this->push(n);
+    while (NodeInterface::get_left(n) != nullptr) {
+      n = NodeInterface::get_left(n);
+      this->push(n);
+    }
+  } else {
+    // skip over the nodes already visited
+    while ((this->depth > 1) &&
+           (NodeInterface::get_right(this->get_node_at(this->depth - 2)) ==
+            this->get_node_at(this->depth - 1))) {
+      this->depth--;
+    }
+
+    // go one further up. If we were at the root, this makes us end().
+    this->depth--;
+  }
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+void
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::step_back()
+{
+  Node * n = this->get_node_at(this->depth - 1);
+  if (NodeInterface::get_left(n) != nullptr) {
+    // go to largest smaller child
+    n = NodeInterface::get_left(n);
+    this->push(n);
+    while (NodeInterface::get_right(n) != nullptr) {
+      n = NodeInterface::get_right(n);
+      this->push(n);
+    }
+  } else {
+    // skip over the nodes already visited
+    while ((this->depth > 1) &&
+           (NodeInterface::get_left(this->get_node_at(this->depth - 2)) ==
+            this->get_node_at(this->depth - 1))) {
+      this->depth--;
+    }
+
+    // go one further up. If we were at the root, this makes us end().
+    this->depth--;
+  }
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::PathIteratorBase()
+    : depth(0)
+{}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::PathIteratorBase(
+    std::nullptr_t)
+    : depth(0)
+{}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::PathIteratorBase(
+    const ConcreteIterator & other)
+    : depth(0)
+{
+  this->copy_path_from(other.path, other.overflow, other.depth);
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+template <class OtherConcrete, class OtherNode>
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::PathIteratorBase(
+    const PathIteratorBase<OtherConcrete, OtherNode, NodeInterface, reverse,
+                           max_depth> & other)
+    : depth(0)
+{
+  this->copy_path_from(other.path, other.overflow, other.depth);
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator &
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+operator=(const ConcreteIterator & other)
+{
+  this->copy_path_from(other.path, other.overflow, other.depth);
+
+  return *(static_cast<ConcreteIterator *>(this));
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator &
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+operator=(ConcreteIterator && other)
+{
+  this->copy_path_from(other.path, other.overflow, other.depth);
+
+  return *(static_cast<ConcreteIterator *>(this));
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+bool
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+operator==(const ConcreteIterator & other) const
+{
+  if ((this->depth == 0) || (other.depth == 0)) {
+    return this->depth == other.depth;
+  }
+  return this->get_node_at(this->depth - 1) == other.get_node_at(other.depth - 1);
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+bool
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+operator!=(const ConcreteIterator & other) const
+{
+  return !(*this == other);
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator &
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::operator++()
+{
+  this->dispatch_operator_pp();
+
+  return (*(static_cast<ConcreteIterator *>(this)));
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator &
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::operator--()
+{
+  this->dispatch_operator_mm();
+
+  return *(static_cast<ConcreteIterator *>(this));
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::operator++(int)
+{
+  ConcreteIterator cpy(*(static_cast<ConcreteIterator *>(this)));
+  this->operator++();
+  return cpy;
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::operator--(int)
+{
+  ConcreteIterator cpy(*(static_cast<ConcreteIterator *>(this)));
+  this->operator--();
+  return cpy;
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator &
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+operator+=(size_t steps)
+{
+  for (size_t i = 0; i < steps; ++i) {
+    this->operator++();
+  }
+
+  return (*(static_cast<ConcreteIterator *>(this)));
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+operator+(size_t steps) const
+{
+  ConcreteIterator cpy(*(static_cast<const ConcreteIterator *>(this)));
+  cpy += steps;
+  return cpy;
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator &
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+operator-=(size_t steps)
+{
+  for (size_t i = 0; i < steps; ++i) {
+    this->operator--();
+  }
+
+  return (*(static_cast<ConcreteIterator *>(this)));
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+ConcreteIterator
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+operator-(size_t steps) const
+{
+  ConcreteIterator cpy(*(static_cast<const ConcreteIterator *>(this)));
+  cpy -= steps;
+  return cpy;
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+typename PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::reference
+    PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+    operator*() const
+{
+  return *(this->get_node_at(this->depth - 1));
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+typename PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::pointer
+    PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::
+    operator->() const
+{
+  return this->get_node_at(this->depth - 1);
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+void
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::push(Node * node)
+{
+  if (this->depth < max_depth) {
+    this->path[this->depth++] = node;
+    return;
+  }
+
+  // The path is deeper than the inline buffer. Entries beyond <depth> are
+  // stale and can be overwritten.
+  const size_t overflow_depth = this->depth - max_depth;
+  if (overflow_depth < this->overflow.size()) {
+    this->overflow[overflow_depth] = node;
+  } else {
+    this->overflow.push_back(node);
+  }
+  this->depth++;
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+void
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::truncate(size_t new_depth)
+{
+  this->depth = new_depth;
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+size_t
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::get_depth() const
+{
+  return this->depth;
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+Node *
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::get_node_at(size_t at) const
+{
+  if (at < max_depth) {
+    return this->path[at];
+  }
+  return this->overflow[at - max_depth];
+}
+
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+template <class OtherNode>
+void
+PathIteratorBase<ConcreteIterator, Node, NodeInterface, reverse, max_depth>::copy_path_from(
+    OtherNode * const * other_path,
+    const std::vector<OtherNode *> & other_overflow, size_t other_depth)
+{
+  this->depth = other_depth;
+  if (other_depth <= max_depth) {
+    std::copy(other_path, other_path + other_depth, this->path);
+    return;
+  }
+  std::copy(other_path, other_path + max_depth, this->path);
+  this->overflow.assign(other_overflow.begin(),
+                        other_overflow.begin() +
+                            static_cast<std::ptrdiff_t>(other_depth - max_depth));
+}
+
 } // namespace internal
 } // namespace ygg
@@ -4,10 +4,37 @@
 
 #include <cstddef>
 #include <iterator>
+#include <type_traits>
+#include <vector>
 
 namespace ygg {
 namespace internal {
 
+/* A NodeInterface may declare a static constexpr bool 'threaded'. If it is
+ * true, the NodeInterface must also provide get_next() and get_prev(), and
+ * IteratorBase follows those instead of walking the tree. */
+template <class NodeInterface, class = void>
+struct is_threaded : std::false_type {
+};
+template <class NodeInterface>
+struct is_threaded<NodeInterface, std::void_t<decltype(NodeInterface::threaded)>>
+    : std::bool_constant<NodeInterface::threaded> {
+};
+
+/* A NodeInterface may declare a static constexpr bool 'compressed'. If it is
+ * true, every node may have a group of equal nodes hanging off it, which is not
+ * part of the tree. The NodeInterface must then also provide
+ * get_dup_successor(), get_dup_predecessor(), get_representative() and
+ * get_last_dup(), and IteratorBase visits the group right after the node. */
+template <class NodeInterface, class = void>
+struct is_compressed : std::false_type {
+};
+template <class NodeInterface>
+struct is_compressed<NodeInterface,
+                     std::void_t<decltype(NodeInterface::compressed)>>
+    : std::bool_constant<NodeInterface::compressed> {
+};
+
 /**
  * @brief Iterator over elements in a tree
  *
@@ -31,6 +58,10 @@ public:
 	IteratorBase();
 	IteratorBase(Node * n);
 	IteratorBase(const ConcreteIterator & other);
+	template <class OtherConcrete, class OtherNode>
+	IteratorBase(
+	    const IteratorBase<OtherConcrete, OtherNode, NodeInterface, reverse> &
+	        other);
 
 	[[gnu::always_inline]] inline ConcreteIterator &
 	operator=(const ConcreteIterator & other);
@@ -101,6 +132,124 @@ protected:
 	Node * n;
 
 	using my_type = IteratorBase<ConcreteIterator, Node, NodeInterface, reverse>;
+
+	template <class, class, class, bool>
+	friend class IteratorBase;
+	/// @endcond
+};
+
+/**
+ * @brief Iterator over elements in a tree without parent pointers
+ *
+ * This iterator stores the path from the root to the node it points to. It is
+ * used by trees that are configured to not store parent pointers in their
+ * nodes. The first max_depth nodes of the path are stored inside the iterator.
+ * Deeper paths spill into a heap-allocated buffer, which makes copying the
+ * iterator more expensive.
+ *
+ * *Warning*: For efficiency reasons, it is currently not possible to
+ * decrement the end() iterator!
+ */
+template <class ConcreteIterator, class Node, class NodeInterface, bool reverse,
+          size_t max_depth>
+class PathIteratorBase {
+public:
+	/// @cond INTERNAL
+	typedef ptrdiff_t difference_type;
+	typedef Node value_type;
+	typedef Node & reference;
+	typedef Node * pointer;
+	typedef std::input_iterator_tag iterator_category;
+
+	PathIteratorBase();
+	PathIteratorBase(std::nullptr_t);
+	PathIteratorBase(const ConcreteIterator & other);
+	template <class OtherConcrete, class OtherNode>
+	PathIteratorBase(const PathIteratorBase<OtherConcrete, OtherNode,
+	                                        NodeInterface, reverse, max_depth> &
+	                     other);
+
+	[[gnu::always_inline]] inline ConcreteIterator &
+	operator=(const ConcreteIterator & other);
+	[[gnu::always_inline]] inline ConcreteIterator &
+	operator=(ConcreteIterator && other);
+
+	[[gnu::always_inline]] inline bool
+	operator==(const ConcreteIterator & other) const;
+	[[gnu::always_inline]] inline bool
+	operator!=(const ConcreteIterator & other) const;
+
+	[[gnu::always_inline]] inline ConcreteIterator & operator++();
+	[[gnu::always_inline]] inline ConcreteIterator operator++(int);
+	[[gnu::always_inline]] inline ConcreteIterator & operator+=(size_t steps);
+	[[gnu::always_inline]] inline ConcreteIterator operator+(size_t steps) const;
+
+	[[gnu::always_inline]] inline ConcreteIterator & operator--();
+	[[gnu::always_inline]] inline ConcreteIterator operator--(int);
+	[[gnu::always_inline]] inline ConcreteIterator & operator-=(size_t steps);
+	[[gnu::always_inline]] inline ConcreteIterator operator-(size_t steps) const;
+
+	[[gnu::always_inline]] inline reference operator*() const;
+	[[gnu::always_inline]] inline pointer operator->() const;
+
+	/*
+	 * Path manipulation, used by the trees to construct iterators while
+	 * descending. The node at depth 0 is the root, the node at
+	 * get_depth() - 1 is the node that the iterator points to.
+	 */
+	[[gnu::always_inline]] inline void push(Node * node);
+	[[gnu::always_inline]] inline void truncate(size_t depth);
+	[[gnu::always_inline]] inline size_t get_depth() const;
+	[[gnu::always_inline]] inline Node * get_node_at(size_t depth) const;
+
+protected:
+	template <bool inner_reverse = reverse>
+	[[gnu::always_inline]] inline
+	    typename std::enable_if<inner_reverse, void>::type
+	    dispatch_operator_pp()
+	{
+		this->step_back();
+	}
+	template <bool inner_reverse = reverse>
+	[[gnu::always_inline]] inline
+	    typename std::enable_if<!inner_reverse, void>::type
+	    dispatch_operator_pp()
+	{
+		this->step_forward();
+	}
+	template <bool inner_reverse = reverse>
+	[[gnu::always_inline]] inline
+	    typename std::enable_if<inner_reverse, void>::type
+	    dispatch_operator_mm()
+	{
+		this->step_forward();
+	}
+	template <bool inner_reverse = reverse>
+	[[gnu::always_inline]] inline
+	    typename std::enable_if<!inner_reverse, void>::type
+	    dispatch_operator_mm()
+	{
+		this->step_back();
+	}
+
+	[[gnu::always_inline]] inline void step_forward();
+	[[gnu::always_inline]] inline void step_back();
+
+	template <class OtherNode>
+	[[gnu::always_inline]] inline void
+	copy_path_from(OtherNode * const * other_path,
+	               const std::vector<OtherNode *> & other_overflow,
+	               size_t other_depth);
+
+	/* Only the first <depth> entries are valid. Copying only copies these.
+	 * Entries at depth max_depth and below live in <overflow>, which stays
+	 * empty (and does not allocate) as long as the tree is not higher. */
+	Node * path[max_depth];
+	std::vector<Node *> overflow;
+	size_t depth;
+
+	template <class, class, class, bool, size_t>
+	friend class PathIteratorBase;
 	/// @endcond
 };
 
@@ -3,6 +3,8 @@
 #define YGG_UTIL_HPP
 
 #include <iterator>
+#include <system_error>
+#include <thread>
 #include <type_traits>
 
 namespace ygg {
@@ -378,6 +380,35 @@ struct pair_hash
 	}
 };
 
+/**
+ * @brief Runs two callables, possibly concurrently
+ *
+ * If <parallel> is set, <first> is run in a new thread while <second> runs in
+ * the calling thread. If no thread can be started (or <parallel> is not set),
+ * both are run sequentially in the calling thread. In any case, both callables
+ * have finished when this returns.
+ */
+template <class F1, class F2>
+void
+run_maybe_parallel(bool parallel, F1 && first, F2 && second)
+{
+	if (parallel) {
+		std::thread worker;
+		try {
+			worker = std::thread(first);
+		} catch (const std::system_error &) {
+			first();
+			second();
+			return;
+		}
+		second();
+		worker.join();
+	} else {
+		first();
+		second();
+	}
+}
+
 /*****************************************************
  *
  * Parameter Pack handling
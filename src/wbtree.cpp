@@ -27,6 +27,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::WBTree(
 	this->root = other.root;
 	other.root = nullptr;
 	this->s = other.s;
+	this->extremes = other.extremes;
 }
 
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
@@ -46,6 +47,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_onepass(
 		// std::cout << "Root case.\n";
 		this->root = &node;
 		node.NB::set_parent(nullptr);
+		this->leaf_attached(node, nullptr);
 		NodeTraits::leaf_inserted(node, *this);
 		return;
 	}
@@ -131,6 +133,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_onepass(
 							n_r->NB::_wbt_size += 1;
 							cur->NB::_wbt_size += 1;
 
+							this->leaf_attached(node, n_r);
 							NodeTraits::leaf_inserted(node, *this);
 
 							this->rotate_right(n_r);
@@ -308,6 +311,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_onepass(
 							n_l->NB::_wbt_size += 1;
 							cur->NB::_wbt_size += 1;
 
+							this->leaf_attached(node, n_l);
 							NodeTraits::leaf_inserted(node, *this);
 
 							this->rotate_left(n_l);
@@ -417,6 +421,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_onepass(
 	} else {
 		parent->NB::set_right(&node);
 	}
+	this->leaf_attached(node, parent);
 	NodeTraits::leaf_inserted(node, *this);
 }
 
@@ -464,6 +469,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base_twopass(
 		// new root!
 		node.NB::set_parent(nullptr);
 		this->root = &node;
+		this->leaf_attached(node, nullptr);
 		NodeTraits::leaf_inserted(node, *this);
 	} else {
 		node.NB::set_parent(parent);
@@ -486,6 +492,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::insert_leaf_base_twopass(
 			}
 		}
 
+		this->leaf_attached(node, parent);
 		NodeTraits::leaf_inserted(node, *this);
 		this->fixup_after_insert_twopass(&node);
 	}
@@ -500,7 +507,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::rotate_left(
 {
 	Node * right_child = parent->NB::get_right();
 
-	size_t right_child_old_size = right_child->NB::_wbt_size;
+	auto right_child_old_size = right_child->NB::_wbt_size;
 	right_child->NB::_wbt_size = parent->NB::_wbt_size;
 	parent->NB::_wbt_size -= right_child_old_size;
 
@@ -541,7 +548,7 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::rotate_right(
 	// TODO adapt rotate_right to arithmetics
 	Node * left_child = parent->NB::get_left();
 
-	size_t left_child_old_size = left_child->NB::_wbt_size;
+	auto left_child_old_size = left_child->NB::_wbt_size;
 	left_child->NB::_wbt_size = parent->NB::_wbt_size;
 	parent->NB::_wbt_size -= left_child_old_size;
 
@@ -715,6 +722,45 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::insert_right_leaning(
 	this->insert_leaf_base_twopass<false>(node, this->root);
 }
 
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::insert_at(
+    const typename TB::InsertHandle & handle, Node & node) noexcept
+{
+	assert(!handle.found());
+	this->s.add(1);
+
+	node.NB::set_right(nullptr);
+	node.NB::set_left(nullptr);
+	node.NB::_wbt_size = 2;
+
+	Node * parent = handle.get_parent();
+	if (__builtin_expect(parent == nullptr, false)) {
+		// new root!
+		node.NB::set_parent(nullptr);
+		this->root = &node;
+		this->leaf_attached(node, nullptr);
+		NodeTraits::leaf_inserted(node, *this);
+		return;
+	}
+
+	// The search did not touch the sizes, so we update them on the way up.
+	for (Node * cur = parent; cur != nullptr; cur = cur->NB::get_parent()) {
+		cur->NB::_wbt_size += 1;
+	}
+
+	node.NB::set_parent(parent);
+	if (handle.is_left_child()) {
+		parent->NB::set_left(&node);
+	} else {
+		parent->NB::set_right(&node);
+	}
+
+	this->leaf_attached(node, parent);
+	NodeTraits::leaf_inserted(node, *this);
+	this->fixup_after_insert_twopass(&node);
+}
+
 template <class Node, class NodeTraits, class Options, class Tag, class Compare>
 void
 WBTree<Node, NodeTraits, Options, Tag, Compare>::verify_sizes() const
@@ -814,6 +860,8 @@ void
 WBTree<Node, NodeTraits, Options, Tag, Compare>::dbg_verify() const
 {
 	this->verify_tree();
+	this->verify_threads();
+	this->verify_extremes();
 	this->verify_order();
 	this->verify_sizes();
 }
@@ -1140,6 +1188,8 @@ void
 WBTree<Node, NodeTraits, Options, Tag, Compare>::remove_onepass(Node & node)
     CMP_NOEXCEPT(node)
 {
+	this->node_detaching(node, node.NB::get_parent());
+
 	/* Basic idea: perform fixup for the part below node as we go down. Then fix
 	 * upwards of node.
 	 */
@@ -1489,6 +1539,8 @@ void
 WBTree<Node, NodeTraits, Options, Tag, Compare>::remove_to_leaf(Node & node)
     CMP_NOEXCEPT(node)
 {
+	this->node_detaching(node, node.NB::get_parent());
+
 	Node * cur = &node;
 
 	// Size reduction is done during up-traversal!
@@ -1718,6 +1770,745 @@ WBTree<Node, NodeTraits, Options, Tag, Compare>::remove(Node & node)
 	}
 }
 
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+WBTree<Node, NodeTraits, Options, Tag, Compare>::pop_front()
+{
+	Node * smallest = this->get_smallest();
+	if (smallest != nullptr) {
+		this->remove(*smallest);
+	}
+	return smallest;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+WBTree<Node, NodeTraits, Options, Tag, Compare>::pop_back()
+{
+	Node * largest = this->get_largest();
+	if (largest != nullptr) {
+		this->remove(*largest);
+	}
+	return largest;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Mutator>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::update_key(Node & node,
+                                                            Mutator && mutator)
+{
+	auto it = this->iterator_to(node);
+	auto prev_it = it;
+	--prev_it;
+	auto next_it = it;
+	++next_it;
+	Node * prev = (prev_it != this->end()) ? &(*prev_it) : nullptr;
+	Node * next = (next_it != this->end()) ? &(*next_it) : nullptr;
+
+	mutator(node);
+
+	const bool before_prev = (prev != nullptr) && this->cmp(node, *prev);
+	const bool after_next = (next != nullptr) && this->cmp(*next, node);
+	if (!before_prev && !after_next) {
+		// Data derived from the key may have changed
+		for (Node * n = &node; n != nullptr; n = n->NB::get_parent()) {
+			NodeTraits::children_changed(*n, *this);
+		}
+		this->s.touch();
+		return;
+	}
+
+	// Relink, searching for the new position from the neighbor the node moved
+	// past
+	this->remove(node);
+	this->insert_at(this->prepare_insert_near(node, before_prev ? *prev : *next),
+	                node);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+size_t
+WBTree<Node, NodeTraits, Options, Tag, Compare>::get_node_count(
+    const Node * n) noexcept
+{
+	// The weight of a subtree is the number of nodes in it plus one.
+	if (n == nullptr) {
+		return 0;
+	}
+	return n->NB::_wbt_size - 1;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+size_t
+WBTree<Node, NodeTraits, Options, Tag, Compare>::rank(
+    const_iterator<false> it) const noexcept
+{
+	if (it == this->cend()) {
+		return get_node_count(this->root);
+	}
+
+	const Node * cur = &(*it);
+	size_t r = get_node_count(cur->NB::get_left());
+
+	while (cur->NB::get_parent() != nullptr) {
+		const Node * parent = cur->NB::get_parent();
+		if (parent->NB::get_right() == cur) {
+			r += get_node_count(parent->NB::get_left()) + 1;
+		}
+		cur = parent;
+	}
+
+	return r;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+typename WBTree<Node, NodeTraits, Options, Tag, Compare>::template iterator<
+    false>
+WBTree<Node, NodeTraits, Options, Tag, Compare>::select(size_t k) noexcept
+{
+	Node * cur = this->root;
+
+	while (cur != nullptr) {
+		size_t left_count = get_node_count(cur->NB::get_left());
+		if (k < left_count) {
+			cur = cur->NB::get_left();
+		} else if (k == left_count) {
+			return iterator<false>(cur);
+		} else {
+			k -= left_count + 1;
+			cur = cur->NB::get_right();
+		}
+	}
+
+	return this->end();
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+typename WBTree<Node, NodeTraits, Options, Tag,
+                Compare>::template const_iterator<false>
+WBTree<Node, NodeTraits, Options, Tag, Compare>::select(size_t k) const noexcept
+{
+	return const_iterator<false>(const_cast<MyClass *>(this)->select(k));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+typename WBTree<Node, NodeTraits, Options, Tag, Compare>::template iterator<
+    false>
+WBTree<Node, NodeTraits, Options, Tag, Compare>::advance(
+    iterator<false> it, ptrdiff_t steps) noexcept
+{
+	ptrdiff_t target = static_cast<ptrdiff_t>(this->rank(it)) + steps;
+	if (target < 0) {
+		return this->end();
+	}
+
+	return this->select(static_cast<size_t>(target));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+typename WBTree<Node, NodeTraits, Options, Tag,
+                Compare>::template const_iterator<false>
+WBTree<Node, NodeTraits, Options, Tag, Compare>::advance(
+    const_iterator<false> it, ptrdiff_t steps) const noexcept
+{
+	ptrdiff_t target = static_cast<ptrdiff_t>(this->rank(it)) + steps;
+	if (target < 0) {
+		return this->cend();
+	}
+
+	return this->select(static_cast<size_t>(target));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+ptrdiff_t
+WBTree<Node, NodeTraits, Options, Tag, Compare>::distance(
+    const_iterator<false> from, const_iterator<false> to) const noexcept
+{
+	return static_cast<ptrdiff_t>(this->rank(to)) -
+	       static_cast<ptrdiff_t>(this->rank(from));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class ForwardIt>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::build_from_sorted(
+    ForwardIt first, ForwardIt last) noexcept
+{
+	using Category = typename std::iterator_traits<ForwardIt>::iterator_category;
+	static_assert(std::is_base_of_v<std::forward_iterator_tag, Category>,
+	              "build_from_sorted() traverses the range more than once and "
+	              "thus needs a forward iterator.");
+	size_t count = static_cast<size_t>(std::distance(first, last));
+
+	this->s.set(count);
+	this->root = this->build_subtree(first, count);
+	if (this->root != nullptr) {
+		this->root->NB::set_parent(nullptr);
+	}
+	this->refresh_extremes();
+	this->rethread();
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class ForwardIt>
+Node *
+WBTree<Node, NodeTraits, Options, Tag, Compare>::build_subtree(
+    ForwardIt & it, size_t count) noexcept
+{
+	if (count == 0) {
+		return nullptr;
+	}
+
+	size_t left_count = (count - 1) / 2;
+	Node * left = this->build_subtree(it, left_count);
+	Node & node = *it;
+	++it;
+	Node * right = this->build_subtree(it, count - left_count - 1);
+
+	node.NB::set_left(left);
+	node.NB::set_right(right);
+	node.NB::set_parent(nullptr);
+	if (left != nullptr) {
+		left->NB::set_parent(&node);
+	}
+	if (right != nullptr) {
+		right->NB::set_parent(&node);
+	}
+	node.NB::_wbt_size = static_cast<typename NB::WBTSizeT>(count + 1);
+
+	NodeTraits::children_changed(node, *this);
+
+	return &node;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+size_t
+WBTree<Node, NodeTraits, Options, Tag, Compare>::get_weight(
+    const Node * n) noexcept
+{
+	if (n == nullptr) {
+		return 1;
+	}
+	return n->NB::_wbt_size;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+bool
+WBTree<Node, NodeTraits, Options, Tag, Compare>::is_balanced(
+    size_t weight_a, size_t weight_b) noexcept
+{
+	return (static_cast<typename Options::WBTDeltaT>(weight_a) *
+	            Options::wbt_delta() >=
+	        static_cast<typename Options::WBTDeltaT>(weight_b)) &&
+	       (static_cast<typename Options::WBTDeltaT>(weight_b) *
+	            Options::wbt_delta() >=
+	        static_cast<typename Options::WBTDeltaT>(weight_a));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+WBTree<Node, NodeTraits, Options, Tag, Compare>::join_subtrees(
+    Node * left, Node & pivot, Node * right) noexcept
+{
+	// Both <left> and <right> must not have parents. We descend along the inner
+	// spine of the heavier tree until we find a subtree that is in balance with
+	// the lighter tree, which is then replaced by <pivot>. Afterwards, we ascend
+	// and rebalance, similar to an insertion.
+	bool descend_left = get_weight(left) < get_weight(right);
+	Node * lower = descend_left ? left : right;
+	size_t lower_weight = get_weight(lower);
+	Node * cur = descend_left ? right : left;
+	this->root = cur;
+
+	Node * parent = nullptr;
+	while ((cur != nullptr) && !is_balanced(get_weight(cur), lower_weight)) {
+		parent = cur;
+		if (descend_left) {
+			cur = cur->NB::get_left();
+		} else {
+			cur = cur->NB::get_right();
+		}
+	}
+
+	if (descend_left) {
+		pivot.NB::set_left(lower);
+		pivot.NB::set_right(cur);
+	} else {
+		pivot.NB::set_left(cur);
+		pivot.NB::set_right(lower);
+	}
+	if (cur != nullptr) {
+		cur->NB::set_parent(&pivot);
+	}
+	if (lower != nullptr) {
+		lower->NB::set_parent(&pivot);
+	}
+	pivot.NB::set_parent(parent);
+	pivot.NB::_wbt_size =
+	    static_cast<typename NB::WBTSizeT>(get_weight(cur) + lower_weight);
+	NodeTraits::children_changed(pivot, *this);
+
+	if (parent == nullptr) {
+		this->root = &pivot;
+		return this->root;
+	}
+
+	if (descend_left) {
+		parent->NB::set_left(&pivot);
+	} else {
+		parent->NB::set_right(&pivot);
+	}
+
+	Node * node = parent;
+	while (node != nullptr) {
+		Node * left_child = node->NB::get_left();
+		Node * right_child = node->NB::get_right();
+		node->NB::_wbt_size = static_cast<typename NB::WBTSizeT>(
+		    get_weight(left_child) + get_weight(right_child));
+		NodeTraits::children_changed(*node, *this);
+
+		if (!is_balanced(get_weight(left_child), get_weight(right_child))) {
+			// Only the inner side can have become too heavy. Use a single rotation
+			// if that restores the balance, a double rotation otherwise.
+			if (descend_left) {
+				size_t outer = get_weight(left_child->NB::get_left());
+				size_t inner = get_weight(left_child->NB::get_right());
+				size_t remaining = get_weight(right_child);
+				if ((left_child->NB::get_right() == nullptr) ||
+				    (is_balanced(inner, remaining) &&
+				     is_balanced(outer, inner + remaining))) {
+					this->rotate_right(node);
+				} else {
+					this->rotate_left(left_child);
+					this->rotate_right(node);
+				}
+			} else {
+				size_t outer = get_weight(right_child->NB::get_right());
+				size_t inner = get_weight(right_child->NB::get_left());
+				size_t remaining = get_weight(left_child);
+				if ((right_child->NB::get_left() == nullptr) ||
+				    (is_balanced(remaining, inner) &&
+				     is_balanced(remaining + inner, outer))) {
+					this->rotate_left(node);
+				} else {
+					this->rotate_right(right_child);
+					this->rotate_left(node);
+				}
+			}
+
+			// switch to new parent
+			node = node->NB::get_parent();
+		}
+
+		node = node->NB::get_parent();
+	}
+
+	return this->root;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+WBTree<Node, NodeTraits, Options, Tag, Compare>::join_subtrees(
+    Node * left, Node * right) noexcept
+{
+	if (left == nullptr) {
+		return right;
+	}
+	if (right == nullptr) {
+		return left;
+	}
+
+	// Use the largest node of <left> as pivot
+	Node * rest;
+	Node * pivot = this->split_last(left, rest);
+	return this->join_subtrees(rest, *pivot, right);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+Node *
+WBTree<Node, NodeTraits, Options, Tag, Compare>::split_last(
+    Node * sub_root, Node *& rest) noexcept
+{
+	Node * left_child = sub_root->NB::get_left();
+	Node * right_child = sub_root->NB::get_right();
+	if (left_child != nullptr) {
+		left_child->NB::set_parent(nullptr);
+	}
+
+	if (right_child == nullptr) {
+		rest = left_child;
+		return sub_root;
+	}
+
+	right_child->NB::set_parent(nullptr);
+	Node * inner;
+	Node * last = this->split_last(right_child, inner);
+	rest = this->join_subtrees(left_child, *sub_root, inner);
+	return last;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <bool on_equality_prefer_left, class Comparable>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::split_subtree(
+    Node * sub_root, const Comparable & key, Node *& left, Node *& right)
+    CMP_NOEXCEPT(key)
+{
+	if (sub_root == nullptr) {
+		left = nullptr;
+		right = nullptr;
+		return;
+	}
+
+	Node * left_child = sub_root->NB::get_left();
+	Node * right_child = sub_root->NB::get_right();
+	if (left_child != nullptr) {
+		left_child->NB::set_parent(nullptr);
+	}
+	if (right_child != nullptr) {
+		right_child->NB::set_parent(nullptr);
+	}
+
+	bool goes_right;
+	if constexpr (on_equality_prefer_left) {
+		goes_right = this->cmp(key, *sub_root);
+	} else {
+		goes_right = !this->cmp(*sub_root, key);
+	}
+
+	Node * inner;
+	if (goes_right) {
+		this->template split_subtree<on_equality_prefer_left>(left_child, key,
+		                                                      left, inner);
+		right = this->join_subtrees(inner, *sub_root, right_child);
+	} else {
+		this->template split_subtree<on_equality_prefer_left>(right_child, key,
+		                                                      inner, right);
+		left = this->join_subtrees(left_child, *sub_root, inner);
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::split(const Comparable & key,
+                                                       MyClass & right)
+    CMP_NOEXCEPT(key)
+{
+	// Nodes in <right> would be lost
+	assert(right.empty());
+
+	Node * left_root;
+	Node * right_root;
+	this->template split_subtree<false>(this->root, key, left_root, right_root);
+	this->thread_split(left_root, right_root);
+
+	this->root = left_root;
+	right.root = right_root;
+	this->refresh_extremes();
+	right.refresh_extremes();
+	this->s.set(get_node_count(left_root));
+	right.s.set(get_node_count(right_root));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::join(Node & pivot,
+                                                      MyClass & right) noexcept
+{
+	this->thread_join(this->root, &pivot, right.root);
+	this->join_subtrees(this->root, pivot, right.root);
+	right.root = nullptr;
+	this->refresh_extremes();
+	right.refresh_extremes();
+	this->take_size_from(right, 1);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::join(MyClass & right) noexcept
+{
+	if (right.empty()) {
+		return;
+	}
+
+	// Use the smallest node of <right> as pivot
+	Node * pivot = right.get_smallest();
+	right.remove(*pivot);
+	this->join(*pivot, right);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::union_subtrees(
+    Node * a, Node * b, Node *& result, Node *& dups, size_t & dup_count,
+    unsigned int parallel_depth) CMP_NOEXCEPT(*b)
+{
+	dups = nullptr;
+	dup_count = 0;
+
+	if (b == nullptr) {
+		result = a;
+		return;
+	}
+	if (a == nullptr) {
+		result = b;
+		return;
+	}
+
+	// Take <b> apart and split <a> at <b>
+	Node * b_left = b->NB::get_left();
+	Node * b_right = b->NB::get_right();
+	if (b_left != nullptr) {
+		b_left->NB::set_parent(nullptr);
+	}
+	if (b_right != nullptr) {
+		b_right->NB::set_parent(nullptr);
+	}
+
+	Node * a_left;
+	Node * a_right;
+	this->template split_subtree<false>(a, *b, a_left, a_right);
+
+	Node * equal = nullptr;
+	if constexpr (!Options::multiple) {
+		// There is at most one node equal to <b>
+		Node * upper;
+		this->template split_subtree<true>(a_right, *b, equal, upper);
+		a_right = upper;
+	}
+
+	Node * result_left;
+	Node * dups_left;
+	size_t dup_count_left;
+	Node * result_right;
+	Node * dups_right;
+	size_t dup_count_right;
+
+	unsigned int next_depth = (parallel_depth > 0) ? parallel_depth - 1 : 0;
+	utilities::run_maybe_parallel(
+	    parallel_depth > 0,
+	    [&]() {
+		    // Joining uses the tree's root as scratch space, so every thread
+		    // needs its own tree.
+		    MyClass scratch;
+		    scratch.union_subtrees(a_left, b_left, result_left, dups_left,
+		                           dup_count_left, next_depth);
+	    },
+	    [&]() {
+		    this->union_subtrees(a_right, b_right, result_right, dups_right,
+		                         dup_count_right, next_depth);
+	    });
+
+	if (equal == nullptr) {
+		result = this->join_subtrees(result_left, *b, result_right);
+		dups = this->join_subtrees(dups_left, dups_right);
+	} else {
+		// Keep our node, <b> becomes a duplicate
+		result = this->join_subtrees(result_left, *equal, result_right);
+		dups = this->join_subtrees(dups_left, *b, dups_right);
+		dup_count = 1;
+	}
+	dup_count += dup_count_left + dup_count_right;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <bool keep_equal>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::filter_subtree(
+    Node * a, const Node * b, Node *& kept, Node *& removed,
+    unsigned int parallel_depth) CMP_NOEXCEPT(*b)
+{
+	if ((a == nullptr) || ((b == nullptr) && keep_equal)) {
+		kept = nullptr;
+		removed = a;
+		return;
+	}
+	if (b == nullptr) {
+		kept = a;
+		removed = nullptr;
+		return;
+	}
+
+	// Split <a> into the nodes less than, equal to and greater than <b>
+	Node * a_left;
+	Node * upper;
+	Node * equal;
+	Node * a_right;
+	this->template split_subtree<false>(a, *b, a_left, upper);
+	this->template split_subtree<true>(upper, *b, equal, a_right);
+
+	Node * kept_left;
+	Node * removed_left;
+	Node * kept_right;
+	Node * removed_right;
+
+	unsigned int next_depth = (parallel_depth > 0) ? parallel_depth - 1 : 0;
+	utilities::run_maybe_parallel(
+	    parallel_depth > 0,
+	    [&]() {
+		    MyClass scratch;
+		    scratch.template filter_subtree<keep_equal>(
+		        a_left, b->NB::get_left(), kept_left, removed_left, next_depth);
+	    },
+	    [&]() {
+		    this->template filter_subtree<keep_equal>(
+		        a_right, b->NB::get_right(), kept_right, removed_right, next_depth);
+	    });
+
+	if constexpr (keep_equal) {
+		kept_right = this->join_subtrees(equal, kept_right);
+	} else {
+		removed_right = this->join_subtrees(equal, removed_right);
+	}
+	kept = this->join_subtrees(kept_left, kept_right);
+	removed = this->join_subtrees(removed_left, removed_right);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <bool keep_equal>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::filter(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	Node * kept_root;
+	Node * removed_root;
+	this->template filter_subtree<keep_equal>(this->root, other.root, kept_root,
+	                                          removed_root, parallel_depth);
+
+	this->root = kept_root;
+	removed.root = removed_root;
+	this->s.set(get_node_count(kept_root));
+	removed.s.set(get_node_count(removed_root));
+	this->refresh_extremes();
+	removed.refresh_extremes();
+	this->rethread();
+	removed.rethread();
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::union_with(
+    MyClass & other, unsigned int parallel_depth) CMP_NOEXCEPT(*other.root)
+{
+	Node * result;
+	Node * dups;
+	size_t dup_count;
+	this->union_subtrees(this->root, other.root, result, dups, dup_count,
+	                     parallel_depth);
+
+	this->root = result;
+	other.root = dups;
+	this->s.set(get_node_count(result));
+	other.s.set(dup_count);
+	this->refresh_extremes();
+	other.refresh_extremes();
+	this->rethread();
+	other.rethread();
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::intersect_with(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	this->template filter<true>(other, removed, parallel_depth);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::difference_with(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	this->template filter<false>(other, removed, parallel_depth);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable1, class Comparable2>
+Node *
+WBTree<Node, NodeTraits, Options, Tag, Compare>::cut_range(
+    const Comparable1 & lo, const Comparable2 & hi)
+{
+	Node * left;
+	Node * upper;
+	Node * middle;
+	Node * right;
+	this->template split_subtree<false>(this->root, lo, left, upper);
+	this->template split_subtree<false>(upper, hi, middle, right);
+
+	this->root = this->join_subtrees(left, right);
+	this->refresh_extremes();
+	this->thread_cut_out(middle);
+	return middle;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable1, class Comparable2>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::erase_range(
+    const Comparable1 & lo, const Comparable2 & hi, MyClass & removed)
+{
+	removed.root = this->cut_range(lo, hi);
+	removed.refresh_extremes();
+	this->s.set(get_node_count(this->root));
+	removed.s.set(get_node_count(removed.root));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Comparable1, class Comparable2, class Disposer>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::erase_range(
+    const Comparable1 & lo, const Comparable2 & hi, Disposer && disposer)
+{
+	Node * middle = this->cut_range(lo, hi);
+	this->s.reduce(this->consume_subtree(middle, disposer));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+template <class Relocate>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::relayout(Node * arena,
+                                                          Relocate && relocate)
+{
+	this->template relayout_base<NB>(arena, relocate);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+void
+WBTree<Node, NodeTraits, Options, Tag, Compare>::write_structure(
+    const Node * nodes, std::ostream & out) const
+{
+	this->template write_structure_base<0>(
+	    bst::StructureHeader::Kind::WBTREE, nodes, out,
+	    [](const Node & n, unsigned char * meta) {
+		    (void)n;
+		    (void)meta;
+		    return false;
+	    });
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare>
+bool
+WBTree<Node, NodeTraits, Options, Tag, Compare>::restore_structure(
+    Node * nodes, size_t node_count, const void * data, size_t bytes)
+{
+	return this->template restore_structure_base<0>(
+	    bst::StructureHeader::Kind::WBTREE, nodes, node_count, data, bytes,
+	    [](Node & n, bool flag, const unsigned char * meta) {
+		    (void)n;
+		    (void)flag;
+		    (void)meta;
+	    },
+	    [this](Node & n) {
+		    n.NB::_wbt_size = static_cast<typename NB::WBTSizeT>(
+		        get_weight(n.NB::get_left()) + get_weight(n.NB::get_right()));
+		    NodeTraits::children_changed(n, *this);
+	    });
+}
+
 } // namespace ygg
 
 #endif // YGG_RBTREE_CPP
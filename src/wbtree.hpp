@@ -9,6 +9,8 @@
 
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <set>
 #include <type_traits>
 
@@ -37,7 +39,10 @@ class WBTreeNodeBase : public bst::BSTNodeBase<Node, Options, Tag> {
 public:
 	// TODO namespacing!
 	void swap_parent_with(Node * other) noexcept;
-	size_t _wbt_size;
+	// 32 bits if WBT_32BIT_SIZES is set
+	using WBTSizeT = std::conditional_t<Options::wbt_32bit_sizes, std::uint32_t,
+	                                    size_t>;
+	WBTSizeT _wbt_size;
 };
 
 /**
@@ -115,6 +120,23 @@ public:
 		(void)old_descendant;
 		(void)t;
 	}
+
+	/**
+	 * @brief Called when a node's children have been set wholesale
+	 *
+	 * This is called during bulk construction (see
+	 * WBTree::build_from_sorted()) as well as while splitting and joining trees,
+	 * whenever the subtrees below <node> have been exchanged. Nodes are visited
+	 * bottom-up, thus it suffices to recompute any information of <node> from
+	 * its children.
+	 */
+	template <class Node, class Tree>
+	static void
+	children_changed(Node & node, Tree & t) noexcept
+	{
+		(void)node;
+		(void)t;
+	}
 };
 
 /**
@@ -147,6 +169,10 @@ public:
 	using TB = bst::BinarySearchTree<Node, Options, Tag, Compare>;
 	static_assert(std::is_base_of<NB, Node>::value,
 	              "Node class not properly derived from WBTreeNodeBase");
+	static_assert(!Options::no_parent_pointers,
+	              "NO_PARENT_POINTERS is currently only supported by the ZTree");
+	static_assert(!Options::compress_duplicates,
+	              "COMPRESS_DUPLICATES is currently only supported by the RBTree");
 
 	/**
 	 * @brief Create a new empty weight balanced tree.
@@ -192,6 +218,21 @@ public:
 	void insert_left_leaning(Node & node) CMP_NOEXCEPT(node);
 	void insert_right_leaning(Node & node) CMP_NOEXCEPT(node);
 
+	/**
+	 * @brief Inserts <node> at a position found by find_or_prepare_insert()
+	 *
+	 * Inserts <node> without searching for its position again. <node> must
+	 * compare equally to the query that was passed to find_or_prepare_insert(),
+	 * the handle must not refer to an existing node (i.e., handle.found() must
+	 * be false) and the tree must not have been modified since the handle was
+	 * created.
+	 *
+	 * @param handle  The insertion position returned by find_or_prepare_insert()
+	 * @param node    The node to be inserted
+	 */
+	void insert_at(const typename TB::InsertHandle & handle, Node & node)
+	    noexcept;
+
 	/**
 	 * @brief Deletes a node that compares equally to <c> from the tree
 	 *
@@ -249,6 +290,312 @@ public:
 	 */
 	void remove(Node & node) CMP_NOEXCEPT(node);
 
+	/**
+	 * @brief Removes the smallest node from the tree
+	 *
+	 * Removes the smallest node from the tree and returns it. If the
+	 * CACHED_EXTREMES option is set, the node is not searched and this runs in
+	 * O(1) amortized time. Otherwise, this takes O(log n).
+	 *
+	 * @return The removed node, or nullptr if the tree was empty
+	 */
+	Node * pop_front();
+
+	/**
+	 * @brief Removes the largest node from the tree
+	 *
+	 * Removes the largest node from the tree and returns it. If the
+	 * CACHED_EXTREMES option is set, the node is not searched and this runs in
+	 * O(1) amortized time. Otherwise, this takes O(log n).
+	 *
+	 * @return The removed node, or nullptr if the tree was empty
+	 */
+	Node * pop_back();
+
+	/**
+	 * @brief Changes the key of <node>, which is in the tree
+	 *
+	 * Calls <mutator> with <node> as only argument. <mutator> may change the
+	 * key of the node. The node is only relinked if it is out of order with its
+	 * in-order predecessor or successor afterwards. In that case, its new
+	 * position is searched starting from the neighbor it moved past. See
+	 * RBTree::update_key() for details.
+	 *
+	 * If the node stays in place, NodeTraits::children_changed() is called for
+	 * it and all its ancestors in O(log n).
+	 *
+	 * @warning If the tree does not allow multiple equal keys, the new key must
+	 * not be present in the tree.
+	 *
+	 * @param node     The node whose key should be changed
+	 * @param mutator  A callable that is passed <node> and changes its key
+	 */
+	template <class Mutator>
+	void update_key(Node & node, Mutator && mutator);
+
+	/**
+	 * @brief Computes the rank of the node an iterator points to
+	 *
+	 * Returns the number of nodes that come before the node pointed to by <it>,
+	 * i.e., its position in an in-order traversal of the tree, starting at zero.
+	 * The rank of end() is the number of nodes in the tree. Since every node
+	 * stores the weight of its subtree anyways, this runs in O(log n) without
+	 * any additional memory.
+	 *
+	 * @param it  Iterator to the node whose rank should be computed, or end()
+	 * @return The number of nodes before <it>
+	 */
+	size_t rank(const_iterator<false> it) const noexcept;
+
+	/**
+	 * @brief Finds the k-th node
+	 *
+	 * Returns an iterator to the node that has exactly <k> nodes before it in
+	 * the tree. This method runs in O(log n).
+	 *
+	 * @param k   The rank of the node to be found, starting at zero.
+	 * @return An iterator to the node with rank <k>, or end() if the tree holds
+	 * no more than <k> nodes.
+	 */
+	const_iterator<false> select(size_t k) const noexcept;
+	iterator<false> select(size_t k) noexcept;
+
+	/**
+	 * @brief Moves an iterator by multiple steps
+	 *
+	 * Returns an iterator that is <steps> positions after <it> (or before <it>,
+	 * if <steps> is negative). In contrast to the iterator's operator+=, which
+	 * takes one step after the other, this uses the subtree weights and runs in
+	 * O(log n). Advancing end() by a negative number of steps is allowed.
+	 *
+	 * @param it    The iterator to start from
+	 * @param steps The number of steps to move
+	 * @return The moved iterator, or end() if the resulting position is not
+	 * inside the tree.
+	 */
+	const_iterator<false> advance(const_iterator<false> it,
+	                              ptrdiff_t steps) const noexcept;
+	iterator<false> advance(iterator<false> it, ptrdiff_t steps) noexcept;
+
+	/**
+	 * @brief Computes the distance between two iterators
+	 *
+	 * Returns the number of steps needed to get from <from> to <to>, which is
+	 * negative if <to> comes before <from>. This method runs in O(log n).
+	 *
+	 * @param from  The iterator to start from. May be end().
+	 * @param to    The iterator to go to. May be end().
+	 * @return The (signed) number of steps from <from> to <to>.
+	 */
+	ptrdiff_t distance(const_iterator<false> from,
+	                   const_iterator<false> to) const noexcept;
+
+	/**
+	 * @brief Builds the tree from a sorted range of nodes
+	 *
+	 * Replaces the contents of the tree with the nodes in [first, last). The
+	 * nodes must already be sorted with respect to the tree's Compare. The tree
+	 * is built in O(n) as a perfectly balanced tree, which satisfies the weight
+	 * balance invariant for every choice of parameters. Any nodes previously
+	 * contained in the tree are discarded (as if clear() had been called).
+	 *
+	 * The children_changed() callback of the NodeTraits is called for every
+	 * node in a bottom-up fashion, so that augmented trees can compute their
+	 * additional information.
+	 *
+	 * @param first   Forward iterator to the first node. Dereferencing it must
+	 * yield a Node &. The range is traversed more than once.
+	 * @param last    Iterator past the last node.
+	 */
+	template <class ForwardIt>
+	void build_from_sorted(ForwardIt first, ForwardIt last) noexcept;
+
+	/**
+	 * @brief Splits the tree at <key>
+	 *
+	 * All nodes that are less than <key> remain in this tree, all other nodes
+	 * are moved into <right>, which must be empty. This runs in O(log n), also
+	 * if CONSTANT_TIME_SIZE is set, since the sizes of the resulting trees are
+	 * the weights of their roots.
+	 *
+	 * @param key     Anything comparable to a Node. See BinarySearchTree::find()
+	 * for details.
+	 * @param right   An empty tree that receives all nodes not less than
+	 * <key>.
+	 */
+	template <class Comparable>
+	void split(const Comparable & key, MyClass & right) CMP_NOEXCEPT(key);
+
+	/**
+	 * @brief Appends a tree to this tree
+	 *
+	 * Moves all nodes of <right> into this tree. No node in <right> may be less
+	 * than any node in this tree. Afterwards, <right> is empty. This runs in
+	 * O(log n).
+	 *
+	 * The variant taking a <pivot> additionally inserts <pivot>, which must not
+	 * be contained in any tree and must fit between the nodes of this tree and
+	 * the nodes of <right>.
+	 *
+	 * @param right   The tree whose nodes should be appended.
+	 */
+	void join(MyClass & right) noexcept;
+	void join(Node & pivot, MyClass & right) noexcept;
+
+	/**
+	 * @brief Moves all nodes of <other> into this tree
+	 *
+	 * Computes the union of this tree and <other> using the join-based
+	 * divide-and-conquer algorithm, which takes O(m log(n/m + 1)) time for trees
+	 * of sizes m <= n. If MULTIPLE is not set, nodes of <other> for which an
+	 * equal node exists in this tree are not moved, but remain in <other>.
+	 * Otherwise, <other> is empty afterwards.
+	 *
+	 * On the topmost <parallel_depth> levels of the recursion, the two halves are
+	 * processed in parallel, using up to 2^<parallel_depth> threads. Comparisons
+	 * must not throw in that case.
+	 *
+	 * @param other           The tree whose nodes should be moved into this tree.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void union_with(MyClass & other, unsigned int parallel_depth = 0)
+	    CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes that have no equal node in <other>
+	 *
+	 * Afterwards, this tree contains exactly the nodes for which an equal node
+	 * exists in <other>. All other nodes are moved into <removed>. Any nodes
+	 * previously contained in <removed> are discarded. <other> is not modified.
+	 * This takes O(m log(n/m + 1)) time for trees of sizes m <= n, see
+	 * union_with() for the meaning of <parallel_depth>.
+	 *
+	 * @param other           The tree to intersect this tree with.
+	 * @param removed         The tree that receives all removed nodes.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void intersect_with(const MyClass & other, MyClass & removed,
+	                    unsigned int parallel_depth = 0) CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes that have an equal node in <other>
+	 *
+	 * The removed nodes are moved into <removed>, any nodes previously contained
+	 * in <removed> are discarded. <other> is not modified. See intersect_with()
+	 * for details.
+	 *
+	 * @param other           The tree whose nodes should be subtracted.
+	 * @param removed         The tree that receives all removed nodes.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void difference_with(const MyClass & other, MyClass & removed,
+	                     unsigned int parallel_depth = 0)
+	    CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes in the range [<lo>, <hi>)
+	 *
+	 * All nodes that are not less than <lo> but less than <hi> are moved into
+	 * <removed>. Any nodes previously contained in <removed> are discarded.
+	 * This takes O(log n) time, independent of the number k of removed nodes:
+	 * The range is split out of the tree and the remainder is joined again,
+	 * and the sizes of both trees are the weights of their roots, thus the
+	 * removed nodes are never counted (unlike in the RBTree and ZTree).
+	 *
+	 * The variant taking a <disposer> instead calls it for every removed node (as
+	 * Node &) in order, taking O(log n + k) time. The links of a node are not
+	 * accessed anymore once the disposer has been called on it, so the disposer
+	 * may e.g. destroy the node.
+	 *
+	 * @param lo        Anything comparable to a Node. The inclusive lower bound
+	 * of the range.
+	 * @param hi        Anything comparable to a Node. The exclusive upper bound
+	 * of the range.
+	 * @param removed   The tree that receives all removed nodes.
+	 */
+	template <class Comparable1, class Comparable2>
+	void erase_range(const Comparable1 & lo, const Comparable2 & hi,
+	                 MyClass & removed);
+	template <class Comparable1, class Comparable2, class Disposer>
+	void erase_range(const Comparable1 & lo, const Comparable2 & hi,
+	                 Disposer && disposer);
+
+	/**
+	 * @brief Moves all nodes into <arena>, in van Emde Boas order
+	 *
+	 * Copies the nodes of the tree into the contiguous buffer <arena> and makes
+	 * the copies the nodes of the tree. The nodes are placed in van Emde Boas
+	 * order: the upper half of the levels of the tree is laid out recursively,
+	 * followed by every subtree hanging off it, from left to right. Thus, any
+	 * search touches only O(log_B n) cache lines or pages, whatever their size B.
+	 * This takes O(n log log n) time and O(n) additional space and is meant to
+	 * be run in quiet periods, e.g. after the tree has been built.
+	 *
+	 * Every node is moved into the arena via its move assignment operator. The
+	 * tree's own node base (i.e., its subtree size) is copied separately.
+	 * Afterwards, <relocate> is called as relocate(Node & old_node, Node &
+	 * new_node) for every node, so that external references can be updated.
+	 * The old nodes are not part of the tree anymore at that point, and are not
+	 * accessed after <relocate> has been called on them, so it may e.g. destroy
+	 * them.
+	 *
+	 * The nodes must not be part of any other tree. If
+	 * POOL_RELATIVE_LINKS is set, the arena must be part of the pool.
+	 *
+	 * @param arena     Pointer to an array of at least size() nodes that are
+	 * not part of any tree. It must not overlap with the tree's nodes.
+	 * @param relocate  Called for every node after it has been moved.
+	 */
+	template <class Relocate>
+	void relayout(Node * arena, Relocate && relocate);
+
+	/**
+	 * @brief Writes the structure of the tree to <out>
+	 *
+	 * Writes a compact binary description of the tree's shape to <out>: For
+	 * every node in pre-order, its index relative to <nodes> and which of its
+	 * children exist. Subtree sizes are not written, they are recomputed on
+	 * restoring. The nodes themselves are not written, you must persist them
+	 * yourself, e.g. as an array. This takes O(n) time.
+	 *
+	 * Together with the nodes, the structure allows restore_structure() to
+	 * rebuild the tree in O(n) time, without comparing any nodes. For n nodes
+	 * spread over less than 2^32 array slots, 16 + 5n bytes are written. See
+	 * bst::StructureHeader for the format.
+	 *
+	 * @param nodes   The start of the array that all nodes of the tree are in
+	 * @param out     The stream to write the structure to
+	 */
+	void write_structure(const Node * nodes, std::ostream & out) const;
+
+	/**
+	 * @brief Restores a tree from its structure written by write_structure()
+	 *
+	 * Makes this tree the tree that write_structure() described, with its nodes
+	 * taken from the array <nodes> at the written indices. Nodes that were in
+	 * this tree before are not part of it anymore (and not touched). The
+	 * structure is read strictly sequentially, so it can e.g. be mapped from a
+	 * file via mmap(). This takes O(n) time and O(log n) additional space, and
+	 * does not compare any nodes. NodeTraits::children_changed() is called on
+	 * every node, children before parents.
+	 *
+	 * The nodes must be equal to the ones the structure was written from, in
+	 * the same order. Only the format of <data> and the indices are checked,
+	 * not whether the tree is a valid tree. If the check fails, the tree is
+	 * empty afterwards.
+	 *
+	 * @param nodes       The start of the array the tree's nodes are taken from
+	 * @param node_count  The number of nodes in the array
+	 * @param data        The structure written by write_structure()
+	 * @param bytes       The size of <data> in bytes
+	 * @return Whether <data> was a valid structure
+	 */
+	bool restore_structure(Node * nodes, size_t node_count, const void * data,
+	                       size_t bytes);
+
 	// Mainly debugging methods
 	/// @cond INTERNAL
 	bool verify_integrity() const;
@@ -292,6 +639,34 @@ protected:
 	void swap_unrelated_nodes(Node * n1, Node * n2) noexcept;
 	void swap_neighbors(Node * parent, Node * child) noexcept;
 
+	static size_t get_node_count(const Node * n) noexcept;
+
+	template <class ForwardIt>
+	Node * build_subtree(ForwardIt & it, size_t count) noexcept;
+
+	// Splitting and joining
+	static size_t get_weight(const Node * n) noexcept;
+	static bool is_balanced(size_t weight_a, size_t weight_b) noexcept;
+	Node * join_subtrees(Node * left, Node & pivot, Node * right) noexcept;
+	Node * join_subtrees(Node * left, Node * right) noexcept;
+	template <bool on_equality_prefer_left, class Comparable>
+	void split_subtree(Node * sub_root, const Comparable & key, Node *& left,
+	                   Node *& right) CMP_NOEXCEPT(key);
+	Node * split_last(Node * sub_root, Node *& rest) noexcept;
+
+	// Set operations
+	void union_subtrees(Node * a, Node * b, Node *& result, Node *& dups,
+	                    size_t & dup_count, unsigned int parallel_depth)
+	    CMP_NOEXCEPT(*b);
+	template <bool keep_equal>
+	void filter_subtree(Node * a, const Node * b, Node *& kept, Node *& removed,
+	                    unsigned int parallel_depth) CMP_NOEXCEPT(*b);
+	template <bool keep_equal>
+	void filter(const MyClass & other, MyClass & removed,
+	            unsigned int parallel_depth) CMP_NOEXCEPT(*other.root);
+	template <class Comparable1, class Comparable2>
+	Node * cut_range(const Comparable1 & lo, const Comparable2 & hi);
+
 	void verify_sizes() const;
 };
 
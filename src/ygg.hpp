@@ -1,8 +1,12 @@
+#include "augmentation.hpp"
 #include "dynamic_segment_tree.hpp"
 #include "intervaltree.hpp"
 #include "list.hpp"
+#include "node_pool.hpp"
 #include "options.hpp"
 #include "rbtree.hpp"
+#include "search_snapshot.hpp"
+#include "sharded_tree.hpp"
 #include "ziptree.hpp"
 #include "energy.hpp"
 #include "wbtree.hpp"
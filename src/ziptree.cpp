@@ -9,6 +9,43 @@
 
 namespace ygg {
 
+inline std::uint64_t &
+ZTreeFastRandom::state() noexcept
+{
+	// Every thread gets a different default seed. The atomic is only touched
+	// once per thread.
+	static std::atomic<std::uint64_t> thread_counter{0};
+	thread_local std::uint64_t s =
+	    (thread_counter.fetch_add(1, std::memory_order_relaxed) + 1) *
+	    0x9e3779b97f4a7c15ull;
+	return s;
+}
+
+inline void
+ZTreeFastRandom::seed(std::uint64_t seed) noexcept
+{
+	state() = seed;
+}
+
+inline std::uint64_t
+ZTreeFastRandom::next() noexcept
+{
+	// wyrand, see https://github.com/wangyi-fudan/wyhash
+	std::uint64_t & s = state();
+	s += 0xa0761d6478bd642full;
+	__uint128_t t = static_cast<__uint128_t>(s) * (s ^ 0xe7037ed1a0b428dbull);
+	return static_cast<std::uint64_t>(t >> 64) ^ static_cast<std::uint64_t>(t);
+}
+
+inline std::uint8_t
+ZTreeFastRandom::next_rank() noexcept
+{
+	// Setting the highest bit caps the rank at 64 and keeps the argument of
+	// ctz from being zero.
+	return static_cast<std::uint8_t>(
+	    __builtin_ctzll(ZTreeFastRandom::next() | (1ull << 63)) + 1);
+}
+
 namespace ztree_internal {
 // @cond INTERNAL
 
@@ -74,6 +111,36 @@ ZTreeRankGenerator<Node, Options, true, false>::get_rank(
 	}
 }
 
+template <class Node>
+Node *
+RankParentStorage<Node>::get_parent() const noexcept
+{
+	return reinterpret_cast<Node *>(this->parent_and_rank & POINTER_MASK);
+}
+
+template <class Node>
+void
+RankParentStorage<Node>::set_parent(Node * new_parent) noexcept
+{
+	this->parent_and_rank = reinterpret_cast<std::uintptr_t>(new_parent) |
+	                        (this->parent_and_rank & ~POINTER_MASK);
+}
+
+template <class Node>
+std::uint8_t
+RankParentStorage<Node>::get_rank() const noexcept
+{
+	return static_cast<std::uint8_t>(this->parent_and_rank >> RANK_SHIFT);
+}
+
+template <class Node>
+void
+RankParentStorage<Node>::set_rank(std::uint8_t rank) noexcept
+{
+	this->parent_and_rank = (this->parent_and_rank & POINTER_MASK) |
+	                        (std::uintptr_t{rank} << RANK_SHIFT);
+}
+
 template <class Node, class Options>
 ZTreeRankGenerator<Node, Options, true, true>::ZTreeRankGenerator()
 {}
@@ -85,24 +152,24 @@ ZTreeRankGenerator<Node, Options, true, true>::update_rank(Node & node) noexcept
 	const auto hasher = typename Options::template ztree_hasher_type<Node>();
 
 	// TODO ffsl? ffs?
+	int rank;
 	if constexpr (Options::ztree_universalize_lincong) {
 		// TODO this is not strictly a universal family
 		size_t universalized =
 		    (hasher(node) * Options::ztree_universalize_coefficient) %
 		    Options::ztree_universalize_modul;
-		node._zt_rank.rank = static_cast<decltype(node._zt_rank.rank)>(
-		    __builtin_ffsl(static_cast<long int>(universalized)));
+		rank = __builtin_ffsl(static_cast<long int>(universalized));
 	} else if constexpr (Options::ztree_universalize_multiply) {
 		// This is a variant of the multiply-shift method by Dietzfelbinger et al.
 		// Since we hash to all of size_t, we don't need a shift.
 		size_t universalized =
 		    (hasher(node) * Options::ztree_universalize_coefficient);
-		node._zt_rank.rank = static_cast<decltype(node._zt_rank.rank)>(
-		    __builtin_ffsl(static_cast<long int>(universalized)));
+		rank = __builtin_ffsl(static_cast<long int>(universalized));
 	} else {
-		node._zt_rank.rank = static_cast<decltype(node._zt_rank.rank)>(
-		    __builtin_ffsl(static_cast<long int>(hasher(node))));
+		rank = __builtin_ffsl(static_cast<long int>(hasher(node)));
 	}
+
+	set_rank(node, static_cast<size_t>(rank));
 }
 
 template <class Node, class Options>
@@ -110,34 +177,86 @@ size_t
 ZTreeRankGenerator<Node, Options, true, true>::get_rank(
     const Node & node) noexcept
 {
-	return static_cast<size_t>(node._zt_rank.rank);
+	if constexpr (Options::ztree_compress_rank) {
+		return node._bst_parent.get_rank();
+	} else {
+		return static_cast<size_t>(node._zt_rank.rank);
+	}
+}
+
+template <class Node, class Options>
+void
+ZTreeRankGenerator<Node, Options, true, true>::set_rank(Node & node,
+                                                        size_t rank) noexcept
+{
+	if constexpr (Options::ztree_compress_rank) {
+		node._bst_parent.set_rank(static_cast<std::uint8_t>(rank));
+	} else {
+		node._zt_rank.rank = static_cast<decltype(node._zt_rank.rank)>(rank);
+	}
 }
 
 template <class Node, class Options>
 ZTreeRankGenerator<Node, Options, false, true>::ZTreeRankGenerator()
 {
-	auto rand_val = std::rand();
-	this->rank = 0;
-	while (rand_val == RAND_MAX) {
-		this->rank = static_cast<decltype(this->rank)>(
-		    (this->rank + static_cast<decltype(this->rank)>(std::log2(RAND_MAX))));
-		rand_val = std::rand();
+	// With ZTREE_COMPRESS_RANK, the node base draws the rank
+	if constexpr (!Options::ztree_compress_rank) {
+		this->rank = draw_rank();
 	}
-	this->rank = static_cast<decltype(this->rank)>(
-	    __builtin_ffsl(static_cast<long int>(rand_val)));
 }
 
 template <class Node, class Options>
 template <class URBG>
 ZTreeRankGenerator<Node, Options, false, true>::ZTreeRankGenerator(URBG && g)
+{
+	static_assert(!Options::ztree_compress_rank,
+	              "With ZTREE_COMPRESS_RANK, use update_rank(node, g) instead.");
+	this->rank = draw_rank(g);
+}
+
+template <class Node, class Options>
+typename ZTreeRankGenerator<Node, Options, false, true>::RankT
+ZTreeRankGenerator<Node, Options, false, true>::draw_rank() noexcept
+{
+	RankT rank;
+	if constexpr (Options::ztree_fast_random_ranks) {
+		rank = static_cast<RankT>(ZTreeFastRandom::next_rank());
+	} else {
+		auto rand_val = std::rand();
+		rank = 0;
+		while (rand_val == RAND_MAX) {
+			rank = static_cast<RankT>(
+			    (rank + static_cast<RankT>(std::log2(RAND_MAX))));
+			rand_val = std::rand();
+		}
+		rank = static_cast<RankT>(__builtin_ffsl(static_cast<long int>(rand_val)));
+	}
+
+	if constexpr (Options::ztree_zipzip_ranks) {
+		rank = add_secondary(rank, draw_secondary());
+	}
+
+	return rank;
+}
+
+template <class Node, class Options>
+template <class URBG>
+typename ZTreeRankGenerator<Node, Options, false, true>::RankT
+ZTreeRankGenerator<Node, Options, false, true>::draw_rank(URBG && g) noexcept
 {
 	auto rand_val = g();
-	this->rank = 0;
+	RankT rank = 0;
 	while (rand_val == g.max()) {
-		this->rank += static_cast<size_t>(std::log2(g.max()));
+		rank = static_cast<RankT>(rank + static_cast<size_t>(std::log2(g.max())));
 		rand_val = g();
 	}
-	this->rank = __builtin_ffsl(static_cast<long int>(rand_val));
+	rank = static_cast<RankT>(__builtin_ffsl(static_cast<long int>(rand_val)));
+
+	if constexpr (Options::ztree_zipzip_ranks) {
+		rank = add_secondary(rank, static_cast<std::uint64_t>(g()));
+	}
+
+	return rank;
 }
 
 template <class Node, class Options>
@@ -146,16 +265,7 @@ ZTreeRankGenerator<Node, Options, false, true>::update_rank(
     Node & node) noexcept
 {
 	// Re-Randomize!
-	auto rand_val = std::rand();
-	node._zt_rank.rank = 0;
-	while (rand_val == RAND_MAX) {
-		node._zt_rank.rank = static_cast<decltype(node._zt_rank.rank)>(
-		    (node._zt_rank.rank +
-		     static_cast<decltype(node._zt_rank.rank)>(std::log2(RAND_MAX))));
-		rand_val = std::rand();
-	}
-	node._zt_rank.rank = static_cast<decltype(node._zt_rank.rank)>(
-	    __builtin_ffsl(static_cast<long int>(rand_val)));
+	set_rank(node, static_cast<size_t>(draw_rank()));
 }
 
 template <class Node, class Options>
@@ -165,13 +275,7 @@ ZTreeRankGenerator<Node, Options, false, true>::update_rank(Node & node,
                                                             URBG && g) noexcept
 {
 	// Re-Randomize!
-	auto rand_val = g();
-	node._zt_rank.rank = 0;
-	while (rand_val == g.max()) {
-		node._zt_rank.rank += static_cast<size_t>(std::log2(g.max()));
-		rand_val = g();
-	}
-	node._zt_rank.rank = __builtin_ffsl(static_cast<long int>(rand_val));
+	set_rank(node, static_cast<size_t>(draw_rank(g)));
 }
 
 template <class Node, class Options>
@@ -179,12 +283,67 @@ size_t
 ZTreeRankGenerator<Node, Options, false, true>::get_rank(
     const Node & node) noexcept
 {
-	return static_cast<size_t>(node._zt_rank.rank);
+	if constexpr (Options::ztree_compress_rank) {
+		return node._bst_parent.get_rank();
+	} else {
+		return static_cast<size_t>(node._zt_rank.rank);
+	}
+}
+
+template <class Node, class Options>
+void
+ZTreeRankGenerator<Node, Options, false, true>::set_rank(Node & node,
+                                                         size_t rank) noexcept
+{
+	if constexpr (Options::ztree_compress_rank) {
+		node._bst_parent.set_rank(static_cast<std::uint8_t>(rank));
+	} else {
+		node._zt_rank.rank = static_cast<decltype(node._zt_rank.rank)>(rank);
+	}
+}
+
+template <class Node, class Options>
+std::uint64_t
+ZTreeRankGenerator<Node, Options, false, true>::draw_secondary() noexcept
+{
+	if constexpr (Options::ztree_fast_random_ranks) {
+		return ZTreeFastRandom::next();
+	} else {
+		// std::rand() yields at least 15 bits, which might not be enough on its own
+		std::uint64_t val = 0;
+		for (size_t i = 0; i < 3; ++i) {
+			val = (val << 15) ^ static_cast<std::uint64_t>(std::rand());
+		}
+		return val;
+	}
+}
+
+template <class Node, class Options>
+typename ZTreeRankGenerator<Node, Options, false, true>::RankT
+ZTreeRankGenerator<Node, Options, false, true>::add_secondary(
+    RankT primary, std::uint64_t secondary) noexcept
+{
+	// Compared as a single integer, the packed ranks are ordered by their
+	// geometric part first and by their secondary part second.
+	constexpr size_t bits = zipzip_secondary_rank_bits<Options>();
+	constexpr std::uint64_t mask = (std::uint64_t{1} << bits) - 1;
+	return static_cast<RankT>((static_cast<std::uint64_t>(primary) << bits) |
+	                          (secondary & mask));
 }
 
 // @endcond
 } // namespace ztree_internal
 
+template <class Node, class Options, class Tag>
+ZTreeNodeBase<Node, Options, Tag>::ZTreeNodeBase() noexcept
+{
+	// With ZTREE_COMPRESS_RANK, the rank generator has no storage of its own.
+	// Hash-based ranks are set via update_rank().
+	if constexpr (Options::ztree_compress_rank && !Options::ztree_use_hash) {
+		this->_bst_parent.set_rank(decltype(this->_zt_rank)::draw_rank());
+	}
+}
+
 template <class Node, class Options, class Tag>
 size_t
 ZTreeNodeBase<Node, Options, Tag>::get_depth() const noexcept
@@ -220,6 +379,7 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::ZTree(
 	this->root = other.root;
 	other.root = nullptr;
 	this->s = other.s;
+	this->extremes = other.extremes;
 }
 
 template <class Node, class NodeTraits, class Options, class Tag, class Compare,
@@ -231,6 +391,7 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::operator=(
 	this->root = other.root;
 	other.root = nullptr;
 	this->s = other.s;
+	this->extremes = other.extremes;
 }
 
 template <class Node, class NodeTraits, class Options, class Tag, class Compare,
@@ -253,9 +414,13 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::insert(
 	auto node_rank = RankGetter::get_rank(node);
 	this->s.add(1);
 
+	NodeTraits traits;
+
 	// TODO this should be handled by the code below
 	if (this->root == nullptr) {
 		this->root = &node;
+		this->leaf_attached(node, nullptr);
+		traits.inserted_without_unzipping(&node);
 		return;
 	}
 
@@ -312,6 +477,83 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::insert(
 
 		if (old_node != nullptr) {
 			this->unzip(*old_node, node);
+		} else {
+			this->leaf_attached(node, current);
+			traits.inserted_without_unzipping(&node);
+		}
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::insert_at(
+    const typename TB::InsertHandle & handle, Node & node) noexcept
+{
+	assert(!handle.found());
+
+	if constexpr (Options::no_parent_pointers) {
+		// We cannot walk up the search path.
+		(void)handle;
+		this->insert(node);
+	} else {
+#ifdef YGG_STORE_SEQUENCE
+		this->bss.register_insert(reinterpret_cast<const void *>(&node),
+		                          Options::SequenceInterface::get_key(node));
+#endif
+
+		node.NB::set_parent(nullptr);
+		node.NB::set_left(nullptr);
+		node.NB::set_right(nullptr);
+		this->s.add(1);
+
+		NodeTraits traits;
+		Node * parent = handle.get_parent();
+		if (parent == nullptr) {
+			this->root = &node;
+			this->leaf_attached(node, nullptr);
+			traits.inserted_without_unzipping(&node);
+			return;
+		}
+
+		// On equal ranks, the root goes below <node>, see insert().
+		auto node_rank = RankGetter::get_rank(node);
+		if (node_rank >= RankGetter::get_rank(*this->root)) {
+			// Replacing the root!
+			Node * old_root = this->root;
+			this->root = &node;
+			this->unzip(*old_root, node);
+			return;
+		}
+
+		/* Ranks do not increase along the search path. Walk up to the topmost
+		 * node with a smaller rank - it must go below <node>. This stops below
+		 * the root. */
+		Node * below = nullptr;
+		while (RankGetter::get_rank(*parent) < node_rank) {
+			below = parent;
+			parent = parent->NB::get_parent();
+		}
+
+		node.NB::set_parent(parent);
+		bool as_left_child;
+		if (below == nullptr) {
+			as_left_child = handle.is_left_child();
+		} else {
+			as_left_child = (parent->NB::get_left() == below);
+		}
+
+		if (as_left_child) {
+			parent->NB::set_left(&node);
+		} else {
+			parent->NB::set_right(&node);
+		}
+
+		if (below != nullptr) {
+			this->unzip(*below, node);
+		} else {
+			this->leaf_attached(node, parent);
+			traits.inserted_without_unzipping(&node);
 		}
 	}
 }
@@ -325,7 +567,9 @@ ZTree<Node, NodeTraits, Options, Tag, Compare,
 	std::vector<size_t> rank_count;
 
 	for (auto & node : *this) {
-		size_t rank = RankGetter::get_rank(node);
+		// Only report the geometric part of zip-zip ranks
+		size_t rank = RankGetter::get_rank(node) >>
+		              ztree_internal::zipzip_secondary_rank_bits<Options>();
 		if (rank_count.size() <= rank) {
 			rank_count.resize(rank + 1, 0);
 		}
@@ -541,9 +785,708 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::unzip(
 		right_head->NB::set_right(nullptr);
 	}
 
+	if constexpr (Options::threaded) {
+		// The spine ends are the neighbors of <newn>. If one of the spines is
+		// empty, the neighbor on that side is still linked to the other end.
+		Node * prev =
+		    (left_head != &newn) ? left_head : right_head->NB::get_prev();
+		Node * next =
+		    (right_head != &newn) ? right_head : left_head->NB::get_next();
+		this->thread_between(prev, newn, next);
+	}
+
+	if constexpr (Options::cached_extremes) {
+		// <newn> is the new smallest node iff nothing below it is smaller and
+		// the old smallest node is its successor. Vice versa for the largest.
+		if ((left_head == &newn) && (right_head == this->extremes.smallest)) {
+			this->extremes.smallest = &newn;
+		}
+		if ((right_head == &newn) && (left_head == this->extremes.largest)) {
+			this->extremes.largest = &newn;
+		}
+	}
+
 	traits.unzip_done(&newn, left_head, right_head);
 } // namespace ygg
 
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <class ForwardIt>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::build_from_sorted(
+    ForwardIt first, ForwardIt last) CMP_NOEXCEPT(*first)
+{
+	using Category = typename std::iterator_traits<ForwardIt>::iterator_category;
+	static_assert(std::is_base_of_v<std::forward_iterator_tag, Category>,
+	              "build_from_sorted() traverses the range more than once and "
+	              "thus needs a forward iterator.");
+	this->root = nullptr;
+	this->s.set(static_cast<size_t>(std::distance(first, last)));
+
+	// The right spine of the tree built so far serves as the stack. It is kept
+	// explicitly since nodes may not have parent pointers.
+	std::vector<Node *> right_spine;
+	std::vector<Node *> run;
+
+	while (first != last) {
+		ForwardIt run_end = std::next(first);
+		if constexpr (Options::multiple) {
+			while ((run_end != last) && !this->cmp(*first, *run_end)) {
+				++run_end;
+			}
+		}
+
+		if (run_end == std::next(first)) {
+			this->link_sorted(*first, right_spine);
+		} else {
+			// Equal nodes must form a chain of left children. Linking them in
+			// order of ascending rank achieves that.
+			run.clear();
+			for (ForwardIt it = first; it != run_end; ++it) {
+				run.push_back(&(*it));
+			}
+			std::stable_sort(run.begin(), run.end(),
+			                 [](const Node * lhs, const Node * rhs) {
+				                 return RankGetter::get_rank(*lhs) <
+				                        RankGetter::get_rank(*rhs);
+			                 });
+			for (Node * n : run) {
+				this->link_sorted(*n, right_spine);
+			}
+		}
+
+		first = run_end;
+	}
+
+	// Nodes still on the right spine did not get their final right child
+	// before.
+	NodeTraits traits;
+	for (auto it = right_spine.rbegin(); it != right_spine.rend(); ++it) {
+		traits.children_changed(*it);
+	}
+
+	this->refresh_extremes();
+	this->rethread();
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::link_sorted(
+    Node & node, std::vector<Node *> & right_spine) CMP_NOEXCEPT(node)
+{
+	auto rank = RankGetter::get_rank(node);
+
+	// Pop everything from the right spine that must go below <node>. On equal
+	// ranks, the node to the left stays above - except for equal nodes, which
+	// may never be right children.
+	// Popped nodes will not receive any more children.
+	NodeTraits traits;
+	Node * below = nullptr;
+	while (!right_spine.empty() &&
+	       ((RankGetter::get_rank(*right_spine.back()) < rank) ||
+	        ((RankGetter::get_rank(*right_spine.back()) == rank) &&
+	         !this->cmp(*right_spine.back(), node)))) {
+		below = right_spine.back();
+		right_spine.pop_back();
+		traits.children_changed(below);
+	}
+	Node * rightmost = right_spine.empty() ? nullptr : right_spine.back();
+
+	node.NB::set_left(below);
+	node.NB::set_right(nullptr);
+	node.NB::set_parent(rightmost);
+	if (below != nullptr) {
+		below->NB::set_parent(&node);
+	}
+
+	if (rightmost != nullptr) {
+		rightmost->NB::set_right(&node);
+	} else {
+		this->root = &node;
+	}
+
+	right_spine.push_back(&node);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <bool on_equality_prefer_left, class Comparable>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::unzip_subtree(
+    Node * sub_root, const Comparable & key, Node *& left, Node *& right)
+    CMP_NOEXCEPT(key)
+{
+	// Unzip the search path: Nodes that go left form the right spine of the
+	// left tree, all other nodes form the left spine of the right tree.
+	left = nullptr;
+	right = nullptr;
+	Node * left_last = nullptr;
+	Node * right_last = nullptr;
+
+	Node * cur = sub_root;
+	while (cur != nullptr) {
+		bool goes_left;
+		if constexpr (on_equality_prefer_left) {
+			goes_left = !this->cmp(key, *cur);
+		} else {
+			goes_left = this->cmp(*cur, key);
+		}
+
+		if (goes_left) {
+			if (left_last != nullptr) {
+				left_last->NB::set_right(cur);
+			} else {
+				left = cur;
+			}
+			cur->NB::set_parent(left_last);
+			left_last = cur;
+			cur = cur->NB::get_right();
+		} else {
+			if (right_last != nullptr) {
+				right_last->NB::set_left(cur);
+			} else {
+				right = cur;
+			}
+			cur->NB::set_parent(right_last);
+			right_last = cur;
+			cur = cur->NB::get_left();
+		}
+	}
+
+	if (left_last != nullptr) {
+		left_last->NB::set_right(nullptr);
+	}
+	if (right_last != nullptr) {
+		right_last->NB::set_left(nullptr);
+	}
+
+	children_changed_upwards(left_last);
+	children_changed_upwards(right_last);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+Node *
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::zip_subtrees(
+    Node * left, Node * right) noexcept
+{
+	// Zip the right spine of <left> with the left spine of <right>
+	Node * root = nullptr;
+	Node * last = nullptr;
+	bool last_from_left = false;
+
+	while ((left != nullptr) || (right != nullptr)) {
+		bool take_left;
+		if (left == nullptr) {
+			take_left = false;
+		} else if (right == nullptr) {
+			take_left = true;
+		} else {
+			take_left = RankGetter::get_rank(*left) >= RankGetter::get_rank(*right);
+		}
+
+		Node * next = take_left ? left : right;
+		if (last == nullptr) {
+			root = next;
+		} else if (last_from_left) {
+			last->NB::set_right(next);
+		} else {
+			last->NB::set_left(next);
+		}
+		next->NB::set_parent(last);
+
+		if ((left == nullptr) || (right == nullptr)) {
+			// The rest is already in place
+			break;
+		}
+
+		last = next;
+		last_from_left = take_left;
+		if (take_left) {
+			left = left->NB::get_right();
+		} else {
+			right = right->NB::get_left();
+		}
+	}
+
+	children_changed_upwards(last);
+	return root;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+Node *
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::zip_subtrees(
+    Node * left, Node & pivot, Node * right) noexcept
+{
+	// Descend along the inner spines as long as there are nodes of higher rank
+	// than <pivot>. On ties, <pivot> is placed above both sides.
+	auto pivot_rank = RankGetter::get_rank(pivot);
+	Node * root = nullptr;
+	Node * last = nullptr;
+	bool last_from_left = false;
+
+	while (true) {
+		bool left_above =
+		    (left != nullptr) && (RankGetter::get_rank(*left) > pivot_rank);
+		bool right_above =
+		    (right != nullptr) && (RankGetter::get_rank(*right) > pivot_rank);
+		if (!left_above && !right_above) {
+			break;
+		}
+
+		bool take_left =
+		    left_above && (!right_above || (RankGetter::get_rank(*left) >=
+		                                    RankGetter::get_rank(*right)));
+		Node * next = take_left ? left : right;
+		if (last == nullptr) {
+			root = next;
+		} else if (last_from_left) {
+			last->NB::set_right(next);
+		} else {
+			last->NB::set_left(next);
+		}
+		next->NB::set_parent(last);
+
+		last = next;
+		last_from_left = take_left;
+		if (take_left) {
+			left = left->NB::get_right();
+		} else {
+			right = right->NB::get_left();
+		}
+	}
+
+	pivot.NB::set_left(left);
+	pivot.NB::set_right(right);
+	if (left != nullptr) {
+		left->NB::set_parent(&pivot);
+	}
+	if (right != nullptr) {
+		right->NB::set_parent(&pivot);
+	}
+
+	pivot.NB::set_parent(last);
+	if (last == nullptr) {
+		root = &pivot;
+	} else if (last_from_left) {
+		last->NB::set_right(&pivot);
+	} else {
+		last->NB::set_left(&pivot);
+	}
+
+	children_changed_upwards(&pivot);
+	return root;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare,
+      RankGetter>::children_changed_upwards(Node * node) noexcept
+{
+	if constexpr (!Options::no_parent_pointers) {
+		NodeTraits traits;
+		while (node != nullptr) {
+			traits.children_changed(node);
+			node = node->NB::get_parent();
+		}
+	} else {
+		(void)node;
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <class Comparable>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::split(
+    const Comparable & key, MyClass & right) CMP_NOEXCEPT(key)
+{
+	// Nodes in <right> would be lost
+	assert(right.empty());
+
+	size_t total = 0;
+	if constexpr (Options::constant_time_size) {
+		total = this->size();
+	}
+
+	Node * left_root;
+	Node * right_root;
+	this->template unzip_subtree<false>(this->root, key, left_root, right_root);
+	this->thread_split(left_root, right_root);
+
+	this->root = left_root;
+	right.root = right_root;
+	this->refresh_extremes();
+	right.refresh_extremes();
+	this->distribute_size(right, total);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::join(
+    MyClass & right) noexcept
+{
+	this->thread_join(this->root, nullptr, right.root);
+	this->root = zip_subtrees(this->root, right.root);
+	right.root = nullptr;
+	this->refresh_extremes();
+	right.refresh_extremes();
+	this->take_size_from(right, 0);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::join(
+    Node & pivot, MyClass & right) noexcept
+{
+	this->thread_join(this->root, &pivot, right.root);
+	this->root = zip_subtrees(this->root, pivot, right.root);
+	right.root = nullptr;
+	this->refresh_extremes();
+	right.refresh_extremes();
+	this->take_size_from(right, 1);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::union_subtrees(
+    Node * a, Node * b, Node *& result, Node *& dups, size_t & dup_count,
+    unsigned int parallel_depth) CMP_NOEXCEPT(*b)
+{
+	dups = nullptr;
+	dup_count = 0;
+
+	if (b == nullptr) {
+		result = a;
+		return;
+	}
+	if (a == nullptr) {
+		result = b;
+		return;
+	}
+
+	// Take <b> apart and split <a> into the nodes less than, equal to and
+	// greater than <b>
+	Node * b_left = b->NB::get_left();
+	Node * b_right = b->NB::get_right();
+	if (b_left != nullptr) {
+		b_left->NB::set_parent(nullptr);
+	}
+	if (b_right != nullptr) {
+		b_right->NB::set_parent(nullptr);
+	}
+
+	Node * a_left;
+	Node * upper;
+	Node * equal;
+	Node * a_right;
+	this->template unzip_subtree<false>(a, *b, a_left, upper);
+	this->template unzip_subtree<true>(upper, *b, equal, a_right);
+
+	Node * result_left;
+	Node * dups_left;
+	size_t dup_count_left;
+	Node * result_right;
+	Node * dups_right;
+	size_t dup_count_right;
+
+	// Unzipping and zipping do not touch the tree itself, so both halves can
+	// work on this tree.
+	unsigned int next_depth = (parallel_depth > 0) ? parallel_depth - 1 : 0;
+	utilities::run_maybe_parallel(
+	    parallel_depth > 0,
+	    [&]() {
+		    this->union_subtrees(a_left, b_left, result_left, dups_left,
+		                         dup_count_left, next_depth);
+	    },
+	    [&]() {
+		    this->union_subtrees(a_right, b_right, result_right, dups_right,
+		                         dup_count_right, next_depth);
+	    });
+
+	if (equal == nullptr) {
+		result = zip_subtrees(result_left, *b, result_right);
+		dups = zip_subtrees(dups_left, dups_right);
+	} else {
+		// Keep our nodes, <b> becomes a duplicate
+		Node * equal_dups = nullptr;
+		if constexpr (Options::multiple) {
+			// Nodes of <b>'s left subtree that are equal to <b> are at the right end
+			// of <result_left>. Their ranks may interleave with those of <equal>, so
+			// they become duplicates, too.
+			Node * lower;
+			this->template unzip_subtree<false>(result_left, *b, lower, equal_dups);
+			result_left = lower;
+		}
+
+		result = zip_subtrees(zip_subtrees(result_left, equal), result_right);
+		dups = zip_subtrees(zip_subtrees(dups_left, equal_dups), *b, dups_right);
+		dup_count = 1;
+	}
+	dup_count += dup_count_left + dup_count_right;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <bool keep_equal>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::filter_subtree(
+    Node * a, const Node * b, Node *& kept, Node *& removed,
+    unsigned int parallel_depth) CMP_NOEXCEPT(*b)
+{
+	if ((a == nullptr) || ((b == nullptr) && keep_equal)) {
+		kept = nullptr;
+		removed = a;
+		return;
+	}
+	if (b == nullptr) {
+		kept = a;
+		removed = nullptr;
+		return;
+	}
+
+	// Split <a> into the nodes less than, equal to and greater than <b>
+	Node * a_left;
+	Node * upper;
+	Node * equal;
+	Node * a_right;
+	this->template unzip_subtree<false>(a, *b, a_left, upper);
+	this->template unzip_subtree<true>(upper, *b, equal, a_right);
+
+	Node * kept_left;
+	Node * removed_left;
+	Node * kept_right;
+	Node * removed_right;
+
+	unsigned int next_depth = (parallel_depth > 0) ? parallel_depth - 1 : 0;
+	utilities::run_maybe_parallel(
+	    parallel_depth > 0,
+	    [&]() {
+		    this->template filter_subtree<keep_equal>(
+		        a_left, b->NB::get_left(), kept_left, removed_left, next_depth);
+	    },
+	    [&]() {
+		    this->template filter_subtree<keep_equal>(
+		        a_right, b->NB::get_right(), kept_right, removed_right, next_depth);
+	    });
+
+	if constexpr (keep_equal) {
+		kept_right = zip_subtrees(equal, kept_right);
+	} else {
+		removed_right = zip_subtrees(equal, removed_right);
+	}
+	kept = zip_subtrees(kept_left, kept_right);
+	removed = zip_subtrees(removed_left, removed_right);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <bool keep_equal>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::filter(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	size_t total = 0;
+	if constexpr (Options::constant_time_size) {
+		total = this->size();
+	}
+
+	Node * kept_root;
+	Node * removed_root;
+	this->template filter_subtree<keep_equal>(this->root, other.root, kept_root,
+	                                          removed_root, parallel_depth);
+
+	this->root = kept_root;
+	removed.root = removed_root;
+	this->refresh_extremes();
+	removed.refresh_extremes();
+	this->rethread();
+	removed.rethread();
+	this->distribute_size(removed, total);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::union_with(
+    MyClass & other, unsigned int parallel_depth) CMP_NOEXCEPT(*other.root)
+{
+	size_t total = 0;
+	if constexpr (Options::constant_time_size) {
+		total = this->size() + other.size();
+	}
+
+	Node * result;
+	Node * dups;
+	size_t dup_count;
+	this->union_subtrees(this->root, other.root, result, dups, dup_count,
+	                     parallel_depth);
+	this->root = result;
+	this->refresh_extremes();
+	this->rethread();
+
+	if constexpr (Options::multiple) {
+		// The duplicates could not be zipped into the result. Insert them one by
+		// one.
+		this->consume_subtree(dups, [&](Node & n) { this->insert(n); });
+		other.root = nullptr;
+		dup_count = 0;
+	} else {
+		other.root = dups;
+		other.rethread();
+	}
+	other.refresh_extremes();
+
+	if constexpr (Options::constant_time_size) {
+		this->s.set(total - dup_count);
+		other.s.set(dup_count);
+	} else {
+		this->s.touch();
+		other.s.touch();
+	}
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::intersect_with(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	this->template filter<true>(other, removed, parallel_depth);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::difference_with(
+    const MyClass & other, MyClass & removed, unsigned int parallel_depth)
+    CMP_NOEXCEPT(*other.root)
+{
+	this->template filter<false>(other, removed, parallel_depth);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <class Comparable1, class Comparable2>
+Node *
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::cut_range(
+    const Comparable1 & lo, const Comparable2 & hi)
+{
+	Node * left;
+	Node * upper;
+	Node * middle;
+	Node * right;
+	this->template unzip_subtree<false>(this->root, lo, left, upper);
+	this->template unzip_subtree<false>(upper, hi, middle, right);
+
+	this->root = zip_subtrees(left, right);
+	this->refresh_extremes();
+	this->thread_cut_out(middle);
+	return middle;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <class Comparable1, class Comparable2>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::erase_range(
+    const Comparable1 & lo, const Comparable2 & hi, MyClass & removed)
+{
+	size_t total = 0;
+	if constexpr (Options::constant_time_size) {
+		total = this->size();
+	}
+
+	removed.root = this->cut_range(lo, hi);
+	removed.refresh_extremes();
+
+	// The removed tree is counted first, so this takes O(k).
+	removed.distribute_size(*this, total);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <class Comparable1, class Comparable2, class Disposer>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::erase_range(
+    const Comparable1 & lo, const Comparable2 & hi, Disposer && disposer)
+{
+	Node * middle = this->cut_range(lo, hi);
+	this->s.reduce(this->consume_subtree(middle, disposer));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <class Relocate>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::relayout(
+    Node * arena, Relocate && relocate)
+{
+	this->template relayout_base<NB>(arena, relocate);
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::write_structure(
+    const Node * nodes, std::ostream & out) const
+{
+	using RankStorage =
+	    ztree_internal::ZTreeRankGenerator<Node, Options, Options::ztree_use_hash,
+	                                       Options::ztree_store_rank>;
+	constexpr size_t rank_bytes = ztree_internal::stored_rank_bytes<Options>();
+
+	this->template write_structure_base<rank_bytes>(
+	    bst::StructureHeader::Kind::ZTREE, nodes, out,
+	    [](const Node & n, unsigned char * meta) {
+		    if constexpr (Options::ztree_store_rank) {
+			    auto rank = static_cast<typename Options::ztree_rank_type::type>(
+			        RankStorage::get_rank(n));
+			    std::memcpy(meta, &rank, rank_bytes);
+		    } else {
+			    (void)n;
+			    (void)meta;
+		    }
+		    return false;
+	    });
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+bool
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::restore_structure(
+    Node * nodes, size_t node_count, const void * data, size_t bytes)
+{
+	using RankStorage =
+	    ztree_internal::ZTreeRankGenerator<Node, Options, Options::ztree_use_hash,
+	                                       Options::ztree_store_rank>;
+	constexpr size_t rank_bytes = ztree_internal::stored_rank_bytes<Options>();
+
+	NodeTraits traits;
+	return this->template restore_structure_base<rank_bytes>(
+	    bst::StructureHeader::Kind::ZTREE, nodes, node_count, data, bytes,
+	    [](Node & n, bool flag, const unsigned char * meta) {
+		    (void)flag;
+		    if constexpr (Options::ztree_store_rank) {
+			    typename Options::ztree_rank_type::type rank;
+			    std::memcpy(&rank, meta, rank_bytes);
+			    RankStorage::set_rank(n, static_cast<size_t>(rank));
+		    } else {
+			    (void)n;
+			    (void)meta;
+		    }
+	    },
+	    [&traits](Node & n) { traits.children_changed(&n); });
+}
+
 template <class Node, class NodeTraits, class Options, class Tag, class Compare,
           class RankGetter>
 void
@@ -556,7 +1499,100 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::remove(Node & n)
 #endif
 
 	this->s.reduce(1);
-	this->zip(n);
+	this->zip(n, this->find_parent(n));
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+Node *
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::pop_front()
+{
+	Node * smallest = this->get_smallest();
+	if (smallest != nullptr) {
+		this->remove(*smallest);
+	}
+	return smallest;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+Node *
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::pop_back()
+{
+	Node * largest = this->get_largest();
+	if (largest != nullptr) {
+		this->remove(*largest);
+	}
+	return largest;
+}
+
+template <class Node, class NodeTraits, class Options, class Tag, class Compare,
+          class RankGetter>
+template <class Mutator>
+void
+ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::update_key(
+    Node & node, Mutator && mutator)
+{
+	auto it = this->iterator_to(node);
+	auto prev_it = it;
+	--prev_it;
+	auto next_it = it;
+	++next_it;
+	Node * prev = (prev_it != this->end()) ? &(*prev_it) : nullptr;
+	Node * next = (next_it != this->end()) ? &(*next_it) : nullptr;
+	// Without parent pointers, the parent can only be found via the old key
+	Node * parent = this->parent_of(it);
+	const auto old_rank = RankGetter::get_rank(node);
+
+	mutator(node);
+
+	if constexpr (Options::ztree_use_hash && Options::ztree_store_rank) {
+		ztree_internal::ZTreeRankGenerator<
+		    Node, Options, Options::ztree_use_hash,
+		    Options::ztree_store_rank>::update_rank(node);
+	}
+
+	// Equal keys must be in the left subtree. Thus, whether the node may equal
+	// a neighbor depends on whether the neighbor is an ancestor or a descendant.
+	bool before_prev = false;
+	if (prev != nullptr) {
+		if (node.NB::get_left() != nullptr) {
+			before_prev = this->cmp(node, *prev);
+		} else {
+			before_prev = !this->cmp(*prev, node);
+		}
+	}
+	bool after_next = false;
+	if (next != nullptr) {
+		if (node.NB::get_right() != nullptr) {
+			after_next = !this->cmp(node, *next);
+		} else {
+			after_next = this->cmp(*next, node);
+		}
+	}
+
+	if (!before_prev && !after_next &&
+	    (RankGetter::get_rank(node) == old_rank)) {
+		this->children_changed_upwards(&node);
+		this->s.touch();
+		return;
+	}
+
+	this->s.reduce(1);
+	this->zip(node, parent);
+
+	if constexpr (Options::no_parent_pointers) {
+		(void)before_prev;
+		this->insert(node);
+	} else {
+		Node * hint = before_prev ? prev : ((next != nullptr) ? next : prev);
+		if (hint == nullptr) {
+			// The node was the only one in the tree
+			this->insert(node);
+		} else {
+			this->insert_at(this->prepare_insert_near(node, *hint), node);
+		}
+	}
 }
 
 template <class Node, class NodeTraits, class Options, class Tag, class Compare,
@@ -577,11 +1613,23 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::erase(
 	                              (Options::stl_erase && Options::multiple)>(c);
 
 	if (el != this->end()) {
-		if constexpr (Options::stl_erase) {
+		if constexpr (Options::stl_erase && Options::no_parent_pointers) {
+			// Zipping changes the paths to the remaining nodes, so we must search
+			// for every further node.
+			size_t count = 0;
+			do {
+				count++;
+				this->zip(*el, this->parent_of(el));
+				el = this->lower_bound(c);
+			} while (Options::multiple && (el != this->end()) &&
+			         (!this->cmp(c, *el)));
+			this->s.reduce(count);
+			return count;
+		} else if constexpr (Options::stl_erase) {
 			size_t count = 1;
 
 			auto next = el + 1;
-			this->zip(*el);
+			this->zip(*el, this->parent_of(el));
 			if (Options::multiple) {
 				el = next;
 
@@ -591,7 +1639,7 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::erase(
 				                        false)) {
 					count++;
 					next = el + 1;
-					this->zip(*el);
+					this->zip(*el, this->parent_of(el));
 					el = next;
 				}
 			} else {
@@ -600,7 +1648,7 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::erase(
 			this->s.reduce(count);
 			return count;
 		} else {
-			this->zip(*el);
+			this->zip(*el, this->parent_of(el));
 			this->s.reduce(1);
 			return &(*el);
 		}
@@ -628,7 +1676,27 @@ ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::erase(
 	                         Options::SequenceInterface::get_key(*it));
 #endif
 
-	if constexpr (!Options::stl_erase) {
+	if constexpr (Options::no_parent_pointers) {
+		// The iterator knows the parent, no need to search for it.
+		Node * n = &(*it);
+		this->s.reduce(1);
+
+		if constexpr (!Options::stl_erase) {
+			this->zip(*n, this->parent_of(it));
+			return n;
+		} else {
+			// The path to the next node may change during zipping.
+			auto next = it + 1;
+			Node * next_node = (next != iterator<reverse>()) ? &(*next) : nullptr;
+			this->zip(*n, this->parent_of(it));
+
+			iterator<reverse> ret;
+			if (next_node != nullptr) {
+				this->build_path_to(this->root, next_node, ret);
+			}
+			return ret;
+		}
+	} else if constexpr (!Options::stl_erase) {
 		Node * n = &(*it);
 		this->remove(*it);
 
@@ -644,15 +1712,17 @@ template <class Node, class NodeTraits, class Options, class Tag, class Compare,
           class RankGetter>
 void
 ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::zip(
-    Node & old_root) noexcept
+    Node & old_root, Node * parent) noexcept
 {
+	this->node_detaching(old_root, parent);
+
 	NodeTraits traits;
 
 	Node * left_head = old_root.NB::get_left();
 	Node * right_head = old_root.NB::get_right();
 	Node * new_head = nullptr;
 
-	Node * cur = old_root.NB::get_parent();
+	Node * cur = parent;
 
 	bool last_from_left;
 
@@ -805,11 +1875,15 @@ template <class Node, class NodeTraits, class Options, class Tag, class Compare,
 void
 ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>::dbg_verify() const
 {
-	if (this->root != nullptr) {
-		assert(this->root->get_parent() == nullptr);
+	if constexpr (!Options::no_parent_pointers) {
+		if (this->root != nullptr) {
+			assert(this->root->get_parent() == nullptr);
+		}
 	}
 
 	this->dbg_verify_consistency(this->root, nullptr, nullptr);
+	this->verify_threads();
+	this->verify_extremes();
 	if (Options::constant_time_size) {
 		this->dbg_verify_size();
 	}
@@ -844,13 +1918,15 @@ ZTree<Node, NodeTraits, Options, Tag, Compare,
 		return;
 	}
 
-	if (sub_root->NB::get_parent() == nullptr) {
-		assert(this->root == sub_root);
-	} else {
-		assert(this->root != sub_root);
-	}
+	if constexpr (!Options::no_parent_pointers) {
+		if (sub_root->NB::get_parent() == nullptr) {
+			assert(this->root == sub_root);
+		} else {
+			assert(this->root != sub_root);
+		}
 
-	assert(sub_root->NB::get_parent() != sub_root);
+		assert(sub_root->NB::get_parent() != sub_root);
+	}
 
 	if (lower_bound_node != nullptr) {
 		assert(this->cmp(*lower_bound_node, *sub_root));
@@ -863,7 +1939,9 @@ ZTree<Node, NodeTraits, Options, Tag, Compare,
 		assert(RankGetter::get_rank(*sub_root->NB::get_right()) <=
 		       RankGetter::get_rank(*sub_root));
 		assert(this->cmp(*sub_root, *sub_root->NB::get_right()));
-		assert(sub_root->NB::get_right()->NB::get_parent() == sub_root);
+		if constexpr (!Options::no_parent_pointers) {
+			assert(sub_root->NB::get_right()->NB::get_parent() == sub_root);
+		}
 
 		this->dbg_verify_consistency(sub_root->NB::get_right(), sub_root,
 		                             upper_bound_node);
@@ -873,7 +1951,9 @@ ZTree<Node, NodeTraits, Options, Tag, Compare,
 		assert(RankGetter::get_rank(*sub_root->NB::get_left()) <=
 		       RankGetter::get_rank(*sub_root));
 		assert(!this->cmp(*sub_root, *sub_root->NB::get_left()));
-		assert(sub_root->NB::get_left()->NB::get_parent() == sub_root);
+		if constexpr (!Options::no_parent_pointers) {
+			assert(sub_root->NB::get_left()->NB::get_parent() == sub_root);
+		}
 
 		this->dbg_verify_consistency(sub_root->NB::get_left(), lower_bound_node,
 		                             sub_root);
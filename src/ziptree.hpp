@@ -11,8 +11,15 @@
 #include "benchmark_sequence.hpp"
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace ygg {
 
@@ -20,6 +27,46 @@ namespace ygg {
 template <class Node, class Options = DefaultOptions, class Tag = int>
 class ZTreeNodeBase;
 
+/**
+ * @brief Thread-local random number generator for Zip Tree ranks
+ *
+ * This is the generator that is used to draw nodes' ranks if you set
+ * TreeFlags::ZTREE_FAST_RANDOM_RANKS. It is a wyrand generator, of which every
+ * thread has its own instance. Thus, threads that each work on their own trees
+ * do not contend on a shared generator state, as they would with std::rand().
+ *
+ * Every thread's generator is seeded differently, but deterministically
+ * depending on the order in which the threads first draw a rank. Call seed() to
+ * make the ranks drawn by the current thread reproducible.
+ */
+class ZTreeFastRandom {
+public:
+	/**
+	 * @brief Seeds the generator of the calling thread
+	 *
+	 * @param seed The new seed
+	 */
+	static void seed(std::uint64_t seed) noexcept;
+
+	/**
+	 * @brief Draws a uniformly distributed 64-bit value from the generator of the
+	 * calling thread
+	 */
+	static std::uint64_t next() noexcept;
+
+	/**
+	 * @brief Draws a geometrically distributed rank (starting at 1) from the
+	 * generator of the calling thread
+	 *
+	 * This uses a single draw: the rank is one plus the number of trailing zeroes
+	 * of the drawn value, capped at 64.
+	 */
+	static std::uint8_t next_rank() noexcept;
+
+private:
+	static std::uint64_t & state() noexcept;
+};
+
 namespace ztree_internal {
 /// @cond INTERNAL
 
@@ -29,6 +76,37 @@ struct dbg_verify_size_helper
 	void operator()(const Tree & t, size_t node_count);
 };
 
+/* Stores the parent pointer of a node together with its rank, which is kept
+ * in the eight most significant bits. Used if ZTREE_COMPRESS_RANK is set. */
+template <class Node>
+class RankParentStorage {
+public:
+	Node * get_parent() const noexcept;
+	void set_parent(Node * new_parent) noexcept;
+
+	std::uint8_t get_rank() const noexcept;
+	void set_rank(std::uint8_t rank) noexcept;
+
+	static constexpr bool parent_reference = false;
+
+private:
+	static constexpr size_t RANK_SHIFT = 56;
+	static constexpr std::uintptr_t POINTER_MASK =
+	    (std::uintptr_t{1} << RANK_SHIFT) - 1;
+
+	// Initialized, since set_rank() and set_parent() each keep the other half
+	std::uintptr_t parent_and_rank = 0;
+};
+
+template <class Node, class Options>
+using ZTreeParentContainerFor =
+    std::conditional_t<Options::ztree_compress_rank, RankParentStorage<Node>,
+                       bst::DefaultParentContainerFor<Node, Options>>;
+
+// Takes the place of the stored rank if it is kept in the parent pointer
+class NoRankField {
+};
+
 template <class Node, class Options, bool use_hash, bool store>
 class ZTreeRankGenerator;
 
@@ -47,13 +125,35 @@ public:
 	ZTreeRankGenerator();
 	static void update_rank(Node & node) noexcept;
 	static size_t get_rank(const Node & node) noexcept;
+	// Sets the stored rank, e.g. to one that has been stored elsewhere
+	static void set_rank(Node & node, size_t rank) noexcept;
 
 private:
 	template <class, class, class>
 	friend class ZTreeNodeBase;
-	typename Options::ztree_rank_type::type rank;
+	// With ZTREE_COMPRESS_RANK, the rank lives in the parent pointer
+	[[no_unique_address]] std::conditional_t<
+	    Options::ztree_compress_rank, NoRankField,
+	    typename Options::ztree_rank_type::type> rank;
 };
 
+// The geometric part of a rank is at most 64, thus it needs seven bits. With
+// zip-zip ranks, the remaining bits of the rank type hold the secondary rank.
+constexpr size_t ZTREE_PRIMARY_RANK_BITS = 7;
+
+template <class Options>
+constexpr size_t
+zipzip_secondary_rank_bits()
+{
+	if constexpr (Options::ztree_zipzip_ranks) {
+		constexpr size_t digits = static_cast<size_t>(
+		    std::numeric_limits<typename Options::ztree_rank_type::type>::digits);
+		return std::min(digits - ZTREE_PRIMARY_RANK_BITS, size_t{32});
+	} else {
+		return 0;
+	}
+}
+
 template <class Node, class Options>
 class ZTreeRankGenerator<Node, Options, false, true> {
 public:
@@ -64,13 +164,50 @@ public:
 	template <class URBG>
 	static void update_rank(Node & node, URBG && g) noexcept;
 	static size_t get_rank(const Node & node) noexcept;
+	static void set_rank(Node & node, size_t rank) noexcept;
+
+	using RankT = typename Options::ztree_rank_type::type;
+	// Draws a new random rank
+	static RankT draw_rank() noexcept;
 
 private:
 	template <class, class, class>
 	friend class ZTreeNodeBase;
-	typename Options::ztree_rank_type::type rank;
+	// With ZTREE_COMPRESS_RANK, the rank lives in the parent pointer
+	[[no_unique_address]] std::conditional_t<Options::ztree_compress_rank,
+	                                         NoRankField, RankT> rank;
+
+	template <class URBG>
+	static RankT draw_rank(URBG && g) noexcept;
+	static std::uint64_t draw_secondary() noexcept;
+	static RankT add_secondary(RankT primary, std::uint64_t secondary) noexcept;
 };
 
+// The number of bytes of a rank stored in a node
+template <class Options>
+constexpr size_t
+stored_rank_bytes()
+{
+	if constexpr (Options::ztree_store_rank) {
+		return sizeof(typename Options::ztree_rank_type::type);
+	} else {
+		return 0;
+	}
+}
+
+// Whether the ranks stored in nodes can be packed into a parent pointer
+template <class Options>
+constexpr bool
+has_byte_rank_type()
+{
+	if constexpr (Options::ztree_store_rank) {
+		return std::is_same_v<typename Options::ztree_rank_type::type,
+		                      std::uint8_t>;
+	} else {
+		return false;
+	}
+}
+
 template <class Node, class Options>
 class ZTreeRankGenerator<Node, Options, false, false> {
 	// Build a static assertion that always fails, but
@@ -98,8 +235,13 @@ class ZTreeRankGenerator<Node, Options, false, false> {
  * be inserted into. See ZTree for details.
  */
 template <class Node, class Options, class Tag>
-class ZTreeNodeBase : public bst::BSTNodeBase<Node, Options, Tag> {
+class ZTreeNodeBase
+    : public bst::BSTNodeBase<
+          Node, Options, Tag,
+          ztree_internal::ZTreeParentContainerFor<Node, Options>> {
 public:
+	ZTreeNodeBase() noexcept;
+
 	// Debugging methods
 	size_t get_depth() const noexcept;
 	auto dbg_get_rank() const noexcept;
@@ -132,8 +274,9 @@ private:
 	template <class, class, bool, bool>
 	friend class ztree_internal::ZTreeRankGenerator;
 
-	ztree_internal::ZTreeRankGenerator<Node, Options, Options::ztree_use_hash,
-	                                   Options::ztree_store_rank>
+	// Takes no space if ZTREE_COMPRESS_RANK is set
+	[[no_unique_address]] ztree_internal::ZTreeRankGenerator<
+	    Node, Options, Options::ztree_use_hash, Options::ztree_store_rank>
 	    _zt_rank;
 };
 
@@ -166,6 +309,19 @@ public:
     (void) left_spine_end;
     (void) right_spine_end;
   }
+
+  /*
+   * Called instead of the unzipping callbacks if the new node became a leaf
+   */
+  void inserted_without_unzipping(Node * n) const noexcept {(void)n;}
+
+  /*
+   * Called bottom-up for every node whose subtrees have been exchanged
+   * during bulk construction, splitting, joining and the set operations, and
+   * for a node whose key update_key() changed in place and its ancestors.
+   * Without parent pointers, this is only called during bulk construction.
+   */
+  void children_changed(Node * n) const noexcept {(void)n;}
 	// clang-format on
 };
 
@@ -199,10 +355,15 @@ template <
     class Tag = int, class Compare = ygg::utilities::flexible_less,
     class RankGetter = ztree_internal::ZTreeRankGenerator<
         Node, Options, Options::ztree_use_hash, Options::ztree_store_rank>>
-class ZTree : public bst::BinarySearchTree<Node, Options, Tag, Compare> {
+class ZTree
+    : public bst::BinarySearchTree<
+          Node, Options, Tag, Compare,
+          ztree_internal::ZTreeParentContainerFor<Node, Options>> {
 public:
 	using NB = ZTreeNodeBase<Node, Options, Tag>;
-	using TB = bst::BinarySearchTree<Node, Options, Tag, Compare>;
+	using TB = bst::BinarySearchTree<
+	    Node, Options, Tag, Compare,
+	    ztree_internal::ZTreeParentContainerFor<Node, Options>>;
 	using MyClass = ZTree<Node, NodeTraits, Options, Tag, Compare, RankGetter>;
 
 	/**********************************************
@@ -211,6 +372,32 @@ public:
 	static_assert(
 	    Options::ztree_store_rank || Options::ztree_use_hash,
 	    "ZipTrees need to have either ZTREE_RANK_TYPE or ZTREE_USE_HASH set");
+	static_assert(!Options::compress_duplicates,
+	              "COMPRESS_DUPLICATES is currently only supported by the RBTree");
+	static_assert(!Options::ztree_zipzip_ranks ||
+	                  (Options::ztree_store_rank && !Options::ztree_use_hash),
+	              "ZTREE_ZIPZIP_RANKS requires ZTREE_RANK_TYPE and can not be "
+	              "combined with ZTREE_USE_HASH");
+	static_assert(!Options::ztree_zipzip_ranks ||
+	                  (ztree_internal::zipzip_secondary_rank_bits<Options>() >=
+	                   16 - ztree_internal::ZTREE_PRIMARY_RANK_BITS),
+	              "ZTREE_ZIPZIP_RANKS requires a rank type with at least 16 value "
+	              "bits");
+	static_assert(!Options::ztree_fast_random_ranks ||
+	                  (Options::ztree_store_rank && !Options::ztree_use_hash),
+	              "ZTREE_FAST_RANDOM_RANKS requires ZTREE_RANK_TYPE and can not "
+	              "be combined with ZTREE_USE_HASH");
+	static_assert(!Options::ztree_compress_rank ||
+	                  ztree_internal::has_byte_rank_type<Options>(),
+	              "ZTREE_COMPRESS_RANK requires ZTREE_RANK_TYPE<std::uint8_t>");
+	static_assert(!Options::ztree_compress_rank ||
+	                  !(Options::ztree_zipzip_ranks ||
+	                    Options::no_parent_pointers ||
+	                    Options::pool_relative_links),
+	              "ZTREE_COMPRESS_RANK can not be combined with "
+	              "ZTREE_ZIPZIP_RANKS, NO_PARENT_POINTERS or POOL_RELATIVE_LINKS");
+	static_assert(!Options::ztree_compress_rank || sizeof(void *) == 8,
+	              "ZTREE_COMPRESS_RANK requires 64-bit pointers");
 
 	/**
 	 * @brief Construct a new empty Zip Tree.
@@ -265,15 +452,89 @@ public:
 	void insert(Node & node) noexcept;
 	void insert(Node & node, Node & hint) noexcept;
 
+	/**
+	 * @brief Inserts <node> at a position found by find_or_prepare_insert()
+	 *
+	 * Inserts <node> without searching for its position again. <node> must
+	 * compare equally to the query that was passed to find_or_prepare_insert(),
+	 * the handle must not refer to an existing node (i.e., handle.found() must
+	 * be false) and the tree must not have been modified since the handle was
+	 * created.
+	 *
+	 * The rank of <node> determines how far up the search path <node> must be
+	 * placed. Since the search path is not stored, it is walked up via the
+	 * parent pointers. If NO_PARENT_POINTERS is set, this falls back to
+	 * insert().
+	 *
+	 * @param handle  The insertion position returned by find_or_prepare_insert()
+	 * @param node    The node to be inserted
+	 */
+	void insert_at(const typename TB::InsertHandle & handle, Node & node)
+	    noexcept;
+
 	/**
 	 * @brief Removes <node> from the tree
 	 *
-	 * Removes <node> from the tree.
+	 * Removes <node> from the tree. If NO_PARENT_POINTERS is set, the node's
+	 * parent must first be searched, which takes O(log n). Erasing via an
+	 * iterator avoids that.
 	 *
 	 * @param   Node  The node to be removed.
 	 */
 	void remove(Node & node) CMP_NOEXCEPT(node);
 
+	/**
+	 * @brief Removes the smallest node from the tree
+	 *
+	 * Removes the smallest node from the tree and returns it. If the
+	 * CACHED_EXTREMES option is set and NO_PARENT_POINTERS is not, the node is
+	 * not searched and this runs in O(1) amortized expected time. Otherwise,
+	 * this takes O(log n).
+	 *
+	 * @return The removed node, or nullptr if the tree was empty
+	 */
+	Node * pop_front();
+
+	/**
+	 * @brief Removes the largest node from the tree
+	 *
+	 * Removes the largest node from the tree and returns it. If the
+	 * CACHED_EXTREMES option is set and NO_PARENT_POINTERS is not, the node is
+	 * not searched and this runs in O(1) amortized expected time. Otherwise,
+	 * this takes O(log n).
+	 *
+	 * @return The removed node, or nullptr if the tree was empty
+	 */
+	Node * pop_back();
+
+	/**
+	 * @brief Changes the key of <node>, which is in the tree
+	 *
+	 * Calls <mutator> with <node> as only argument. <mutator> may change the
+	 * key of the node. The node is only relinked if it is out of order with its
+	 * in-order predecessor or successor afterwards, or if its rank changed. In
+	 * that case, its new position is searched starting from the neighbor it
+	 * moved past. See RBTree::update_key() for details.
+	 *
+	 * If ranks are computed from hashes and stored (i.e., TreeFlags::
+	 * ZTREE_USE_HASH and TreeFlags::ZTREE_RANK_TYPE are set), the stored rank is
+	 * updated after <mutator> has been called.
+	 *
+	 * If the node stays in place, the zipping callbacks of the NodeTraits are
+	 * not called. Instead, NodeTraits::children_changed() is called for the
+	 * node and all its ancestors in O(log n), so that data derived from the
+	 * keys is recomputed. Without parent pointers, it is not called, as for
+	 * all other operations except bulk construction.
+	 *
+	 * @warning If NO_PARENT_POINTERS is set, the node is always re-inserted
+	 * from the root if it has to be relinked.
+	 *
+	 * @param node     The node whose key should be changed
+	 * @param mutator  A callable that is passed <node> and changes its key
+	 */
+	template <class Mutator>
+	void update_key(Node & node, Mutator && mutator);
+
 	/**
 	 * @brief Deletes a node that compares equally to <c> from the tree
 	 *
@@ -318,6 +579,233 @@ public:
 	utilities::select_type_t<const iterator<reverse>, Node *, Options::stl_erase>
 	erase(const iterator<reverse> & it) CMP_NOEXCEPT(*it);
 
+	/**
+	 * @brief Builds the tree from a sorted range of nodes
+	 *
+	 * Replaces the contents of the tree with the nodes in [first, last). The
+	 * nodes must already be sorted with respect to the tree's Compare. Since the
+	 * shape of a zip tree is determined by the ranks of its nodes, the tree is
+	 * built as the Cartesian tree of the ranks, using a stack along the
+	 * right spine. This runs in O(n). Any nodes previously contained in the tree
+	 * are discarded (as if clear() had been called).
+	 *
+	 * If the tree allows for multiple equal elements, nodes that compare equal
+	 * may be reordered among themselves, just as insert() would do.
+	 *
+	 * @param first   Forward iterator to the first node. Dereferencing it must
+	 * yield a Node &. The range is traversed more than once.
+	 * @param last    Iterator past the last node.
+	 */
+	template <class ForwardIt>
+	void build_from_sorted(ForwardIt first, ForwardIt last) CMP_NOEXCEPT(*first);
+
+	/**
+	 * @brief Splits the tree at <key>
+	 *
+	 * All nodes that are less than <key> remain in this tree, all other nodes
+	 * are moved into <right>, which must be empty.
+	 *
+	 * If CONSTANT_TIME_SIZE is set, this runs in expected O(log n + m), where m
+	 * is the size of the smaller resulting tree, since the sizes of the
+	 * resulting trees must be counted. Otherwise, it only unzips the search
+	 * path of <key> and runs in expected O(log n).
+	 *
+	 * @param key     Anything comparable to a Node. See BinarySearchTree::find()
+	 * for details.
+	 * @param right   An empty tree that receives all nodes not less than
+	 * <key>.
+	 */
+	template <class Comparable>
+	void split(const Comparable & key, MyClass & right) CMP_NOEXCEPT(key);
+
+	/**
+	 * @brief Appends a tree to this tree
+	 *
+	 * Moves all nodes of <right> into this tree. Every node in <right> must be
+	 * greater than every node in this tree - note that in contrast to the other
+	 * trees, equal nodes are not allowed across the two trees, since zip trees
+	 * never store equal nodes as right children of each other. Afterwards,
+	 * <right> is empty. This zips the right spine of this tree with the left
+	 * spine of <right> and thus runs in expected O(log n).
+	 *
+	 * The variant taking a <pivot> additionally inserts <pivot>, which must not
+	 * be contained in any tree and must be greater than every node in this tree
+	 * and less than every node in <right>.
+	 *
+	 * Note that the zipping callbacks of the NodeTraits are not called while
+	 * splitting or joining trees.
+	 *
+	 * @param right   The tree whose nodes should be appended.
+	 */
+	void join(MyClass & right) noexcept;
+	void join(Node & pivot, MyClass & right) noexcept;
+
+	/**
+	 * @brief Moves all nodes of <other> into this tree
+	 *
+	 * Computes the union of this tree and <other> using the join-based
+	 * divide-and-conquer algorithm, which takes expected O(m log(n/m + 1)) time
+	 * for trees of sizes m <= n. If MULTIPLE is not set, nodes of <other> for
+	 * which an equal node exists in this tree are not moved, but remain in
+	 * <other>. Otherwise, <other> is empty afterwards. Since the ranks of equal
+	 * nodes cannot be merged by zipping, such nodes of <other> are then inserted
+	 * one by one.
+	 *
+	 * On the topmost <parallel_depth> levels of the recursion, the two halves are
+	 * processed in parallel, using up to 2^<parallel_depth> threads. Comparisons
+	 * must not throw in that case. The zipping callbacks of the NodeTraits are
+	 * not called.
+	 *
+	 * @param other           The tree whose nodes should be moved into this tree.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void union_with(MyClass & other, unsigned int parallel_depth = 0)
+	    CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes that have no equal node in <other>
+	 *
+	 * Afterwards, this tree contains exactly the nodes for which an equal node
+	 * exists in <other>. All other nodes are moved into <removed>. Any nodes
+	 * previously contained in <removed> are discarded. <other> is not modified.
+	 * This takes expected O(m log(n/m + 1)) time for trees of sizes m <= n, see
+	 * union_with() for the meaning of <parallel_depth>.
+	 *
+	 * Note that if CONSTANT_TIME_SIZE is set, the sizes of the resulting trees
+	 * must be counted, which takes time linear in the size of the smaller of the
+	 * two.
+	 *
+	 * @param other           The tree to intersect this tree with.
+	 * @param removed         The tree that receives all removed nodes.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void intersect_with(const MyClass & other, MyClass & removed,
+	                    unsigned int parallel_depth = 0) CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes that have an equal node in <other>
+	 *
+	 * The removed nodes are moved into <removed>, any nodes previously contained
+	 * in <removed> are discarded. <other> is not modified. See intersect_with()
+	 * for details.
+	 *
+	 * @param other           The tree whose nodes should be subtracted.
+	 * @param removed         The tree that receives all removed nodes.
+	 * @param parallel_depth  The number of recursion levels that start an
+	 * additional thread.
+	 */
+	void difference_with(const MyClass & other, MyClass & removed,
+	                     unsigned int parallel_depth = 0)
+	    CMP_NOEXCEPT(*other.root);
+
+	/**
+	 * @brief Removes all nodes in the range [<lo>, <hi>)
+	 *
+	 * All nodes that are not less than <lo> but less than <hi> are moved into
+	 * <removed>. Any nodes previously contained in <removed> are discarded.
+	 * This takes expected O(log n + k) time for k removed nodes.
+	 *
+	 * The range is split out of the tree and the remainder is joined again in
+	 * expected O(log n). The O(k) term is for counting the removed nodes if
+	 * CONSTANT_TIME_SIZE is set. Without CONSTANT_TIME_SIZE, this takes
+	 * expected O(log n) time, independent of k.
+	 *
+	 * The variant taking a <disposer> instead calls it for every removed node (as
+	 * Node &) in order, taking expected O(log n + k) time. The links of a node are
+	 * not accessed anymore once the disposer has been called on it, so the
+	 * disposer may e.g. destroy the node.
+	 *
+	 * @param lo        Anything comparable to a Node. The inclusive lower bound
+	 * of the range.
+	 * @param hi        Anything comparable to a Node. The exclusive upper bound
+	 * of the range.
+	 * @param removed   The tree that receives all removed nodes.
+	 */
+	template <class Comparable1, class Comparable2>
+	void erase_range(const Comparable1 & lo, const Comparable2 & hi,
+	                 MyClass & removed);
+	template <class Comparable1, class Comparable2, class Disposer>
+	void erase_range(const Comparable1 & lo, const Comparable2 & hi,
+	                 Disposer && disposer);
+
+	/**
+	 * @brief Moves all nodes into <arena>, in van Emde Boas order
+	 *
+	 * Copies the nodes of the tree into the contiguous buffer <arena> and makes
+	 * the copies the nodes of the tree. The nodes are placed in van Emde Boas
+	 * order: the upper half of the levels of the tree is laid out recursively,
+	 * followed by every subtree hanging off it, from left to right. Thus, any
+	 * search touches only O(log_B n) cache lines or pages, whatever their size B.
+	 * This takes expected O(n log log n) time and O(n) additional space and is
+	 * meant to be run in quiet periods, e.g. after the tree has been built.
+	 *
+	 * Every node is moved into the arena via its move assignment operator. The
+	 * tree's own node base (i.e., its rank) is copied separately.
+	 * Afterwards, <relocate> is called as relocate(Node & old_node, Node &
+	 * new_node) for every node, so that external references can be updated.
+	 * The old nodes are not part of the tree anymore at that point, and are not
+	 * accessed after <relocate> has been called on them, so it may e.g. destroy
+	 * them.
+	 *
+	 * The nodes must not be part of any other tree. If hash-based ranks
+	 * are used, the hash must not depend on the node's address. If
+	 * POOL_RELATIVE_LINKS is set, the arena must be part of the pool.
+	 *
+	 * @param arena     Pointer to an array of at least size() nodes that are
+	 * not part of any tree. It must not overlap with the tree's nodes.
+	 * @param relocate  Called for every node after it has been moved.
+	 */
+	template <class Relocate>
+	void relayout(Node * arena, Relocate && relocate);
+
+	/**
+	 * @brief Writes the structure of the tree to <out>
+	 *
+	 * Writes a compact binary description of the tree's shape to <out>: For
+	 * every node in pre-order, its index relative to <nodes>, which of its
+	 * children exist and, if ranks are stored in the nodes, its rank. The nodes
+	 * themselves are not written, you must persist them yourself, e.g. as an
+	 * array. This takes O(n) time.
+	 *
+	 * Together with the nodes, the structure allows restore_structure() to
+	 * rebuild the tree in O(n) time, without comparing any nodes. For n nodes
+	 * spread over less than 2^32 array slots, 16 + (5 + r)n bytes are written,
+	 * where r is the size of the rank type (zero if ranks are not stored). See
+	 * bst::StructureHeader for the format.
+	 *
+	 * @param nodes   The start of the array that all nodes of the tree are in
+	 * @param out     The stream to write the structure to
+	 */
+	void write_structure(const Node * nodes, std::ostream & out) const;
+
+	/**
+	 * @brief Restores a tree from its structure written by write_structure()
+	 *
+	 * Makes this tree the tree that write_structure() described, with its nodes
+	 * taken from the array <nodes> at the written indices. Stored ranks are
+	 * restored as well. Nodes that were in this tree before are not part of it
+	 * anymore (and not touched). The structure is read strictly sequentially,
+	 * so it can e.g. be mapped from a file via mmap(). This takes O(n) time and
+	 * expected O(log n) additional space, and does not compare any nodes.
+	 * NodeTraits::children_changed() is called on every node, children before
+	 * parents.
+	 *
+	 * The nodes must be equal to the ones the structure was written from, in
+	 * the same order. Only the format of <data> and the indices are checked,
+	 * not whether the tree is a valid tree. If the check fails, the tree is
+	 * empty afterwards.
+	 *
+	 * @param nodes       The start of the array the tree's nodes are taken from
+	 * @param node_count  The number of nodes in the array
+	 * @param data        The structure written by write_structure()
+	 * @param bytes       The size of <data> in bytes
+	 * @return Whether <data> was a valid structure
+	 */
+	bool restore_structure(Node * nodes, size_t node_count, const void * data,
+	                       size_t bytes);
+
 	// Debugging methods
 	void dbg_verify() const;
 	void dbg_print_rank_stats() const;
@@ -334,7 +822,33 @@ public:
 
 private:
 	void unzip(Node & oldn, Node & newn) noexcept;
-	void zip(Node & old_root) noexcept;
+	void zip(Node & old_root, Node * parent) noexcept;
+
+	void link_sorted(Node & node, std::vector<Node *> & right_spine)
+	    CMP_NOEXCEPT(node);
+
+	// Splitting and joining
+	template <bool on_equality_prefer_left, class Comparable>
+	void unzip_subtree(Node * sub_root, const Comparable & key, Node *& left,
+	                   Node *& right) CMP_NOEXCEPT(key);
+	static Node * zip_subtrees(Node * left, Node * right) noexcept;
+	static Node * zip_subtrees(Node * left, Node & pivot, Node * right) noexcept;
+	// Calls children_changed() on <node> and all of its ancestors. This is a
+	// no-op without parent pointers.
+	static void children_changed_upwards(Node * node) noexcept;
+
+	// Set operations
+	void union_subtrees(Node * a, Node * b, Node *& result, Node *& dups,
+	                    size_t & dup_count, unsigned int parallel_depth)
+	    CMP_NOEXCEPT(*b);
+	template <bool keep_equal>
+	void filter_subtree(Node * a, const Node * b, Node *& kept, Node *& removed,
+	                    unsigned int parallel_depth) CMP_NOEXCEPT(*b);
+	template <bool keep_equal>
+	void filter(const MyClass & other, MyClass & removed,
+	            unsigned int parallel_depth) CMP_NOEXCEPT(*other.root);
+	template <class Comparable1, class Comparable2>
+	Node * cut_range(const Comparable1 & lo, const Comparable2 & hi);
 
 	// Debugging methods
 	void dbg_verify_consistency(Node * sub_root, Node * lower_bound,
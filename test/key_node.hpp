@@ -0,0 +1,73 @@
+#ifndef YGG_TEST_KEY_NODE_HPP
+#define YGG_TEST_KEY_NODE_HPP
+
+#include "../src/rbtree.hpp"
+#include "../src/wbtree.hpp"
+#include "../src/ziptree.hpp"
+
+namespace ygg {
+namespace testing {
+namespace utilities {
+
+/* A node with an int key, which is also comparable to plain ints. <Base> is
+ * the node base class of the tree (which itself needs the final node class). */
+template <class Base>
+class KeyNode : public Base {
+public:
+	int key;
+
+	KeyNode() : key(0){};
+	explicit KeyNode(int key_in) : key(key_in){};
+
+	bool
+	operator<(const KeyNode & other) const
+	{
+		return this->key < other.key;
+	}
+};
+
+template <class Base>
+bool
+operator<(const KeyNode<Base> & lhs, int rhs)
+{
+	return lhs.key < rhs;
+}
+template <class Base>
+bool
+operator<(int lhs, const KeyNode<Base> & rhs)
+{
+	return lhs < rhs.key;
+}
+
+/* Key nodes for the three trees, and trees of them with the default node
+ * traits. Use these to run a typed test suite on all three trees with the
+ * same set of options. */
+template <class Options>
+class RBKeyNode : public KeyNode<RBTreeNodeBase<RBKeyNode<Options>, Options>> {
+public:
+	using KeyNode<RBTreeNodeBase<RBKeyNode<Options>, Options>>::KeyNode;
+};
+template <class Options>
+class WBKeyNode : public KeyNode<WBTreeNodeBase<WBKeyNode<Options>, Options>> {
+public:
+	using KeyNode<WBTreeNodeBase<WBKeyNode<Options>, Options>>::KeyNode;
+};
+template <class Options>
+class ZKeyNode : public KeyNode<ZTreeNodeBase<ZKeyNode<Options>, Options>> {
+public:
+	using KeyNode<ZTreeNodeBase<ZKeyNode<Options>, Options>>::KeyNode;
+};
+
+template <class Options>
+using RBKeyTree = RBTree<RBKeyNode<Options>, RBDefaultNodeTraits, Options>;
+template <class Options>
+using WBKeyTree = WBTree<WBKeyNode<Options>, WBDefaultNodeTraits, Options>;
+template <class Options>
+using ZKeyTree =
+    ZTree<ZKeyNode<Options>, ZTreeDefaultNodeTraits<ZKeyNode<Options>>, Options>;
+
+} // namespace utilities
+} // namespace testing
+} // namespace ygg
+
+#endif // YGG_TEST_KEY_NODE_HPP
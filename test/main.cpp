@@ -1,10 +1,17 @@
 #include <gtest/gtest.h>
 
+#include "test_augmentation.hpp"
+#include "test_cached_extremes.hpp"
+#include "test_compressed_duplicates.hpp"
 #include "test_dynamic_segment_tree.hpp"
 #include "test_intervaltree.hpp"
 #include "test_list.hpp"
 #include "test_multi_rbtree.hpp"
+#include "test_node_pool.hpp"
 #include "test_rbtree.hpp"
+#include "test_search_snapshot.hpp"
+#include "test_sharded_tree.hpp"
+#include "test_threaded.hpp"
 #include "test_ziptree.hpp"
 #include "test_energy.hpp"
 #include "test_wbtree.hpp"
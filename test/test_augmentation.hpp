@@ -0,0 +1,321 @@
+#ifndef YGG_TEST_AUGMENTATION_HPP
+#define YGG_TEST_AUGMENTATION_HPP
+
+#include "../src/augmentation.hpp"
+#include "../src/rbtree.hpp"
+#include "../src/wbtree.hpp"
+#include "../src/ziptree.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace ygg {
+namespace testing {
+namespace augmentation {
+
+constexpr size_t AUGMENTATION_TESTSIZE = 2000;
+constexpr size_t AUGMENTATION_SEED = 4;
+
+using RBOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE>;
+using WBOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE>;
+using ZOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::ZTREE_RANK_TYPE<int>>;
+
+/* A polynomial hash of the sequence of values. Combining is not commutative,
+ * so this also checks that the values are combined in the right order. */
+class HashMonoid {
+public:
+	using value_type = std::pair<uint64_t, uint64_t>;
+
+	static value_type
+	identity()
+	{
+		return {0, 1};
+	}
+
+	static value_type
+	combine(const value_type & lhs, const value_type & rhs)
+	{
+		return {lhs.first * rhs.second + rhs.first, lhs.second * rhs.second};
+	}
+
+	template <class Node>
+	static value_type
+	get_value(const Node & n)
+	{
+		return {n.value, 31};
+	}
+};
+
+template <class Base>
+class KeyValueNode : public Base, public AugmentedNodeBase<HashMonoid> {
+public:
+	int key;
+	uint64_t value;
+
+	KeyValueNode() : key(0), value(0){};
+	KeyValueNode(int key_in, uint64_t value_in) : key(key_in), value(value_in){};
+
+	bool
+	operator<(const KeyValueNode & other) const
+	{
+		return this->key < other.key;
+	}
+};
+
+template <class Base>
+bool
+operator<(const KeyValueNode<Base> & lhs, int rhs)
+{
+	return lhs.key < rhs;
+}
+template <class Base>
+bool
+operator<(int lhs, const KeyValueNode<Base> & rhs)
+{
+	return lhs < rhs.key;
+}
+
+class RBNode : public KeyValueNode<RBTreeNodeBase<RBNode, RBOptions>> {
+public:
+	using KeyValueNode::KeyValueNode;
+};
+class WBNode : public KeyValueNode<WBTreeNodeBase<WBNode, WBOptions>> {
+public:
+	using KeyValueNode::KeyValueNode;
+};
+class ZNode : public KeyValueNode<ZTreeNodeBase<ZNode, ZOptions>> {
+public:
+	using KeyValueNode::KeyValueNode;
+};
+
+using RBT = RBTree<RBNode, RBAugmentedNodeTraits<HashMonoid>, RBOptions>;
+using WBT = WBTree<WBNode, WBAugmentedNodeTraits<HashMonoid>, WBOptions>;
+using ZT =
+    ZTree<ZNode, ZAugmentedNodeTraits<ZNode, ZOptions, HashMonoid>, ZOptions>;
+
+template <class Tree>
+class AugmentationTest : public ::testing::Test {
+};
+
+using TreeTypes = ::testing::Types<RBT, WBT, ZT>;
+TYPED_TEST_SUITE(AugmentationTest, TreeTypes);
+
+template <class Tree>
+HashMonoid::value_type
+naive_aggregate(Tree & t, int lo, int hi)
+{
+	HashMonoid::value_type result = HashMonoid::identity();
+	for (auto & n : t) {
+		if ((n.key >= lo) && (n.key < hi)) {
+			result = HashMonoid::combine(result, HashMonoid::get_value(n));
+		}
+	}
+	return result;
+}
+
+template <class Node, class NB>
+HashMonoid::value_type
+verify_aggregates(const Node * n)
+{
+	if (n == nullptr) {
+		return HashMonoid::identity();
+	}
+
+	auto expected = HashMonoid::combine(
+	    HashMonoid::combine(verify_aggregates<Node, NB>(n->NB::get_left()),
+	                        HashMonoid::get_value(*n)),
+	    verify_aggregates<Node, NB>(n->NB::get_right()));
+	EXPECT_EQ(n->get_aggregate(), expected);
+	return expected;
+}
+
+template <class Tree>
+void
+verify_tree(Tree & t)
+{
+	using Node = typename Tree::NodeT;
+	t.dbg_verify();
+	verify_aggregates<Node, typename Tree::NB>(t.get_root());
+	Aggregator<Tree, HashMonoid> agg(t);
+	ASSERT_EQ(agg.total(),
+	          naive_aggregate(t, -1, static_cast<int>(AUGMENTATION_TESTSIZE)));
+}
+
+TYPED_TEST(AugmentationTest, EmptyTest)
+{
+	using Tree = TypeParam;
+	Tree t;
+	Aggregator<Tree, HashMonoid> agg(t);
+
+	ASSERT_EQ(agg.total(), HashMonoid::identity());
+	ASSERT_EQ(agg.aggregate(0, 100), HashMonoid::identity());
+}
+
+TYPED_TEST(AugmentationTest, InsertRemoveTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(AUGMENTATION_SEED);
+	// Use a small key range to get many duplicates
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(AUGMENTATION_TESTSIZE / 4));
+	std::uniform_int_distribution<uint64_t> value_dist(1, 1000);
+
+	std::vector<Node> nodes;
+	nodes.reserve(AUGMENTATION_TESTSIZE);
+	for (size_t i = 0; i < AUGMENTATION_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng), value_dist(rng));
+	}
+
+	Tree t;
+	Aggregator<Tree, HashMonoid> agg(t);
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		t.insert(nodes[i]);
+		if (i % 100 == 0) {
+			verify_tree(t);
+		}
+	}
+	verify_tree(t);
+
+	for (int i = 0; i < 1000; ++i) {
+		int lo = key_dist(rng) - 2;
+		int hi = lo + key_dist(rng) / 4;
+		ASSERT_EQ(agg.aggregate(lo, hi), naive_aggregate(t, lo, hi));
+	}
+
+	std::vector<Node *> to_remove;
+	for (auto & n : nodes) {
+		to_remove.push_back(&n);
+	}
+	std::shuffle(to_remove.begin(), to_remove.end(), rng);
+	for (size_t i = 0; i < to_remove.size() / 2; ++i) {
+		t.remove(*to_remove[i]);
+		if (i % 100 == 0) {
+			verify_tree(t);
+		}
+	}
+	verify_tree(t);
+
+	for (int i = 0; i < 1000; ++i) {
+		int lo = key_dist(rng) - 2;
+		int hi = lo + key_dist(rng) / 4;
+		ASSERT_EQ(agg.aggregate(lo, hi), naive_aggregate(t, lo, hi));
+	}
+}
+
+TYPED_TEST(AugmentationTest, RefreshTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::vector<Node> nodes;
+	for (int i = 0; i < 500; ++i) {
+		nodes.emplace_back(i, static_cast<uint64_t>(i));
+	}
+
+	Tree t;
+	Aggregator<Tree, HashMonoid> agg(t);
+	for (auto & n : nodes) {
+		t.insert(n);
+	}
+
+	for (size_t i = 0; i < nodes.size(); i += 7) {
+		nodes[i].value += 1000;
+		agg.refresh(nodes[i]);
+	}
+	verify_tree(t);
+	ASSERT_EQ(agg.aggregate(100, 200), naive_aggregate(t, 100, 200));
+
+	// update_key() keeps the aggregates intact, whether the node moves or
+	// stays in place
+	for (size_t i = 0; i < nodes.size(); i += 3) {
+		t.update_key(nodes[i],
+		             [&](Node & node) { node.key = (node.key * 17) % 503; });
+	}
+	verify_tree(t);
+	ASSERT_EQ(agg.aggregate(100, 200), naive_aggregate(t, 100, 200));
+	for (size_t i = 1; i < nodes.size(); i += 3) {
+		t.update_key(nodes[i], [&](Node & node) { node.value += 7; });
+	}
+	verify_tree(t);
+	ASSERT_EQ(agg.aggregate(100, 200), naive_aggregate(t, 100, 200));
+}
+
+TYPED_TEST(AugmentationTest, BulkOperationsTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(AUGMENTATION_SEED);
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(AUGMENTATION_TESTSIZE / 2));
+	std::uniform_int_distribution<uint64_t> value_dist(1, 1000);
+
+	std::vector<Node> nodes;
+	nodes.reserve(AUGMENTATION_TESTSIZE);
+	for (size_t i = 0; i < AUGMENTATION_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng), value_dist(rng));
+	}
+	std::sort(nodes.begin(), nodes.end());
+
+	Tree t;
+	t.build_from_sorted(nodes.begin(), nodes.end());
+	verify_tree(t);
+
+	// Split and join
+	Tree right;
+	t.split(static_cast<int>(AUGMENTATION_TESTSIZE / 4), right);
+	verify_tree(t);
+	verify_tree(right);
+	t.join(right);
+	verify_tree(t);
+
+	// Set operations
+	Tree other;
+	for (size_t i = 0; i < AUGMENTATION_TESTSIZE / 2; ++i) {
+		t.remove(nodes[i * 2]);
+		other.insert(nodes[i * 2]);
+	}
+	verify_tree(t);
+	verify_tree(other);
+
+	Tree removed;
+	t.intersect_with(other, removed);
+	verify_tree(t);
+	verify_tree(removed);
+	t.union_with(removed);
+	verify_tree(t);
+	t.difference_with(other, removed);
+	verify_tree(t);
+	verify_tree(removed);
+	t.union_with(removed);
+	verify_tree(t);
+
+	// Range erasure
+	Tree erased;
+	t.erase_range(100, 300, erased);
+	verify_tree(t);
+	verify_tree(erased);
+
+	Aggregator<Tree, HashMonoid> agg(t);
+	for (int i = 0; i < 1000; ++i) {
+		int lo = key_dist(rng) - 2;
+		int hi = lo + key_dist(rng) / 4;
+		ASSERT_EQ(agg.aggregate(lo, hi), naive_aggregate(t, lo, hi));
+	}
+}
+
+} // namespace augmentation
+} // namespace testing
+} // namespace ygg
+
+#endif // YGG_TEST_AUGMENTATION_HPP
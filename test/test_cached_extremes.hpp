@@ -0,0 +1,213 @@
+#ifndef YGG_TEST_CACHED_EXTREMES_HPP
+#define YGG_TEST_CACHED_EXTREMES_HPP
+
+#include "../src/rbtree.hpp"
+#include "../src/wbtree.hpp"
+#include "../src/ziptree.hpp"
+#include "key_node.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace ygg {
+namespace testing {
+namespace cached_extremes {
+
+constexpr size_t EXTREMES_TESTSIZE = 2000;
+constexpr size_t EXTREMES_SEED = 4;
+
+using RBOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::CACHED_EXTREMES>;
+using WBOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::CACHED_EXTREMES, TreeFlags::THREADED>;
+using ZOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::ZTREE_RANK_TYPE<int>, TreeFlags::CACHED_EXTREMES>;
+using ZNoParentOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::ZTREE_RANK_TYPE<int>, TreeFlags::CACHED_EXTREMES,
+                TreeFlags::NO_PARENT_POINTERS<>>;
+
+using RBT = utilities::RBKeyTree<RBOptions>;
+using WBT = utilities::WBKeyTree<WBOptions>;
+using ZT = utilities::ZKeyTree<ZOptions>;
+using ZNoParentT = utilities::ZKeyTree<ZNoParentOptions>;
+
+template <class Tree>
+class CachedExtremesTest : public ::testing::Test {
+};
+
+using TreeTypes = ::testing::Types<RBT, WBT, ZT, ZNoParentT>;
+TYPED_TEST_SUITE(CachedExtremesTest, TreeTypes);
+
+template <class Tree>
+void
+verify_extremes(Tree & t, const std::multiset<int> & keys)
+{
+	t.dbg_verify();
+	if (keys.empty()) {
+		ASSERT_TRUE(t.begin() == t.end());
+		ASSERT_TRUE(t.rbegin() == t.rend());
+	} else {
+		ASSERT_EQ(t.begin()->key, *keys.begin());
+		ASSERT_EQ(t.rbegin()->key, *keys.rbegin());
+	}
+}
+
+TYPED_TEST(CachedExtremesTest, PriorityQueueTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(EXTREMES_SEED);
+	// Use a small key range to get many duplicates
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(EXTREMES_TESTSIZE / 4));
+
+	std::vector<Node> nodes;
+	nodes.reserve(EXTREMES_TESTSIZE);
+	for (size_t i = 0; i < EXTREMES_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng));
+	}
+
+	Tree t;
+	std::multiset<int> keys;
+	ASSERT_EQ(t.pop_front(), nullptr);
+	ASSERT_EQ(t.pop_back(), nullptr);
+
+	// Interleave insertions with popping from both ends
+	size_t next = 0;
+	std::uniform_int_distribution<int> op_dist(0, 3);
+	while (next < nodes.size()) {
+		int op = op_dist(rng);
+		if ((op <= 1) || keys.empty()) {
+			t.insert(nodes[next]);
+			keys.insert(nodes[next].key);
+			next++;
+		} else if (op == 2) {
+			Node * popped = t.pop_front();
+			ASSERT_NE(popped, nullptr);
+			ASSERT_EQ(popped->key, *keys.begin());
+			keys.erase(keys.begin());
+		} else {
+			Node * popped = t.pop_back();
+			ASSERT_NE(popped, nullptr);
+			ASSERT_EQ(popped->key, *keys.rbegin());
+			keys.erase(std::prev(keys.end()));
+		}
+		verify_extremes(t, keys);
+	}
+
+	// Drain the queue
+	while (!keys.empty()) {
+		Node * popped = t.pop_front();
+		ASSERT_NE(popped, nullptr);
+		ASSERT_EQ(popped->key, *keys.begin());
+		keys.erase(keys.begin());
+	}
+	verify_extremes(t, keys);
+	ASSERT_EQ(t.pop_front(), nullptr);
+}
+
+TYPED_TEST(CachedExtremesTest, RemoveExtremesTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::vector<Node> nodes;
+	for (int i = 0; i < 200; ++i) {
+		nodes.emplace_back(i);
+	}
+
+	Tree t;
+	std::multiset<int> keys;
+	for (auto & n : nodes) {
+		t.insert(n);
+		keys.insert(n.key);
+		verify_extremes(t, keys);
+	}
+
+	// Removing the extremes by other means must update the cache
+	for (int i = 0; i < 50; ++i) {
+		t.remove(nodes[static_cast<size_t>(i)]);
+		keys.erase(keys.find(i));
+		verify_extremes(t, keys);
+
+		t.erase(199 - i);
+		keys.erase(keys.find(199 - i));
+		verify_extremes(t, keys);
+	}
+}
+
+TYPED_TEST(CachedExtremesTest, BulkOperationsTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(EXTREMES_SEED);
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(EXTREMES_TESTSIZE / 2));
+
+	std::vector<Node> nodes;
+	nodes.reserve(EXTREMES_TESTSIZE);
+	for (size_t i = 0; i < EXTREMES_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng));
+	}
+	std::sort(nodes.begin(), nodes.end());
+
+	Tree t;
+	t.build_from_sorted(nodes.begin(), nodes.end());
+	t.dbg_verify();
+
+	Tree right;
+	t.split(static_cast<int>(EXTREMES_TESTSIZE / 4), right);
+	t.dbg_verify();
+	right.dbg_verify();
+	t.join(right);
+	t.dbg_verify();
+	right.dbg_verify();
+
+	Tree other;
+	for (size_t i = 0; i < EXTREMES_TESTSIZE / 2; ++i) {
+		t.remove(nodes[i * 2]);
+		other.insert(nodes[i * 2]);
+	}
+	t.dbg_verify();
+	other.dbg_verify();
+
+	Tree removed;
+	t.intersect_with(other, removed);
+	t.dbg_verify();
+	removed.dbg_verify();
+	t.union_with(removed);
+	t.dbg_verify();
+	removed.dbg_verify();
+	t.difference_with(other, removed);
+	t.dbg_verify();
+	removed.dbg_verify();
+	t.union_with(removed);
+	t.dbg_verify();
+
+	Tree erased;
+	t.erase_range(0, 100, erased);
+	t.dbg_verify();
+	erased.dbg_verify();
+	t.erase_range(900, 2000, erased);
+	t.dbg_verify();
+	erased.dbg_verify();
+
+	t.clear();
+	t.dbg_verify();
+	ASSERT_EQ(t.pop_back(), nullptr);
+}
+
+} // namespace cached_extremes
+} // namespace testing
+} // namespace ygg
+
+#endif // YGG_TEST_CACHED_EXTREMES_HPP
@@ -0,0 +1,579 @@
+#ifndef YGG_TEST_COMPRESSED_DUPLICATES_HPP
+#define YGG_TEST_COMPRESSED_DUPLICATES_HPP
+
+#include "../src/augmentation.hpp"
+#include "../src/rbtree.hpp"
+#include "key_node.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace ygg {
+namespace testing {
+namespace compressed_duplicates {
+
+constexpr size_t COMPRESSED_TESTSIZE = 2000;
+constexpr size_t COMPRESSED_SEED = 4;
+
+using PlainOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE>;
+using CompressedOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::COMPRESS_DUPLICATES>;
+using CompressedExtremesOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::COMPRESS_DUPLICATES, TreeFlags::CACHED_EXTREMES,
+                TreeFlags::COMPRESS_COLOR>;
+
+using PlainT = utilities::RBKeyTree<PlainOptions>;
+using CompressedT = utilities::RBKeyTree<CompressedOptions>;
+using CompressedExtremesT = utilities::RBKeyTree<CompressedExtremesOptions>;
+
+template <class Tree>
+class CompressedDuplicatesTest : public ::testing::Test {
+};
+
+using TreeTypes = ::testing::Types<PlainT, CompressedT, CompressedExtremesT>;
+TYPED_TEST_SUITE(CompressedDuplicatesTest, TreeTypes);
+
+template <class Node>
+std::vector<int>
+keys_of(const std::vector<Node *> & nodes)
+{
+	std::vector<int> keys;
+	for (const Node * n : nodes) {
+		keys.push_back(n->key);
+	}
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+/* Compares iteration in both directions, count() and equal_range() to the
+ * keys expected in the tree. */
+template <class Tree>
+void
+verify_tree(Tree & t, const std::vector<int> & expected)
+{
+	t.dbg_verify();
+	ASSERT_EQ(t.size(), expected.size());
+
+	std::vector<int> forward;
+	for (auto & n : t) {
+		forward.push_back(n.key);
+	}
+	ASSERT_EQ(forward, expected);
+
+	std::vector<int> backward;
+	for (auto it = t.rbegin(); it != t.rend(); ++it) {
+		backward.push_back(it->key);
+	}
+	std::reverse(backward.begin(), backward.end());
+	ASSERT_EQ(backward, expected);
+
+	std::map<int, size_t> counts;
+	for (int key : expected) {
+		counts[key]++;
+	}
+	for (auto [key, count] : counts) {
+		ASSERT_EQ(t.count(key), count);
+
+		auto range = t.equal_range(key);
+		ASSERT_EQ(static_cast<size_t>(std::distance(range.first, range.second)),
+		          count);
+		ASSERT_EQ(range.first->key, key);
+		ASSERT_TRUE(range.first == t.lower_bound(key));
+		ASSERT_TRUE(range.second == t.upper_bound(key));
+		ASSERT_TRUE(t.find(key) == range.first);
+	}
+
+	// Keys that are not in the tree
+	ASSERT_EQ(t.count(-1), 0u);
+	auto range = t.equal_range(-1);
+	ASSERT_TRUE(range.first == range.second);
+	ASSERT_TRUE(range.first == t.begin());
+}
+
+TYPED_TEST(CompressedDuplicatesTest, InsertRemoveTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(COMPRESSED_SEED);
+	// Use a small key range to get large groups
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(COMPRESSED_TESTSIZE / 20));
+
+	std::vector<Node> nodes;
+	nodes.reserve(COMPRESSED_TESTSIZE);
+	for (size_t i = 0; i < COMPRESSED_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng));
+	}
+
+	Tree t;
+	std::vector<Node *> in_tree;
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		if (i % 3 == 0) {
+			t.insert(nodes[i]);
+		} else if (i % 3 == 1) {
+			auto handle = t.find_or_prepare_insert(nodes[i]);
+			if (handle.found()) {
+				t.insert(nodes[i]);
+			} else {
+				t.insert_at(handle, nodes[i]);
+			}
+		} else if constexpr (Tree::OptionsT::compress_duplicates) {
+			// Hint at a node that is probably a duplicate
+			auto hint = t.iterator_to(*in_tree[in_tree.size() / 2]);
+			t.insert(nodes[i], hint);
+		} else {
+			t.insert(nodes[i]);
+		}
+		in_tree.push_back(&nodes[i]);
+		if (i % 100 == 0) {
+			verify_tree(t, keys_of(in_tree));
+		}
+	}
+	verify_tree(t, keys_of(in_tree));
+
+	// Hinted searches starting at duplicates
+	for (size_t i = 0; i < in_tree.size(); i += 7) {
+		auto hint = t.iterator_to(*in_tree[i]);
+		int query = key_dist(rng);
+		ASSERT_TRUE(t.lower_bound(query, hint) == t.lower_bound(query));
+		ASSERT_TRUE(t.upper_bound(query, hint) == t.upper_bound(query));
+	}
+
+	// Removes representatives as well as duplicates
+	std::shuffle(in_tree.begin(), in_tree.end(), rng);
+	for (size_t i = 0; i < COMPRESSED_TESTSIZE / 2; ++i) {
+		t.remove(*in_tree.back());
+		in_tree.pop_back();
+		if (i % 100 == 0) {
+			verify_tree(t, keys_of(in_tree));
+		}
+	}
+	verify_tree(t, keys_of(in_tree));
+
+	// Nodes change their groups
+	for (size_t i = 0; i < in_tree.size(); i += 5) {
+		t.update_key(*in_tree[i], [](Node & n) { n.key = (n.key * 7) % 101; });
+	}
+	verify_tree(t, keys_of(in_tree));
+
+	// Removing a whole group by key
+	int erased_key = in_tree.front()->key;
+	while (t.count(erased_key) > 0) {
+		Node * erased = t.erase(erased_key);
+		ASSERT_EQ(erased->key, erased_key);
+	}
+	in_tree.erase(std::remove_if(in_tree.begin(), in_tree.end(),
+	                             [&](Node * n) { return n->key == erased_key; }),
+	              in_tree.end());
+	verify_tree(t, keys_of(in_tree));
+}
+
+TYPED_TEST(CompressedDuplicatesTest, UpdateKeyTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::vector<Node> nodes;
+	for (int key : {0, 10, 10, 10, 20, 30}) {
+		nodes.emplace_back(key);
+	}
+	Tree t;
+	for (auto & n : nodes) {
+		t.insert(n);
+	}
+	auto expected_keys = [&]() {
+		std::vector<int> keys;
+		for (const auto & n : nodes) {
+			keys.push_back(n.key);
+		}
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	};
+	auto order = [&]() {
+		std::vector<const Node *> visited;
+		for (const auto & n : t) {
+			visited.push_back(&n);
+		}
+		return visited;
+	};
+
+	// Stays between its neighbors
+	t.update_key(nodes[0], [](Node & n) { n.key = 5; });
+	verify_tree(t, expected_keys());
+
+	// Joins the group of its predecessor
+	t.update_key(nodes[5], [](Node & n) { n.key = 20; });
+	verify_tree(t, expected_keys());
+
+	// Stays in its group, at its position
+	auto before = order();
+	t.update_key(nodes[2], [](Node &) {});
+	ASSERT_EQ(order(), before);
+	t.update_key(nodes[1], [](Node &) {});
+	ASSERT_EQ(order(), before);
+	verify_tree(t, expected_keys());
+
+	// Leaves its group, as duplicate and as representative
+	t.update_key(nodes[2], [](Node & n) { n.key = 15; });
+	verify_tree(t, expected_keys());
+	t.update_key(nodes[1], [](Node & n) { n.key = 25; });
+	verify_tree(t, expected_keys());
+
+	// Moves far, alone and into a distant group
+	t.update_key(nodes[3], [](Node & n) { n.key = 100; });
+	verify_tree(t, expected_keys());
+	t.update_key(nodes[0], [](Node & n) { n.key = 20; });
+	verify_tree(t, expected_keys());
+	ASSERT_EQ(t.count(20), size_t{3});
+}
+
+TYPED_TEST(CompressedDuplicatesTest, PopTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::vector<Node> nodes;
+	for (int i = 0; i < 300; ++i) {
+		nodes.emplace_back(i % 10);
+	}
+
+	Tree t;
+	std::vector<int> keys;
+	for (auto & n : nodes) {
+		t.insert(n);
+		keys.push_back(n.key);
+	}
+	std::sort(keys.begin(), keys.end());
+	verify_tree(t, keys);
+
+	// Equal nodes must leave in the order in which iteration visits them
+	while (!keys.empty()) {
+		Node * first = &(*t.begin());
+		Node * front = t.pop_front();
+		ASSERT_EQ(front, first);
+		ASSERT_EQ(front->key, keys.front());
+		keys.erase(keys.begin());
+
+		if (!keys.empty()) {
+			Node * last = &(*t.rbegin());
+			Node * back = t.pop_back();
+			ASSERT_EQ(back, last);
+			ASSERT_EQ(back->key, keys.back());
+			keys.pop_back();
+		}
+		verify_tree(t, keys);
+	}
+	ASSERT_EQ(t.pop_front(), nullptr);
+}
+
+TYPED_TEST(CompressedDuplicatesTest, BulkOperationsTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(COMPRESSED_SEED);
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(COMPRESSED_TESTSIZE / 10));
+
+	std::vector<Node> nodes;
+	nodes.reserve(COMPRESSED_TESTSIZE);
+	for (size_t i = 0; i < COMPRESSED_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng));
+	}
+	std::sort(nodes.begin(), nodes.end());
+
+	std::vector<Node *> all;
+	for (auto & n : nodes) {
+		all.push_back(&n);
+	}
+
+	Tree t;
+	t.build_from_sorted(nodes.begin(), nodes.end());
+	verify_tree(t, keys_of(all));
+
+	// Split and join
+	int split_key = static_cast<int>(COMPRESSED_TESTSIZE / 40);
+	std::vector<Node *> lower;
+	std::vector<Node *> upper;
+	for (Node * n : all) {
+		if (n->key < split_key) {
+			lower.push_back(n);
+		} else {
+			upper.push_back(n);
+		}
+	}
+
+	Tree right;
+	t.split(split_key, right);
+	verify_tree(t, keys_of(lower));
+	verify_tree(right, keys_of(upper));
+	t.join(right);
+	verify_tree(t, keys_of(all));
+
+	t.split(split_key, right);
+	Node & pivot = *lower.back();
+	t.remove(pivot);
+	t.join(pivot, right);
+	verify_tree(t, keys_of(all));
+
+	// Joining trees that both contain the largest key of the left tree
+	t.split(split_key, right);
+	for (size_t i = 0; i < 3; ++i) {
+		right.remove(*upper[i]);
+		upper[i]->key = lower.back()->key;
+		right.insert(*upper[i]);
+	}
+	verify_tree(right, keys_of(upper));
+	t.join(right);
+	verify_tree(t, keys_of(all));
+	ASSERT_EQ(right.size(), 0u);
+
+	// Set operations
+	Tree other;
+	std::vector<Node *> in_t;
+	std::vector<Node *> in_other;
+	for (size_t i = 0; i < all.size(); ++i) {
+		if (i % 2 == 0) {
+			t.remove(*all[i]);
+			other.insert(*all[i]);
+			in_other.push_back(all[i]);
+		} else {
+			in_t.push_back(all[i]);
+		}
+	}
+	verify_tree(t, keys_of(in_t));
+	verify_tree(other, keys_of(in_other));
+
+	Tree removed;
+	t.intersect_with(other, removed);
+	t.dbg_verify();
+	removed.dbg_verify();
+	ASSERT_EQ(t.size() + removed.size(), in_t.size());
+	t.union_with(removed);
+	verify_tree(t, keys_of(in_t));
+
+	t.difference_with(other, removed);
+	t.dbg_verify();
+	removed.dbg_verify();
+	t.union_with(removed);
+	verify_tree(t, keys_of(in_t));
+
+	t.union_with(other);
+	verify_tree(t, keys_of(all));
+	for (Node * n : in_other) {
+		t.remove(*n);
+		other.insert(*n);
+	}
+	verify_tree(t, keys_of(in_t));
+
+	// Range erasure
+	std::vector<Node *> outside;
+	std::vector<Node *> inside;
+	for (Node * n : in_t) {
+		if ((n->key >= 20) && (n->key < 60)) {
+			inside.push_back(n);
+		} else {
+			outside.push_back(n);
+		}
+	}
+
+	Tree erased;
+	t.erase_range(20, 60, erased);
+	verify_tree(t, keys_of(outside));
+	verify_tree(erased, keys_of(inside));
+
+	std::vector<int> disposed;
+	erased.erase_range(0, 40, [&](Node & n) { disposed.push_back(n.key); });
+	std::vector<int> remaining;
+	for (Node * n : inside) {
+		if (n->key >= 40) {
+			remaining.push_back(n->key);
+		}
+	}
+	std::sort(remaining.begin(), remaining.end());
+	verify_tree(erased, remaining);
+	ASSERT_EQ(disposed.size() + remaining.size(), inside.size());
+}
+
+TYPED_TEST(CompressedDuplicatesTest, RelayoutTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::vector<Node> nodes;
+	for (int i = 0; i < 1000; ++i) {
+		nodes.emplace_back((i * 7) % 100);
+	}
+
+	Tree t;
+	std::vector<int> keys;
+	for (auto & n : nodes) {
+		t.insert(n);
+		keys.push_back(n.key);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	// Every node, including the duplicates, must be moved
+	std::vector<Node> arena(nodes.size());
+	size_t relocated = 0;
+	t.relayout(arena.data(), [&](Node & old_node, Node & new_node) {
+		ASSERT_EQ(old_node.key, new_node.key);
+		relocated++;
+	});
+	ASSERT_EQ(relocated, nodes.size());
+	verify_tree(t, keys);
+	for (auto & n : t) {
+		ASSERT_GE(&n, arena.data());
+		ASSERT_LT(&n, arena.data() + arena.size());
+	}
+
+	while (!keys.empty()) {
+		Node * front = t.pop_front();
+		ASSERT_EQ(front->key, keys.front());
+		keys.erase(keys.begin());
+	}
+	verify_tree(t, keys);
+}
+
+TYPED_TEST(CompressedDuplicatesTest, StructureTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::vector<Node> nodes;
+	std::vector<Node> copies;
+	for (int i = 0; i < 1000; ++i) {
+		nodes.emplace_back((i * 7) % 100);
+		copies.emplace_back((i * 7) % 100);
+	}
+
+	Tree t;
+	std::vector<int> keys;
+	for (auto & n : nodes) {
+		t.insert(n);
+		keys.push_back(n.key);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	// Duplicates must be restored into their groups
+	std::ostringstream out;
+	t.write_structure(nodes.data(), out);
+	const std::string data = out.str();
+	Tree restored;
+	ASSERT_TRUE(restored.restore_structure(copies.data(), copies.size(),
+	                                       data.data(), data.size()));
+	verify_tree(restored, keys);
+
+	auto it = t.begin();
+	for (auto & n : restored) {
+		ASSERT_EQ(&n - copies.data(), &(*it) - nodes.data());
+		++it;
+	}
+
+	while (!keys.empty()) {
+		Node * front = restored.pop_front();
+		ASSERT_EQ(front->key, keys.front());
+		keys.erase(keys.begin());
+	}
+	verify_tree(restored, keys);
+}
+
+class SumMonoid {
+public:
+	using value_type = size_t;
+
+	static value_type
+	identity()
+	{
+		return 0;
+	}
+
+	static value_type
+	combine(const value_type & lhs, const value_type & rhs)
+	{
+		return lhs + rhs;
+	}
+
+	template <class Node>
+	static value_type
+	get_value(const Node & n)
+	{
+		return n.value;
+	}
+};
+
+class AugmentedNode
+    : public utilities::KeyNode<
+          RBTreeNodeBase<AugmentedNode, CompressedOptions>>,
+      public AugmentedNodeBase<SumMonoid> {
+public:
+	size_t value = 0;
+};
+
+// Checks the aggregate of every tree node against its subtree and returns it
+size_t
+verify_aggregates(const AugmentedNode * n)
+{
+	if (n == nullptr) {
+		return 0;
+	}
+	size_t sum = verify_aggregates(n->get_left()) + n->value +
+	             verify_aggregates(n->get_right());
+	EXPECT_EQ(n->get_aggregate(), sum);
+	return sum;
+}
+
+TEST(CompressedDuplicatesAugmentationTest, PromotionTest)
+{
+	using Tree = RBTree<AugmentedNode, RBAugmentedNodeTraits<SumMonoid>,
+	                    CompressedOptions>;
+
+	std::vector<AugmentedNode> nodes(COMPRESSED_TESTSIZE);
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		nodes[i].key = static_cast<int>(i % 50);
+		nodes[i].value = i;
+	}
+	std::shuffle(nodes.begin(), nodes.end(), std::mt19937(COMPRESSED_SEED));
+
+	Tree t;
+	for (auto & n : nodes) {
+		t.insert(n);
+	}
+	verify_aggregates(t.get_root());
+
+	// Representatives that stay in their group keep the aggregates intact
+	for (int key = 0; key < 50; key += 3) {
+		t.update_key(*t.find(key), [](AugmentedNode & n) { n.value += 1000; });
+	}
+	verify_aggregates(t.get_root());
+
+	// Removing the representatives promotes another node of each group into
+	// the tree, which carries a different value.
+	while (!t.empty()) {
+		auto it = t.find(static_cast<int>(t.size() % 50));
+		if (it == t.end()) {
+			it = t.begin();
+		}
+		t.remove(*it);
+		t.dbg_verify();
+		verify_aggregates(t.get_root());
+		if (::testing::Test::HasFailure()) {
+			break;
+		}
+	}
+}
+
+} // namespace compressed_duplicates
+} // namespace testing
+} // namespace ygg
+
+#endif // YGG_TEST_COMPRESSED_DUPLICATES_HPP
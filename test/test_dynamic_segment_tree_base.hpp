@@ -509,6 +509,75 @@ TEST(__DST_BASENAME(DynSegTreeTest), ComprehensiveTest)
 	checker(deleted);
 }
 
+TEST(__DST_BASENAME(DynSegTreeTest), BuildTest)
+{
+	constexpr int size = DYNSEGTREE_COMPREHENSIVE_TESTSIZE;
+	constexpr int max_point = 10 * size;
+	std::mt19937 rng(DYNSEGTREE_SEED + 2);
+	std::uniform_int_distribution<int> bounds_distr(0, max_point / 2);
+
+	std::vector<__DST_BASENAME(Node)> built_nodes;
+	std::vector<__DST_BASENAME(Node)> inserted_nodes;
+	built_nodes.reserve(2 * size);
+	inserted_nodes.reserve(2 * size);
+	for (int i = 0; i < 2 * size; ++i) {
+		int lower = bounds_distr(rng);
+		int upper = lower + 1 + bounds_distr(rng);
+		// Use negative values, too, so that the maximum is not always found at
+		// the same place
+		built_nodes.emplace_back(lower, upper, i - size / 2);
+		inserted_nodes.emplace_back(lower, upper, i - size / 2);
+	}
+
+	__DST_BASENAME(DynSegTree) built;
+	__DST_BASENAME(DynSegTree) inserted;
+
+	// Building an empty tree must work
+	built.build(built_nodes.begin(), built_nodes.begin());
+	ASSERT_TRUE(built.empty());
+
+	built.build(built_nodes.begin(), built_nodes.begin() + size);
+	for (int i = 0; i < size; ++i) {
+		inserted.insert(inserted_nodes[static_cast<size_t>(i)]);
+	}
+
+	auto compare = [&]() {
+		built.dbg_verify();
+		built.dbg_verify_max_combiner<MCombiner>();
+
+		for (int x = 0; x <= max_point; ++x) {
+			ASSERT_EQ(built.query(x), inserted.query(x));
+		}
+		ASSERT_EQ(built.get_combined<MCombiner>(),
+		          inserted.get_combined<MCombiner>());
+		auto built_rm = built.get_combiner<RMCombiner>();
+		auto inserted_rm = inserted.get_combiner<RMCombiner>();
+		ASSERT_EQ(built_rm.get(), inserted_rm.get());
+		ASSERT_EQ(built_rm.get_left_border(), inserted_rm.get_left_border());
+		ASSERT_EQ(built_rm.get_right_border(), inserted_rm.get_right_border());
+	};
+	compare();
+
+	// The built tree must remain fully functional
+	for (int i = 0; i < size; i += 2) {
+		built.remove(built_nodes[static_cast<size_t>(i)]);
+		inserted.remove(inserted_nodes[static_cast<size_t>(i)]);
+	}
+	for (int i = size; i < 2 * size; ++i) {
+		built.insert(built_nodes[static_cast<size_t>(i)]);
+		inserted.insert(inserted_nodes[static_cast<size_t>(i)]);
+	}
+	compare();
+
+	// Rebuilding discards the previous contents
+	inserted.clear();
+	for (int i = size / 2; i < 2 * size; ++i) {
+		inserted.insert(inserted_nodes[static_cast<size_t>(i)]);
+	}
+	built.build(built_nodes.begin() + size / 2, built_nodes.end());
+	compare();
+}
+
 TEST(__DST_BASENAME(DynSegTreeTest), ComprehensiveCombinerTest)
 {
 	std::mt19937 rng(DYNSEGTREE_SEED + 1);
@@ -4,6 +4,7 @@
 #include "../src/intervaltree.hpp"
 #include "randomizer.hpp"
 
+#include <sstream>
 #include <unordered_set>
 
 namespace ygg {
@@ -199,6 +200,88 @@ TEST(ITreeTest, RandomInsertionRandomDeletionTest)
 	}
 }
 
+TEST(ITreeTest, BuildFromSortedTest)
+{
+	auto tree = IntervalTree<ITNode, MyNodeTraits<ITNode>>();
+
+	std::vector<ITNode> nodes(IT_TESTSIZE);
+	std::mt19937 rng(4); // chosen by fair xkcd
+
+	for (unsigned int i = 0; i < IT_TESTSIZE; ++i) {
+		std::uniform_int_distribution<unsigned int> bounds_distr(
+		    0, std::numeric_limits<unsigned int>::max() / 2);
+		unsigned int lower = bounds_distr(rng);
+		unsigned int upper = lower + bounds_distr(rng);
+
+		nodes[i] = ITNode(lower, upper, static_cast<int>(i));
+	}
+
+	std::sort(nodes.begin(), nodes.end(),
+	          [](const ITNode & lhs, const ITNode & rhs) {
+		          return lhs.lower < rhs.lower;
+	          });
+
+	tree.build_from_sorted(nodes.begin(), nodes.end());
+	ASSERT_TRUE(tree.verify_integrity());
+
+	// The maxima must be kept up to date after the bulk construction
+	for (unsigned int i = 0; i < IT_TESTSIZE; i += 2) {
+		tree.remove(nodes[i]);
+		ASSERT_TRUE(tree.verify_integrity());
+	}
+	for (unsigned int i = 0; i < IT_TESTSIZE; i += 2) {
+		tree.insert(nodes[i]);
+		ASSERT_TRUE(tree.verify_integrity());
+	}
+}
+
+TEST(ITreeTest, StructureTest)
+{
+	auto tree = IntervalTree<ITNode, MyNodeTraits<ITNode>>();
+
+	std::vector<ITNode> nodes(IT_TESTSIZE);
+	std::mt19937 rng(4);
+	std::uniform_int_distribution<unsigned int> bounds_distr(0, 10000);
+	for (unsigned int i = 0; i < IT_TESTSIZE; ++i) {
+		unsigned int lower = bounds_distr(rng);
+		unsigned int upper = lower + bounds_distr(rng) / 10;
+		nodes[i] = ITNode(lower, upper, static_cast<int>(i));
+		tree.insert(nodes[i]);
+	}
+
+	std::ostringstream out;
+	tree.write_structure(nodes.data(), out);
+	const std::string data = out.str();
+
+	// The copy constructor copies neither links nor the interval maxima
+	std::vector<ITNode> copies(nodes);
+	auto restored = IntervalTree<ITNode, MyNodeTraits<ITNode>>();
+	ASSERT_TRUE(restored.restore_structure(copies.data(), copies.size(),
+	                                       data.data(), data.size()));
+	ASSERT_TRUE(restored.verify_integrity());
+
+	for (unsigned int i = 0; i < 100; ++i) {
+		unsigned int lower = bounds_distr(rng);
+		Interval q(lower, lower + bounds_distr(rng) / 100);
+		std::vector<int> expected;
+		for (auto & n : tree.query(q)) {
+			expected.push_back(n.data);
+		}
+		std::vector<int> found;
+		for (auto & n : restored.query(q)) {
+			ASSERT_GE(&n, copies.data());
+			ASSERT_LT(&n, copies.data() + IT_TESTSIZE);
+			found.push_back(n.data);
+		}
+		ASSERT_EQ(found, expected);
+	}
+
+	for (unsigned int i = 0; i < IT_TESTSIZE; i += 2) {
+		restored.remove(copies[i]);
+	}
+	ASSERT_TRUE(restored.verify_integrity());
+}
+
 TEST(ITreeTest, TrivialQueryTest)
 {
 	auto tree = IntervalTree<ITNode, MyNodeTraits<ITNode>>();
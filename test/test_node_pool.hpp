@@ -0,0 +1,232 @@
+#ifndef YGG_TEST_NODE_POOL_HPP
+#define YGG_TEST_NODE_POOL_HPP
+
+#include "../src/node_pool.hpp"
+#include "../src/rbtree.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace ygg {
+namespace testing {
+namespace node_pool {
+
+constexpr size_t POOL_TESTSIZE = 5000;
+constexpr size_t POOL_SEED = 4;
+
+using PoolOptions = TreeOptions<TreeFlags::MULTIPLE>;
+
+class PoolNode : public RBTreeNodeBase<PoolNode, PoolOptions> {
+public:
+	int key;
+
+	explicit PoolNode(int key_in) : key(key_in)
+	{
+		if (key_in < 0) {
+			throw std::invalid_argument("negative key");
+		}
+	};
+
+	bool
+	operator<(const PoolNode & other) const
+	{
+		return this->key < other.key;
+	}
+};
+
+using PoolTree = RBTree<PoolNode, RBDefaultNodeTraits, PoolOptions>;
+
+TEST(NodePoolTest, CreateDestroyReuseTest)
+{
+	NodePool<PoolNode> pool;
+	ASSERT_EQ(pool.size(), 0);
+	ASSERT_EQ(pool.capacity(), 0);
+
+	std::vector<PoolNode *> nodes;
+	for (int i = 0; i < static_cast<int>(POOL_TESTSIZE); ++i) {
+		nodes.push_back(pool.create(i));
+	}
+	ASSERT_EQ(pool.size(), POOL_TESTSIZE);
+	size_t capacity = pool.capacity();
+	ASSERT_GE(capacity, POOL_TESTSIZE);
+
+	for (int i = 0; i < static_cast<int>(POOL_TESTSIZE); ++i) {
+		ASSERT_EQ(nodes[static_cast<size_t>(i)]->key, i);
+	}
+
+	// Destroying and re-creating must reuse the freed memory
+	std::vector<PoolNode *> freed;
+	for (size_t i = 0; i < POOL_TESTSIZE; i += 2) {
+		freed.push_back(nodes[i]);
+		pool.destroy(nodes[i]);
+	}
+	ASSERT_EQ(pool.size(), POOL_TESTSIZE / 2);
+
+	std::vector<PoolNode *> recreated;
+	for (size_t i = 0; i < freed.size(); ++i) {
+		recreated.push_back(pool.create(42));
+	}
+	ASSERT_EQ(pool.capacity(), capacity);
+	ASSERT_EQ(pool.size(), POOL_TESTSIZE);
+
+	std::sort(freed.begin(), freed.end());
+	std::sort(recreated.begin(), recreated.end());
+	ASSERT_EQ(freed, recreated);
+}
+
+TEST(NodePoolTest, StableAddressesTest)
+{
+	// Tiny chunks force many chunks to be allocated
+	NodePool<PoolNode> pool(NodePoolBacking::HEAP, 10 * sizeof(PoolNode));
+
+	std::vector<PoolNode *> nodes;
+	for (int i = 0; i < static_cast<int>(POOL_TESTSIZE); ++i) {
+		nodes.push_back(pool.create(i));
+	}
+	ASSERT_GE(pool.capacity(), POOL_TESTSIZE);
+
+	// No node overlaps another one
+	std::vector<PoolNode *> sorted = nodes;
+	std::sort(sorted.begin(), sorted.end());
+	for (size_t i = 1; i < sorted.size(); ++i) {
+		ASSERT_GE(reinterpret_cast<char *>(sorted[i]) -
+		              reinterpret_cast<char *>(sorted[i - 1]),
+		          static_cast<ptrdiff_t>(sizeof(PoolNode)));
+	}
+
+	for (int i = 0; i < static_cast<int>(POOL_TESTSIZE); ++i) {
+		ASSERT_EQ(nodes[static_cast<size_t>(i)]->key, i);
+	}
+
+	for (auto n : nodes) {
+		pool.destroy(n);
+	}
+	ASSERT_EQ(pool.size(), 0);
+}
+
+TEST(NodePoolTest, CreateNearTest)
+{
+	constexpr size_t per_chunk = 16;
+	NodePool<PoolNode> pool(NodePoolBacking::HEAP, per_chunk * sizeof(PoolNode));
+
+	std::vector<PoolNode *> nodes;
+	for (int i = 0; i < static_cast<int>(10 * per_chunk); ++i) {
+		nodes.push_back(pool.create(i));
+	}
+	ASSERT_EQ(pool.capacity(), 10 * per_chunk);
+
+	// Free one slot in the first chunk, then a few in the last one. A plain
+	// create() would take one of the latter.
+	PoolNode * first = nodes[0];
+	pool.destroy(nodes[1]);
+	for (size_t i = 9 * per_chunk; i < 9 * per_chunk + 4; ++i) {
+		pool.destroy(nodes[i]);
+	}
+
+	PoolNode * near = pool.create_near(*first, 1);
+	ASSERT_EQ(near, nodes[1]);
+	ASSERT_EQ(near->key, 1);
+
+	// The first chunk is full now, so this falls back to create()
+	PoolNode * other = pool.create_near(*first, 2);
+	ASSERT_GE(other, nodes[9 * per_chunk]);
+	ASSERT_LT(other, nodes[9 * per_chunk + 4]);
+	ASSERT_EQ(pool.capacity(), 10 * per_chunk);
+}
+
+TEST(NodePoolTest, ThrowingConstructorTest)
+{
+	NodePool<PoolNode> pool;
+	PoolNode * a = pool.create(1);
+	ASSERT_THROW(pool.create(-1), std::invalid_argument);
+	ASSERT_EQ(pool.size(), 1);
+
+	// The slot of the failed construction is reused
+	PoolNode * b = pool.create(2);
+	ASSERT_EQ(b, a + 1);
+}
+
+TEST(NodePoolTest, HugePageBackingTest)
+{
+	for (auto backing : {NodePoolBacking::TRANSPARENT_HUGE_PAGES,
+	                     NodePoolBacking::HUGETLB}) {
+		NodePool<PoolNode> pool(backing);
+#if defined(__linux__)
+		ASSERT_NE(pool.get_backing(), NodePoolBacking::HEAP);
+#endif
+
+		std::vector<PoolNode *> nodes;
+		for (int i = 0; i < static_cast<int>(POOL_TESTSIZE); ++i) {
+			nodes.push_back(pool.create(i));
+		}
+		for (int i = 0; i < static_cast<int>(POOL_TESTSIZE); ++i) {
+			ASSERT_EQ(nodes[static_cast<size_t>(i)]->key, i);
+		}
+		for (auto n : nodes) {
+			pool.destroy(n);
+		}
+	}
+}
+
+TEST(NodePoolTest, TreeTest)
+{
+	NodePool<PoolNode> pool(NodePoolBacking::TRANSPARENT_HUGE_PAGES);
+	std::mt19937 rng(POOL_SEED);
+	std::uniform_int_distribution<int> key_dist(0, 1000);
+
+	PoolTree t;
+	std::vector<PoolNode *> nodes;
+	for (size_t i = 0; i < POOL_TESTSIZE; ++i) {
+		PoolNode * n;
+		if (nodes.empty()) {
+			n = pool.create(key_dist(rng));
+		} else {
+			n = pool.create_near(*nodes.back(), key_dist(rng));
+		}
+		t.insert(*n);
+		nodes.push_back(n);
+	}
+	ASSERT_TRUE(t.verify_integrity());
+
+	std::shuffle(nodes.begin(), nodes.end(), rng);
+	for (size_t i = 0; i < POOL_TESTSIZE / 2; ++i) {
+		t.remove(*nodes.back());
+		pool.destroy(nodes.back());
+		nodes.pop_back();
+	}
+	ASSERT_TRUE(t.verify_integrity());
+
+	for (size_t i = 0; i < POOL_TESTSIZE / 2; ++i) {
+		PoolNode * n = pool.create(key_dist(rng));
+		t.insert(*n);
+		nodes.push_back(n);
+	}
+	ASSERT_TRUE(t.verify_integrity());
+	ASSERT_EQ(pool.size(), POOL_TESTSIZE);
+
+	std::vector<int> keys;
+	for (auto n : nodes) {
+		keys.push_back(n->key);
+	}
+	std::sort(keys.begin(), keys.end());
+	auto it = keys.begin();
+	for (auto & n : t) {
+		ASSERT_EQ(n.key, *it);
+		++it;
+	}
+
+	for (auto n : nodes) {
+		t.remove(*n);
+		pool.destroy(n);
+	}
+	ASSERT_TRUE(t.empty());
+}
+
+} // namespace node_pool
+} // namespace testing
+} // namespace ygg
+
+#endif // YGG_TEST_NODE_POOL_HPP
@@ -6,7 +6,10 @@
 
 #include <algorithm>
 #include <gtest/gtest.h>
+#include <iterator>
 #include <random>
+#include <set>
+#include <sstream>
 #include <vector>
 
 namespace ygg {
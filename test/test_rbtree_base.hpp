@@ -621,6 +621,166 @@ TEST(__RBT_BASENAME(RBTreeTest), FindTest)
 	}
 }
 
+TEST(__RBT_BASENAME(RBTreeTest), FindBatchTest)
+{
+	auto tree = RBTree<Node, NodeTraits, __RBT_NONMULTIPLE<>>();
+
+	Node nodes[RBTREE_TESTSIZE];
+
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes[i] = Node(static_cast<int>(2 * i));
+		tree.insert(nodes[i]);
+	}
+
+	// Mix existing and nonexisting queries
+	std::vector<int> queries;
+	for (unsigned int i = 0; i < 2 * RBTREE_TESTSIZE + 1; ++i) {
+		queries.push_back(static_cast<int>(i));
+	}
+	std::shuffle(queries.begin(), queries.end(),
+	             ygg::testing::utilities::Randomizer(RBTREE_SEED));
+
+	std::vector<decltype(tree.end())> results(queries.size());
+	tree.find_batch(queries.begin(), queries.end(), results.begin());
+
+	for (size_t i = 0; i < queries.size(); ++i) {
+		ASSERT_EQ(results[i], tree.find(queries[i]));
+	}
+
+	// Fewer queries than slots
+	tree.find_batch<16>(queries.begin(), queries.begin() + 3, results.begin());
+	for (size_t i = 0; i < 3; ++i) {
+		ASSERT_EQ(results[i], tree.find(queries[i]));
+	}
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), FindOrPrepareInsertTest)
+{
+	auto tree = RBTree<Node, NodeTraits, __RBT_NONMULTIPLE<>>();
+
+	// Every key is offered twice, only one of the nodes may be inserted
+	std::vector<Node> nodes;
+	for (int i = 0; i < 2 * RBTREE_TESTSIZE; ++i) {
+		nodes.emplace_back(i % RBTREE_TESTSIZE);
+	}
+	std::shuffle(nodes.begin(), nodes.end(),
+	             ygg::testing::utilities::Randomizer(RBTREE_SEED));
+
+	for (auto & n : nodes) {
+		auto handle = tree.find_or_prepare_insert(n.data);
+		if (handle.found()) {
+			ASSERT_EQ(handle.get_node()->data, n.data);
+			ASSERT_NE(handle.get_node(), &n);
+		} else {
+			ASSERT_EQ(handle.get_node(), nullptr);
+			tree.insert_at(handle, n);
+		}
+	}
+
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), static_cast<size_t>(RBTREE_TESTSIZE));
+
+	int expected = 0;
+	for (auto & n : tree) {
+		ASSERT_EQ(n.data, expected);
+		expected++;
+	}
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), HintedSearchTest)
+{
+	auto tree = RBTree<MultiNode, MultiNodeTraits, __RBT_MULTIPLE<>>();
+
+	// Every even key appears twice
+	std::vector<MultiNode> nodes;
+	for (int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes.emplace_back((i / 2) * 2);
+	}
+	for (auto & n : nodes) {
+		tree.insert(n);
+	}
+	tree.dbg_verify();
+
+	std::vector<decltype(tree.begin())> hints;
+	for (auto it = tree.begin(); it != tree.end(); ++it) {
+		hints.push_back(it);
+	}
+	hints.push_back(tree.end());
+
+	// Ascending queries with the previous result as hint, as well as hints far
+	// away from the result
+	auto prev_lower = tree.end();
+	auto prev_upper = tree.end();
+	for (int q = -1; q <= RBTREE_TESTSIZE + 1; ++q) {
+		auto lower = tree.lower_bound(q);
+		auto upper = tree.upper_bound(q);
+		auto found = tree.find(q);
+
+		ASSERT_TRUE(tree.lower_bound(q, prev_lower) == lower);
+		ASSERT_TRUE(tree.upper_bound(q, prev_upper) == upper);
+
+		for (size_t i = 0; i < hints.size(); i += 97) {
+			size_t hint_index = (i + static_cast<size_t>(q + 1)) % hints.size();
+			auto hint = hints[hint_index];
+			ASSERT_TRUE(tree.lower_bound(q, hint) == lower);
+			ASSERT_TRUE(tree.upper_bound(q, hint) == upper);
+			if (found == tree.end()) {
+				ASSERT_TRUE(tree.find(q, hint) == tree.end());
+			} else {
+				ASSERT_TRUE(tree.find(q, hint) == lower);
+			}
+		}
+
+		prev_lower = lower;
+		prev_upper = upper;
+	}
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), UpdateKeyTest)
+{
+	auto tree = RBTree<MultiNode, MultiNodeTraits, __RBT_MULTIPLE<>>();
+
+	std::vector<MultiNode> nodes;
+	for (int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes.emplace_back(4 * i);
+	}
+	for (auto & n : nodes) {
+		tree.insert(n);
+	}
+
+	// Mostly small moves, which often keep the node in place, and some far
+	// jumps
+	std::mt19937 rng(RBTREE_SEED);
+	std::uniform_int_distribution<size_t> index_distr(0, nodes.size() - 1);
+	std::uniform_int_distribution<int> small_distr(-6, 6);
+	std::uniform_int_distribution<int> far_distr(-4 * RBTREE_TESTSIZE,
+	                                             4 * RBTREE_TESTSIZE);
+
+	for (int i = 0; i < 2 * RBTREE_TESTSIZE; ++i) {
+		auto & n = nodes[index_distr(rng)];
+		int delta = (i % 4 == 0) ? far_distr(rng) : small_distr(rng);
+		tree.update_key(n, [&](MultiNode & to_change) { to_change.data += delta; });
+
+		if (i % 100 == 0) {
+			tree.dbg_verify();
+		}
+	}
+
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), static_cast<size_t>(RBTREE_TESTSIZE));
+
+	std::vector<int> expected;
+	for (auto & n : nodes) {
+		expected.push_back(n.data);
+	}
+	std::sort(expected.begin(), expected.end());
+	auto expected_it = expected.begin();
+	for (auto & n : tree) {
+		ASSERT_EQ(n.data, *expected_it);
+		++expected_it;
+	}
+}
+
 TEST(__RBT_BASENAME(RBTreeTest), ComprehensiveTest)
 {
 	auto tree = RBTree<Node, NodeTraits, __RBT_NONMULTIPLE<>>();
@@ -761,4 +921,740 @@ TEST(__RBT_BASENAME(RBTreeTest), ComprehensiveMultipleTest)
 		ASSERT_EQ(&(*it), &(persistent_nodes[i]));
 	}
 }
+
+TEST(__RBT_BASENAME(RBTreeTest), OrderQueriesTest)
+{
+	using MyNode = MultiNodeBase<TreeFlags::ORDER_QUERIES>;
+	auto tree = RBTree<MyNode, MultiNodeTraits,
+	                   __RBT_MULTIPLE<TreeFlags::ORDER_QUERIES>>();
+
+	std::vector<MyNode> nodes(RBTREE_TESTSIZE);
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		// Every value appears twice
+		nodes[i].data = static_cast<int>(i / 2);
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(RBTREE_SEED));
+
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+	tree.dbg_verify();
+
+	size_t pos = 0;
+	for (auto & n : tree) {
+		ASSERT_EQ(tree.rank(n), pos);
+		ASSERT_EQ(&(*tree.select(pos)), &n);
+		pos++;
+	}
+	ASSERT_EQ(tree.select(pos), tree.end());
+
+	ASSERT_EQ(tree.count_range(0, RBTREE_TESTSIZE), RBTREE_TESTSIZE);
+	ASSERT_EQ(tree.count_range(3, 3), 2);
+	ASSERT_EQ(tree.count_range(3, 7), 10);
+	ASSERT_EQ(tree.count_range(7, 3), 0);
+	ASSERT_EQ(tree.count_range(-10, -1), 0);
+
+	// Remove every other node, check again
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[indices[i]]);
+		tree.dbg_verify();
+	}
+
+	pos = 0;
+	for (auto & n : tree) {
+		ASSERT_EQ(tree.rank(n), pos);
+		ASSERT_EQ(&(*tree.select(pos)), &n);
+		pos++;
+	}
+	ASSERT_EQ(pos, RBTREE_TESTSIZE / 2);
+	ASSERT_EQ(tree.count_range(0, RBTREE_TESTSIZE), RBTREE_TESTSIZE / 2);
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), OrderQueriesNonMultipleTest)
+{
+	using MyNode = NodeBase<TreeFlags::ORDER_QUERIES>;
+	auto tree = RBTree<MyNode, NodeTraits,
+	                   __RBT_NONMULTIPLE<TreeFlags::ORDER_QUERIES>>();
+
+	std::vector<MyNode> nodes(RBTREE_TESTSIZE);
+	std::vector<MyNode> duplicates(RBTREE_TESTSIZE);
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(2 * i);
+		duplicates[i].data = static_cast<int>(2 * i);
+	}
+
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		tree.insert(nodes[i]);
+		// Must not be inserted, must not change any sizes
+		tree.insert(duplicates[i]);
+	}
+	tree.dbg_verify();
+
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		ASSERT_EQ(tree.rank(nodes[i]), i);
+		ASSERT_EQ(&(*tree.select(i)), &nodes[i]);
+		ASSERT_EQ(tree.count_range(0, static_cast<int>(2 * i)), i + 1);
+		ASSERT_EQ(tree.count_range(0, static_cast<int>(2 * i + 1)), i + 1);
+	}
+
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		tree.erase(static_cast<int>(2 * i));
+		tree.dbg_verify();
+		ASSERT_EQ(tree.count_range(0, 2 * RBTREE_TESTSIZE),
+		          RBTREE_TESTSIZE - i - 1);
+	}
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), BuildFromSortedTest)
+{
+	using MyNode = MultiNodeBase<TreeFlags::ORDER_QUERIES>;
+	using Tree =
+	    RBTree<MyNode, MultiNodeTraits, __RBT_MULTIPLE<TreeFlags::ORDER_QUERIES>>;
+
+	std::vector<MyNode> nodes(RBTREE_TESTSIZE);
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		// Every value appears twice
+		nodes[i].data = static_cast<int>(i / 2);
+		nodes[i].sub_data = static_cast<int>(i);
+	}
+
+	// Test all small sizes (every shape of the last level), and a large one
+	std::vector<size_t> sizes;
+	for (size_t i = 0; i < 70; ++i) {
+		sizes.push_back(i);
+	}
+	sizes.push_back(RBTREE_TESTSIZE);
+
+	Tree tree;
+	for (size_t size : sizes) {
+		// Build on top of the previous tree - its contents must be discarded
+		tree.build_from_sorted(nodes.begin(), nodes.begin() + size);
+		tree.dbg_verify();
+		ASSERT_EQ(tree.size(), size);
+		ASSERT_EQ(tree.empty(), size == 0);
+
+		size_t pos = 0;
+		for (auto & n : tree) {
+			ASSERT_EQ(&n, &nodes[pos]);
+			ASSERT_EQ(tree.rank(n), pos);
+			pos++;
+		}
+		ASSERT_EQ(pos, size);
+	}
+
+	// The built tree must behave like any other tree
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[i]);
+	}
+	tree.dbg_verify();
+	std::vector<MyNode> more_nodes(RBTREE_TESTSIZE / 2);
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE / 2; ++i) {
+		more_nodes[i].data = static_cast<int>(i);
+		tree.insert(more_nodes[i]);
+	}
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE);
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), RelayoutTest)
+{
+	using MyNode = MultiNodeBase<TreeFlags::ORDER_QUERIES>;
+	using Tree =
+	    RBTree<MyNode, MultiNodeTraits, __RBT_MULTIPLE<TreeFlags::ORDER_QUERIES>>;
+
+	// A perfect tree of height four: The top two levels come first, then the
+	// four bottom subtrees from left to right.
+	std::vector<MyNode> small_nodes(15);
+	for (unsigned int i = 0; i < 15; ++i) {
+		small_nodes[i].data = static_cast<int>(i);
+	}
+	Tree small_tree;
+	small_tree.build_from_sorted(small_nodes.begin(), small_nodes.end());
+	std::vector<MyNode> small_arena(15);
+	small_tree.relayout(small_arena.data(), [](MyNode &, MyNode &) {});
+	small_tree.dbg_verify();
+	const std::vector<int> veb{7, 3, 11, 1, 0, 2, 5, 4, 6, 9, 8, 10, 13, 12, 14};
+	for (size_t i = 0; i < 15; ++i) {
+		ASSERT_EQ(small_arena[i].data, veb[i]);
+	}
+
+	std::vector<MyNode> nodes(RBTREE_TESTSIZE);
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i / 2);
+		nodes[i].sub_data = static_cast<int>(i);
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(RBTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	// Colors and subtree sizes are not copied by MyNode's assignment operator
+	std::vector<MyNode> arena(RBTREE_TESTSIZE);
+	std::vector<MyNode *> moved_to(RBTREE_TESTSIZE, nullptr);
+	tree.relayout(arena.data(), [&](MyNode & old_node, MyNode & new_node) {
+		ASSERT_EQ(old_node.sub_data, new_node.sub_data);
+		moved_to[static_cast<size_t>(old_node.sub_data)] = &new_node;
+	});
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE);
+
+	size_t pos = 0;
+	for (auto & n : tree) {
+		ASSERT_GE(&n, arena.data());
+		ASSERT_LT(&n, arena.data() + RBTREE_TESTSIZE);
+		ASSERT_EQ(tree.rank(n), pos);
+		pos++;
+	}
+	ASSERT_EQ(pos, RBTREE_TESTSIZE);
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		ASSERT_NE(moved_to[i], nullptr);
+		ASSERT_EQ(tree.find(static_cast<int>(i / 2))->data,
+		          static_cast<int>(i / 2));
+	}
+
+	// The relaid-out tree must behave like any other tree
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; i += 2) {
+		tree.remove(*moved_to[i]);
+	}
+	tree.dbg_verify();
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; i += 2) {
+		tree.insert(nodes[i]);
+	}
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE);
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), StructureTest)
+{
+	using MyNode = MultiNodeBase<TreeFlags::ORDER_QUERIES>;
+	using Tree =
+	    RBTree<MyNode, MultiNodeTraits, __RBT_MULTIPLE<TreeFlags::ORDER_QUERIES>>;
+
+	std::vector<MyNode> nodes(RBTREE_TESTSIZE);
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i / 2);
+		nodes[i].sub_data = static_cast<int>(i);
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(RBTREE_SEED));
+
+	Tree tree;
+	// Leave out some nodes, they must not end up in the restored tree
+	for (size_t i = 0; i < RBTREE_TESTSIZE - 100; ++i) {
+		tree.insert(nodes[indices[i]]);
+	}
+
+	std::ostringstream out;
+	tree.write_structure(nodes.data(), out);
+	const std::string data = out.str();
+	ASSERT_EQ(data.size(), 16 + 5 * tree.size());
+
+	// MyNode's copy constructor copies neither colors nor links
+	std::vector<MyNode> copies(nodes);
+	Tree restored;
+	ASSERT_TRUE(restored.restore_structure(copies.data(), copies.size(),
+	                                       data.data(), data.size()));
+	restored.dbg_verify();
+	ASSERT_EQ(restored.size(), tree.size());
+
+	auto index_of = [](const auto & vec, const MyNode * n) {
+		return (n == nullptr) ? -1 : static_cast<int>(n - vec.data());
+	};
+	auto it = tree.begin();
+	size_t pos = 0;
+	for (auto & n : restored) {
+		ASSERT_EQ(index_of(copies, &n), index_of(nodes, &(*it)));
+		ASSERT_EQ(n.get_color(), it->get_color());
+		ASSERT_EQ(index_of(copies, n.get_parent()),
+		          index_of(nodes, it->get_parent()));
+		ASSERT_EQ(restored.rank(n), pos);
+		++it;
+		++pos;
+	}
+	ASSERT_EQ(it, tree.end());
+
+	// The restored tree must behave like any other tree
+	for (size_t i = 0; i < RBTREE_TESTSIZE - 100; i += 2) {
+		restored.remove(copies[indices[i]]);
+	}
+	restored.dbg_verify();
+	for (size_t i = RBTREE_TESTSIZE - 100; i < RBTREE_TESTSIZE; ++i) {
+		restored.insert(copies[indices[i]]);
+	}
+	restored.dbg_verify();
+
+	// Malformed data is rejected
+	Tree broken;
+	ASSERT_FALSE(broken.restore_structure(copies.data(), copies.size(),
+	                                      data.data(), data.size() - 1));
+	ASSERT_TRUE(broken.empty());
+	ASSERT_FALSE(broken.restore_structure(copies.data(), 10, data.data(),
+	                                      data.size()));
+	ASSERT_TRUE(broken.empty());
+	std::string wrong_magic = data;
+	wrong_magic[0] = 'X';
+	ASSERT_FALSE(broken.restore_structure(copies.data(), copies.size(),
+	                                      wrong_magic.data(),
+	                                      wrong_magic.size()));
+	ASSERT_TRUE(broken.empty());
+	// The second record repeats the root's index, which would link the root
+	// below itself
+	std::string repeated = data;
+	std::copy(repeated.begin() + 16, repeated.begin() + 20,
+	          repeated.begin() + 21);
+	ASSERT_FALSE(broken.restore_structure(copies.data(), copies.size(),
+	                                      repeated.data(), repeated.size()));
+	ASSERT_TRUE(broken.empty());
+
+	// Empty trees work, too
+	Tree empty;
+	std::ostringstream empty_out;
+	empty.write_structure(nodes.data(), empty_out);
+	const std::string empty_data = empty_out.str();
+	ASSERT_TRUE(broken.restore_structure(copies.data(), copies.size(),
+	                                     empty_data.data(), empty_data.size()));
+	ASSERT_TRUE(broken.empty());
+	broken.dbg_verify();
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), SplitJoinTest)
+{
+	using MyNode = MultiNodeBase<TreeFlags::ORDER_QUERIES>;
+	using Tree =
+	    RBTree<MyNode, MultiNodeTraits, __RBT_MULTIPLE<TreeFlags::ORDER_QUERIES>>;
+
+	std::vector<MyNode> nodes(RBTREE_TESTSIZE);
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		// Every value appears twice
+		nodes[i].data = static_cast<int>(i / 2);
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(RBTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	std::mt19937 rng(RBTREE_SEED);
+	std::uniform_int_distribution<int> key_distr(-1, RBTREE_TESTSIZE / 2 + 1);
+	MyNode pivot;
+
+	for (unsigned int round = 0; round < 50; ++round) {
+		int key = key_distr(rng);
+
+		Tree right;
+		tree.split(key, right);
+		tree.dbg_verify();
+		right.dbg_verify();
+
+		size_t expected_left =
+		    static_cast<size_t>(std::clamp(2 * key, 0, RBTREE_TESTSIZE));
+		ASSERT_EQ(tree.size(), expected_left);
+		ASSERT_EQ(right.size(), RBTREE_TESTSIZE - expected_left);
+		for (auto & n : tree) {
+			ASSERT_LT(n.data, key);
+		}
+		for (auto & n : right) {
+			ASSERT_GE(n.data, key);
+		}
+
+		if (round % 2 == 0) {
+			tree.join(right);
+		} else {
+			// Join with a pivot, then remove the pivot again
+			pivot.data = key;
+			tree.join(pivot, right);
+			tree.dbg_verify();
+			ASSERT_EQ(tree.size(), RBTREE_TESTSIZE + 1);
+			tree.remove(pivot);
+		}
+
+		tree.dbg_verify();
+		ASSERT_TRUE(right.empty());
+		ASSERT_EQ(tree.size(), RBTREE_TESTSIZE);
+
+		size_t pos = 0;
+		for (auto & n : tree) {
+			ASSERT_EQ(n.data, static_cast<int>(pos / 2));
+			ASSERT_EQ(tree.rank(n), pos);
+			pos++;
+		}
+	}
+
+	// Join trees of very different sizes
+	tree.clear();
+	Tree small;
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		if (i < 10) {
+			small.insert(nodes[i]);
+		} else {
+			tree.insert(nodes[i]);
+		}
+	}
+	small.join(tree);
+	small.dbg_verify();
+	ASSERT_TRUE(tree.empty());
+	ASSERT_EQ(small.size(), RBTREE_TESTSIZE);
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), SplitJoinNoOrderQueriesTest)
+{
+	auto tree = RBTree<Node, NodeTraits, __RBT_NONMULTIPLE<>>();
+
+	Node nodes[RBTREE_TESTSIZE];
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i);
+		tree.insert(nodes[i]);
+	}
+
+	for (int key = -1; key <= RBTREE_TESTSIZE; key += 97) {
+		auto right = RBTree<Node, NodeTraits, __RBT_NONMULTIPLE<>>();
+		tree.split(key, right);
+		tree.dbg_verify();
+		right.dbg_verify();
+
+		size_t expected_left =
+		    static_cast<size_t>(std::clamp(key, 0, RBTREE_TESTSIZE));
+		ASSERT_EQ(tree.size(), expected_left);
+		ASSERT_EQ(right.size(), RBTREE_TESTSIZE - expected_left);
+
+		tree.join(right);
+		tree.dbg_verify();
+		ASSERT_EQ(tree.size(), RBTREE_TESTSIZE);
+	}
+
+	int i = 0;
+	for (auto & n : tree) {
+		ASSERT_EQ(n.data, i);
+		i++;
+	}
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), SetOperationsTest)
+{
+	using Tree = RBTree<Node, NodeTraits, __RBT_NONMULTIPLE<>>;
+
+	std::vector<Node> a_nodes(RBTREE_TESTSIZE);
+	std::vector<Node> b_nodes(RBTREE_TESTSIZE / 4);
+	std::set<int> a_values;
+	std::set<int> b_values;
+	for (unsigned int i = 0; i < a_nodes.size(); ++i) {
+		a_nodes[i].data = static_cast<int>(2 * i);
+		a_values.insert(a_nodes[i].data);
+	}
+	for (unsigned int i = 0; i < b_nodes.size(); ++i) {
+		b_nodes[i].data = static_cast<int>(3 * i);
+		b_values.insert(b_nodes[i].data);
+	}
+
+	std::vector<int> union_values;
+	std::vector<int> intersection_values;
+	std::vector<int> difference_values;
+	std::set_union(a_values.begin(), a_values.end(), b_values.begin(),
+	               b_values.end(), std::back_inserter(union_values));
+	std::set_intersection(a_values.begin(), a_values.end(), b_values.begin(),
+	                      b_values.end(), std::back_inserter(intersection_values));
+	std::set_difference(a_values.begin(), a_values.end(), b_values.begin(),
+	                    b_values.end(), std::back_inserter(difference_values));
+
+	auto fill = [](Tree & t, std::vector<Node> & nodes) {
+		t.clear();
+		for (auto & n : nodes) {
+			t.insert(n);
+		}
+	};
+	auto check = [](const Tree & t, const std::vector<int> & values) {
+		t.dbg_verify();
+		ASSERT_EQ(t.size(), values.size());
+		size_t i = 0;
+		for (auto & n : t) {
+			ASSERT_EQ(n.data, values[i]);
+			i++;
+		}
+	};
+
+	for (unsigned int parallel_depth : {0u, 3u}) {
+		Tree a;
+		Tree b;
+		Tree removed;
+
+		// Union, both ways round
+		fill(a, a_nodes);
+		fill(b, b_nodes);
+		a.union_with(b, parallel_depth);
+		check(a, union_values);
+		check(b, intersection_values);
+		for (auto & n : b) {
+			ASSERT_TRUE((&n >= &b_nodes.front()) && (&n <= &b_nodes.back()));
+		}
+
+		fill(a, a_nodes);
+		fill(b, b_nodes);
+		b.union_with(a, parallel_depth);
+		check(b, union_values);
+		check(a, intersection_values);
+
+		// Intersection
+		fill(a, a_nodes);
+		fill(b, b_nodes);
+		a.intersect_with(b, removed, parallel_depth);
+		check(a, intersection_values);
+		check(removed, difference_values);
+		ASSERT_EQ(b.size(), b_nodes.size());
+		b.dbg_verify();
+
+		// Difference
+		fill(a, a_nodes);
+		a.difference_with(b, removed, parallel_depth);
+		check(a, difference_values);
+		check(removed, intersection_values);
+
+		// Empty operands
+		Tree empty;
+		a.union_with(empty, parallel_depth);
+		check(a, difference_values);
+		a.intersect_with(empty, removed, parallel_depth);
+		ASSERT_TRUE(a.empty());
+		check(removed, difference_values);
+	}
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), MultipleSetOperationsTest)
+{
+	using MyNode = MultiNodeBase<TreeFlags::ORDER_QUERIES>;
+	using Tree =
+	    RBTree<MyNode, MultiNodeTraits, __RBT_MULTIPLE<TreeFlags::ORDER_QUERIES>>;
+
+	// Every value appears twice in <a> and once in <b>
+	std::vector<MyNode> a_nodes(RBTREE_TESTSIZE);
+	std::vector<MyNode> b_nodes(RBTREE_TESTSIZE / 2);
+	for (unsigned int i = 0; i < a_nodes.size(); ++i) {
+		a_nodes[i].data = static_cast<int>(i / 2);
+	}
+	for (unsigned int i = 0; i < b_nodes.size(); ++i) {
+		b_nodes[i].data = static_cast<int>(2 * i);
+	}
+
+	Tree a;
+	Tree b;
+	for (auto & n : a_nodes) {
+		a.insert(n);
+	}
+	for (auto & n : b_nodes) {
+		b.insert(n);
+	}
+
+	a.union_with(b, 2);
+	a.dbg_verify();
+	ASSERT_TRUE(b.empty());
+	ASSERT_EQ(a.size(), a_nodes.size() + b_nodes.size());
+
+	size_t pos = 0;
+	int last = -1;
+	for (auto & n : a) {
+		ASSERT_GE(n.data, last);
+		ASSERT_EQ(a.rank(n), pos);
+		last = n.data;
+		pos++;
+	}
+
+	// Remove all even values again
+	std::vector<MyNode> c_nodes(b_nodes);
+	Tree c;
+	for (auto & n : c_nodes) {
+		c.insert(n);
+	}
+	Tree removed;
+	a.difference_with(c, removed);
+	a.dbg_verify();
+	removed.dbg_verify();
+	ASSERT_EQ(a.size(), a_nodes.size() / 2);
+	ASSERT_EQ(removed.size(), a_nodes.size() / 2 + b_nodes.size());
+	for (auto & n : a) {
+		ASSERT_EQ(n.data % 2, 1);
+	}
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), EraseRangeTest)
+{
+	using MyNode = MultiNodeBase<TreeFlags::ORDER_QUERIES>;
+	using Tree =
+	    RBTree<MyNode, MultiNodeTraits, __RBT_MULTIPLE<TreeFlags::ORDER_QUERIES>>;
+
+	std::vector<MyNode> nodes(RBTREE_TESTSIZE);
+	Tree tree;
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		// Every value appears twice
+		nodes[i].data = static_cast<int>(i / 2);
+		tree.insert(nodes[i]);
+	}
+
+	// Remove [100, 200)
+	Tree removed;
+	tree.erase_range(100, 200, removed);
+	tree.dbg_verify();
+	removed.dbg_verify();
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE - 200);
+	ASSERT_EQ(removed.size(), 200);
+	int expected = 100;
+	for (auto & n : removed) {
+		ASSERT_EQ(n.data, expected / 2 + 50);
+		expected++;
+	}
+	size_t pos = 0;
+	for (auto & n : tree) {
+		ASSERT_TRUE((n.data < 100) || (n.data >= 200));
+		ASSERT_EQ(tree.rank(n), pos);
+		pos++;
+	}
+
+	// Empty and inverted ranges remove nothing
+	tree.erase_range(150, 160, removed);
+	ASSERT_TRUE(removed.empty());
+	tree.erase_range(300, 250, removed);
+	ASSERT_TRUE(removed.empty());
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE - 200);
+
+	// Remove [300, 400) via a disposer
+	std::vector<int> disposed;
+	tree.erase_range(300, 400, [&](MyNode & n) {
+		disposed.push_back(n.data);
+		n.data = -1;
+	});
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE - 400);
+	ASSERT_EQ(disposed.size(), 200);
+	ASSERT_TRUE(std::is_sorted(disposed.begin(), disposed.end()));
+	ASSERT_EQ(disposed.front(), 300);
+	ASSERT_EQ(disposed.back(), 399);
+
+	// Remove everything
+	tree.erase_range(-1, RBTREE_TESTSIZE, removed);
+	tree.dbg_verify();
+	ASSERT_TRUE(tree.empty());
+	ASSERT_EQ(removed.size(), RBTREE_TESTSIZE - 400);
+}
+
+TEST(__RBT_BASENAME(RBTreeTest), EraseRangeNoOrderQueriesTest)
+{
+	using Tree = RBTree<Node, NodeTraits, __RBT_NONMULTIPLE<>>;
+
+	Node nodes[RBTREE_TESTSIZE];
+	Tree tree;
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i);
+		tree.insert(nodes[i]);
+	}
+
+	std::mt19937 rng(RBTREE_SEED);
+	std::uniform_int_distribution<int> key_distr(0, RBTREE_TESTSIZE);
+	std::set<int> remaining;
+	for (int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		remaining.insert(i);
+	}
+
+	for (unsigned int round = 0; round < 20; ++round) {
+		int lo = key_distr(rng);
+		int hi = lo + key_distr(rng) / 20;
+
+		size_t expected_removed = static_cast<size_t>(
+		    std::distance(remaining.lower_bound(lo), remaining.lower_bound(hi)));
+		remaining.erase(remaining.lower_bound(lo), remaining.lower_bound(hi));
+
+		Tree removed;
+		tree.erase_range(lo, hi, removed);
+		tree.dbg_verify();
+		removed.dbg_verify();
+		ASSERT_EQ(tree.size(), remaining.size());
+		ASSERT_EQ(removed.size(), expected_removed);
+		for (auto & n : removed) {
+			ASSERT_GE(n.data, lo);
+			ASSERT_LT(n.data, hi);
+		}
+	}
+
+	auto it = remaining.begin();
+	for (auto & n : tree) {
+		ASSERT_EQ(n.data, *it);
+		++it;
+	}
+}
+
+class RelativeLinkPool {
+public:
+	static void * base;
+
+	static void *
+	get_base() noexcept
+	{
+		return base;
+	}
+};
+void * RelativeLinkPool::base = nullptr;
+
+TEST(__RBT_BASENAME(RBTreeTest), PoolRelativeLinksTest)
+{
+	using MyNode =
+	    MultiNodeBase<TreeFlags::POOL_RELATIVE_LINKS<RelativeLinkPool>>;
+	using Tree =
+	    RBTree<MyNode, MultiNodeTraits,
+	           __RBT_MULTIPLE<TreeFlags::POOL_RELATIVE_LINKS<RelativeLinkPool>>>;
+
+	// Links and color fit into 12 bytes
+	static_assert(sizeof(MyNode) < sizeof(MultiNode));
+
+	std::vector<MyNode> nodes(RBTREE_TESTSIZE);
+	RelativeLinkPool::base = nodes.data();
+
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i / 2);
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(RBTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+	tree.dbg_verify();
+
+	int last = -1;
+	for (auto & n : tree) {
+		ASSERT_GE(n.data, last);
+		last = n.data;
+	}
+	ASSERT_EQ(tree.find(17)->data, 17);
+	ASSERT_TRUE(tree.find(RBTREE_TESTSIZE) == tree.end());
+
+	Tree right;
+	tree.split(RBTREE_TESTSIZE / 4, right);
+	tree.dbg_verify();
+	right.dbg_verify();
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE / 2);
+	tree.join(right);
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE);
+
+	for (unsigned int i = 0; i < RBTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[indices[i]]);
+		tree.dbg_verify();
+	}
+	ASSERT_EQ(tree.size(), RBTREE_TESTSIZE / 2);
+}
+
 // TODO test equal elements
@@ -0,0 +1,206 @@
+#ifndef YGG_TEST_SEARCH_SNAPSHOT_HPP
+#define YGG_TEST_SEARCH_SNAPSHOT_HPP
+
+#include "../src/rbtree.hpp"
+#include "../src/search_snapshot.hpp"
+#include "../src/wbtree.hpp"
+#include "../src/ziptree.hpp"
+#include "key_node.hpp"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace ygg {
+namespace testing {
+namespace search_snapshot {
+
+constexpr size_t SNAPSHOT_TESTSIZE = 3000;
+constexpr size_t SNAPSHOT_SEED = 4;
+
+using RBOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::MODIFICATION_COUNTER>;
+// No constant time size: the snapshot must count the nodes itself
+using WBOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::MODIFICATION_COUNTER>;
+using ZOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::ZTREE_USE_HASH, TreeFlags::MODIFICATION_COUNTER>;
+
+// ZTREE_USE_HASH needs the hash specialization below
+using ZNode = utilities::ZKeyNode<ZOptions>;
+
+} // namespace search_snapshot
+} // namespace testing
+} // namespace ygg
+
+namespace std {
+template <>
+struct hash<ygg::testing::search_snapshot::ZNode>
+{
+	size_t
+	operator()(const ygg::testing::search_snapshot::ZNode & n) const noexcept
+	{
+		return std::hash<int>{}(n.key);
+	}
+};
+} // namespace std
+
+namespace ygg {
+namespace testing {
+namespace search_snapshot {
+
+class KeyGetter {
+public:
+	template <class Node>
+	static int
+	get_key(const Node & n)
+	{
+		return n.key;
+	}
+};
+
+using RBT = utilities::RBKeyTree<RBOptions>;
+using WBT = utilities::WBKeyTree<WBOptions>;
+using ZT = utilities::ZKeyTree<ZOptions>;
+
+template <class Tree>
+class SearchSnapshotTest : public ::testing::Test {
+};
+
+using TreeTypes = ::testing::Types<RBT, WBT, ZT>;
+TYPED_TEST_SUITE(SearchSnapshotTest, TreeTypes);
+
+TYPED_TEST(SearchSnapshotTest, EmptyTest)
+{
+	using Tree = TypeParam;
+	Tree t;
+	SearchSnapshot<Tree, KeyGetter> snapshot(t);
+
+	ASSERT_TRUE(snapshot.empty());
+	ASSERT_EQ(snapshot.size(), 0);
+	ASSERT_TRUE(snapshot.lower_bound(0) == t.end());
+	ASSERT_TRUE(snapshot.upper_bound(0) == t.end());
+	ASSERT_TRUE(snapshot.find(0) == t.end());
+	ASSERT_FALSE(snapshot.is_stale());
+}
+
+TYPED_TEST(SearchSnapshotTest, QueryTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(SNAPSHOT_SEED);
+	// Use a small key range to get many duplicates
+	std::uniform_int_distribution<int> key_dist(0, SNAPSHOT_TESTSIZE / 2);
+
+	std::vector<Node> nodes;
+	nodes.reserve(SNAPSHOT_TESTSIZE);
+	for (size_t i = 0; i < SNAPSHOT_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng) * 2);
+	}
+
+	Tree t;
+	for (auto & n : nodes) {
+		t.insert(n);
+	}
+
+	// Different sizes exercise different shapes of the last level
+	for (size_t n = 0; n < 70; ++n) {
+		Tree small;
+		std::vector<Node> small_nodes;
+		for (size_t i = 0; i < n; ++i) {
+			small_nodes.emplace_back(static_cast<int>(2 * i));
+		}
+		for (auto & node : small_nodes) {
+			small.insert(node);
+		}
+
+		SearchSnapshot<Tree, KeyGetter> snapshot(small);
+		ASSERT_EQ(snapshot.size(), n);
+		for (int q = -1; q <= static_cast<int>(2 * n); ++q) {
+			ASSERT_TRUE(snapshot.lower_bound(q) == small.lower_bound(q));
+			ASSERT_TRUE(snapshot.upper_bound(q) == small.upper_bound(q));
+			ASSERT_TRUE(snapshot.find(q) == small.find(q));
+		}
+	}
+
+	SearchSnapshot<Tree, KeyGetter> snapshot(t);
+	ASSERT_EQ(snapshot.size(), SNAPSHOT_TESTSIZE);
+
+	// Odd queries are never found, even queries hit runs of equal keys
+	for (int q = -1; q <= static_cast<int>(SNAPSHOT_TESTSIZE) + 2; ++q) {
+		ASSERT_TRUE(snapshot.lower_bound(q) == t.lower_bound(q));
+		ASSERT_TRUE(snapshot.upper_bound(q) == t.upper_bound(q));
+
+		auto it = snapshot.find(q);
+		if (it == t.end()) {
+			ASSERT_TRUE(t.find(q) == t.end());
+		} else {
+			// With duplicates, find must return the first equal element
+			ASSERT_EQ(it->key, q);
+			ASSERT_TRUE(it == t.lower_bound(q));
+		}
+	}
+}
+
+TYPED_TEST(SearchSnapshotTest, StalenessTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::vector<Node> nodes;
+	for (int i = 0; i < 100; ++i) {
+		nodes.emplace_back(i);
+	}
+
+	Tree t;
+	for (int i = 0; i < 50; ++i) {
+		t.insert(nodes[static_cast<size_t>(i)]);
+	}
+
+	SearchSnapshot<Tree, KeyGetter> snapshot(t);
+	ASSERT_FALSE(snapshot.is_stale());
+	ASSERT_TRUE(snapshot.find(10) != t.end());
+
+	t.remove(nodes[10]);
+	ASSERT_TRUE(snapshot.is_stale());
+	snapshot.rebuild();
+	ASSERT_FALSE(snapshot.is_stale());
+	ASSERT_TRUE(snapshot.find(10) == t.end());
+	ASSERT_EQ(snapshot.size(), 49);
+
+	t.insert(nodes[75]);
+	ASSERT_TRUE(snapshot.is_stale());
+	snapshot.rebuild();
+	ASSERT_TRUE(snapshot.find(75) != t.end());
+
+	// Splitting and joining are modifications, too
+	Tree right;
+	t.split(60, right);
+	ASSERT_TRUE(snapshot.is_stale());
+	snapshot.rebuild();
+	ASSERT_TRUE(snapshot.find(75) == t.end());
+	ASSERT_TRUE(snapshot.lower_bound(60) == t.end());
+
+	t.join(right);
+	ASSERT_TRUE(snapshot.is_stale());
+	snapshot.rebuild();
+	ASSERT_EQ(snapshot.find(75)->key, 75);
+
+	t.clear();
+	ASSERT_TRUE(snapshot.is_stale());
+	snapshot.rebuild();
+	ASSERT_TRUE(snapshot.empty());
+
+	// A default-constructed snapshot has no tree to search
+	SearchSnapshot<Tree, KeyGetter> unbound;
+	ASSERT_TRUE(unbound.is_stale());
+}
+
+} // namespace search_snapshot
+} // namespace testing
+} // namespace ygg
+
+#endif // YGG_TEST_SEARCH_SNAPSHOT_HPP
@@ -0,0 +1,374 @@
+#ifndef YGG_TEST_SHARDED_TREE_HPP
+#define YGG_TEST_SHARDED_TREE_HPP
+
+#include "../src/rbtree.hpp"
+#include "../src/sharded_tree.hpp"
+#include "../src/wbtree.hpp"
+#include "../src/ziptree.hpp"
+#include "key_node.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace ygg {
+namespace testing {
+namespace sharded_tree {
+
+constexpr size_t SHARDED_TESTSIZE = 4000;
+constexpr size_t SHARDED_SEED = 4;
+
+using RBOptions = TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE>;
+// rebalance() finds the boundaries via select()
+using RBOrderOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::ORDER_QUERIES>;
+// No constant time size: the shards must be counted
+using WBOptions = TreeOptions<TreeFlags::MULTIPLE>;
+using ZOptions =
+    TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::ZTREE_RANK_TYPE<std::uint8_t>,
+                TreeFlags::ZTREE_FAST_RANDOM_RANKS>;
+
+class KeyGetter {
+public:
+	template <class Node>
+	static int
+	get_key(const Node & n)
+	{
+		return n.key;
+	}
+};
+
+using RBT = utilities::RBKeyTree<RBOptions>;
+using RBOrderT = utilities::RBKeyTree<RBOrderOptions>;
+using WBT = utilities::WBKeyTree<WBOptions>;
+using ZT = utilities::ZKeyTree<ZOptions>;
+// The concurrency test only uses the RBTree
+using RBNode = RBT::NodeT;
+
+template <class Tree>
+class ShardedTreeTest : public ::testing::Test {
+};
+
+using TreeTypes = ::testing::Types<RBT, RBOrderT, WBT, ZT>;
+TYPED_TEST_SUITE(ShardedTreeTest, TreeTypes);
+
+template <class Sharded>
+std::vector<int>
+collect_keys(const Sharded & sharded)
+{
+	std::vector<int> keys;
+	sharded.for_each([&](const auto & n) { keys.push_back(n.key); });
+	return keys;
+}
+
+TYPED_TEST(ShardedTreeTest, QueryTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	ShardedTree<Tree, KeyGetter> sharded({1000, 2000, 3000});
+	ASSERT_EQ(sharded.shard_count(), size_t{4});
+	ASSERT_TRUE(sharded.empty());
+
+	std::mt19937 rng(SHARDED_SEED);
+	// Use a small key range to get many duplicates
+	std::uniform_int_distribution<int> key_dist(0, 4000 / 2);
+	std::vector<Node> nodes;
+	nodes.reserve(SHARDED_TESTSIZE);
+	std::vector<int> keys;
+	for (size_t i = 0; i < SHARDED_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng) * 2);
+		keys.push_back(nodes.back().key);
+	}
+	for (auto & n : nodes) {
+		sharded.insert(n);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	ASSERT_FALSE(sharded.empty());
+	ASSERT_EQ(sharded.size(), SHARDED_TESTSIZE);
+	for (size_t shard = 0; shard < 4; ++shard) {
+		auto expected = std::count_if(keys.begin(), keys.end(), [&](int k) {
+			// The last shard is unbounded
+			return k >= static_cast<int>(shard * 1000) &&
+			       (shard == 3 || k < static_cast<int>((shard + 1) * 1000));
+		});
+		ASSERT_EQ(sharded.shard_size(shard), static_cast<size_t>(expected));
+	}
+	ASSERT_EQ(collect_keys(sharded), keys);
+
+	for (int q = -1; q <= 4001; ++q) {
+		Node * found = sharded.find(q);
+		if (std::binary_search(keys.begin(), keys.end(), q)) {
+			ASSERT_NE(found, nullptr);
+			ASSERT_EQ(found->key, q);
+		} else {
+			ASSERT_EQ(found, nullptr);
+		}
+	}
+
+	// Ranges within one shard, spanning several shards and empty ranges
+	std::uniform_int_distribution<int> bound_dist(-10, 4010);
+	for (size_t i = 0; i < 200; ++i) {
+		int lo = bound_dist(rng);
+		int hi = (i % 2 == 0) ? lo + 50 : bound_dist(rng);
+
+		std::vector<int> expected;
+		for (int k : keys) {
+			if (k >= lo && k <= hi) {
+				expected.push_back(k);
+			}
+		}
+		std::vector<int> visited;
+		sharded.for_each_in_range(
+		    lo, hi, [&](const Node & n) { visited.push_back(n.key); });
+		ASSERT_EQ(visited, expected);
+	}
+
+	for (size_t i = 0; i < SHARDED_TESTSIZE; i += 2) {
+		sharded.remove(nodes[i]);
+	}
+	ASSERT_EQ(sharded.size(), SHARDED_TESTSIZE / 2);
+	keys.clear();
+	for (size_t i = 1; i < SHARDED_TESTSIZE; i += 2) {
+		keys.push_back(nodes[i].key);
+	}
+	std::sort(keys.begin(), keys.end());
+	ASSERT_EQ(collect_keys(sharded), keys);
+}
+
+TYPED_TEST(ShardedTreeTest, RebalanceTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+	constexpr size_t shard_count = 5;
+
+	// All nodes end up in the last shard
+	ShardedTree<Tree, KeyGetter> sharded({-40, -30, -20, -10});
+	std::vector<Node> nodes;
+	nodes.reserve(SHARDED_TESTSIZE);
+	for (size_t i = 0; i < SHARDED_TESTSIZE; ++i) {
+		nodes.emplace_back(static_cast<int>(i));
+	}
+	std::vector<size_t> order(SHARDED_TESTSIZE);
+	for (size_t i = 0; i < SHARDED_TESTSIZE; ++i) {
+		order[i] = i;
+	}
+	std::shuffle(order.begin(), order.end(), std::mt19937(SHARDED_SEED));
+	for (auto i : order) {
+		sharded.insert(nodes[i]);
+	}
+	ASSERT_EQ(sharded.shard_size(shard_count - 1), SHARDED_TESTSIZE);
+
+	auto check_balanced = [&](size_t total) {
+		for (size_t shard = 0; shard < shard_count; ++shard) {
+			ASSERT_EQ(sharded.shard_size(shard), total / shard_count);
+		}
+		auto boundaries = sharded.get_boundaries();
+		ASSERT_TRUE(std::is_sorted(boundaries.begin(), boundaries.end()));
+	};
+
+	sharded.rebalance();
+	check_balanced(SHARDED_TESTSIZE);
+	std::vector<int> keys;
+	for (auto & n : nodes) {
+		keys.push_back(n.key);
+	}
+	ASSERT_EQ(collect_keys(sharded), keys);
+
+	// Remove the upper half, which empties the upper shards. Newly inserted
+	// nodes must still be found in the right shards.
+	for (size_t i = SHARDED_TESTSIZE / 2; i < SHARDED_TESTSIZE; ++i) {
+		sharded.remove(nodes[i]);
+	}
+	sharded.rebalance();
+	check_balanced(SHARDED_TESTSIZE / 2);
+	for (size_t i = 0; i < SHARDED_TESTSIZE / 2; ++i) {
+		ASSERT_EQ(sharded.find(static_cast<int>(i)), &nodes[i]);
+	}
+	ASSERT_EQ(sharded.find(static_cast<int>(SHARDED_TESTSIZE / 2)), nullptr);
+
+	for (size_t i = SHARDED_TESTSIZE / 2; i < SHARDED_TESTSIZE; ++i) {
+		sharded.insert(nodes[i]);
+	}
+	ASSERT_EQ(collect_keys(sharded), keys);
+	sharded.rebalance();
+	check_balanced(SHARDED_TESTSIZE);
+	for (size_t i = 0; i < SHARDED_TESTSIZE; ++i) {
+		ASSERT_EQ(sharded.find(static_cast<int>(i)), &nodes[i]);
+	}
+
+	// Equal keys stay together
+	std::vector<Node> dups(SHARDED_TESTSIZE, Node(42));
+	ShardedTree<Tree, KeyGetter> dup_sharded({10, 20});
+	for (auto & n : dups) {
+		dup_sharded.insert(n);
+	}
+	dup_sharded.rebalance();
+	ASSERT_EQ(dup_sharded.size(), SHARDED_TESTSIZE);
+	size_t full_shards = 0;
+	for (size_t shard = 0; shard < 3; ++shard) {
+		full_shards += (dup_sharded.shard_size(shard) > 0) ? 1 : 0;
+	}
+	ASSERT_EQ(full_shards, size_t{1});
+	ASSERT_NE(dup_sharded.find(42), nullptr);
+}
+
+TYPED_TEST(ShardedTreeTest, ViewTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	// The shards between 1000 and 3000 stay empty
+	ShardedTree<Tree, KeyGetter> sharded({1000, 2000, 3000, 4000});
+	std::vector<Node> nodes;
+	for (int key = 0; key < 1000; key += 2) {
+		nodes.emplace_back(key);
+	}
+	for (int key = 3000; key < 5000; key += 2) {
+		nodes.emplace_back(key);
+	}
+	std::vector<int> keys;
+	for (auto & n : nodes) {
+		sharded.insert(n);
+		keys.push_back(n.key);
+	}
+
+	{
+		auto view = sharded.view();
+		std::vector<int> visited;
+		for (const Node & n : view) {
+			visited.push_back(n.key);
+		}
+		ASSERT_EQ(visited, keys);
+		ASSERT_EQ(static_cast<size_t>(std::distance(view.begin(), view.end())),
+		          nodes.size());
+
+		for (int q = -1; q <= 5001; ++q) {
+			auto expected_lower = std::lower_bound(keys.begin(), keys.end(), q);
+			auto lower = view.lower_bound(q);
+			if (expected_lower == keys.end()) {
+				ASSERT_TRUE(lower == view.end());
+			} else {
+				ASSERT_EQ(lower->key, *expected_lower);
+			}
+
+			auto expected_upper = std::upper_bound(keys.begin(), keys.end(), q);
+			auto upper = view.upper_bound(q);
+			if (expected_upper == keys.end()) {
+				ASSERT_TRUE(upper == view.end());
+			} else {
+				ASSERT_EQ(upper->key, *expected_upper);
+			}
+		}
+
+		// Crossing the empty shards
+		auto it = view.lower_bound(998);
+		ASSERT_EQ((it++)->key, 998);
+		ASSERT_EQ(it->key, 3000);
+	}
+
+	// Writers can proceed once the view is gone
+	for (auto & n : nodes) {
+		sharded.remove(n);
+	}
+	auto view = sharded.view();
+	ASSERT_TRUE(view.begin() == view.end());
+	ASSERT_TRUE(view.lower_bound(0) == view.end());
+}
+
+TEST(ShardedTreeConcurrencyTest, ConcurrentTest)
+{
+	constexpr size_t thread_count = 4;
+	constexpr size_t per_thread = SHARDED_TESTSIZE;
+
+	ShardedTree<RBT, KeyGetter> sharded({1000, 2000, 3000});
+	std::vector<std::vector<RBNode>> nodes(thread_count);
+	for (size_t t = 0; t < thread_count; ++t) {
+		for (size_t i = 0; i < per_thread; ++i) {
+			nodes[t].emplace_back(static_cast<int>(i * thread_count + t));
+		}
+	}
+
+	// Writers insert and remove their own nodes, while a reader runs range
+	// queries and the main thread moves the shard boundaries around.
+	std::atomic<bool> done{false};
+	std::atomic<bool> reader_ok{true};
+	std::thread reader([&]() {
+		std::mt19937 rng(SHARDED_SEED);
+		std::uniform_int_distribution<int> bound_dist(
+		    0, static_cast<int>(per_thread * thread_count));
+		for (size_t round = 0; !done.load(); ++round) {
+			int lo = bound_dist(rng);
+			int last = lo - 1;
+			auto check = [&](const RBNode & n) {
+				if (n.key <= last || n.key < lo || n.key > lo + 500) {
+					reader_ok.store(false);
+				}
+				last = n.key;
+			};
+			if (round % 2 == 0) {
+				sharded.for_each_in_range(lo, lo + 500, check);
+			} else {
+				auto view = sharded.view();
+				for (auto it = view.lower_bound(lo);
+				     it != view.end() && it->key <= lo + 500; ++it) {
+					check(*it);
+				}
+			}
+		}
+	});
+
+	auto run_writers = [&](bool insert) {
+		std::vector<std::thread> writers;
+		for (size_t t = 0; t < thread_count; ++t) {
+			writers.emplace_back([&, t]() {
+				for (auto & n : nodes[t]) {
+					if (insert) {
+						sharded.insert(n);
+					} else {
+						sharded.remove(n);
+					}
+				}
+			});
+		}
+		for (size_t round = 0; round < 20; ++round) {
+			sharded.rebalance();
+			std::this_thread::yield();
+		}
+		for (auto & writer : writers) {
+			writer.join();
+		}
+	};
+
+	run_writers(true);
+	ASSERT_EQ(sharded.size(), per_thread * thread_count);
+	std::vector<int> keys = collect_keys(sharded);
+	ASSERT_EQ(keys.size(), per_thread * thread_count);
+	for (size_t i = 0; i < keys.size(); ++i) {
+		ASSERT_EQ(keys[i], static_cast<int>(i));
+	}
+	for (size_t t = 0; t < thread_count; ++t) {
+		for (auto & n : nodes[t]) {
+			ASSERT_EQ(sharded.find(n.key), &n);
+		}
+	}
+
+	run_writers(false);
+	done.store(true);
+	reader.join();
+	ASSERT_TRUE(reader_ok.load());
+	ASSERT_TRUE(sharded.empty());
+}
+
+} // namespace sharded_tree
+} // namespace testing
+} // namespace ygg
+
+#endif // YGG_TEST_SHARDED_TREE_HPP
@@ -0,0 +1,290 @@
+#ifndef YGG_TEST_THREADED_HPP
+#define YGG_TEST_THREADED_HPP
+
+#include "../src/rbtree.hpp"
+#include "../src/wbtree.hpp"
+#include "../src/ziptree.hpp"
+#include "key_node.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace ygg {
+namespace testing {
+namespace threaded {
+
+constexpr size_t THREADED_TESTSIZE = 2000;
+constexpr size_t THREADED_SEED = 4;
+
+using RBOptions = TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                              TreeFlags::THREADED>;
+using WBOptions = TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                              TreeFlags::THREADED>;
+using ZOptions = TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                             TreeFlags::ZTREE_RANK_TYPE<int>, TreeFlags::THREADED>;
+
+using RBT = utilities::RBKeyTree<RBOptions>;
+using WBT = utilities::WBKeyTree<WBOptions>;
+using ZT = utilities::ZKeyTree<ZOptions>;
+
+template <class Tree>
+class ThreadedTest : public ::testing::Test {
+};
+
+using TreeTypes = ::testing::Types<RBT, WBT, ZT>;
+TYPED_TEST_SUITE(ThreadedTest, TreeTypes);
+
+/* Checks the threads via dbg_verify() and compares forward and backward
+ * iteration to the set of nodes expected in the tree. */
+template <class Tree>
+void
+verify_tree(Tree & t, std::vector<int> expected)
+{
+	t.dbg_verify();
+	std::sort(expected.begin(), expected.end());
+
+	std::vector<int> forward;
+	for (auto & n : t) {
+		forward.push_back(n.key);
+	}
+	ASSERT_EQ(forward, expected);
+
+	std::vector<int> backward;
+	for (auto it = t.rbegin(); it != t.rend(); ++it) {
+		backward.push_back(it->key);
+	}
+	std::reverse(backward.begin(), backward.end());
+	ASSERT_EQ(backward, expected);
+}
+
+template <class Node>
+std::vector<int>
+keys_of(const std::vector<Node *> & nodes)
+{
+	std::vector<int> keys;
+	for (const Node * n : nodes) {
+		keys.push_back(n->key);
+	}
+	return keys;
+}
+
+TYPED_TEST(ThreadedTest, InsertRemoveTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(THREADED_SEED);
+	// Use a small key range to get many duplicates
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(THREADED_TESTSIZE / 4));
+
+	std::vector<Node> nodes;
+	nodes.reserve(THREADED_TESTSIZE);
+	for (size_t i = 0; i < THREADED_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng));
+	}
+
+	Tree t;
+	std::vector<Node *> in_tree;
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		auto handle = t.find_or_prepare_insert(nodes[i]);
+		if ((i % 2 == 0) || handle.found()) {
+			t.insert(nodes[i]);
+		} else {
+			t.insert_at(handle, nodes[i]);
+		}
+		in_tree.push_back(&nodes[i]);
+		if (i % 100 == 0) {
+			verify_tree(t, keys_of(in_tree));
+		}
+	}
+	verify_tree(t, keys_of(in_tree));
+
+	std::shuffle(in_tree.begin(), in_tree.end(), rng);
+	for (size_t i = 0; i < THREADED_TESTSIZE / 2; ++i) {
+		t.remove(*in_tree.back());
+		in_tree.pop_back();
+		if (i % 100 == 0) {
+			verify_tree(t, keys_of(in_tree));
+		}
+	}
+	verify_tree(t, keys_of(in_tree));
+
+	// Moving nodes around must keep the threads intact
+	for (size_t i = 0; i < in_tree.size(); i += 5) {
+		t.update_key(*in_tree[i], [](Node & n) { n.key = (n.key * 7) % 503; });
+	}
+	verify_tree(t, keys_of(in_tree));
+}
+
+TYPED_TEST(ThreadedTest, BulkOperationsTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(THREADED_SEED);
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(THREADED_TESTSIZE / 2));
+
+	std::vector<Node> nodes;
+	nodes.reserve(THREADED_TESTSIZE);
+	for (size_t i = 0; i < THREADED_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng));
+	}
+	std::sort(nodes.begin(), nodes.end());
+
+	std::vector<Node *> all;
+	for (auto & n : nodes) {
+		all.push_back(&n);
+	}
+
+	Tree t;
+	t.build_from_sorted(nodes.begin(), nodes.end());
+	verify_tree(t, keys_of(all));
+
+	// Split and join
+	int split_key = static_cast<int>(THREADED_TESTSIZE / 4);
+	std::vector<Node *> lower;
+	std::vector<Node *> upper;
+	for (Node * n : all) {
+		if (n->key < split_key) {
+			lower.push_back(n);
+		} else {
+			upper.push_back(n);
+		}
+	}
+
+	Tree right;
+	t.split(split_key, right);
+	verify_tree(t, keys_of(lower));
+	verify_tree(right, keys_of(upper));
+	t.join(right);
+	verify_tree(t, keys_of(all));
+
+	t.split(split_key, right);
+	Node & pivot = *lower.back();
+	t.remove(pivot);
+	t.join(pivot, right);
+	verify_tree(t, keys_of(all));
+
+	// Set operations
+	Tree other;
+	std::vector<Node *> in_t;
+	std::vector<Node *> in_other;
+	for (size_t i = 0; i < all.size(); ++i) {
+		if (i % 2 == 0) {
+			t.remove(*all[i]);
+			other.insert(*all[i]);
+			in_other.push_back(all[i]);
+		} else {
+			in_t.push_back(all[i]);
+		}
+	}
+	verify_tree(t, keys_of(in_t));
+	verify_tree(other, keys_of(in_other));
+
+	Tree removed;
+	t.intersect_with(other, removed);
+	t.dbg_verify();
+	removed.dbg_verify();
+	ASSERT_EQ(t.size() + removed.size(), in_t.size());
+	t.union_with(removed);
+	verify_tree(t, keys_of(in_t));
+
+	t.difference_with(other, removed);
+	t.dbg_verify();
+	removed.dbg_verify();
+	t.union_with(removed);
+	verify_tree(t, keys_of(in_t));
+
+	// Range erasure
+	std::vector<Node *> outside;
+	std::vector<Node *> inside;
+	for (Node * n : in_t) {
+		if ((n->key >= 100) && (n->key < 300)) {
+			inside.push_back(n);
+		} else {
+			outside.push_back(n);
+		}
+	}
+
+	Tree erased;
+	t.erase_range(100, 300, erased);
+	verify_tree(t, keys_of(outside));
+	verify_tree(erased, keys_of(inside));
+}
+
+TYPED_TEST(ThreadedTest, RelayoutTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(THREADED_SEED);
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(THREADED_TESTSIZE / 4));
+
+	std::vector<Node> nodes;
+	nodes.reserve(THREADED_TESTSIZE);
+	std::vector<Node *> all;
+	for (size_t i = 0; i < THREADED_TESTSIZE; ++i) {
+		nodes.emplace_back(key_dist(rng));
+	}
+
+	Tree t;
+	for (auto & n : nodes) {
+		t.insert(n);
+		all.push_back(&n);
+	}
+
+	std::vector<Node> arena(THREADED_TESTSIZE);
+	t.relayout(arena.data(), [](Node &, Node &) {});
+	verify_tree(t, keys_of(all));
+	for (auto & n : t) {
+		ASSERT_GE(&n, arena.data());
+		ASSERT_LT(&n, arena.data() + THREADED_TESTSIZE);
+	}
+}
+
+TYPED_TEST(ThreadedTest, StructureTest)
+{
+	using Tree = TypeParam;
+	using Node = typename Tree::NodeT;
+
+	std::mt19937 rng(THREADED_SEED);
+	std::uniform_int_distribution<int> key_dist(
+	    0, static_cast<int>(THREADED_TESTSIZE / 4));
+
+	std::vector<Node> nodes;
+	std::vector<Node> copies;
+	for (size_t i = 0; i < THREADED_TESTSIZE; ++i) {
+		int key = key_dist(rng);
+		nodes.emplace_back(key);
+		copies.emplace_back(key);
+	}
+
+	Tree t;
+	std::vector<Node *> all;
+	for (auto & n : nodes) {
+		t.insert(n);
+		all.push_back(&n);
+	}
+
+	std::ostringstream out;
+	t.write_structure(nodes.data(), out);
+	const std::string data = out.str();
+
+	// The threads are rebuilt
+	Tree restored;
+	ASSERT_TRUE(restored.restore_structure(copies.data(), copies.size(),
+	                                       data.data(), data.size()));
+	verify_tree(restored, keys_of(all));
+}
+
+} // namespace threaded
+} // namespace testing
+} // namespace ygg
+
+#endif // YGG_TEST_THREADED_HPP
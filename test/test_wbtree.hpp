@@ -5,9 +5,13 @@
 #include "randomizer.hpp"
 
 #include <algorithm>
+#include <cstdint>
 #include <gtest/gtest.h>
+#include <iterator>
 #include <random>
+#include <set>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 
 namespace ygg {
@@ -78,6 +82,36 @@ using DEFAULT_FLAGS =
 
 } // namespace wbtree_smalldelta
 
+namespace wbtree_32bit {
+
+#undef __WBT_BASENAME
+#define __WBT_BASENAME(NAME) S32_##NAME
+#undef __WBT_NAMESPACE
+#define __WBT_NAMESPACE wbtree_32bit
+template <class AddOpt = EmptyDummyOpt>
+using MULTI_FLAGS =
+    TreeOptions<TreeFlags::WBT_32BIT_SIZES, TreeFlags::MULTIPLE,
+                TreeFlags::CONSTANT_TIME_SIZE, AddOpt>;
+template <class AddOpt = EmptyDummyOpt>
+using DEFAULT_FLAGS =
+    TreeOptions<TreeFlags::WBT_32BIT_SIZES, TreeFlags::CONSTANT_TIME_SIZE,
+                TreeFlags::MICRO_AVOID_CONDITIONALS, AddOpt>;
+
+#undef WBTREE_SEED
+#define WBTREE_SEED 6
+#include "test_wbtree_base.hpp"
+
+TEST(S32_WBTreeTest, NodeSizeTest)
+{
+	static_assert(std::is_same_v<Node::WBTSizeT, std::uint32_t>);
+	if constexpr (sizeof(void *) == 8) {
+		// Three links and the size, with the int member in the tail padding
+		ASSERT_EQ(sizeof(Node), 32);
+	}
+}
+
+} // namespace wbtree_32bit
+
 } // namespace testing
 } // namespace ygg
 
@@ -863,6 +863,523 @@ TEST(__WBT_BASENAME(WBTreeTest), ReverseIterationTest)
 	}
 }
 
+TEST(__WBT_BASENAME(WBTreeTest), RankSelectTest)
+{
+	auto tree = WBTree<Node, NodeTraits, DEFAULT_FLAGS<>>();
+
+	Node nodes[WBTREE_TESTSIZE];
+	std::vector<size_t> indices;
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		nodes[i] = Node(static_cast<int>(i));
+		indices.push_back(i);
+	}
+
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(WBTREE_SEED));
+
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_EQ(tree.rank(tree.end()), WBTREE_TESTSIZE);
+	ASSERT_EQ(tree.select(WBTREE_TESTSIZE), tree.end());
+
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		ASSERT_EQ(tree.rank(tree.iterator_to(nodes[i])), i);
+		ASSERT_EQ(&(*tree.select(i)), &nodes[i]);
+	}
+
+	// Remove half of the nodes and check again
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[indices[i]]);
+	}
+	ASSERT_TRUE(tree.verify_integrity());
+
+	size_t pos = 0;
+	for (auto & n : tree) {
+		ASSERT_EQ(tree.rank(tree.iterator_to(n)), pos);
+		ASSERT_EQ(&(*tree.select(pos)), &n);
+		pos++;
+	}
+	ASSERT_EQ(tree.rank(tree.end()), pos);
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), AdvanceDistanceTest)
+{
+	auto tree = WBTree<Node, NodeTraits, DEFAULT_FLAGS<>>();
+
+	Node nodes[WBTREE_TESTSIZE];
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		nodes[i] = Node(static_cast<int>(i));
+		tree.insert(nodes[i]);
+	}
+
+	ASSERT_TRUE(tree.verify_integrity());
+
+	std::mt19937 rng(WBTREE_SEED);
+	std::uniform_int_distribution<int> pos_distr(0, WBTREE_TESTSIZE - 1);
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		int from = pos_distr(rng);
+		int to = pos_distr(rng);
+
+		auto from_it = tree.iterator_to(nodes[from]);
+		auto to_it = tree.advance(from_it, to - from);
+		ASSERT_EQ(&(*to_it), &nodes[to]);
+		ASSERT_EQ(tree.distance(from_it, to_it), to - from);
+		ASSERT_EQ(tree.distance(to_it, from_it), from - to);
+
+		// Compare to stepwise iteration
+		if (to > from) {
+			ASSERT_EQ(from_it + static_cast<size_t>(to - from), to_it);
+		}
+	}
+
+	// Out of bounds and end() handling
+	ASSERT_EQ(tree.advance(tree.begin(), -1), tree.end());
+	ASSERT_EQ(tree.advance(tree.begin(), WBTREE_TESTSIZE), tree.end());
+	ASSERT_EQ(&(*tree.advance(tree.end(), -1)), &nodes[WBTREE_TESTSIZE - 1]);
+	ASSERT_EQ(tree.distance(tree.begin(), tree.end()), WBTREE_TESTSIZE);
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), BuildFromSortedTest)
+{
+	auto tree = WBTree<MultiNode, MultiNodeTraits, MULTI_FLAGS<>>();
+
+	std::vector<MultiNode> nodes(WBTREE_TESTSIZE);
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		// Every value appears twice
+		nodes[i] = MultiNode(static_cast<int>(i / 2), static_cast<int>(i));
+	}
+
+	// Test all small sizes, and a large one
+	std::vector<size_t> sizes;
+	for (size_t i = 0; i < 70; ++i) {
+		sizes.push_back(i);
+	}
+	sizes.push_back(WBTREE_TESTSIZE);
+
+	for (size_t size : sizes) {
+		// Build on top of the previous tree - its contents must be discarded
+		tree.build_from_sorted(nodes.begin(), nodes.begin() + size);
+		ASSERT_TRUE(tree.verify_integrity());
+		ASSERT_EQ(tree.size(), size);
+
+		size_t pos = 0;
+		for (auto & n : tree) {
+			ASSERT_EQ(&n, &nodes[pos]);
+			ASSERT_EQ(tree.rank(tree.iterator_to(n)), pos);
+			pos++;
+		}
+		ASSERT_EQ(pos, size);
+	}
+
+	// The built tree must behave like any other tree
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[i]);
+	}
+	ASSERT_TRUE(tree.verify_integrity());
+	std::vector<MultiNode> more_nodes(WBTREE_TESTSIZE / 2);
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE / 2; ++i) {
+		more_nodes[i] = MultiNode(static_cast<int>(i));
+		tree.insert(more_nodes[i]);
+	}
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_EQ(tree.size(), WBTREE_TESTSIZE);
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), RelayoutTest)
+{
+	using Tree = WBTree<MultiNode, MultiNodeTraits, MULTI_FLAGS<>>;
+
+	std::vector<MultiNode> nodes(WBTREE_TESTSIZE);
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		nodes[i] = MultiNode(static_cast<int>(i / 2), static_cast<int>(i));
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(), std::mt19937(WBTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	// The subtree sizes are not copied by MultiNode's assignment operator
+	std::vector<MultiNode> arena(WBTREE_TESTSIZE);
+	std::vector<MultiNode *> moved_to(WBTREE_TESTSIZE, nullptr);
+	tree.relayout(arena.data(), [&](MultiNode & old_node, MultiNode & new_node) {
+		ASSERT_EQ(old_node.sub_data, new_node.sub_data);
+		moved_to[static_cast<size_t>(old_node.sub_data)] = &new_node;
+	});
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_EQ(tree.size(), WBTREE_TESTSIZE);
+	// The root comes first
+	ASSERT_EQ(tree.get_root(), arena.data());
+
+	size_t pos = 0;
+	for (auto & n : tree) {
+		ASSERT_GE(&n, arena.data());
+		ASSERT_LT(&n, arena.data() + WBTREE_TESTSIZE);
+		ASSERT_EQ(tree.rank(tree.iterator_to(n)), pos);
+		pos++;
+	}
+	ASSERT_EQ(pos, WBTREE_TESTSIZE);
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		ASSERT_NE(moved_to[i], nullptr);
+	}
+
+	// The relaid-out tree must behave like any other tree
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; i += 2) {
+		tree.remove(*moved_to[i]);
+	}
+	ASSERT_TRUE(tree.verify_integrity());
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; i += 2) {
+		tree.insert(nodes[i]);
+	}
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_EQ(tree.size(), WBTREE_TESTSIZE);
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), StructureTest)
+{
+	using Tree = WBTree<MultiNode, MultiNodeTraits, MULTI_FLAGS<>>;
+
+	std::vector<MultiNode> nodes(WBTREE_TESTSIZE);
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		nodes[i] = MultiNode(static_cast<int>(i / 2), static_cast<int>(i));
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(), std::mt19937(WBTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	std::ostringstream out;
+	tree.write_structure(nodes.data(), out);
+	const std::string data = out.str();
+
+	// The subtree sizes are not copied by MultiNode's copy constructor
+	std::vector<MultiNode> copies(nodes);
+	Tree restored;
+	ASSERT_TRUE(restored.restore_structure(copies.data(), copies.size(),
+	                                       data.data(), data.size()));
+	ASSERT_TRUE(restored.verify_integrity());
+	ASSERT_EQ(restored.size(), WBTREE_TESTSIZE);
+	ASSERT_EQ(restored.get_root() - copies.data(),
+	          tree.get_root() - nodes.data());
+
+	auto it = tree.begin();
+	size_t pos = 0;
+	for (auto & n : restored) {
+		ASSERT_EQ(&n - copies.data(), &(*it) - nodes.data());
+		ASSERT_EQ(restored.rank(restored.iterator_to(n)), pos);
+		++it;
+		++pos;
+	}
+	ASSERT_EQ(it, tree.end());
+
+	// The restored tree must behave like any other tree
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; i += 2) {
+		restored.remove(copies[i]);
+	}
+	ASSERT_TRUE(restored.verify_integrity());
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; i += 2) {
+		restored.insert(copies[i]);
+	}
+	ASSERT_TRUE(restored.verify_integrity());
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), SplitJoinTest)
+{
+	using Tree = WBTree<MultiNode, MultiNodeTraits, MULTI_FLAGS<>>;
+
+	std::vector<MultiNode> nodes(WBTREE_TESTSIZE);
+	std::vector<size_t> indices;
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		// Every value appears twice
+		nodes[i] = MultiNode(static_cast<int>(i / 2), static_cast<int>(i));
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(WBTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	std::mt19937 rng(WBTREE_SEED);
+	std::uniform_int_distribution<int> key_distr(-1, WBTREE_TESTSIZE / 2 + 1);
+	MultiNode pivot;
+
+	for (unsigned int round = 0; round < 50; ++round) {
+		int key = key_distr(rng);
+
+		Tree right;
+		tree.split(key, right);
+		ASSERT_TRUE(tree.verify_integrity());
+		ASSERT_TRUE(right.verify_integrity());
+
+		size_t expected_left =
+		    static_cast<size_t>(std::clamp(2 * key, 0, WBTREE_TESTSIZE));
+		ASSERT_EQ(tree.size(), expected_left);
+		ASSERT_EQ(right.size(), WBTREE_TESTSIZE - expected_left);
+		for (auto & n : tree) {
+			ASSERT_LT(n.data, key);
+		}
+		for (auto & n : right) {
+			ASSERT_GE(n.data, key);
+		}
+
+		if (round % 2 == 0) {
+			tree.join(right);
+		} else {
+			// Join with a pivot, then remove the pivot again
+			pivot.data = key;
+			tree.join(pivot, right);
+			ASSERT_TRUE(tree.verify_integrity());
+			ASSERT_EQ(tree.size(), WBTREE_TESTSIZE + 1);
+			tree.remove(pivot);
+		}
+
+		ASSERT_TRUE(tree.verify_integrity());
+		ASSERT_TRUE(right.empty());
+		ASSERT_EQ(tree.size(), WBTREE_TESTSIZE);
+
+		size_t pos = 0;
+		for (auto & n : tree) {
+			ASSERT_EQ(n.data, static_cast<int>(pos / 2));
+			ASSERT_EQ(tree.rank(tree.iterator_to(n)), pos);
+			pos++;
+		}
+	}
+
+	// Join trees of very different sizes
+	tree.clear();
+	Tree small;
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		if (i < 10) {
+			small.insert(nodes[i]);
+		} else {
+			tree.insert(nodes[i]);
+		}
+	}
+	small.join(tree);
+	ASSERT_TRUE(small.verify_integrity());
+	ASSERT_TRUE(tree.empty());
+	ASSERT_EQ(small.size(), WBTREE_TESTSIZE);
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), SetOperationsTest)
+{
+	using Tree = WBTree<Node, NodeTraits, DEFAULT_FLAGS<>>;
+
+	std::vector<Node> a_nodes(WBTREE_TESTSIZE);
+	std::vector<Node> b_nodes(WBTREE_TESTSIZE / 4);
+	std::set<int> a_values;
+	std::set<int> b_values;
+	for (unsigned int i = 0; i < a_nodes.size(); ++i) {
+		a_nodes[i].data = static_cast<int>(2 * i);
+		a_values.insert(a_nodes[i].data);
+	}
+	for (unsigned int i = 0; i < b_nodes.size(); ++i) {
+		b_nodes[i].data = static_cast<int>(3 * i);
+		b_values.insert(b_nodes[i].data);
+	}
+
+	std::vector<int> union_values;
+	std::vector<int> intersection_values;
+	std::vector<int> difference_values;
+	std::set_union(a_values.begin(), a_values.end(), b_values.begin(),
+	               b_values.end(), std::back_inserter(union_values));
+	std::set_intersection(a_values.begin(), a_values.end(), b_values.begin(),
+	                      b_values.end(), std::back_inserter(intersection_values));
+	std::set_difference(a_values.begin(), a_values.end(), b_values.begin(),
+	                    b_values.end(), std::back_inserter(difference_values));
+
+	auto fill = [](Tree & t, std::vector<Node> & nodes) {
+		t.clear();
+		for (auto & n : nodes) {
+			t.insert(n);
+		}
+	};
+	auto check = [](const Tree & t, const std::vector<int> & values) {
+		ASSERT_TRUE(t.verify_integrity());
+		ASSERT_EQ(t.size(), values.size());
+		size_t i = 0;
+		for (auto & n : t) {
+			ASSERT_EQ(n.data, values[i]);
+			i++;
+		}
+	};
+
+	for (unsigned int parallel_depth : {0u, 3u}) {
+		Tree a;
+		Tree b;
+		Tree removed;
+
+		fill(a, a_nodes);
+		fill(b, b_nodes);
+		a.union_with(b, parallel_depth);
+		check(a, union_values);
+		check(b, intersection_values);
+		for (auto & n : b) {
+			ASSERT_TRUE((&n >= &b_nodes.front()) && (&n <= &b_nodes.back()));
+		}
+
+		fill(a, a_nodes);
+		fill(b, b_nodes);
+		a.intersect_with(b, removed, parallel_depth);
+		check(a, intersection_values);
+		check(removed, difference_values);
+		ASSERT_EQ(b.size(), b_nodes.size());
+
+		fill(a, a_nodes);
+		a.difference_with(b, removed, parallel_depth);
+		check(a, difference_values);
+		check(removed, intersection_values);
+	}
+
+	// With multiple equal nodes, the union keeps all of them
+	using MultiTree = WBTree<MultiNode, MultiNodeTraits, MULTI_FLAGS<>>;
+	std::vector<MultiNode> multi_a(WBTREE_TESTSIZE);
+	std::vector<MultiNode> multi_b(WBTREE_TESTSIZE / 2);
+	MultiTree ma;
+	MultiTree mb;
+	for (unsigned int i = 0; i < multi_a.size(); ++i) {
+		multi_a[i] = MultiNode(static_cast<int>(i / 2), static_cast<int>(i));
+		ma.insert(multi_a[i]);
+	}
+	for (unsigned int i = 0; i < multi_b.size(); ++i) {
+		multi_b[i] = MultiNode(static_cast<int>(2 * i), static_cast<int>(i));
+		mb.insert(multi_b[i]);
+	}
+	ma.union_with(mb, 2);
+	ASSERT_TRUE(ma.verify_integrity());
+	ASSERT_TRUE(mb.empty());
+	ASSERT_EQ(ma.size(), multi_a.size() + multi_b.size());
+	int last = -1;
+	for (auto & n : ma) {
+		ASSERT_GE(n.data, last);
+		last = n.data;
+	}
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), EraseRangeTest)
+{
+	using Tree = WBTree<MultiNode, MultiNodeTraits, MULTI_FLAGS<>>;
+
+	std::vector<MultiNode> nodes(WBTREE_TESTSIZE);
+	std::vector<size_t> indices;
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		// Every value appears twice
+		nodes[i] = MultiNode(static_cast<int>(i / 2), static_cast<int>(i));
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(WBTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	Tree removed;
+	tree.erase_range(100, 200, removed);
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_TRUE(removed.verify_integrity());
+	ASSERT_EQ(tree.size(), WBTREE_TESTSIZE - 200);
+	ASSERT_EQ(removed.size(), 200);
+	for (auto & n : removed) {
+		ASSERT_GE(n.data, 100);
+		ASSERT_LT(n.data, 200);
+	}
+
+	tree.erase_range(300, 250, removed);
+	ASSERT_TRUE(removed.empty());
+
+	std::vector<int> disposed;
+	tree.erase_range(0, 50, [&](MultiNode & n) { disposed.push_back(n.data); });
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_EQ(tree.size(), WBTREE_TESTSIZE - 300);
+	ASSERT_EQ(disposed.size(), 100);
+	ASSERT_TRUE(std::is_sorted(disposed.begin(), disposed.end()));
+
+	size_t pos = 0;
+	for (auto & n : tree) {
+		ASSERT_TRUE(((n.data >= 50) && (n.data < 100)) || (n.data >= 200));
+		ASSERT_EQ(tree.rank(tree.iterator_to(n)), pos);
+		pos++;
+	}
+}
+
+class RelativeLinkPool {
+public:
+	static void * base;
+
+	static void *
+	get_base() noexcept
+	{
+		return base;
+	}
+};
+void * RelativeLinkPool::base = nullptr;
+
+TEST(__WBT_BASENAME(WBTreeTest), PoolRelativeLinksTest)
+{
+	using RelativeOpt = TreeFlags::POOL_RELATIVE_LINKS<RelativeLinkPool>;
+	using MyNode = MultiNodeBase<RelativeOpt>;
+	using Tree = WBTree<MyNode, MultiNodeTraits, MULTI_FLAGS<RelativeOpt>>;
+
+	static_assert(sizeof(MyNode) < sizeof(MultiNode));
+
+	std::vector<MyNode> nodes(WBTREE_TESTSIZE);
+	RelativeLinkPool::base = nodes.data();
+
+	std::vector<size_t> indices;
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		nodes[i] = MyNode(static_cast<int>(i / 2), static_cast<int>(i));
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(WBTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+	ASSERT_TRUE(tree.verify_integrity());
+
+	int last = -1;
+	for (auto & n : tree) {
+		ASSERT_GE(n.data, last);
+		last = n.data;
+	}
+	ASSERT_EQ(tree.find(17)->data, 17);
+
+	Tree right;
+	tree.split(WBTREE_TESTSIZE / 4, right);
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_TRUE(right.verify_integrity());
+	ASSERT_EQ(tree.size(), WBTREE_TESTSIZE / 2);
+	tree.join(right);
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_EQ(tree.size(), WBTREE_TESTSIZE);
+
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[indices[i]]);
+		if (i % WBTREE_CHECK_INTERVAL == 0) {
+			ASSERT_TRUE(tree.verify_integrity());
+		}
+	}
+	ASSERT_TRUE(tree.verify_integrity());
+	ASSERT_EQ(tree.size(), WBTREE_TESTSIZE / 2);
+}
+
 TEST(__WBT_BASENAME(WBTreeTest), FindTest)
 {
 	auto tree = WBTree<Node, NodeTraits, DEFAULT_FLAGS<>>();
@@ -889,6 +1406,153 @@ TEST(__WBT_BASENAME(WBTreeTest), FindTest)
 	}
 }
 
+TEST(__WBT_BASENAME(WBTreeTest), FindBatchTest)
+{
+	auto tree = WBTree<Node, NodeTraits, DEFAULT_FLAGS<>>();
+
+	Node nodes[WBTREE_TESTSIZE];
+
+	for (unsigned int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		nodes[i] = Node(static_cast<int>(2 * i));
+		tree.insert(nodes[i]);
+	}
+
+	std::vector<int> queries;
+	for (unsigned int i = 0; i < 2 * WBTREE_TESTSIZE + 1; ++i) {
+		queries.push_back(static_cast<int>(i));
+	}
+	std::shuffle(queries.begin(), queries.end(),
+	             ygg::testing::utilities::Randomizer(4));
+
+	std::vector<decltype(tree.end())> results(queries.size());
+	tree.find_batch(queries.begin(), queries.end(), results.begin());
+
+	for (size_t i = 0; i < queries.size(); ++i) {
+		ASSERT_EQ(results[i], tree.find(queries[i]));
+	}
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), FindOrPrepareInsertTest)
+{
+	auto tree = WBTree<Node, NodeTraits, DEFAULT_FLAGS<>>();
+
+	// Every key is offered twice, only one of the nodes may be inserted
+	std::vector<Node> nodes;
+	for (int i = 0; i < 2 * WBTREE_TESTSIZE; ++i) {
+		nodes.emplace_back(i % WBTREE_TESTSIZE);
+	}
+	std::shuffle(nodes.begin(), nodes.end(),
+	             ygg::testing::utilities::Randomizer(WBTREE_SEED));
+
+	for (auto & n : nodes) {
+		auto handle = tree.find_or_prepare_insert(n.data);
+		if (handle.found()) {
+			ASSERT_EQ(handle.get_node()->data, n.data);
+			ASSERT_NE(handle.get_node(), &n);
+		} else {
+			ASSERT_EQ(handle.get_node(), nullptr);
+			tree.insert_at(handle, n);
+		}
+	}
+
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), static_cast<size_t>(WBTREE_TESTSIZE));
+
+	int expected = 0;
+	for (auto & n : tree) {
+		ASSERT_EQ(n.data, expected);
+		expected++;
+	}
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), HintedSearchTest)
+{
+	auto tree = WBTree<MultiNode, MultiNodeTraits, MULTI_FLAGS<>>();
+
+	// Every even key appears twice
+	std::vector<MultiNode> nodes;
+	for (int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		nodes.emplace_back((i / 2) * 2);
+	}
+	std::shuffle(nodes.begin(), nodes.end(),
+	             ygg::testing::utilities::Randomizer(WBTREE_SEED));
+	for (auto & n : nodes) {
+		tree.insert(n);
+	}
+	tree.dbg_verify();
+
+	std::vector<decltype(tree.begin())> hints;
+	for (auto it = tree.begin(); it != tree.end(); ++it) {
+		hints.push_back(it);
+	}
+	hints.push_back(tree.end());
+
+	auto prev_lower = tree.end();
+	auto prev_upper = tree.end();
+	for (int q = -1; q <= WBTREE_TESTSIZE + 1; ++q) {
+		auto lower = tree.lower_bound(q);
+		auto upper = tree.upper_bound(q);
+
+		ASSERT_TRUE(tree.lower_bound(q, prev_lower) == lower);
+		ASSERT_TRUE(tree.upper_bound(q, prev_upper) == upper);
+		ASSERT_TRUE(tree.find(q, prev_lower) == tree.find(q));
+
+		for (size_t i = 0; i < hints.size(); i += 251) {
+			size_t hint_index = (i + static_cast<size_t>(q + 1)) % hints.size();
+			ASSERT_TRUE(tree.lower_bound(q, hints[hint_index]) == lower);
+			ASSERT_TRUE(tree.upper_bound(q, hints[hint_index]) == upper);
+		}
+
+		prev_lower = lower;
+		prev_upper = upper;
+	}
+}
+
+TEST(__WBT_BASENAME(WBTreeTest), UpdateKeyTest)
+{
+	auto tree = WBTree<MultiNode, MultiNodeTraits, MULTI_FLAGS<>>();
+
+	std::vector<MultiNode> nodes;
+	for (int i = 0; i < WBTREE_TESTSIZE; ++i) {
+		nodes.emplace_back(4 * i);
+	}
+	for (auto & n : nodes) {
+		tree.insert(n);
+	}
+
+	// Mostly small moves, which often keep the node in place, and some far
+	// jumps
+	std::mt19937 rng(WBTREE_SEED);
+	std::uniform_int_distribution<size_t> index_distr(0, nodes.size() - 1);
+	std::uniform_int_distribution<int> small_distr(-6, 6);
+	std::uniform_int_distribution<int> far_distr(-4 * WBTREE_TESTSIZE,
+	                                             4 * WBTREE_TESTSIZE);
+
+	for (int i = 0; i < 2 * WBTREE_TESTSIZE; ++i) {
+		auto & n = nodes[index_distr(rng)];
+		int delta = (i % 4 == 0) ? far_distr(rng) : small_distr(rng);
+		tree.update_key(n, [&](MultiNode & to_change) { to_change.data += delta; });
+
+		if (i % 100 == 0) {
+			tree.dbg_verify();
+		}
+	}
+
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), static_cast<size_t>(WBTREE_TESTSIZE));
+
+	std::vector<int> expected;
+	for (auto & n : nodes) {
+		expected.push_back(n.data);
+	}
+	std::sort(expected.begin(), expected.end());
+	auto expected_it = expected.begin();
+	for (auto & n : tree) {
+		ASSERT_EQ(n.data, *expected_it);
+		++expected_it;
+	}
+}
+
 TEST(__WBT_BASENAME(WBTreeTest), ComprehensiveTest)
 {
 	auto tree = WBTree<Node, NodeTraits, DEFAULT_FLAGS<>>();
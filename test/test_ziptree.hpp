@@ -6,7 +6,11 @@
 
 #include <algorithm>
 #include <gtest/gtest.h>
+#include <numeric>
 #include <random>
+#include <set>
+#include <sstream>
+#include <thread>
 #include <vector>
 
 namespace ygg {
@@ -198,6 +202,50 @@ using ImplicitRankTreeBase =
           ImplicitRankOptions<AddOpt>>;
 using ImplicitRankTree = ImplicitRankTreeBase<>;
 
+using FastRankOptions =
+    ygg::TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                     TreeFlags::ZTREE_RANK_TYPE<std::uint8_t>,
+                     TreeFlags::ZTREE_FAST_RANDOM_RANKS>;
+using ZipZipRankOptions =
+    ygg::TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                     TreeFlags::ZTREE_RANK_TYPE<std::uint32_t>,
+                     TreeFlags::ZTREE_ZIPZIP_RANKS>;
+using FastZipZipRankOptions =
+    ygg::TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+                     TreeFlags::ZTREE_RANK_TYPE<std::uint16_t>,
+                     TreeFlags::ZTREE_ZIPZIP_RANKS,
+                     TreeFlags::ZTREE_FAST_RANDOM_RANKS>;
+
+template <class MyOptions>
+class RandomRankNode
+    : public ZTreeNodeBase<RandomRankNode<MyOptions>, MyOptions> {
+public:
+	int data;
+
+	RandomRankNode() : data(0){};
+	explicit RandomRankNode(int data_in) : data(data_in){};
+
+	bool
+	operator<(const RandomRankNode<MyOptions> & other) const
+	{
+		return this->data < other.data;
+	}
+
+	void
+	rerandomize()
+	{
+		this->update_rank();
+	}
+};
+
+template <class MyOptions>
+using RandomRankTree =
+    ZTree<RandomRankNode<MyOptions>,
+          ZTreeDefaultNodeTraits<RandomRankNode<MyOptions>>, MyOptions>;
+
+using FastRankNode = RandomRankNode<FastRankOptions>;
+using FastRankTree = RandomRankTree<FastRankOptions>;
+
 TEST(ZipTreeTest, TrivialInsertionTest)
 {
 	ExplicitRankTree tree;
@@ -250,6 +298,214 @@ TEST(ZipTreeTest, TrivialFindTest)
 	ASSERT_TRUE(itree.find(5) == itree.end());
 }
 
+TEST(ZipTreeTest, FindBatchTest)
+{
+	ImplicitRankTree tree;
+
+	std::vector<HashRankNode> nodes(ZIPTREE_TESTSIZE);
+	for (unsigned int i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i].set_from(HashRankNode(static_cast<int>(2 * i)));
+		tree.insert(nodes[i]);
+	}
+	tree.dbg_verify();
+
+	std::vector<int> queries;
+	for (unsigned int i = 0; i < 2 * ZIPTREE_TESTSIZE + 1; ++i) {
+		queries.push_back(static_cast<int>(i));
+	}
+	std::shuffle(queries.begin(), queries.end(),
+	             ygg::testing::utilities::Randomizer(ZIPTREE_SEED));
+
+	std::vector<decltype(tree.end())> results(queries.size());
+	tree.find_batch<4>(queries.begin(), queries.end(), results.begin());
+
+	for (size_t i = 0; i < queries.size(); ++i) {
+		ASSERT_EQ(results[i], tree.find(queries[i]));
+		if ((queries[i] % 2 == 0) &&
+		    (queries[i] < static_cast<int>(2 * ZIPTREE_TESTSIZE))) {
+			ASSERT_EQ(&(*results[i]), &nodes[static_cast<size_t>(queries[i] / 2)]);
+		}
+	}
+}
+
+TEST(ZipTreeTest, FindOrPrepareInsertTest)
+{
+	// Few distinct ranks lead to many rank ties
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::uniform_int_distribution<int> rank_distr(0, 7);
+
+	// Every key is offered twice, only one of the nodes may be inserted
+	std::vector<Node> nodes;
+	for (size_t i = 0; i < 2 * ZIPTREE_TESTSIZE; ++i) {
+		nodes.emplace_back(static_cast<int>(i % ZIPTREE_TESTSIZE), rank_distr(rng));
+	}
+	std::shuffle(nodes.begin(), nodes.end(),
+	             ygg::testing::utilities::Randomizer(ZIPTREE_SEED));
+	std::vector<Node> reference_nodes = nodes;
+
+	ExplicitRankTree tree;
+	ExplicitRankTree reference;
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		auto handle = tree.find_or_prepare_insert(nodes[i].data);
+		if (handle.found()) {
+			ASSERT_EQ(handle.get_node()->data, nodes[i].data);
+		} else {
+			tree.insert_at(handle, nodes[i]);
+			reference.insert(reference_nodes[i]);
+		}
+	}
+
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE);
+
+	// Must have built exactly the same tree as insert()
+	auto ref_it = reference.begin();
+	int expected = 0;
+	for (auto & n : tree) {
+		ASSERT_EQ(n.data, expected);
+		ASSERT_EQ(n.get_depth(), ref_it->get_depth());
+		expected++;
+		ref_it++;
+	}
+}
+
+TEST(ZipTreeTest, HintedSearchTest)
+{
+	using NoParentOpt = TreeFlags::NO_PARENT_POINTERS<>;
+	using NoParentNode = NodeBase<NoParentOpt>;
+
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::geometric_distribution<int> rank_distr(0.5);
+
+	// Every even key appears twice
+	std::vector<Node> nodes;
+	std::vector<NoParentNode> no_parent_nodes;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		int rank = rank_distr(rng);
+		nodes.emplace_back(static_cast<int>((i / 2) * 2), rank);
+		no_parent_nodes.emplace_back(static_cast<int>((i / 2) * 2), rank);
+	}
+
+	auto check = [](auto & tree) {
+		std::vector<decltype(tree.begin())> hints;
+		for (auto it = tree.begin(); it != tree.end(); ++it) {
+			hints.push_back(it);
+		}
+		hints.push_back(tree.end());
+
+		auto prev_lower = tree.end();
+		auto prev_upper = tree.end();
+		for (int q = -1; q <= static_cast<int>(ZIPTREE_TESTSIZE) + 1; ++q) {
+			auto lower = tree.lower_bound(q);
+			auto upper = tree.upper_bound(q);
+
+			ASSERT_TRUE(tree.lower_bound(q, prev_lower) == lower);
+			ASSERT_TRUE(tree.upper_bound(q, prev_upper) == upper);
+			ASSERT_TRUE(tree.find(q, prev_lower) == tree.find(q));
+
+			for (size_t i = 0; i < hints.size(); i += 251) {
+				size_t hint_index = (i + static_cast<size_t>(q + 1)) % hints.size();
+				ASSERT_TRUE(tree.lower_bound(q, hints[hint_index]) == lower);
+				ASSERT_TRUE(tree.upper_bound(q, hints[hint_index]) == upper);
+			}
+
+			prev_lower = lower;
+			prev_upper = upper;
+		}
+	};
+
+	ExplicitRankTree tree;
+	for (auto & n : nodes) {
+		tree.insert(n);
+	}
+	tree.dbg_verify();
+	check(tree);
+
+	// Without parent pointers, the search climbs along the iterator's path
+	ExplicitRankTreeBase<NoParentOpt> no_parent_tree;
+	for (auto & n : no_parent_nodes) {
+		no_parent_tree.insert(n);
+	}
+	no_parent_tree.dbg_verify();
+	check(no_parent_tree);
+}
+
+TEST(ZipTreeTest, UpdateKeyTest)
+{
+	using NoParentOpt = TreeFlags::NO_PARENT_POINTERS<>;
+
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::geometric_distribution<int> rank_distr(0.5);
+	std::uniform_int_distribution<int> small_distr(-6, 6);
+	std::uniform_int_distribution<int> far_distr(
+	    -4 * static_cast<int>(ZIPTREE_TESTSIZE),
+	    4 * static_cast<int>(ZIPTREE_TESTSIZE));
+
+	// Mostly small moves, which often keep the node in place, and some far
+	// jumps. Every few moves also change the rank.
+	auto run = [&](auto & tree, auto & nodes, auto change_rank) {
+		using MyNode = std::decay_t<decltype(nodes[0])>;
+
+		for (auto & n : nodes) {
+			tree.insert(n);
+		}
+
+		std::uniform_int_distribution<size_t> index_distr(0, nodes.size() - 1);
+		for (size_t i = 0; i < 2 * ZIPTREE_TESTSIZE; ++i) {
+			auto & n = nodes[index_distr(rng)];
+			int delta = (i % 4 == 0) ? far_distr(rng) : small_distr(rng);
+			int new_rank = rank_distr(rng);
+			tree.update_key(n, [&](MyNode & to_change) {
+				to_change.data += delta;
+				if (i % 5 == 0) {
+					change_rank(to_change, new_rank);
+				}
+			});
+
+			if (i % 100 == 0) {
+				tree.dbg_verify();
+			}
+		}
+
+		tree.dbg_verify();
+		ASSERT_EQ(tree.size(), nodes.size());
+
+		std::vector<int> expected;
+		for (auto & n : nodes) {
+			expected.push_back(n.data);
+		}
+		std::sort(expected.begin(), expected.end());
+		auto expected_it = expected.begin();
+		for (auto & n : tree) {
+			ASSERT_EQ(n.data, *expected_it);
+			++expected_it;
+		}
+	};
+
+	auto set_rank = [](auto & n, int rank) { n.rank = rank; };
+	auto keep_rank = [](auto &, int) {};
+
+	std::vector<Node> nodes;
+	std::vector<NodeBase<NoParentOpt>> no_parent_nodes;
+	std::vector<HashRankNode> hash_nodes;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		int rank = rank_distr(rng);
+		nodes.emplace_back(static_cast<int>(4 * i), rank);
+		no_parent_nodes.emplace_back(static_cast<int>(4 * i), rank);
+		hash_nodes.emplace_back(static_cast<int>(4 * i));
+	}
+
+	ExplicitRankTree tree;
+	run(tree, nodes, set_rank);
+
+	ExplicitRankTreeBase<NoParentOpt> no_parent_tree;
+	run(no_parent_tree, no_parent_nodes, set_rank);
+
+	// Ranks are derived from the keys here
+	ImplicitRankTree hash_tree;
+	run(hash_tree, hash_nodes, keep_rank);
+}
+
 TEST(ZipTreeTest, TrivialUnzippingTest)
 {
 	ExplicitRankTree tree;
@@ -434,6 +690,1043 @@ TEST(ZipTreeTest, InsertionAndDeletionTest)
 	ASSERT_TRUE(iit == itree.end());
 }
 
+TEST(ZipTreeTest, FastRandomRanksTest)
+{
+	std::vector<FastRankNode> nodes(ZIPTREE_TESTSIZE);
+	std::vector<size_t> ranks;
+
+	// Seeding makes the ranks reproducible
+	ZTreeFastRandom::seed(ZIPTREE_SEED);
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i);
+		nodes[i].rerandomize();
+		ranks.push_back(nodes[i].dbg_get_rank());
+	}
+	ZTreeFastRandom::seed(ZIPTREE_SEED);
+	size_t rank_one = 0;
+	size_t rank_two = 0;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i].rerandomize();
+		ASSERT_EQ(nodes[i].dbg_get_rank(), ranks[i]);
+		ASSERT_GE(ranks[i], 1u);
+		ASSERT_LE(ranks[i], 64u);
+		rank_one += (ranks[i] == 1) ? 1 : 0;
+		rank_two += (ranks[i] == 2) ? 1 : 0;
+	}
+
+	// Ranks must be geometrically distributed
+	ASSERT_GT(rank_one, ZIPTREE_TESTSIZE * 45 / 100);
+	ASSERT_LT(rank_one, ZIPTREE_TESTSIZE * 55 / 100);
+	ASSERT_GT(rank_two, ZIPTREE_TESTSIZE * 20 / 100);
+	ASSERT_LT(rank_two, ZIPTREE_TESTSIZE * 30 / 100);
+
+	std::vector<size_t> indices;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(ZIPTREE_SEED));
+
+	FastRankTree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+	tree.dbg_verify();
+
+	int expected = 0;
+	for (const auto & n : tree) {
+		ASSERT_EQ(n.data, expected);
+		expected++;
+	}
+	ASSERT_EQ(static_cast<size_t>(expected), ZIPTREE_TESTSIZE);
+	tree.clear();
+
+	// Every thread draws from its own generator into its own tree
+	constexpr size_t thread_count = 4;
+	std::vector<std::vector<FastRankNode>> thread_nodes(thread_count);
+	std::vector<FastRankTree> trees(thread_count);
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < thread_count; ++t) {
+		threads.emplace_back([&, t]() {
+			thread_nodes[t] = std::vector<FastRankNode>(ZIPTREE_TESTSIZE);
+			for (auto index : indices) {
+				thread_nodes[t][index].data = static_cast<int>(index);
+				thread_nodes[t][index].rerandomize();
+				trees[t].insert(thread_nodes[t][index]);
+			}
+		});
+	}
+	for (auto & thread : threads) {
+		thread.join();
+	}
+
+	for (size_t t = 0; t < thread_count; ++t) {
+		trees[t].dbg_verify();
+		ASSERT_EQ(trees[t].size(), ZIPTREE_TESTSIZE);
+		trees[t].clear();
+	}
+}
+
+template <class MyOptions>
+double
+zipzip_average_depth(std::vector<size_t> & ranks, unsigned int seed)
+{
+	std::vector<RandomRankNode<MyOptions>> nodes(ZIPTREE_TESTSIZE);
+	RandomRankTree<MyOptions> tree;
+
+	std::srand(seed);
+	ZTreeFastRandom::seed(seed);
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i);
+		nodes[i].rerandomize();
+		ranks.push_back(nodes[i].dbg_get_rank());
+		tree.insert(nodes[i]);
+	}
+	tree.dbg_verify();
+
+	size_t depth_sum = 0;
+	int expected = 0;
+	for (const auto & n : tree) {
+		EXPECT_EQ(n.data, expected);
+		expected++;
+		depth_sum += n.get_depth();
+	}
+
+	// Remove every other node
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[i]);
+	}
+	tree.dbg_verify();
+	EXPECT_EQ(tree.size(), ZIPTREE_TESTSIZE / 2);
+
+	tree.clear();
+	return static_cast<double>(depth_sum) /
+	       static_cast<double>(ZIPTREE_TESTSIZE);
+}
+
+TEST(ZipTreeTest, ZipZipRanksTest)
+{
+	std::vector<size_t> plain_ranks;
+	std::vector<size_t> zipzip_ranks;
+	std::vector<size_t> fast_zipzip_ranks;
+
+	double plain_depth = 0;
+	double zipzip_depth = 0;
+	double fast_zipzip_depth = 0;
+	for (unsigned int seed = 1; seed <= 10; ++seed) {
+		plain_depth += zipzip_average_depth<FastRankOptions>(plain_ranks, seed);
+		zipzip_depth +=
+		    zipzip_average_depth<ZipZipRankOptions>(zipzip_ranks, seed);
+		fast_zipzip_depth +=
+		    zipzip_average_depth<FastZipZipRankOptions>(fast_zipzip_ranks, seed);
+	}
+	plain_depth /= 10;
+	zipzip_depth /= 10;
+	fast_zipzip_depth /= 10;
+
+	// The geometric part of the rank is stored above the secondary part
+	size_t rank_one = 0;
+	std::set<size_t> secondary_ranks;
+	for (size_t rank : zipzip_ranks) {
+		ASSERT_GE(rank >> 25, 1u);
+		ASSERT_LE(rank >> 25, 64u);
+		rank_one += ((rank >> 25) == 1) ? 1 : 0;
+		secondary_ranks.insert(rank & ((1u << 25) - 1));
+	}
+	ASSERT_GT(rank_one, zipzip_ranks.size() * 45 / 100);
+	ASSERT_LT(rank_one, zipzip_ranks.size() * 55 / 100);
+	ASSERT_GT(secondary_ranks.size(), zipzip_ranks.size() * 99 / 100);
+
+	// Secondary ranks spread over the nine available bits
+	secondary_ranks.clear();
+	for (size_t rank : fast_zipzip_ranks) {
+		ASSERT_GE(rank >> 9, 1u);
+		ASSERT_LE(rank >> 9, 64u);
+		secondary_ranks.insert(rank & ((1u << 9) - 1));
+	}
+	ASSERT_EQ(secondary_ranks.size(), 512u);
+
+	// With sorted insertion, the expected depth of a node drops from about
+	// 1.5 log n to about 1.39 log n, i.e., by roughly seven percent.
+	ASSERT_LT(zipzip_depth, 0.97 * plain_depth);
+	ASSERT_LT(fast_zipzip_depth, 0.97 * plain_depth);
+}
+
+TEST(ZipTreeTest, CompressedRanksTest)
+{
+	using CompressedRankOptions =
+	    ygg::TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+	                     TreeFlags::ZTREE_RANK_TYPE<std::uint8_t>,
+	                     TreeFlags::ZTREE_FAST_RANDOM_RANKS,
+	                     TreeFlags::ZTREE_COMPRESS_RANK>;
+	using MyNode = RandomRankNode<CompressedRankOptions>;
+	using Tree = RandomRankTree<CompressedRankOptions>;
+
+	// The rank takes no space of its own
+	ASSERT_EQ(sizeof(ZTreeNodeBase<MyNode, CompressedRankOptions>),
+	          3 * sizeof(void *));
+	ASSERT_GT(sizeof(ZTreeNodeBase<FastRankNode, FastRankOptions>),
+	          3 * sizeof(void *));
+
+	// The same seed yields the same ranks as with separately stored ranks
+	std::vector<FastRankNode> plain_nodes(ZIPTREE_TESTSIZE);
+	ZTreeFastRandom::seed(ZIPTREE_SEED);
+	for (auto & n : plain_nodes) {
+		n.rerandomize();
+	}
+	ZTreeFastRandom::seed(ZIPTREE_SEED);
+	std::vector<MyNode> nodes(ZIPTREE_TESTSIZE);
+	std::vector<size_t> ranks;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i);
+		ranks.push_back(nodes[i].dbg_get_rank());
+		ASSERT_EQ(ranks[i], plain_nodes[i].dbg_get_rank());
+	}
+
+	std::vector<size_t> indices(ZIPTREE_TESTSIZE);
+	std::iota(indices.begin(), indices.end(), size_t{0});
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(ZIPTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+	tree.dbg_verify();
+
+	// Setting parents must leave the ranks alone, and vice versa
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[i]);
+	}
+	tree.dbg_verify();
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		ASSERT_EQ(nodes[i].dbg_get_rank(), ranks[i]);
+	}
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; i += 2) {
+		nodes[i].rerandomize();
+		tree.insert(nodes[i]);
+	}
+	tree.dbg_verify();
+
+	int expected = 0;
+	for (const auto & n : tree) {
+		ASSERT_EQ(n.data, expected);
+		expected++;
+	}
+	ASSERT_EQ(static_cast<size_t>(expected), ZIPTREE_TESTSIZE);
+
+	// Ranks are part of the written structure
+	std::ostringstream out;
+	tree.write_structure(nodes.data(), out);
+	const std::string data = out.str();
+	std::vector<MyNode> copies(ZIPTREE_TESTSIZE);
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		copies[i].data = nodes[i].data;
+	}
+	Tree restored;
+	ASSERT_TRUE(restored.restore_structure(copies.data(), copies.size(),
+	                                       data.data(), data.size()));
+	restored.dbg_verify();
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		ASSERT_EQ(copies[i].dbg_get_rank(), nodes[i].dbg_get_rank());
+	}
+}
+
+TEST(ZipTreeTest, BuildFromSortedTest)
+{
+	ExplicitRankTree tree;
+	ImplicitRankTree itree;
+
+	std::vector<Node> nodes(ZIPTREE_TESTSIZE);
+	std::vector<HashRankNode> inodes(ZIPTREE_TESTSIZE);
+
+	// Few different ranks, such that there are many ties
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::uniform_int_distribution<int> rank_distr(0, 7);
+
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		// Every value appears three times
+		nodes[i] = Node(static_cast<int>(i / 3), rank_distr(rng));
+		inodes[i].set_from(HashRankNode(static_cast<int>(i)));
+	}
+
+	tree.build_from_sorted(nodes.begin(), nodes.end());
+	itree.build_from_sorted(inodes.begin(), inodes.end());
+	tree.dbg_verify();
+	itree.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE);
+	ASSERT_EQ(itree.size(), ZIPTREE_TESTSIZE);
+
+	// Equal nodes may have been reordered
+	std::set<const Node *> seen;
+	size_t i = 0;
+	for (auto & node : tree) {
+		ASSERT_EQ(node.get_data(), static_cast<int>(i / 3));
+		seen.insert(&node);
+		i++;
+	}
+	ASSERT_EQ(seen.size(), ZIPTREE_TESTSIZE);
+
+	i = 0;
+	for (auto & node : itree) {
+		ASSERT_EQ(&node, &inodes[i]);
+		i++;
+	}
+
+	// Rebuilding must discard the old contents
+	tree.build_from_sorted(nodes.begin(), nodes.begin() + 10);
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), 10);
+
+	// Subsequent operations must work on the built tree
+	tree.build_from_sorted(nodes.begin(), nodes.end());
+	for (size_t j = 0; j < ZIPTREE_TESTSIZE; j += 2) {
+		tree.remove(nodes[j]);
+		itree.remove(inodes[j]);
+	}
+	tree.dbg_verify();
+	itree.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE / 2);
+	ASSERT_EQ(itree.size(), ZIPTREE_TESTSIZE / 2);
+}
+
+TEST(ZipTreeTest, RelayoutTest)
+{
+	ygg::ZTreeFastRandom::seed(ZIPTREE_SEED);
+
+	std::vector<FastRankNode> nodes(ZIPTREE_TESTSIZE);
+	std::vector<size_t> indices;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i].data = static_cast<int>(i / 2);
+		nodes[i].rerandomize();
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(ZIPTREE_SEED));
+
+	FastRankTree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	std::vector<FastRankNode> arena(ZIPTREE_TESTSIZE);
+	size_t relocated = 0;
+	tree.relayout(arena.data(), [&](FastRankNode & old_node,
+	                                FastRankNode & new_node) {
+		ASSERT_EQ(old_node.data, new_node.data);
+		ASSERT_EQ(old_node.dbg_get_rank(), new_node.dbg_get_rank());
+		relocated++;
+	});
+	tree.dbg_verify();
+	ASSERT_EQ(relocated, ZIPTREE_TESTSIZE);
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE);
+	ASSERT_EQ(tree.get_root(), arena.data());
+
+	int last = -1;
+	for (auto & n : tree) {
+		ASSERT_GE(&n, arena.data());
+		ASSERT_LT(&n, arena.data() + ZIPTREE_TESTSIZE);
+		ASSERT_GE(n.data, last);
+		last = n.data;
+	}
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; i += 2) {
+		tree.remove(arena[i]);
+	}
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE / 2);
+
+	// Without parent pointers, only the child links must be fixed
+	using NoParentOpt = TreeFlags::NO_PARENT_POINTERS<>;
+	using MyNode = NodeBase<NoParentOpt>;
+	using Tree = ExplicitRankTreeBase<NoParentOpt>;
+
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::geometric_distribution<int> rank_distr(0.5);
+	std::vector<MyNode> np_nodes(ZIPTREE_TESTSIZE);
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		np_nodes[i] = MyNode(static_cast<int>(i), rank_distr(rng));
+	}
+	Tree np_tree;
+	for (auto index : indices) {
+		np_tree.insert(np_nodes[index]);
+	}
+	std::vector<MyNode> np_arena(ZIPTREE_TESTSIZE);
+	np_tree.relayout(np_arena.data(), [](MyNode &, MyNode &) {});
+	np_tree.dbg_verify();
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		auto it = np_tree.find(static_cast<int>(i));
+		ASSERT_EQ(it->data, static_cast<int>(i));
+		ASSERT_GE(&*it, np_arena.data());
+		ASSERT_LT(&*it, np_arena.data() + ZIPTREE_TESTSIZE);
+	}
+}
+
+TEST(ZipTreeTest, StructureTest)
+{
+	using MyNode = RandomRankNode<ZipZipRankOptions>;
+	using Tree = RandomRankTree<ZipZipRankOptions>;
+
+	std::vector<MyNode> nodes;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes.emplace_back(static_cast<int>(i / 2));
+	}
+	std::vector<size_t> indices(ZIPTREE_TESTSIZE);
+	std::iota(indices.begin(), indices.end(), size_t{0});
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(ZIPTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+
+	std::ostringstream out;
+	tree.write_structure(nodes.data(), out);
+	const std::string data = out.str();
+	ASSERT_EQ(data.size(), 16 + (5 + sizeof(std::uint32_t)) * ZIPTREE_TESTSIZE);
+
+	// Freshly constructed nodes have new random ranks
+	std::vector<MyNode> copies;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		copies.emplace_back(nodes[i].data);
+	}
+	Tree restored;
+	ASSERT_TRUE(restored.restore_structure(copies.data(), copies.size(),
+	                                       data.data(), data.size()));
+	restored.dbg_verify();
+	ASSERT_EQ(restored.size(), ZIPTREE_TESTSIZE);
+	ASSERT_EQ(restored.get_root() - copies.data(),
+	          tree.get_root() - nodes.data());
+
+	auto it = tree.begin();
+	for (auto & n : restored) {
+		ASSERT_EQ(&n - copies.data(), &(*it) - nodes.data());
+		ASSERT_EQ(n.dbg_get_rank(), it->dbg_get_rank());
+		++it;
+	}
+	ASSERT_EQ(it, tree.end());
+
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; i += 2) {
+		restored.remove(copies[i]);
+	}
+	restored.dbg_verify();
+	ASSERT_EQ(restored.size(), ZIPTREE_TESTSIZE / 2);
+
+	// Ranks of a different size are rejected
+	FastRankTree fast_tree;
+	std::vector<FastRankNode> fast_nodes(ZIPTREE_TESTSIZE);
+	ASSERT_FALSE(fast_tree.restore_structure(
+	    fast_nodes.data(), fast_nodes.size(), data.data(), data.size()));
+	ASSERT_TRUE(fast_tree.empty());
+
+	// Without parent pointers, the tree is restored just the same
+	using NoParentOpt = TreeFlags::NO_PARENT_POINTERS<>;
+	using NPNode = NodeBase<NoParentOpt>;
+	using NPTree = ExplicitRankTreeBase<NoParentOpt>;
+
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::geometric_distribution<int> rank_distr(0.5);
+	std::vector<NPNode> np_nodes(ZIPTREE_TESTSIZE);
+	std::vector<NPNode> np_copies(ZIPTREE_TESTSIZE);
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		np_nodes[i] = NPNode(static_cast<int>(i), rank_distr(rng));
+		np_copies[i] = NPNode(np_nodes[i].data, np_nodes[i].rank);
+	}
+	NPTree np_tree;
+	for (auto index : indices) {
+		np_tree.insert(np_nodes[index]);
+	}
+	std::ostringstream np_out;
+	np_tree.write_structure(np_nodes.data(), np_out);
+	const std::string np_data = np_out.str();
+
+	NPTree np_restored;
+	ASSERT_TRUE(np_restored.restore_structure(np_copies.data(), np_copies.size(),
+	                                          np_data.data(), np_data.size()));
+	np_restored.dbg_verify();
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		auto found = np_restored.find(static_cast<int>(i));
+		ASSERT_EQ(&*found, &np_copies[i]);
+	}
+}
+
+TEST(ZipTreeTest, SplitJoinTest)
+{
+	ExplicitRankTree tree;
+	ImplicitRankTree itree;
+
+	std::vector<Node> nodes(ZIPTREE_TESTSIZE);
+	std::vector<HashRankNode> inodes(ZIPTREE_TESTSIZE);
+
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::uniform_int_distribution<int> rank_distr(0, 7);
+
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i] = Node(static_cast<int>(i), rank_distr(rng));
+		inodes[i].set_from(HashRankNode(static_cast<int>(i)));
+		tree.insert(nodes[i]);
+		itree.insert(inodes[i]);
+	}
+
+	std::uniform_int_distribution<int> key_distr(
+	    -1, static_cast<int>(ZIPTREE_TESTSIZE));
+	for (unsigned int round = 0; round < 50; ++round) {
+		int key = key_distr(rng);
+		size_t expected_left = static_cast<size_t>(
+		    std::clamp(key, 0, static_cast<int>(ZIPTREE_TESTSIZE)));
+
+		ExplicitRankTree right;
+		ImplicitRankTree iright;
+		tree.split(key, right);
+		itree.split(key, iright);
+
+		tree.dbg_verify();
+		right.dbg_verify();
+		itree.dbg_verify();
+		iright.dbg_verify();
+		ASSERT_EQ(tree.size(), expected_left);
+		ASSERT_EQ(right.size(), ZIPTREE_TESTSIZE - expected_left);
+		ASSERT_EQ(itree.size(), expected_left);
+		ASSERT_EQ(iright.size(), ZIPTREE_TESTSIZE - expected_left);
+
+		if ((round % 2 == 0) || (expected_left == ZIPTREE_TESTSIZE)) {
+			tree.join(right);
+			itree.join(iright);
+		} else {
+			// Use the smallest node of the right part as pivot
+			right.remove(nodes[expected_left]);
+			tree.join(nodes[expected_left], right);
+			itree.join(iright);
+		}
+
+		ASSERT_TRUE(right.empty());
+		ASSERT_TRUE(iright.empty());
+		tree.dbg_verify();
+		itree.dbg_verify();
+		ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE);
+		ASSERT_EQ(itree.size(), ZIPTREE_TESTSIZE);
+
+		size_t i = 0;
+		for (auto & node : tree) {
+			ASSERT_EQ(&node, &nodes[i]);
+			i++;
+		}
+		i = 0;
+		for (auto & node : itree) {
+			ASSERT_EQ(&node, &inodes[i]);
+			i++;
+		}
+	}
+}
+
+TEST(ZipTreeTest, SetOperationsTest)
+{
+	using UniqueOptions = ygg::TreeOptions<TreeFlags::CONSTANT_TIME_SIZE,
+	                                       TreeFlags::ZTREE_RANK_TYPE<int>>;
+	class UniqueNode : public ZTreeNodeBase<UniqueNode, UniqueOptions> {
+	public:
+		int data = 0;
+		int rank = 0;
+
+		bool
+		operator<(const UniqueNode & other) const
+		{
+			return this->data < other.data;
+		}
+	};
+	struct UniqueRankGetter
+	{
+		static size_t
+		get_rank(const UniqueNode & n)
+		{
+			return static_cast<size_t>(n.rank);
+		}
+	};
+	using UniqueTree =
+	    ZTree<UniqueNode, ZTreeDefaultNodeTraits<UniqueNode>, UniqueOptions, int,
+	          ygg::utilities::flexible_less, UniqueRankGetter>;
+
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::uniform_int_distribution<int> rank_distr(0, 7);
+
+	std::vector<UniqueNode> a_nodes(ZIPTREE_TESTSIZE);
+	std::vector<UniqueNode> b_nodes(ZIPTREE_TESTSIZE / 4);
+	std::set<int> a_values;
+	std::set<int> b_values;
+	for (size_t i = 0; i < a_nodes.size(); ++i) {
+		a_nodes[i].data = static_cast<int>(2 * i);
+		a_nodes[i].rank = rank_distr(rng);
+		a_values.insert(a_nodes[i].data);
+	}
+	for (size_t i = 0; i < b_nodes.size(); ++i) {
+		b_nodes[i].data = static_cast<int>(3 * i);
+		b_nodes[i].rank = rank_distr(rng);
+		b_values.insert(b_nodes[i].data);
+	}
+
+	std::vector<int> union_values;
+	std::vector<int> intersection_values;
+	std::vector<int> difference_values;
+	std::set_union(a_values.begin(), a_values.end(), b_values.begin(),
+	               b_values.end(), std::back_inserter(union_values));
+	std::set_intersection(a_values.begin(), a_values.end(), b_values.begin(),
+	                      b_values.end(), std::back_inserter(intersection_values));
+	std::set_difference(a_values.begin(), a_values.end(), b_values.begin(),
+	                    b_values.end(), std::back_inserter(difference_values));
+
+	auto fill = [](UniqueTree & t, std::vector<UniqueNode> & nodes) {
+		t.clear();
+		for (auto & n : nodes) {
+			t.insert(n);
+		}
+	};
+	auto check = [](const UniqueTree & t, const std::vector<int> & values) {
+		t.dbg_verify();
+		ASSERT_EQ(t.size(), values.size());
+		size_t i = 0;
+		for (auto & n : t) {
+			ASSERT_EQ(n.data, values[i]);
+			i++;
+		}
+	};
+
+	for (unsigned int parallel_depth : {0u, 3u}) {
+		UniqueTree a;
+		UniqueTree b;
+		UniqueTree removed;
+
+		fill(a, a_nodes);
+		fill(b, b_nodes);
+		a.union_with(b, parallel_depth);
+		check(a, union_values);
+		check(b, intersection_values);
+		for (auto & n : b) {
+			ASSERT_TRUE((&n >= &b_nodes.front()) && (&n <= &b_nodes.back()));
+		}
+
+		fill(a, a_nodes);
+		fill(b, b_nodes);
+		a.intersect_with(b, removed, parallel_depth);
+		check(a, intersection_values);
+		check(removed, difference_values);
+		ASSERT_EQ(b.size(), b_nodes.size());
+
+		fill(a, a_nodes);
+		a.difference_with(b, removed, parallel_depth);
+		check(a, difference_values);
+		check(removed, intersection_values);
+	}
+
+	// With multiple equal nodes, the union keeps all of them
+	std::vector<Node> multi_a(ZIPTREE_TESTSIZE);
+	std::vector<Node> multi_b(ZIPTREE_TESTSIZE / 2);
+	std::vector<Node> multi_c(ZIPTREE_TESTSIZE / 2);
+	ExplicitRankTree ma;
+	ExplicitRankTree mb;
+	ExplicitRankTree mc;
+	for (size_t i = 0; i < multi_a.size(); ++i) {
+		multi_a[i] = Node(static_cast<int>(i / 2), rank_distr(rng));
+		ma.insert(multi_a[i]);
+	}
+	for (size_t i = 0; i < multi_b.size(); ++i) {
+		multi_b[i] = Node(static_cast<int>(i), rank_distr(rng));
+		mb.insert(multi_b[i]);
+		multi_c[i] = Node(static_cast<int>(2 * i), rank_distr(rng));
+		mc.insert(multi_c[i]);
+	}
+
+	ma.union_with(mb, 2);
+	ma.dbg_verify();
+	ASSERT_TRUE(mb.empty());
+	ASSERT_EQ(ma.size(), multi_a.size() + multi_b.size());
+	int last = -1;
+	for (auto & n : ma) {
+		ASSERT_GE(n.data, last);
+		last = n.data;
+	}
+
+	// Remove all even values
+	ExplicitRankTree removed;
+	ma.difference_with(mc, removed);
+	ma.dbg_verify();
+	removed.dbg_verify();
+	ASSERT_EQ(ma.size(), (multi_a.size() + multi_b.size()) / 2);
+	ASSERT_EQ(removed.size(), (multi_a.size() + multi_b.size()) / 2);
+	for (auto & n : ma) {
+		ASSERT_EQ(n.data % 2, 1);
+	}
+}
+
+TEST(ZipTreeTest, EraseRangeTest)
+{
+	ExplicitRankTree tree;
+
+	std::vector<Node> nodes(ZIPTREE_TESTSIZE);
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::uniform_int_distribution<int> rank_distr(0, 7);
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		// Every value appears twice
+		nodes[i] = Node(static_cast<int>(i / 2), rank_distr(rng));
+		tree.insert(nodes[i]);
+	}
+
+	ExplicitRankTree removed;
+	tree.erase_range(100, 200, removed);
+	tree.dbg_verify();
+	removed.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE - 200);
+	ASSERT_EQ(removed.size(), 200);
+	for (auto & n : removed) {
+		ASSERT_GE(n.data, 100);
+		ASSERT_LT(n.data, 200);
+	}
+
+	tree.erase_range(300, 250, removed);
+	ASSERT_TRUE(removed.empty());
+
+	std::vector<int> disposed;
+	tree.erase_range(0, 50, [&](Node & n) { disposed.push_back(n.data); });
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE - 300);
+	ASSERT_EQ(disposed.size(), 100);
+	ASSERT_TRUE(std::is_sorted(disposed.begin(), disposed.end()));
+
+	int last = 50;
+	for (auto & n : tree) {
+		ASSERT_TRUE(((n.data >= 50) && (n.data < 100)) || (n.data >= 200));
+		ASSERT_GE(n.data, last);
+		last = n.data;
+	}
+}
+
+class RelativeLinkPool {
+public:
+	static void * base;
+
+	static void *
+	get_base() noexcept
+	{
+		return base;
+	}
+};
+void * RelativeLinkPool::base = nullptr;
+
+TEST(ZipTreeTest, PoolRelativeLinksTest)
+{
+	using RelativeOpt = TreeFlags::POOL_RELATIVE_LINKS<RelativeLinkPool>;
+	using MyNode = NodeBase<RelativeOpt>;
+	using Tree = ExplicitRankTreeBase<RelativeOpt>;
+
+	static_assert(sizeof(MyNode) < sizeof(Node));
+
+	std::vector<MyNode> nodes(ZIPTREE_TESTSIZE);
+	RelativeLinkPool::base = nodes.data();
+
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::uniform_int_distribution<int> rank_distr(0, 7);
+	std::vector<size_t> indices;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i] = MyNode(static_cast<int>(i), rank_distr(rng));
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(ZIPTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+	tree.dbg_verify();
+
+	int expected = 0;
+	for (auto & n : tree) {
+		ASSERT_EQ(n.data, expected);
+		expected++;
+	}
+	ASSERT_EQ(tree.find(17)->data, 17);
+
+	Tree right;
+	tree.split(static_cast<int>(ZIPTREE_TESTSIZE / 2), right);
+	tree.dbg_verify();
+	right.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE / 2);
+	tree.join(right);
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE);
+
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; i += 2) {
+		tree.remove(nodes[indices[i]]);
+	}
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), ZIPTREE_TESTSIZE / 2);
+}
+
+TEST(ZipTreeTest, NoParentPointersTest)
+{
+	using NoParentOpt = TreeFlags::NO_PARENT_POINTERS<>;
+	using MyNode = NodeBase<NoParentOpt>;
+	using Tree = ExplicitRankTreeBase<NoParentOpt>;
+
+	static_assert(sizeof(MyNode) + sizeof(Node *) == sizeof(Node));
+
+	// Every key appears twice, geometric ranks as in a proper zip tree
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::geometric_distribution<int> rank_distr(0.5);
+	std::vector<MyNode> nodes(ZIPTREE_TESTSIZE);
+	std::vector<size_t> indices;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		nodes[i] = MyNode(static_cast<int>(i / 2), rank_distr(rng));
+		indices.push_back(i);
+	}
+	std::shuffle(indices.begin(), indices.end(),
+	             ygg::testing::utilities::Randomizer(ZIPTREE_SEED));
+
+	Tree tree;
+	for (auto index : indices) {
+		tree.insert(nodes[index]);
+	}
+	tree.dbg_verify();
+
+	std::multiset<int> reference;
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		reference.insert(static_cast<int>(i / 2));
+	}
+
+	auto check_contents = [&]() {
+		tree.dbg_verify();
+		ASSERT_EQ(tree.size(), reference.size());
+
+		auto ref_it = reference.begin();
+		for (auto & n : tree) {
+			ASSERT_EQ(n.data, *ref_it);
+			++ref_it;
+		}
+
+		auto ref_rit = reference.rbegin();
+		for (auto it = tree.rbegin(); it != tree.rend(); ++it) {
+			ASSERT_EQ(it->data, *ref_rit);
+			++ref_rit;
+		}
+	};
+	check_contents();
+
+	for (int q = -1; q <= static_cast<int>(ZIPTREE_TESTSIZE / 2); ++q) {
+		auto lb = tree.lower_bound(q);
+		auto ub = tree.upper_bound(q);
+		auto ref_lb = reference.lower_bound(q);
+		auto ref_ub = reference.upper_bound(q);
+
+		ASSERT_EQ(lb == tree.end(), ref_lb == reference.end());
+		ASSERT_EQ(ub == tree.end(), ref_ub == reference.end());
+		if (ref_lb != reference.end()) {
+			ASSERT_EQ(lb->data, *ref_lb);
+		}
+		if (ref_ub != reference.end()) {
+			ASSERT_EQ(ub->data, *ref_ub);
+		}
+
+		auto found = tree.find(q);
+		if (reference.find(q) == reference.end()) {
+			ASSERT_EQ(found, tree.end());
+		} else {
+			// find() returns the first of the equal elements
+			ASSERT_EQ(found, lb);
+			++found;
+			ASSERT_EQ(found->data, q);
+			--found;
+			ASSERT_EQ(found, lb);
+		}
+	}
+
+	// iterator_to must find the right one among the equal nodes
+	for (auto & n : nodes) {
+		auto it = tree.iterator_to(n);
+		ASSERT_EQ(&(*it), &n);
+		if (&n != &(*tree.rbegin())) {
+			++it;
+			--it;
+			ASSERT_EQ(&(*it), &n);
+		}
+	}
+
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE / 4; ++i) {
+		MyNode & n = nodes[indices[i]];
+		reference.erase(reference.find(n.data));
+		if (i % 2 == 0) {
+			tree.remove(n);
+		} else {
+			ASSERT_EQ(tree.erase(tree.iterator_to(n)), &n);
+		}
+	}
+	check_contents();
+
+	Tree right;
+	tree.split(static_cast<int>(ZIPTREE_TESTSIZE / 4), right);
+	tree.dbg_verify();
+	right.dbg_verify();
+	ASSERT_TRUE(tree.rbegin()->data < static_cast<int>(ZIPTREE_TESTSIZE / 4));
+	ASSERT_EQ(right.begin()->data, static_cast<int>(ZIPTREE_TESTSIZE / 4));
+	tree.join(right);
+	check_contents();
+
+	std::vector<MyNode> sorted_nodes(ZIPTREE_TESTSIZE);
+	for (size_t i = 0; i < ZIPTREE_TESTSIZE; ++i) {
+		sorted_nodes[i] = MyNode(static_cast<int>(i), rank_distr(rng));
+	}
+	Tree built;
+	built.build_from_sorted(sorted_nodes.begin(), sorted_nodes.end());
+	built.dbg_verify();
+	int expected = 0;
+	for (auto & n : built) {
+		ASSERT_EQ(n.data, expected);
+		expected++;
+	}
+	ASSERT_EQ(built.erase(17), &sorted_nodes[17]);
+	ASSERT_EQ(built.find(17), built.end());
+
+	// Falls back to a regular insertion
+	MyNode extra(static_cast<int>(2 * ZIPTREE_TESTSIZE), 3);
+	auto handle = built.find_or_prepare_insert(extra.data);
+	ASSERT_FALSE(handle.found());
+	built.insert_at(handle, extra);
+	built.dbg_verify();
+	ASSERT_EQ(&(*built.rbegin()), &extra);
+}
+
+TEST(ZipTreeTest, NoParentPointersSTLEraseTest)
+{
+	using Options =
+	    ygg::TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+	                     TreeFlags::ZTREE_RANK_TYPE<int>, TreeFlags::STL_ERASE,
+	                     TreeFlags::NO_PARENT_POINTERS<>>;
+	class MyNode : public ZTreeNodeBase<MyNode, Options> {
+	public:
+		int data;
+		int rank;
+
+		bool
+		operator<(const MyNode & other) const
+		{
+			return this->data < other.data;
+		}
+	};
+	class MyRankGetter {
+	public:
+		static size_t
+		get_rank(const MyNode & n)
+		{
+			return static_cast<size_t>(n.rank);
+		}
+	};
+	using Tree = ZTree<MyNode, ZTreeDefaultNodeTraits<MyNode>, Options, int,
+	                   ygg::utilities::flexible_less, MyRankGetter>;
+
+	std::mt19937 rng(ZIPTREE_SEED);
+	std::geometric_distribution<int> rank_distr(0.5);
+	std::vector<MyNode> nodes(30);
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		nodes[i].data = static_cast<int>(i % 3);
+		nodes[i].rank = rank_distr(rng);
+	}
+
+	Tree tree;
+	for (auto & n : nodes) {
+		tree.insert(n);
+	}
+	tree.dbg_verify();
+
+	MyNode query;
+	query.data = 1;
+	ASSERT_EQ(tree.erase(query), 10);
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), 20);
+	ASSERT_EQ(tree.find(query), tree.end());
+
+	// Erasing through iterators must return valid iterators
+	auto it = tree.begin();
+	for (size_t i = 0; i < 10; ++i) {
+		ASSERT_EQ(it->data, 0);
+		it = tree.erase(it);
+	}
+	ASSERT_EQ(it, tree.begin());
+	ASSERT_EQ(it->data, 2);
+
+	auto rit = tree.rbegin();
+	for (size_t i = 0; i < 10; ++i) {
+		rit = tree.erase(rit);
+	}
+	ASSERT_EQ(rit, tree.rend());
+	ASSERT_TRUE(tree.empty());
+}
+
+TEST(ZipTreeTest, NoParentPointersDeepPathTest)
+{
+	using Options =
+	    ygg::TreeOptions<TreeFlags::MULTIPLE, TreeFlags::CONSTANT_TIME_SIZE,
+	                     TreeFlags::ZTREE_RANK_TYPE<int>,
+	                     TreeFlags::NO_PARENT_POINTERS<>>;
+	class MyNode : public ZTreeNodeBase<MyNode, Options> {
+	public:
+		int data;
+
+		bool
+		operator<(const MyNode & other) const
+		{
+			return this->data < other.data;
+		}
+	};
+	// Equal keys with equal ranks form a chain
+	class MyRankGetter {
+	public:
+		static size_t
+		get_rank(const MyNode &)
+		{
+			return 0;
+		}
+	};
+	using Tree = ZTree<MyNode, ZTreeDefaultNodeTraits<MyNode>, Options, int,
+	                   ygg::utilities::flexible_less, MyRankGetter>;
+
+	// Much deeper than the 48 nodes an iterator stores inline by default
+	std::vector<MyNode> nodes(400);
+	Tree tree;
+	for (auto & n : nodes) {
+		n.data = 0;
+		tree.insert(n);
+	}
+	tree.dbg_verify();
+
+	size_t count = 0;
+	for (auto it = tree.begin(); it != tree.end(); ++it) {
+		++count;
+	}
+	ASSERT_EQ(count, nodes.size());
+	count = 0;
+	for (auto it = tree.rbegin(); it != tree.rend(); ++it) {
+		++count;
+	}
+	ASSERT_EQ(count, nodes.size());
+
+	// Copies of deep iterators must step like the original
+	auto deep = tree.rbegin();
+	Tree::const_iterator<true> deep_copy = deep;
+	ASSERT_EQ(&(*deep_copy), &(*deep));
+	++deep;
+	++deep_copy;
+	ASSERT_EQ(&(*deep_copy), &(*deep));
+
+	tree.remove(nodes[nodes.size() / 2]);
+	tree.dbg_verify();
+	for (size_t i = 0; i < nodes.size() / 2; ++i) {
+		ASSERT_NE(tree.erase(tree.rbegin()), nullptr);
+	}
+	tree.dbg_verify();
+	ASSERT_EQ(tree.size(), nodes.size() / 2 - 1);
+	while (!tree.empty()) {
+		ASSERT_NE(tree.erase(tree.begin()), nullptr);
+	}
+}
+
 TEST(ZipTreeTest, EraseIteratorTest)
 {
 	ExplicitRankTree tree;